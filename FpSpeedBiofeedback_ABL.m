@@ -11,6 +11,9 @@ cd('C:\ABL_Documents\ABL User-Driven Treadmill Documents\TM_Controller_RTspeed')
 addpath(genpath('bin'));
 loadlibrary('treadmill0x2Dremote.dll','treadmill0x2Dremote.h');
 loadlibrary('Cortex_SDK.dll','MatlabCortex.h');
+if exist('CortexEngine.dll', 'file')
+    CortexSky('Load'); % Cortex commands and SDK2 relay off the control loop
+end
 fprintf('Loaded Libraries \n');
 
 % Input intial conditions
@@ -55,6 +58,7 @@ Settings.PauseB4 = 'No';
 % Settings.Biofeedback = 'none';
 Settings.Biofeedback = 'Time';
 Settings.FrameRate = frameRate; 
+Settings.FillGaps = 'Yes'; % interpolate short gaps in the frame sequence
 
 % run TM
 [WarmUpData] = FixedSpeedTM(Settings);
@@ -245,6 +249,7 @@ end
 
 
 %% Export Results?
+CortexSky('Unload');
 exitValue = mCortexExit();
 FileName = strcat(SubjName, '.mat'); 
 save(FileName)
@@ -1,10 +1,17 @@
 function [FpData] = AnalyzeFp(InputData, bodyMass, PlotFp)
 
 %% extract propulsive force from data structure
-Ry = [InputData.F1Y];
-Rz = [InputData.F1Z];
-Ly = [InputData.F2Y];
-Lz = [InputData.F2Z];
+if isscalar(InputData) % TrialLog's columns: frames x samples
+    Ry = reshape(InputData.F1Y', 1, []);
+    Rz = reshape(InputData.F1Z', 1, []);
+    Ly = reshape(InputData.F2Y', 1, []);
+    Lz = reshape(InputData.F2Z', 1, []);
+else
+    Ry = [InputData.F1Y];
+    Rz = [InputData.F1Z];
+    Ly = [InputData.F2Y];
+    Lz = [InputData.F2Z];
+end
 
 %% Find Peaks
 PkProm = bodyMass * 1.5; % threshold peak prominence
@@ -0,0 +1,98 @@
+function [KF] = BodyPositionKF(KF, Meas, dt)
+% Kalman filter for fore/aft body position and velocity on the treadmill
+% KF is the filter from the previous frame (start with [] or a struct
+% holding only KF.Params to override the defaults below)
+% Meas holds the frame means CoP1y, CoP2y, F1Z, F2Z and optionally
+% Marker, a fore/aft pelvis marker position in m (NaN when missing)
+% dt is the time since the previous frame (s)
+% KF.Pos and KF.Vel hold the filtered position (m) and velocity (m/s)
+%
+% The force-weighted CoP of both plates oscillates about the body center
+% within each step, so it is fused as a noisy measurement of position,
+% trusted more in double support. Frames with no foot loaded only
+% predict. Constant velocity model, two states, scalar updates.
+
+%% default parameters
+if isempty(KF) || ~isfield(KF, 'x')
+    Params.Thresh = 25; % threshold for determining if a true vGRF
+    Params.AccelNoise = 1.0; % process noise, (m/s^2)^2 per Hz
+    Params.DoubleStd = 0.05; % CoP measurement noise in double support (m)
+    Params.SingleStd = 0.15; % CoP measurement noise in single support (m)
+    Params.MarkerStd = 0.01; % marker measurement noise (m)
+    if isstruct(KF) && isfield(KF, 'Params')
+        Fields = fieldnames(KF.Params);
+        for i = 1:length(Fields)
+            Params.(Fields{i}) = KF.Params.(Fields{i});
+        end
+    end
+    KF = struct();
+    KF.Params = Params;
+    KF.x = [NaN; 0]; % [position; velocity]
+    KF.P = diag([1, 1]);
+    KF.Pos = NaN;
+    KF.Vel = 0;
+end
+Params = KF.Params;
+
+%% force-weighted CoP measurement
+On1 = Meas.F1Z > Params.Thresh;
+On2 = Meas.F2Z > Params.Thresh;
+if On1 && On2
+    z = (Meas.F1Z * Meas.CoP1y + Meas.F2Z * Meas.CoP2y) / (Meas.F1Z + Meas.F2Z);
+    R = Params.DoubleStd^2;
+elseif On1
+    z = Meas.CoP1y;
+    R = Params.SingleStd^2;
+elseif On2
+    z = Meas.CoP2y;
+    R = Params.SingleStd^2;
+else
+    z = NaN;
+    R = NaN;
+end
+
+Marker = NaN;
+if isfield(Meas, 'Marker')
+    Marker = Meas.Marker;
+end
+
+%% initialize on first measurement
+if isnan(KF.x(1))
+    if ~isnan(Marker)
+        KF.x(1) = Marker;
+    elseif ~isnan(z)
+        KF.x(1) = z;
+    else
+        return
+    end
+    KF.Pos = KF.x(1);
+    return
+end
+
+%% predict
+q = Params.AccelNoise;
+F = [1 dt; 0 1];
+Q = q .* [dt^3/3, dt^2/2; dt^2/2, dt];
+KF.x = F * KF.x;
+KF.P = F * KF.P * F' + Q;
+
+%% update with each available measurement (H = [1 0])
+if ~isnan(z)
+    KF = ScalarUpdate(KF, z, R);
+end
+if ~isnan(Marker)
+    KF = ScalarUpdate(KF, Marker, Params.MarkerStd^2);
+end
+
+KF.Pos = KF.x(1);
+KF.Vel = KF.x(2);
+
+end
+
+function [KF] = ScalarUpdate(KF, z, R)
+% position measurement update
+S = KF.P(1,1) + R;
+K = KF.P(:,1) ./ S;
+KF.x = KF.x + K .* (z - KF.x(1));
+KF.P = KF.P - K * KF.P(1,:);
+end
@@ -0,0 +1,79 @@
+function [Results] = CompareSelfPace(Settings, Variants, Scenarios)
+% Runs controller variants through the same simulated scenarios and
+% tabulates how they settle, oscillate and track Fp (see SimulateSelfPace)
+%
+% Settings  - base settings of SimulateSelfPace
+% Variants  - struct array, Name plus the Settings fields that make the
+%             variant, e.g. Controller, PositionEstimate or Ctrl
+% Scenarios - struct array, Name plus the Settings fields of the
+%             scenario, e.g. Walker (speed schedule), Host (drops,
+%             jitter), PlantLatency or Seed; [] runs Settings alone
+% Empty fields are left out. Results(v,s) holds the summary metrics of
+% variant v in scenario s
+%
+% Example:
+%   S = struct('Duration',300, 'FrameRate',100, 'StartSpeed',1.0);
+%   V = struct('Name',{'Linear','Predictive'}, ...
+%       'Controller',{'Linear','Predictive'});
+%   C = struct('Name',{'Steady','Speed up'}, 'Walker',{ ...
+%       struct('Schedule',[0 1.2]), struct('Schedule',[0 1.0; 60 1.4])});
+%   R = CompareSelfPace(S, V, C);
+
+if nargin < 3 || isempty(Scenarios)
+    Scenarios = struct('Name', 'Base');
+end
+Metrics = {'SettlingTime','Overshoot','Reversals','PosRMS','TimeOutside', ...
+    'SpeedRMS','FpError','CommandRate'};
+
+Results = struct([]);
+for v = 1:length(Variants)
+    for s = 1:length(Scenarios)
+        Run = Merge(Merge(Settings, Scenarios(s)), Variants(v));
+        Sim = SimulateSelfPace(Run);
+        R.Variant = Variants(v).Name;
+        R.Scenario = Scenarios(s).Name;
+        for m = 1:length(Metrics)
+            R.(Metrics{m}) = Sim.(Metrics{m});
+        end
+        R.Settle = Sim.Settle;
+        if isempty(Results)
+            Results = R;
+        else
+            Results(v,s) = R;
+        end
+    end
+end
+
+%% means over scenarios, one row per variant
+fprintf('%-16s %8s %9s %9s %7s %8s %8s %8s\n', 'Variant', 'Settle s', ...
+    'Overshoot', 'Rev/min', 'PosRMS', 'SpeedRMS', 'FpErr N', 'Cmd/s');
+for v = 1:length(Variants)
+    Row = Results(v,:);
+    fprintf('%-16s %8.2f %9.3f %9.1f %7.3f %8.3f %8.2f %8.1f\n', ...
+        Variants(v).Name, mean([Row.SettlingTime]), mean([Row.Overshoot]), ...
+        mean([Row.Reversals]), mean([Row.PosRMS]), mean([Row.SpeedRMS]), ...
+        mean([Row.FpError]), mean([Row.CommandRate]));
+end
+
+end
+
+function [S] = Merge(S, Over)
+% fields of Over into S; Ctrl, Walker and Host are merged field by field
+Fields = fieldnames(Over);
+for i = 1:length(Fields)
+    Name = Fields{i};
+    if strcmp(Name, 'Name') || isempty(Over.(Name))
+        continue
+    end
+    if any(strcmp(Name, {'Ctrl','Walker','Host'})) && isfield(S, Name) ...
+            && isstruct(Over.(Name))
+        Sub = fieldnames(Over.(Name));
+        for j = 1:length(Sub)
+            S.(Name).(Sub{j}) = Over.(Name).(Sub{j});
+        end
+    else
+        S.(Name) = Over.(Name);
+    end
+end
+
+end
@@ -0,0 +1,102 @@
+function [Cd, Events] = ContactDetect(Action, Cd, varargin)
+% Foot contact on every analog sample of every plate at once, with
+% hysteresis, and heel strike and toe-off times interpolated between
+% samples
+%
+% Cd = ContactDetect('Init', FrameRate, On, Off)
+%   contact begins when vertical force rises above On (N, default 25)
+%   and ends when it falls below Off (N, default 15)
+% [Cd, Events] = ContactDetect('Frame', Cd, Fz, FrameTime)
+%   Fz is plates x samples of the frame's vertical force, FrameTime the
+%   timeline time of its last sample; the others are 1/(samples x
+%   FrameRate) apart, and the last sample of the previous frame precedes
+%   them, so crossings at frame boundaries and across gaps are timed too
+%
+% After a frame: Cd.On (plates x 1) is contact at its last sample,
+% Cd.Mask (plates x samples) contact at each sample, Cd.Strike and
+% Cd.Off (1 x plates) the heel strike and toe-off times within it (NaN
+% if none). Events, in time order, has Plate, Type ('HeelStrike' or
+% 'ToeOff') and Time.
+%
+% A crossing is placed by linear interpolation between the two samples
+% around it, so event times are sub-sample; a frame is classified as it
+% arrives, at no added latency.
+
+Events = struct('Plate',{}, 'Type',{}, 'Time',{});
+switch Action
+
+    case 'Init'
+        FrameRate = Cd;
+        Cd = struct();
+        Cd.FrameRate = FrameRate;
+        Cd.OnThresh = 25;
+        if ~isempty(varargin) && ~isempty(varargin{1})
+            Cd.OnThresh = varargin{1};
+        end
+        Cd.OffThresh = 15;
+        if length(varargin) > 1 && ~isempty(varargin{2})
+            Cd.OffThresh = varargin{2};
+        end
+        Cd.On = [];
+        Cd.Last = [];
+        Cd.LastTime = NaN;
+        Cd.Mask = [];
+        Cd.Strike = [];
+        Cd.Off = [];
+
+    case 'Frame'
+        Fz = varargin{1};
+        FrameTime = varargin{2};
+        [P, n] = size(Fz);
+        t = FrameTime + ((1:n) - n) ./ (n * Cd.FrameRate);
+        if isempty(Cd.On)
+            % feet already down at the start make no heel strike
+            Cd.On = Fz(:,1) > Cd.OnThresh;
+            Cd.Last = Fz(:,1);
+            Cd.LastTime = t(1) - 1 / (n * Cd.FrameRate);
+        end
+
+        % previous sample first; each sample above On or below Off decides
+        % the state, the ones between hold the last decision
+        F = [Cd.Last, Fz];
+        T = [Cd.LastTime, t];
+        Code = (F > Cd.OnThresh) - (F < Cd.OffThresh);
+        Code(:,1) = 2 * Cd.On - 1;
+        Decided = cummax(repmat(1:n+1, P, 1) .* (Code ~= 0), 2);
+        State = Code(sub2ind([P, n+1], repmat((1:P)', 1, n+1), Decided)) > 0;
+
+        Rise = State(:,2:end) & ~State(:,1:end-1);
+        Fall = ~State(:,2:end) & State(:,1:end-1);
+        [p, j] = find(Rise | Fall);
+        p = p(:);
+        j = j(:);
+        IsRise = reshape(Rise(sub2ind([P, n], p, j)), [], 1);
+        Thresh = Cd.OffThresh + IsRise .* (Cd.OnThresh - Cd.OffThresh);
+        F0 = reshape(F(sub2ind([P, n+1], p, j)), [], 1);
+        F1 = reshape(F(sub2ind([P, n+1], p, j+1)), [], 1);
+        T0 = reshape(T(j), [], 1);
+        Time = T0 + (Thresh - F0) ./ (F1 - F0) .* (reshape(T(j+1), [], 1) - T0);
+
+        Cd.Strike = NaN(1, P);
+        Cd.Off = NaN(1, P);
+        [Time, Order] = sort(Time);
+        Types = {'ToeOff', 'HeelStrike'};
+        for i = 1:length(Order)
+            e = Order(i);
+            Events(i) = struct('Plate',p(e), 'Type',Types{IsRise(e) + 1}, ...
+                'Time',Time(i)); %#ok<AGROW>
+            if IsRise(e)
+                Cd.Strike(p(e)) = Time(i);
+            else
+                Cd.Off(p(e)) = Time(i);
+            end
+        end
+
+        Cd.Mask = State(:,2:end);
+        Cd.On = State(:,end);
+        Cd.Last = Fz(:,end);
+        Cd.LastTime = t(end);
+
+end
+
+end
@@ -0,0 +1,930 @@
+/*=========================================================
+//
+// File: CortexEngine.cpp
+//
+// C interface of the Cortex engine, see CortexEngine.h
+//
+=============================================================================*/
+
+#include "CortexEngine.h"
+
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifndef _WIN32
+#include <dlfcn.h>
+#endif
+
+#include "treadmill0x2Dremote.h"
+
+#include "FrameRelay.h"
+#include "FrameRing.h"
+#include "Metrics.h"
+#include "MetricsServer.h"
+#include "SegmentEuler.h"
+#include "SignalMonitor.h"
+#include "SkyQueue.h"
+#include "Trace.h"
+#include "TrialExport.h"
+#include "TreadmillLink.h"
+#include "TrialRecorder.h"
+#include "Watchdog.h"
+
+using namespace CortexEngine;
+
+namespace
+{
+
+// created by CortexEngine_Initialize; threads must not be started or
+// joined from static constructors or destructors of a DLL
+std::mutex g_Mutex;
+// shared so that SkyWait and RequestWait can wait outside g_Mutex
+std::shared_ptr<SkyQueue> g_pSky;
+
+void (*g_SkyHandler)(int iTicket, int iReturnCode) = NULL;
+
+// frame consumers, called from the SDK's data thread
+std::mutex g_FrameMutex;
+FrameRelay* g_pRelay = NULL;
+// shared so that RecorderExport can write it outside g_Mutex
+std::shared_ptr<TrialRecorder> g_pRecorder;
+SignalMonitor* g_pMonitor = NULL;
+// shared so that RingWait can hold the ring while RingStop runs
+std::shared_ptr<FrameRing> g_pRing;
+int g_usRingSpin = 0;
+// kept after WatchdogStop for its status, replaced by the next start
+Watchdog* g_pWatchdog = NULL;
+int (*g_WatchdogStop)(double, double, double) = NULL;
+// kept after TreadmillClose for its counts; shared with the watchdog's
+// stop command
+std::shared_ptr<TreadmillLink> g_pTreadmill;
+
+// atomics only, fed without locks; the server is started and stopped
+// under g_Mutex
+Metrics g_Metrics;
+MetricsServer* g_pMetricsServer = NULL;
+
+// frame times are seconds since CortexEngine_Initialize
+std::chrono::steady_clock::time_point g_Start;
+
+/** ns of steady_clock, the time base of Metrics */
+long long SteadyNs(std::chrono::steady_clock::time_point Time)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Time.time_since_epoch()).count();
+}
+
+void FrameHandler(sFrameOfData* pFrameOfData)
+{
+    if (!pFrameOfData)
+        return;
+    const long long TraceBegin = Trace::Now();
+    if (TraceBegin >= 0)
+    {
+        static thread_local bool bNamed = false;
+        if (!bNamed)
+            Trace::NameThread("Cortex data");
+        bNamed = true;
+    }
+    const int iFrame = pFrameOfData->iFrame;
+    const std::chrono::steady_clock::time_point Arrival = std::chrono::steady_clock::now();
+    const long long ArrivalNs = SteadyNs(Arrival);
+    g_Metrics.OnFrame(iFrame, pFrameOfData->fDelay, ArrivalNs);
+    double Time = std::chrono::duration<double>(Arrival - g_Start).count();
+    std::lock_guard<std::mutex> Lock(g_FrameMutex);
+    // recorded before the lock is released, TraceStart takes it
+    TraceScope Callback(TRACE_CALLBACK, iFrame, TraceBegin);
+    if (g_pRing)
+    {
+        TraceScope Span(TRACE_RING, iFrame);
+        g_pRing->Push(*pFrameOfData, Time);
+    }
+    if (g_pRecorder)
+    {
+        TraceScope Span(TRACE_RECORD, iFrame);
+        g_pRecorder->OnFrame(*pFrameOfData, Time);
+    }
+    if (g_pMonitor)
+    {
+        TraceScope Span(TRACE_MONITOR, iFrame);
+        g_pMonitor->OnFrame(*pFrameOfData, Time);
+    }
+    if (g_pRelay)
+    {
+        TraceScope Span(TRACE_RELAY, iFrame);
+        g_pRelay->OnFrame(pFrameOfData);
+    }
+    if (g_pWatchdog)
+        g_pWatchdog->OnFrame();
+    g_Metrics.OnHandler(SteadyNs(std::chrono::steady_clock::now()) - ArrivalNs);
+}
+
+std::shared_ptr<FrameRing> Ring()
+{
+    std::lock_guard<std::mutex> Lock(g_FrameMutex);
+    return g_pRing;
+}
+
+std::shared_ptr<SkyQueue> Sky()
+{
+    std::lock_guard<std::mutex> Lock(g_Mutex);
+    return g_pSky;
+}
+
+/** The treadmill link, backed by TREADMILL_setSpeed of the treadmill
+ *  library MATLAB loaded, unless CortexEngine_WatchdogSetStopFunc gave
+ *  another command; under g_Mutex */
+BeltCommand StopCommand()
+{
+    if (g_WatchdogStop)
+        return BeltCommand(g_WatchdogStop);
+    t_TREADMILL_setSpeed pSetSpeed = NULL;
+#ifdef _WIN32
+    HMODULE hTreadmill = GetModuleHandleA("treadmill0x2Dremote.dll");
+    if (hTreadmill)
+        pSetSpeed = (t_TREADMILL_setSpeed)GetProcAddress(hTreadmill, "TREADMILL_setSpeed");
+#else
+    pSetSpeed = (t_TREADMILL_setSpeed)dlsym(RTLD_DEFAULT, "TREADMILL_setSpeed");
+#endif
+    std::shared_ptr<TreadmillLink> pLink = g_pTreadmill;
+    if (!pLink)
+        return pSetSpeed ? BeltCommand(pSetSpeed) : BeltCommand();
+    // the link does not block; the library still gets the stop through if
+    // the link is closed or reconnecting
+    return [pLink, pSetSpeed](double Left, double Right, double Accel)
+    {
+        int iResult = pLink->SetSpeed(Left, Right, Accel);
+        if (iResult != TREADMILL_OK && pSetSpeed)
+            iResult = pSetSpeed(Left, Right, Accel);
+        return iResult;
+    };
+}
+
+void SkyHandler(const SkyResult& R)
+{
+    if (g_SkyHandler)
+        g_SkyHandler(R.iTicket, R.iReturnCode);
+}
+
+int CollectSky(int iTicket, int msTimeout, int* pReturnCode, sSkyReturn* pSkyReturn)
+{
+    std::shared_ptr<SkyQueue> pSky = Sky();
+    if (!pSky)
+        return -RC_ApiError;
+    SkyResult R;
+    int iDone = pSky->Collect(iTicket, msTimeout, &R);
+    if (iDone < 0)
+        return -RC_ApiError;
+    if (iDone > 0 && pReturnCode)
+        *pReturnCode = R.iReturnCode;
+    if (iDone > 0 && pSkyReturn)
+        *pSkyReturn = R.Sky;
+    return iDone;
+}
+
+int CollectRequest(int iTicket, int msTimeout, int* pReturnCode,
+                   void* pResponse, int nBytes, int* pnBytes)
+{
+    std::shared_ptr<SkyQueue> pSky = Sky();
+    if (!pSky)
+        return -RC_ApiError;
+    SkyResult R;
+    int iDone = pSky->Collect(iTicket, msTimeout, &R);
+    if (iDone < 0)
+        return -RC_ApiError;
+    if (iDone > 0)
+    {
+        int n = (int)R.Response.size();
+        if (pReturnCode)
+            *pReturnCode = R.iReturnCode;
+        if (pnBytes)
+            *pnBytes = n;
+        if (pResponse && nBytes > 0 && n > 0)
+            std::memcpy(pResponse, &R.Response[0], n < nBytes ? n : nBytes);
+    }
+    return iDone;
+}
+
+} // namespace
+
+//==================================================================
+
+int CortexEngine_Initialize()
+{
+    std::lock_guard<std::mutex> Lock(g_Mutex);
+    if (g_pSky)
+        return RC_ApiError;
+    g_Start = std::chrono::steady_clock::now();
+    Trace::SetEpoch(g_Start);
+    g_pSky.reset(new SkyQueue());
+    g_pSky->SetHandler(SkyHandler);
+    g_pSky->Start();
+    Cortex_SetDataHandlerFunc(FrameHandler);
+    return RC_Okay;
+}
+
+int CortexEngine_Exit()
+{
+    std::lock_guard<std::mutex> Lock(g_Mutex);
+    if (!g_pSky)
+        return RC_ApiError;
+    Cortex_SetDataHandlerFunc(NULL);
+    {
+        std::lock_guard<std::mutex> FrameLock(g_FrameMutex);
+        Trace::Stop();
+        delete g_pWatchdog;
+        g_pWatchdog = NULL;
+        delete g_pRelay;
+        g_pRelay = NULL;
+        g_pRecorder.reset();
+        delete g_pMonitor;
+        g_pMonitor = NULL;
+        if (g_pRing)
+            g_pRing->Close();
+        g_pRing.reset();
+    }
+    delete g_pMetricsServer;
+    g_pMetricsServer = NULL;
+    if (g_pTreadmill)
+        g_pTreadmill->Close();
+    // a wait still holding the queue returns by its timeout; its ticket
+    // is answered before the worker stops
+    g_pSky->Stop();
+    g_pSky.reset();
+    return RC_Okay;
+}
+
+//==================================================================
+
+int CortexEngine_SkySubmit(char* szCommand, int msTimeout)
+{
+    std::lock_guard<std::mutex> Lock(g_Mutex);
+    if (!g_pSky || !szCommand)
+        return -RC_ApiError;
+    return g_pSky->SubmitSky(szCommand, msTimeout);
+}
+
+int CortexEngine_RequestSubmit(char* szCommand)
+{
+    std::lock_guard<std::mutex> Lock(g_Mutex);
+    if (!g_pSky || !szCommand)
+        return -RC_ApiError;
+    return g_pSky->SubmitRequest(szCommand);
+}
+
+int CortexEngine_SkyPoll(int iTicket, int* pReturnCode, sSkyReturn* pSkyReturn)
+{
+    return CollectSky(iTicket, 0, pReturnCode, pSkyReturn);
+}
+
+int CortexEngine_SkyWait(int iTicket, int msTimeout, int* pReturnCode, sSkyReturn* pSkyReturn)
+{
+    return CollectSky(iTicket, msTimeout, pReturnCode, pSkyReturn);
+}
+
+int CortexEngine_RequestPoll(int iTicket, int* pReturnCode, void* pResponse, int nBytes, int* pnBytes)
+{
+    return CollectRequest(iTicket, 0, pReturnCode, pResponse, nBytes, pnBytes);
+}
+
+int CortexEngine_RequestWait(int iTicket, int msTimeout, int* pReturnCode, void* pResponse, int nBytes, int* pnBytes)
+{
+    return CollectRequest(iTicket, msTimeout, pReturnCode, pResponse, nBytes, pnBytes);
+}
+
+int CortexEngine_SetSkyHandlerFunc(void (*MyFunction)(int iTicket, int iReturnCode))
+{
+    g_SkyHandler = MyFunction;
+    return RC_Okay;
+}
+
+int CortexEngine_SetCacheable(char* szCommand, int bCacheable)
+{
+    std::lock_guard<std::mutex> Lock(g_Mutex);
+    if (!g_pSky || !szCommand)
+        return RC_ApiError;
+    g_pSky->SetCacheable(szCommand, bCacheable != 0);
+    return RC_Okay;
+}
+
+int CortexEngine_ClearCache()
+{
+    std::lock_guard<std::mutex> Lock(g_Mutex);
+    if (!g_pSky)
+        return RC_ApiError;
+    g_pSky->ClearCache();
+    return RC_Okay;
+}
+
+int CortexEngine_SkyPending()
+{
+    std::lock_guard<std::mutex> Lock(g_Mutex);
+    if (!g_pSky)
+        return 0;
+    return g_pSky->Pending();
+}
+
+//==================================================================
+
+int CortexEngine_RelayEnable()
+{
+    Cortex_SetClientCommunicationEnabled(1);
+    return RC_Okay;
+}
+
+int CortexEngine_RelayStart()
+{
+    std::lock_guard<std::mutex> Lock(g_Mutex);
+    if (!g_pSky || !Cortex_IsClientCommunicationEnabled())
+        return RC_ApiError;
+    std::lock_guard<std::mutex> FrameLock(g_FrameMutex);
+    if (!g_pRelay)
+        g_pRelay = new FrameRelay();
+    return RC_Okay;
+}
+
+int CortexEngine_RelayStop()
+{
+    std::lock_guard<std::mutex> FrameLock(g_FrameMutex);
+    if (!g_pRelay)
+        return RC_ApiError;
+    delete g_pRelay;
+    g_pRelay = NULL;
+    return RC_Okay;
+}
+
+int CortexEngine_RelaySetState(float fSpeed, float fFp)
+{
+    // no frame lock: the state is atomic and the relay and recorder are
+    // only deleted by their Stop and by Exit, on the caller's own thread
+    FrameRelay* pRelay = g_pRelay;
+    TrialRecorder* pRecorder = g_pRecorder.get();
+    g_Metrics.SetState(fSpeed, fFp);
+    if (!pRelay && !pRecorder)
+        return RC_ApiError;
+    if (pRelay)
+        pRelay->SetState(fSpeed, fFp);
+    if (pRecorder)
+        pRecorder->SetState(fSpeed, fFp);
+    return RC_Okay;
+}
+
+int CortexEngine_RelayStats(int* pnForwarded, int* pnRepeated, int* pnFailed, double* pMeanMicros, double* pMaxMicros)
+{
+    std::lock_guard<std::mutex> FrameLock(g_FrameMutex);
+    if (!g_pRelay)
+        return RC_ApiError;
+    RelayStats S = g_pRelay->Stats();
+    if (pnForwarded) *pnForwarded = S.nForwarded;
+    if (pnRepeated) *pnRepeated = S.nRepeated;
+    if (pnFailed) *pnFailed = S.nFailed;
+    if (pMeanMicros) *pMeanMicros = S.MeanMicros;
+    if (pMaxMicros) *pMaxMicros = S.MaxMicros;
+    return RC_Okay;
+}
+
+//==================================================================
+// Frame ring and trial recorder
+
+int CortexEngine_RingStart(int nSlots, int nMaxMarkers, int nMaxAnalog, int nMaxForces)
+{
+    std::lock_guard<std::mutex> Lock(g_Mutex);
+    if (!g_pSky)
+        return RC_ApiError;
+    RingLimits Limits;
+    Limits.nSlots = nSlots;
+    Limits.nMaxMarkers = nMaxMarkers;
+    Limits.nMaxAnalog = nMaxAnalog;
+    Limits.nMaxForces = nMaxForces;
+    // allocate outside the frame lock, the data thread is waiting on it
+    std::shared_ptr<FrameRing> pRing(new FrameRing(Limits));
+    pRing->SetSpin(g_usRingSpin);
+    std::lock_guard<std::mutex> FrameLock(g_FrameMutex);
+    if (g_pRing)
+        g_pRing->Close();
+    g_pRing = pRing;
+    return RC_Okay;
+}
+
+int CortexEngine_RingStop()
+{
+    std::lock_guard<std::mutex> FrameLock(g_FrameMutex);
+    if (!g_pRing)
+        return RC_ApiError;
+    g_pRing->Close();
+    g_pRing.reset();
+    return RC_Okay;
+}
+
+int CortexEngine_RingLayout(int* pnSlots, int* pnMaxMarkers, int* pnMaxAnalog, int* pnMaxForces,
+                            sRingFrame** ppHeaders, float** ppMarkers, short** ppAnalog, float** ppForces)
+{
+    std::shared_ptr<FrameRing> pRing = Ring();
+    if (!pRing)
+        return RC_ApiError;
+    const RingLimits& L = pRing->Limits();
+    if (pnSlots) *pnSlots = L.nSlots;
+    if (pnMaxMarkers) *pnMaxMarkers = L.nMaxMarkers;
+    if (pnMaxAnalog) *pnMaxAnalog = L.nMaxAnalog;
+    if (pnMaxForces) *pnMaxForces = L.nMaxForces;
+    if (ppHeaders) *ppHeaders = pRing->Headers();
+    if (ppMarkers) *ppMarkers = pRing->Markers();
+    if (ppAnalog) *ppAnalog = pRing->Analog();
+    if (ppForces) *ppForces = pRing->Forces();
+    return RC_Okay;
+}
+
+void* CortexEngine_RingAcquire()
+{
+    std::shared_ptr<FrameRing> pRing = Ring();
+    return pRing ? new std::shared_ptr<FrameRing>(pRing) : NULL;
+}
+
+int CortexEngine_RingRelease(void* pHandle)
+{
+    if (!pHandle)
+        return RC_ApiError;
+    delete static_cast<std::shared_ptr<FrameRing>*>(pHandle);
+    return RC_Okay;
+}
+
+long long CortexEngine_RingHead()
+{
+    std::shared_ptr<FrameRing> pRing = Ring();
+    return pRing ? pRing->Head() : 0;
+}
+
+long long CortexEngine_RingWait(long long iSeq, int msTimeout)
+{
+    std::shared_ptr<FrameRing> pRing = Ring();
+    if (!pRing)
+        return -1;
+    long long iHead = pRing->Wait(iSeq, msTimeout);
+    return Ring() == pRing ? iHead : -1;
+}
+
+int CortexEngine_RingSetSpin(int usSpin)
+{
+    g_usRingSpin = usSpin < 0 ? FrameSignal::SPIN_ALWAYS : usSpin;
+    std::shared_ptr<FrameRing> pRing = Ring();
+    if (pRing)
+        pRing->SetSpin(g_usRingSpin);
+    return RC_Okay;
+}
+
+int CortexEngine_RingValid(long long iSeq)
+{
+    std::shared_ptr<FrameRing> pRing = Ring();
+    return pRing && pRing->Valid(iSeq) ? 1 : 0;
+}
+
+int CortexEngine_RingDrain(long long iSince, int nMaxFrames,
+                           int* piChannels, int nChannels, int nMaxSamples,
+                           int* piMarkers, int nMarkers,
+                           double* pInfo, double* pAnalog, double* pMarkers)
+{
+    std::shared_ptr<FrameRing> pRing = Ring();
+    if (!pRing)
+        return -RC_ApiError;
+    if (nMaxFrames <= 0)
+        return 0;
+    if (!piChannels || nMaxSamples <= 0)
+        nChannels = 0;
+    if (!piMarkers)
+        nMarkers = 0;
+    return pRing->Drain(iSince, nMaxFrames, piChannels, nChannels, nMaxSamples,
+                        piMarkers, nMarkers, pInfo, pAnalog, pMarkers);
+}
+
+int CortexEngine_RecorderStart(int nRows)
+{
+    std::lock_guard<std::mutex> Lock(g_Mutex);
+    if (!g_pSky || nRows <= 0)
+        return RC_ApiError;
+    std::shared_ptr<TrialRecorder> pRecorder(new TrialRecorder(nRows));
+    std::shared_ptr<TrialRecorder> pOld;
+    {
+        std::lock_guard<std::mutex> FrameLock(g_FrameMutex);
+        pOld = g_pRecorder;
+        g_pRecorder = pRecorder;
+    }
+    return RC_Okay; // pOld is released, unless an export still holds it
+}
+
+int CortexEngine_RecorderStop()
+{
+    // an export in progress keeps the recorder until it is done
+    std::lock_guard<std::mutex> Lock(g_Mutex);
+    std::shared_ptr<TrialRecorder> pOld;
+    {
+        std::lock_guard<std::mutex> FrameLock(g_FrameMutex);
+        pOld.swap(g_pRecorder);
+    }
+    return pOld ? RC_Okay : RC_ApiError;
+}
+
+int CortexEngine_RecorderColumns(double** ppData, int* pnCapacity, int* pnColumns)
+{
+    std::lock_guard<std::mutex> FrameLock(g_FrameMutex);
+    if (!g_pRecorder)
+        return RC_ApiError;
+    if (ppData) *ppData = const_cast<double*>(g_pRecorder->Data());
+    if (pnCapacity) *pnCapacity = g_pRecorder->Capacity();
+    if (pnColumns) *pnColumns = REC_N_COLUMNS;
+    return RC_Okay;
+}
+
+void* CortexEngine_RecorderAcquire()
+{
+    std::lock_guard<std::mutex> FrameLock(g_FrameMutex);
+    return g_pRecorder ? new std::shared_ptr<TrialRecorder>(g_pRecorder) : NULL;
+}
+
+int CortexEngine_RecorderRelease(void* pHandle)
+{
+    if (!pHandle)
+        return RC_ApiError;
+    delete static_cast<std::shared_ptr<TrialRecorder>*>(pHandle);
+    return RC_Okay;
+}
+
+int CortexEngine_RecorderRows(int* pnDropped)
+{
+    // no frame lock, so polling does not hold up the data thread
+    TrialRecorder* pRecorder = g_pRecorder.get();
+    if (!pRecorder)
+        return 0;
+    if (pnDropped)
+        *pnDropped = pRecorder->Dropped();
+    return pRecorder->Rows();
+}
+
+const char* CortexEngine_RecorderColumnName(int iColumn)
+{
+    return RecorderColumnName(iColumn);
+}
+
+int CortexEngine_RecorderExport(char* szPath)
+{
+    // the shared recorder outlives a RecorderStop or RecorderStart during
+    // the export, which holds neither g_Mutex nor the data thread's lock
+    std::shared_ptr<TrialRecorder> pRecorder;
+    {
+        std::lock_guard<std::mutex> Lock(g_Mutex);
+        pRecorder = g_pRecorder;
+    }
+    if (!pRecorder)
+        return -RC_ApiError;
+    long long n = ExportRecorder(*pRecorder, szPath);
+    return n < 0 ? -RC_ApiError : (int)n;
+}
+
+int CortexEngine_ExportTrialLog(char* szLog, char* szPath)
+{
+    long long n = ExportTrialLog(szLog, szPath);
+    return n < 0 || n > 0x7FFFFFFF ? -RC_ApiError : (int)n;
+}
+
+//==================================================================
+// Batch Euler angle conversions
+
+int CortexEngine_SegmentMatrices(double* pSegments, int nSegments, int iRotationOrder, double* pMatrices)
+{
+    if (nSegments < 0 || (nSegments > 0 && (!pSegments || !pMatrices)))
+        return RC_ApiError;
+    // aX, aY, aZ start at element 3 of each tSegmentData
+    const int nStride = sizeof(tSegmentData) / sizeof(double);
+    return Euler::Matrices(iRotationOrder, pSegments + 3, nStride, nSegments, pMatrices)
+        ? RC_Okay : RC_ApiError;
+}
+
+int CortexEngine_EulerMatrices(double* pAngles, int n, int iRotationOrder, double* pMatrices)
+{
+    if (n < 0 || (n > 0 && (!pAngles || !pMatrices)))
+        return RC_ApiError;
+    return Euler::Matrices(iRotationOrder, pAngles, 3, n, pMatrices) ? RC_Okay : RC_ApiError;
+}
+
+int CortexEngine_MatrixEulers(double* pMatrices, int n, int iRotationOrder, double* pAngles)
+{
+    if (n < 0 || (n > 0 && (!pMatrices || !pAngles)))
+        return RC_ApiError;
+    return Euler::Angles(iRotationOrder, pMatrices, n, pAngles, 3) ? RC_Okay : RC_ApiError;
+}
+
+//==================================================================
+// Watchdog
+
+int CortexEngine_WatchdogStart(int msLoop, int msFrames, double fAccel)
+{
+    std::lock_guard<std::mutex> Lock(g_Mutex);
+    if (!g_pSky)
+        return RC_ApiError;
+    BeltCommand Stop = StopCommand();
+    if (!Stop)
+        return RC_ApiError;
+    WatchdogParams Params;
+    Params.msLoop = msLoop;
+    Params.msFrames = msFrames;
+    Params.Accel = fAccel;
+    Watchdog* pWatchdog = new Watchdog(Params, Stop, g_Start);
+    Watchdog* pOld = NULL;
+    {
+        std::lock_guard<std::mutex> FrameLock(g_FrameMutex);
+        pOld = g_pWatchdog;
+        g_pWatchdog = pWatchdog;
+    }
+    delete pOld;
+    pWatchdog->Start();
+    return RC_Okay;
+}
+
+int CortexEngine_WatchdogBeat()
+{
+    // no lock: called every loop iteration, and the watchdog is only
+    // replaced or deleted by WatchdogStart and Exit on the caller's thread
+    Watchdog* pWatchdog = g_pWatchdog;
+    if (!pWatchdog || !pWatchdog->Armed())
+        return -RC_ApiError;
+    pWatchdog->Beat();
+    return pWatchdog->Tripped() ? 1 : 0;
+}
+
+int CortexEngine_WatchdogTripped()
+{
+    // as WatchdogBeat, on the caller's thread
+    Watchdog* pWatchdog = g_pWatchdog;
+    return pWatchdog && pWatchdog->Tripped() ? 1 : 0;
+}
+
+int CortexEngine_WatchdogStop()
+{
+    Watchdog* pWatchdog = g_pWatchdog;
+    if (!pWatchdog || !pWatchdog->Armed())
+        return RC_ApiError;
+    pWatchdog->Stop();
+    return RC_Okay;
+}
+
+int CortexEngine_WatchdogStatus(int* piReason, double* pTime, double* pGap, int* piStopResult,
+                                double* pMaxLoopGap, double* pMaxFrameGap, double* pMaxLateMicros)
+{
+    Watchdog* pWatchdog = g_pWatchdog;
+    if (!pWatchdog)
+        return RC_ApiError;
+    WatchdogEvent E = pWatchdog->Event();
+    WatchdogStats S = pWatchdog->Stats();
+    if (piReason) *piReason = E.iReason;
+    if (pTime) *pTime = E.Time;
+    if (pGap) *pGap = E.Gap;
+    if (piStopResult) *piStopResult = E.iStopResult;
+    if (pMaxLoopGap) *pMaxLoopGap = S.MaxLoopGap;
+    if (pMaxFrameGap) *pMaxFrameGap = S.MaxFrameGap;
+    if (pMaxLateMicros) *pMaxLateMicros = S.MaxLateMicros;
+    return RC_Okay;
+}
+
+int CortexEngine_WatchdogSetStopFunc(int (*MyFunction)(double fLeft, double fRight, double fAccel))
+{
+    g_WatchdogStop = MyFunction;
+    return RC_Okay;
+}
+
+//==================================================================
+// Pipeline tracing
+
+int CortexEngine_TraceStart(int nEvents)
+{
+    std::lock_guard<std::mutex> Lock(g_Mutex);
+    if (!g_pSky)
+        return RC_ApiError;
+    std::lock_guard<std::mutex> FrameLock(g_FrameMutex);
+    return Trace::Start(nEvents) ? RC_Okay : RC_ApiError;
+}
+
+int CortexEngine_TraceStop()
+{
+    std::lock_guard<std::mutex> FrameLock(g_FrameMutex);
+    Trace::Stop();
+    return RC_Okay;
+}
+
+int CortexEngine_TraceBegin(int iStage)
+{
+    Trace::Begin(iStage);
+    return RC_Okay;
+}
+
+int CortexEngine_TraceEnd(int iStage, int iFrame)
+{
+    Trace::End(iStage, iFrame);
+    return RC_Okay;
+}
+
+int CortexEngine_TraceThreadName(char* szName)
+{
+    Trace::NameThread(szName);
+    return RC_Okay;
+}
+
+int CortexEngine_TraceWrite(char* szPath, int* pnDropped)
+{
+    int n = Trace::Write(szPath, pnDropped);
+    return n < 0 ? -RC_ApiError : n;
+}
+
+//==================================================================
+// Live metrics
+
+int CortexEngine_MetricsStart(int iPort)
+{
+    std::lock_guard<std::mutex> Lock(g_Mutex);
+    if (!g_pSky)
+        return RC_ApiError;
+    // the old server lets go of the port first, a restart may reuse it
+    delete g_pMetricsServer;
+    g_pMetricsServer = new MetricsServer(g_Metrics);
+    if (g_pMetricsServer->Start(iPort))
+        return RC_Okay;
+    delete g_pMetricsServer;
+    g_pMetricsServer = NULL;
+    return RC_ApiError;
+}
+
+int CortexEngine_MetricsStop()
+{
+    std::lock_guard<std::mutex> Lock(g_Mutex);
+    if (!g_pMetricsServer)
+        return RC_ApiError;
+    delete g_pMetricsServer;
+    g_pMetricsServer = NULL;
+    return RC_Okay;
+}
+
+int CortexEngine_MetricsLoop(int iFrame, int bCommand)
+{
+    g_Metrics.OnLoop(iFrame, bCommand != 0, SteadyNs(std::chrono::steady_clock::now()));
+    return RC_Okay;
+}
+
+//==================================================================
+// Analog signal quality
+
+int CortexEngine_MonitorStart(int* piChannels, int nChannels, int nRailMargin,
+                              int nStuckSamples, int nSpikeBits, double fNoiseBits)
+{
+    std::lock_guard<std::mutex> Lock(g_Mutex);
+    if (!g_pSky)
+        return RC_ApiError;
+    MonitorParams Params;
+    if (piChannels && nChannels >= 0)
+        Params.Channels.assign(piChannels, piChannels + nChannels);
+    if (nRailMargin > 0)
+        Params.RailMargin = nRailMargin;
+    if (nStuckSamples > 0)
+        Params.StuckSamples = nStuckSamples;
+    if (nSpikeBits > 0)
+        Params.SpikeBits = nSpikeBits;
+    if (fNoiseBits > 0.0)
+        Params.NoiseBits = (float)fNoiseBits;
+    SignalMonitor* pMonitor = new SignalMonitor(Params, [](int, int Alerts) {
+        g_Metrics.OnSignalAlerts(Alerts);
+    });
+    SignalMonitor* pOld = NULL;
+    {
+        std::lock_guard<std::mutex> FrameLock(g_FrameMutex);
+        pOld = g_pMonitor;
+        g_pMonitor = pMonitor;
+    }
+    delete pOld;
+    return RC_Okay;
+}
+
+int CortexEngine_MonitorStop()
+{
+    SignalMonitor* pOld = NULL;
+    {
+        std::lock_guard<std::mutex> FrameLock(g_FrameMutex);
+        pOld = g_pMonitor;
+        g_pMonitor = NULL;
+    }
+    if (!pOld)
+        return RC_ApiError;
+    delete pOld;
+    return RC_Okay;
+}
+
+int CortexEngine_MonitorAlerts(int* piAlerts, int nMaxChannels)
+{
+    std::vector<int> Alerts;
+    {
+        std::lock_guard<std::mutex> FrameLock(g_FrameMutex);
+        if (!g_pMonitor)
+            return -RC_ApiError;
+        Alerts = g_pMonitor->TakeAlerts();
+    }
+    int n = 0;
+    for (int c = 0; c < (int)Alerts.size(); c++)
+    {
+        if (Alerts[c])
+            n++;
+        if (piAlerts && c < nMaxChannels)
+            piAlerts[c] = Alerts[c];
+    }
+    for (int c = (int)Alerts.size(); piAlerts && c < nMaxChannels; c++)
+        piAlerts[c] = 0;
+    return n;
+}
+
+int CortexEngine_MonitorStats(int iScope, double* pStats, int nMaxChannels)
+{
+    std::vector<SignalCounts> Counts;
+    {
+        std::lock_guard<std::mutex> FrameLock(g_FrameMutex);
+        if (!g_pMonitor)
+            return -RC_ApiError;
+        Counts = iScope == 1 ? g_pMonitor->Trial() : g_pMonitor->LastSecond();
+    }
+    const int nc = (int)Counts.size();
+    for (int c = 0; pStats && c < nMaxChannels; c++)
+    {
+        double Row[SIGNAL_N_STATS] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+        if (c < nc)
+        {
+            const SignalCounts& C = Counts[c];
+            Row[0] = (double)C.nSamples;
+            Row[1] = (double)C.nRail;
+            Row[2] = (double)C.nStuck;
+            Row[3] = (double)C.nSpikes;
+            Row[4] = C.NoiseRms();
+            Row[5] = (double)C.Alerts;
+        }
+        for (int k = 0; k < SIGNAL_N_STATS; k++)
+            pStats[k * nMaxChannels + c] = Row[k];
+    }
+    return nc;
+}
+
+//==================================================================
+// Treadmill link
+
+int CortexEngine_TreadmillOpen(char* szAddress, char* szPort, int iCore)
+{
+    std::lock_guard<std::mutex> Lock(g_Mutex);
+    if (!szAddress || !szPort)
+        return TREADMILL_ADDRESS;
+    // the old link lets go of its socket and affinity first
+    if (g_pTreadmill)
+        g_pTreadmill->Close();
+    TreadmillLinkParams Params;
+    Params.Address = szAddress;
+    Params.Port = szPort;
+    Params.iCore = iCore;
+    std::shared_ptr<TreadmillLink> pLink = std::make_shared<TreadmillLink>(Params,
+        [](int iResult, long long ns) { g_Metrics.OnTreadmillSend(iResult, ns); });
+    const int iResult = pLink->Open();
+    if (iResult == TREADMILL_OK)
+        g_pTreadmill = pLink;
+    return iResult;
+}
+
+int CortexEngine_TreadmillSetSpeed(double fLeft, double fRight, double fAccel)
+{
+    // no lock: called from the control loop, and the link is only
+    // replaced by TreadmillOpen on the same thread
+    TreadmillLink* pLink = g_pTreadmill.get();
+    if ((fLeft != 0.0 || fRight != 0.0) && CortexEngine_WatchdogTripped())
+        return TREADMILL_STOPPED;
+    if (!pLink)
+    {
+        g_Metrics.OnTreadmillSend(TREADMILL_NOT_CONNECTED, -1);
+        return TREADMILL_NOT_CONNECTED;
+    }
+    return pLink->SetSpeed(fLeft, fRight, fAccel);
+}
+
+int CortexEngine_TreadmillStats(double* pStats, int nStats)
+{
+    std::lock_guard<std::mutex> Lock(g_Mutex);
+    if (!g_pTreadmill || nStats < 0 || (nStats > 0 && !pStats))
+        return RC_ApiError;
+    const TreadmillStats S = g_pTreadmill->Stats();
+    const double Values[TREADMILL_N_STATS] = {
+        (double)S.nCommands, (double)S.nSent, (double)S.nSendErrors, (double)S.nNotConnected,
+        (double)S.nReconnects, S.MeanMicros, S.MaxMicros, (double)S.bConnected, (double)S.bPinned
+    };
+    for (int i = 0; i < nStats && i < TREADMILL_N_STATS; i++)
+        pStats[i] = Values[i];
+    return RC_Okay;
+}
+
+int CortexEngine_TreadmillClose()
+{
+    std::lock_guard<std::mutex> Lock(g_Mutex);
+    if (!g_pTreadmill || !g_pTreadmill->IsOpen())
+        return RC_ApiError;
+    g_pTreadmill->Close();
+    return RC_Okay;
+}
@@ -0,0 +1,1010 @@
+/*=========================================================
+//
+// File: CortexEngine.h
+//
+// This file defines the interface to the Cortex engine, a helper library
+// that runs alongside Cortex_SDK.dll in the MATLAB process.
+//
+//----------------------------------------------------------
+Modification History:
+
+Date      By          Comment
+------------------------------------------------------------
+Oct 2026  abl         First version, asynchronous Sky command queue
+Oct 2026  abl         SDK2 relay of frames with treadmill channels
+Oct 2026  abl         Batch Euler angle conversions
+Oct 2026  abl         Frame ring and trial recorder, for the Python bindings
+Oct 2026  abl         Batched drain of the frame ring for MATLAB
+Oct 2026  abl         Watchdog stopping the belt on control loop or frame stalls
+Oct 2026  abl         Spin-then-sleep frame waits without locks on the data thread
+Oct 2026  abl         Pipeline tracing to Chrome trace files
+Oct 2026  abl         Live loop metrics served to Prometheus
+Oct 2026  abl         Export of recorded trials to .mat and .npy/.npz files
+Oct 2026  abl         Analog signal quality monitor (rail, stuck, spikes, noise)
+Oct 2026  abl         Timed non-blocking treadmill link with reconnection
+=============================================================================*/
+
+/*! \file CortexEngine.h
+This file defines the API of the Cortex engine. It is plain C so that it can
+be loaded from MATLAB with loadlibrary and called with calllib, the same way
+as Cortex_SDK.dll and treadmill0x2Dremote.dll.
+*/
+
+#ifndef CortexEngine_H
+#define CortexEngine_H
+
+#include "MatlabCortex.h"
+
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+
+//==================================================================
+
+/** This function starts the engine's worker threads.
+ *
+ *  Call it once, after Cortex_Initialize (mCortexInitialize) and before
+ *  any other CortexEngine function.
+ *
+ * \return RC_Okay, RC_ApiError if already initialized
+*/
+DLL int CortexEngine_Initialize();
+
+//==================================================================
+
+/** This function stops the engine's worker threads.
+ *
+ *  Call it before Cortex_Exit (mCortexExit). Sky commands still queued are
+ *  executed first; results that were never collected are discarded.
+ *
+ * \return RC_Okay, RC_ApiError if not initialized
+*/
+DLL int CortexEngine_Exit();
+
+
+//==================================================================
+// Asynchronous Sky commands and requests
+//==================================================================
+
+/*
+ *  Cortex_SkyCommand and Cortex_Request block the caller until Cortex
+ *  answers or the timeout expires. The engine runs them on its own thread
+ *  so a control loop can start or stop recordings, or query Cortex,
+ *  without stalling. Commands are queued, executed in the order submitted,
+ *  and each one gets a ticket for collecting its result.
+ *
+ *  Every command queued while the worker is busy is executed in one batch
+ *  on its next pass. Identical requests in a batch are sent to Cortex only
+ *  once. Results of idempotent requests (GetContextFrameRate and the other
+ *  session constants, see CortexEngine_SetCacheable) are cached for the
+ *  session and returned without contacting Cortex again.
+ *
+ *  Only the engine's worker should call Cortex_SkyCommand and
+ *  Cortex_Request while the engine is running.
+ */
+
+//==================================================================
+
+/** This function queues a Sky command.
+ *
+ * \param szCommand - The Sky command, including arguments, as for Cortex_SkyCommand.
+ * \param msTimeout - The time in milliseconds the worker waits for Cortex.
+ *
+ * \return A ticket (> 0) for CortexEngine_SkyPoll / CortexEngine_SkyWait,
+ *         or -RC_ApiError if the engine is not running.
+*/
+DLL int CortexEngine_SkySubmit(char* szCommand, int msTimeout);
+
+//==================================================================
+
+/** This function queues a request, as for Cortex_Request.
+ *
+ * \param szCommand - The request to send to Cortex.
+ *
+ * \return A ticket (> 0) for CortexEngine_RequestPoll / CortexEngine_RequestWait,
+ *         or -RC_ApiError if the engine is not running.
+*/
+DLL int CortexEngine_RequestSubmit(char* szCommand);
+
+//==================================================================
+
+/** This function checks whether a Sky command has completed.
+ *
+ *  Once a result has been returned the ticket is released.
+ *
+ * \param iTicket - The ticket from CortexEngine_SkySubmit.
+ * \param pReturnCode - Receives the sSkyReturn::ReturnCode of the command.
+ * \param pSkyReturn - Receives Cortex's full response, may be NULL (e.g. from MATLAB).
+ *
+ * \return 1 if completed, 0 if still queued or running, -RC_ApiError for an unknown ticket.
+*/
+DLL int CortexEngine_SkyPoll(int iTicket, int* pReturnCode, sSkyReturn* pSkyReturn);
+
+//==================================================================
+
+/** This function waits for a Sky command to complete.
+ *
+ * \param iTicket - The ticket from CortexEngine_SkySubmit.
+ * \param msTimeout - The longest time in milliseconds to wait.
+ *
+ *  The other parameters and the return value are as for CortexEngine_SkyPoll.
+ *  Other calls into the engine do not wait for it.
+*/
+DLL int CortexEngine_SkyWait(int iTicket, int msTimeout, int* pReturnCode, sSkyReturn* pSkyReturn);
+
+//==================================================================
+
+/** This function checks whether a request has completed.
+ *
+ *  Once a result has been returned the ticket is released.
+ *
+ * \param iTicket - The ticket from CortexEngine_RequestSubmit.
+ * \param pReturnCode - Receives the return code of Cortex_Request.
+ * \param pResponse - Receives up to nBytes of the response.
+ * \param nBytes - The size of pResponse.
+ * \param pnBytes - Receives the full size of the response.
+ *
+ * \return 1 if completed, 0 if still queued or running, -RC_ApiError for an unknown ticket.
+*/
+DLL int CortexEngine_RequestPoll(int iTicket, int* pReturnCode, void* pResponse, int nBytes, int* pnBytes);
+
+//==================================================================
+
+/** This function waits for a request to complete.
+ *
+ * \param iTicket - The ticket from CortexEngine_RequestSubmit.
+ * \param msTimeout - The longest time in milliseconds to wait.
+ *
+ *  The other parameters and the return value are as for CortexEngine_RequestPoll.
+ *  Other calls into the engine do not wait for it.
+*/
+DLL int CortexEngine_RequestWait(int iTicket, int msTimeout, int* pReturnCode, void* pResponse, int nBytes, int* pnBytes);
+
+//==================================================================
+
+/** This function sets up a callback for completed Sky commands and requests.
+ *
+ *  The callback runs on the engine's worker thread. It should return
+ *  quickly; the next queued command waits for it. Tickets of commands
+ *  reported to the callback still need to be collected or are released
+ *  at CortexEngine_Exit.
+ *
+ * \param MyFunction - This user defined function handles completed commands.
+ *
+ * \return RC_Okay
+*/
+DLL int CortexEngine_SetSkyHandlerFunc(void (*MyFunction)(int iTicket, int iReturnCode));
+
+//==================================================================
+
+/** This function marks a request as idempotent, or not.
+ *
+ *  The first successful response of a cacheable request is kept for the
+ *  rest of the session. GetContextFrameRate, GetContextAnalogSampleRate,
+ *  GetContextAnalogBitDepth, GetUpAxis and GetConversionToMillimeters
+ *  are cacheable by default.
+ *
+ * \param szCommand - The request.
+ * \param bCacheable - Nonzero to cache its response.
+ *
+ * \return RC_Okay, RC_ApiError if the engine is not running
+*/
+DLL int CortexEngine_SetCacheable(char* szCommand, int bCacheable);
+
+//==================================================================
+
+/** This function forgets all cached responses, e.g. after the Cortex
+ *  frame rate or analog setup has been changed.
+ *
+ * \return RC_Okay, RC_ApiError if the engine is not running
+*/
+DLL int CortexEngine_ClearCache();
+
+//==================================================================
+
+/** This function returns the number of Sky commands and requests queued
+ *  or running.
+*/
+DLL int CortexEngine_SkyPending();
+
+
+//==================================================================
+// SDK2 relay
+//==================================================================
+
+/*
+ *  The controller host can act as an SDK2 host for the other lab tools.
+ *  Each frame from Cortex is forwarded once to the SDK2 clients with
+ *  treadmill channels appended after Cortex's analog channels, so the
+ *  clients need not connect to Cortex or recompute forces. Appended
+ *  channels, per analog sample:
+ *
+ *    F1Y, F1Z, F2Y, F2Z   scaled plate forces, 0.1 N
+ *    CoP1y, CoP2y         frame mean fore/aft CoPs, mm
+ *    RightOn, LeftOn      stance flags
+ *    Speed                last commanded belt speed, mm/s
+ *    Fp                   latest mean peak propulsive force, 0.1 N
+ *
+ *  The frame is sent from the SDK's data thread as it arrives, with one
+ *  multicast for all clients.
+ */
+
+//==================================================================
+
+/** This function enables communication with SDK2 clients.
+ *
+ *  Same as Cortex_SetClientCommunicationEnabled(1); it must be called
+ *  BEFORE Cortex_Initialize (mCortexInitialize).
+ *
+ * \return RC_Okay
+*/
+DLL int CortexEngine_RelayEnable();
+
+//==================================================================
+
+/** This function starts forwarding frames to SDK2 clients.
+ *
+ * \return RC_Okay, RC_ApiError if the engine is not running or client
+ *         communication was not enabled
+*/
+DLL int CortexEngine_RelayStart();
+
+//==================================================================
+
+/** This function stops forwarding frames.
+ *
+ * \return RC_Okay, RC_ApiError if the relay is not running
+*/
+DLL int CortexEngine_RelayStop();
+
+//==================================================================
+
+/** This function sets the controller state carried on the next frames.
+ *
+ *  The state goes to the relay and to the trial recorder, whichever runs,
+ *  and to the live metrics.
+ *
+ * \param fSpeed - The last commanded belt speed (m/s).
+ * \param fFp - The latest mean peak propulsive force (N).
+ *
+ * \return RC_Okay, RC_ApiError if neither the relay nor the recorder is running
+*/
+DLL int CortexEngine_RelaySetState(float fSpeed, float fFp);
+
+//==================================================================
+
+/** This function reports how the relay is doing.
+ *
+ * \param pnForwarded - Frames sent to clients.
+ * \param pnRepeated - Frames seen more than once and not re-sent.
+ * \param pnFailed - Sends that failed.
+ * \param pMeanMicros - Mean time from frame arrival to send complete (us).
+ * \param pMaxMicros - Longest time from frame arrival to send complete (us).
+ *
+ * \return RC_Okay, RC_ApiError if the relay is not running
+*/
+DLL int CortexEngine_RelayStats(int* pnForwarded, int* pnRepeated, int* pnFailed, double* pMeanMicros, double* pMaxMicros);
+
+
+//==================================================================
+// Batch Euler angle conversions
+//==================================================================
+
+/*
+ *  Cortex_ConstructRotationMatrix and Cortex_ExtractEulerAngles for whole
+ *  arrays, with the same conventions for ZYX_ORDER .. XZY_ORDER. The SDK
+ *  does not implement XYX_ORDER .. ZYZ_ORDER; for those these use proper
+ *  Euler angles (see the ReadMe). The order is checked once per call.
+ *  These do not need the engine to be running.
+ */
+
+//==================================================================
+
+/** This function constructs the rotation matrices of segment data.
+ *
+ * \param pSegments - nSegments tSegmentData (X,Y,Z, aX,aY,aZ, Length).
+ * \param nSegments - The number of segments.
+ * \param iRotationOrder - ZYX_ORDER .. ZYZ_ORDER, as for
+ *                         Cortex_ConstructRotationMatrix.
+ * \param pMatrices - nSegments 3x3 row major matrices.
+ *
+ * \return RC_Okay, RC_ApiError for an unknown rotation order
+*/
+DLL int CortexEngine_SegmentMatrices(double* pSegments, int nSegments, int iRotationOrder, double* pMatrices);
+
+//==================================================================
+
+/** This function constructs rotation matrices from Euler angles.
+ *
+ * \param pAngles - n sets of three angles in degrees.
+ * \param n - The number of sets.
+ * \param iRotationOrder - ZYX_ORDER .. ZYZ_ORDER.
+ * \param pMatrices - n 3x3 row major matrices.
+ *
+ * \return RC_Okay, RC_ApiError for an unknown rotation order
+*/
+DLL int CortexEngine_EulerMatrices(double* pAngles, int n, int iRotationOrder, double* pMatrices);
+
+//==================================================================
+
+/** This function decodes rotation matrices into Euler angles.
+ *
+ * \param pMatrices - n 3x3 row major matrices.
+ * \param n - The number of matrices.
+ * \param iRotationOrder - ZYX_ORDER .. ZYZ_ORDER.
+ * \param pAngles - n sets of three angles in degrees.
+ *
+ * \return RC_Okay, RC_ApiError for an unknown rotation order
+*/
+DLL int CortexEngine_MatrixEulers(double* pMatrices, int n, int iRotationOrder, double* pAngles);
+
+
+
+//==================================================================
+// Frame ring and trial recorder
+//==================================================================
+
+/*
+ *  The ring keeps the last frames from Cortex in preallocated slots; the
+ *  recorder keeps the treadmill signals of every frame of a trial as
+ *  columns. Both are filled on the SDK's data thread and both hand out
+ *  pointers to their storage, which does not move until they are
+ *  stopped, so readers (cortexengine.py) can view it without copying.
+ */
+
+/** Header of one frame in the ring */
+typedef struct sRingFrame
+{
+    long long Seq;             //!< Ring sequence, 1 for the first frame; 0 while written
+    int       iFrame;          //!< Cortex frame number
+    float     fDelay;          //!< Cortex's delay estimate (s)
+    double    fTime;           //!< Arrival, seconds since CortexEngine_Initialize
+    int       nMarkers;        //!< Markers of all bodies, in body order
+    int       nAnalogChannels;
+    int       nAnalogSamples;
+    int       nForcePlates;
+    int       nForceSamples;
+    int       bTruncated;      //!< Data beyond the slot's capacity was dropped
+
+} sRingFrame;
+
+//==================================================================
+
+/** This function starts keeping frames in the ring.
+ *
+ *  Frame Seq is in slot (Seq - 1) % nSlots until it is overwritten nSlots
+ *  frames later. Zero for any size selects its default.
+ *
+ * \param nSlots - Frames kept (1024).
+ * \param nMaxMarkers - Markers per frame (256).
+ * \param nMaxAnalog - Analog values per frame, channels * samples (2048).
+ * \param nMaxForces - Force samples per frame, plates * samples (128).
+ *
+ * \return RC_Okay, RC_ApiError if the engine is not running
+*/
+DLL int CortexEngine_RingStart(int nSlots, int nMaxMarkers, int nMaxAnalog, int nMaxForces);
+
+//==================================================================
+
+/** This function releases the ring; pointers from RingLayout become invalid,
+ *  unless a handle from CortexEngine_RingAcquire still holds its storage.
+ *
+ * \return RC_Okay, RC_ApiError if the ring is not running
+*/
+DLL int CortexEngine_RingStop();
+
+//==================================================================
+
+/** This function describes the ring's storage.
+ *
+ *  Each array covers all slots: headers [nSlots], markers
+ *  [nSlots][nMaxMarkers][3], analog [nSlots][nMaxAnalog] (samples of a
+ *  frame interleaved by channel, as in sAnalogData) and forces
+ *  [nSlots][nMaxForces][7]. Any pointer argument may be NULL.
+ *
+ * \return RC_Okay, RC_ApiError if the ring is not running
+*/
+DLL int CortexEngine_RingLayout(int* pnSlots, int* pnMaxMarkers, int* pnMaxAnalog, int* pnMaxForces,
+                                sRingFrame** ppHeaders, float** ppMarkers, short** ppAnalog, float** ppForces);
+
+//==================================================================
+
+/** This function keeps the ring's storage allocated for views of it.
+ *
+ *  Until the handle is released, the pointers from RingLayout stay valid
+ *  after RingStop, a second RingStart or Exit; the frames in them are
+ *  then no longer updated. For bindings whose arrays may outlive the ring
+ *  (cortexengine.py). Call it before RingLayout, on the same thread.
+ *
+ * \return A handle for CortexEngine_RingRelease, NULL if the ring is not running
+*/
+DLL void* CortexEngine_RingAcquire();
+
+//==================================================================
+
+/** This function releases a handle from CortexEngine_RingAcquire.
+ *
+ * \return RC_Okay, RC_ApiError if pHandle is NULL
+*/
+DLL int CortexEngine_RingRelease(void* pHandle);
+
+//==================================================================
+
+/** This function returns the sequence of the latest frame.
+ *
+ * \return The sequence, 0 before the first frame or if the ring is not running
+*/
+DLL long long CortexEngine_RingHead();
+
+//==================================================================
+
+/** This function waits for a frame after iSeq.
+ *
+ *  The caller spins for the time set by CortexEngine_RingSetSpin, then
+ *  sleeps until the data thread publishes the next frame. A sleeping
+ *  caller uses no CPU and wakes within the scheduler's latency of the
+ *  frame's arrival.
+ *
+ * \param iSeq - The last sequence the caller has seen.
+ * \param msTimeout - Longest wait (ms).
+ *
+ * \return The latest sequence, which is iSeq or less on timeout; -1 if the
+ *         ring is not running or was stopped while waiting
+*/
+DLL long long CortexEngine_RingWait(long long iSeq, int msTimeout);
+
+//==================================================================
+
+/** This function sets how CortexEngine_RingWait waits.
+ *
+ *  0 sleeps at once, the least CPU. A positive usSpin spins that many
+ *  microseconds before sleeping, so frames arriving within it are seen
+ *  without a wake-up. A negative usSpin spins for the whole wait: the
+ *  lowest latency, but a core stays busy. Kept across RingStart.
+ *
+ * \param usSpin - Spin time (us), 0 or negative.
+ *
+ * \return RC_Okay
+*/
+DLL int CortexEngine_RingSetSpin(int usSpin);
+
+//==================================================================
+
+/** This function tells whether frame iSeq is still in its slot.
+ *
+ *  Check it after reading a slot: if it returns 0 the slot was being
+ *  overwritten and what was read must be discarded.
+ *
+ * \return 1 if the slot holds frame iSeq, completely written; 0 otherwise
+*/
+DLL int CortexEngine_RingValid(long long iSeq);
+
+//==================================================================
+
+/** This function copies selected data of every frame after iSince.
+ *
+ *  For MATLAB loops slower than the camera: one call returns all frames
+ *  since the last call, oldest first, into arrays the caller allocated
+ *  once. Outputs are column major, nMaxFrames rows:
+ *
+ *    pInfo     [nMaxFrames x 4]                  Seq, Cortex frame, Time, nSamples
+ *    pAnalog   [nMaxFrames*nMaxSamples x nChannels]  samples of the frames
+ *                                                in turn; frame k has nSamples rows
+ *    pMarkers  [nMaxFrames x 3*nMarkers]         X, Y, Z of each selected marker
+ *
+ *  Values missing from a frame are NaN. Frames overwritten before this
+ *  call are skipped; they show as a jump in Seq. Any output may be NULL.
+ *
+ * \param iSince - Seq of the last frame already read (0 for all kept frames).
+ * \param nMaxFrames - Rows of pInfo and pMarkers; more frames wait for the next call.
+ * \param piChannels - Analog channels to copy, 0 based.
+ * \param nChannels - The number of channels.
+ * \param nMaxSamples - Analog samples kept per frame.
+ * \param piMarkers - Markers to copy, 0 based over all bodies in body order.
+ * \param nMarkers - The number of markers.
+ *
+ * \return The number of frames copied, -RC_ApiError if the ring is not running
+*/
+DLL int CortexEngine_RingDrain(long long iSince, int nMaxFrames,
+                               int* piChannels, int nChannels, int nMaxSamples,
+                               int* piMarkers, int nMarkers,
+                               double* pInfo, double* pAnalog, double* pMarkers);
+
+//==================================================================
+
+/** This function starts recording the treadmill signals of each frame.
+ *
+ *  A running recorder is replaced. Columns are listed by
+ *  CortexEngine_RecorderColumnName; the state columns (Speed, Fp) come from
+ *  CortexEngine_RelaySetState.
+ *
+ * \param nRows - Frames that can be recorded; later frames are dropped.
+ *
+ * \return RC_Okay, RC_ApiError if the engine is not running
+*/
+DLL int CortexEngine_RecorderStart(int nRows);
+
+//==================================================================
+
+/** This function releases the recorder; pointers to its columns become invalid,
+ *  unless a handle from CortexEngine_RecorderAcquire still holds them.
+ *
+ *  An export in progress keeps the recorder until it has been written.
+ *
+ * \return RC_Okay, RC_ApiError if the recorder is not running
+*/
+DLL int CortexEngine_RecorderStop();
+
+//==================================================================
+
+/** This function describes the recorder's storage.
+ *
+ *  Column c is the nCapacity doubles at *ppData + c * nCapacity.
+ *
+ * \return RC_Okay, RC_ApiError if the recorder is not running
+*/
+DLL int CortexEngine_RecorderColumns(double** ppData, int* pnCapacity, int* pnColumns);
+
+//==================================================================
+
+/** This function keeps the recorder's columns allocated for views of them.
+ *
+ *  As CortexEngine_RingAcquire: the pointer from RecorderColumns stays
+ *  valid, holding the rows recorded until RecorderStop, until the handle
+ *  is released. Call it before RecorderColumns, on the same thread.
+ *
+ * \return A handle for CortexEngine_RecorderRelease, NULL if the recorder is not running
+*/
+DLL void* CortexEngine_RecorderAcquire();
+
+//==================================================================
+
+/** This function releases a handle from CortexEngine_RecorderAcquire.
+ *
+ * \return RC_Okay, RC_ApiError if pHandle is NULL
+*/
+DLL int CortexEngine_RecorderRelease(void* pHandle);
+
+//==================================================================
+
+/** This function returns the number of rows recorded so far.
+ *
+ * \param pnDropped - Frames not recorded because the columns were full, or NULL.
+ *
+ * \return The rows, 0 if the recorder is not running
+*/
+DLL int CortexEngine_RecorderRows(int* pnDropped);
+
+//==================================================================
+
+/** This function returns the name of recorder column iColumn, "" if none. */
+DLL const char* CortexEngine_RecorderColumnName(int iColumn);
+
+//==================================================================
+
+/** This function writes the rows recorded so far to a file.
+ *
+ *  The format follows the extension: .mat (MATLAB v5, an n x 1 double
+ *  per column and an Info struct), .npz (an array per column and an Info
+ *  record) or .npy (one n x nColumns array). Recording, and other calls
+ *  into the engine, go on meanwhile.
+ *
+ * \param szPath - File to write; it is replaced.
+ *
+ * \return The rows written, -RC_ApiError if the recorder is not running,
+ *         the extension is not one of these or the file could not be written
+*/
+DLL int CortexEngine_RecorderExport(char* szPath);
+
+//==================================================================
+
+/** This function converts a trial log (bin/TrialLog.m) to a .mat, .npz or .npy file.
+ *
+ *  Each scalar column becomes an n x 1 double, F1Y, F1Z, F2Y and F2Z
+ *  n x samples per frame, and, except in a .npy, the stances an
+ *  nStances x 8 double Stances (see Info.StanceColumns). The log is read
+ *  in large blocks; the engine need not be running.
+ *
+ * \param szLog - Log file written by TrialLog; its stances are in szLog.steps.
+ * \param szPath - File to write, format by extension as for CortexEngine_RecorderExport.
+ *
+ * \return The rows written, -RC_ApiError if the log could not be read or the file written
+*/
+DLL int CortexEngine_ExportTrialLog(char* szLog, char* szPath);
+
+
+//==================================================================
+// Watchdog
+//==================================================================
+
+/*
+ *  If MATLAB stops running the control loop (a breakpoint, a slow
+ *  redraw, a long garbage collection) or Cortex stops sending frames, the
+ *  belt would keep the last commanded speed. The watchdog is a thread of
+ *  the engine that checks every few milliseconds, at real-time priority,
+ *  how long ago the loop last called CortexEngine_WatchdogBeat and the
+ *  last frame arrived. When either is older than its deadline it sends
+ *  TREADMILL_setSpeed(0, 0, acceleration) once, through the engine's
+ *  treadmill link if it is open (see CortexEngine_TreadmillOpen) and
+ *  otherwise, or if that send fails, through the treadmill0x2Dremote
+ *  library already loaded in the process, and records why.
+ */
+
+#define WATCHDOG_LOOP    1  //!< No heartbeat from the control loop
+#define WATCHDOG_FRAMES  2  //!< No frame from Cortex
+
+//==================================================================
+
+/** This function arms the watchdog.
+ *
+ *  Call it just before the control loop, after the belt has been started
+ *  through treadmill0x2Dremote. The loop deadline runs from this call,
+ *  the frame deadline from the first frame after it. An armed watchdog is
+ *  replaced.
+ *
+ * \param msLoop - Longest time between heartbeats (ms), 0 not to watch the loop.
+ * \param msFrames - Longest time between frames (ms), 0 not to watch frames.
+ * \param fAccel - Acceleration of the stop (m/s^2), as for TREADMILL_setSpeed.
+ *
+ * \return RC_Okay, RC_ApiError if the engine is not running or no belt
+ *         command was found (see CortexEngine_WatchdogSetStopFunc)
+*/
+DLL int CortexEngine_WatchdogStart(int msLoop, int msFrames, double fAccel);
+
+//==================================================================
+
+/** This function is the control loop's heartbeat; call it every iteration.
+ *
+ * \return 1 if the watchdog has stopped the belt, after which the loop
+ *         must not command a speed; 0 otherwise; -RC_ApiError if not armed
+*/
+DLL int CortexEngine_WatchdogBeat();
+
+//==================================================================
+
+/** This function tells, without a heartbeat, whether the watchdog has
+ *  stopped the belt.
+ *
+ *  Check it just before any speed command sent other than through
+ *  CortexEngine_TreadmillSetSpeed, which checks it itself: a loop that
+ *  stalls after its heartbeat would otherwise restart the belt when it
+ *  resumes. It stays 1 after CortexEngine_WatchdogStop, until the next
+ *  CortexEngine_WatchdogStart.
+ *
+ * \return 1 if it has, 0 if not or if the watchdog was never armed
+*/
+DLL int CortexEngine_WatchdogTripped();
+
+//==================================================================
+
+/** This function disarms the watchdog; its status remains readable.
+ *
+ *  Call it after the loop, before the trial's own stop command.
+ *
+ * \return RC_Okay, RC_ApiError if not armed
+*/
+DLL int CortexEngine_WatchdogStop();
+
+//==================================================================
+
+/** This function reports what the watchdog did.
+ *
+ * \param piReason - 0, WATCHDOG_LOOP or WATCHDOG_FRAMES.
+ * \param pTime - When it stopped the belt, seconds since CortexEngine_Initialize.
+ * \param pGap - Age of the heartbeat or frame at that time (s).
+ * \param piStopResult - Return of the belt command.
+ * \param pMaxLoopGap - Longest time without a heartbeat seen (s).
+ * \param pMaxFrameGap - Longest time without a frame seen (s).
+ * \param pMaxLateMicros - Latest wake-up after a scheduled check.
+ *
+ *  Any pointer may be NULL.
+ *
+ * \return RC_Okay, RC_ApiError if the watchdog was never armed
+*/
+DLL int CortexEngine_WatchdogStatus(int* piReason, double* pTime, double* pGap, int* piStopResult,
+                                    double* pMaxLoopGap, double* pMaxFrameGap, double* pMaxLateMicros);
+
+//==================================================================
+
+/** This function sets the belt command the watchdog sends.
+ *
+ *  By default it is the treadmill link, backed by TREADMILL_setSpeed of
+ *  the loaded treadmill0x2Dremote library. NULL restores the default.
+ *  Takes effect at the next CortexEngine_WatchdogStart.
+ *
+ * \return RC_Okay
+*/
+DLL int CortexEngine_WatchdogSetStopFunc(int (*MyFunction)(double fLeft, double fRight, double fAccel));
+
+
+//==================================================================
+// Pipeline tracing
+//==================================================================
+
+/*
+ *  Spans of the stages each frame goes through, on the data thread and in
+ *  the control loop, kept in per-thread buffers and written at the end of
+ *  a trial as Chrome trace JSON (chrome://tracing or ui.perfetto.dev).
+ *  The engine records the data thread's stages itself; the control loop
+ *  marks its own with CortexEngine_TraceBegin and CortexEngine_TraceEnd.
+ *  While tracing is off every span costs one atomic load.
+ */
+
+#define TRACE_CALLBACK  0   //!< The engine's data handler, all of it
+#define TRACE_RING      1   //!< Copying the frame into the ring
+#define TRACE_CONVERT   2   //!< Forces, CoPs and stance from the analog data
+#define TRACE_FILTER    3   //!< Filtering (gap fill, marker position)
+#define TRACE_GAIT      4   //!< Stance and step events
+#define TRACE_CONTROL   5   //!< The speed law
+#define TRACE_SEND      6   //!< TREADMILL_setSpeed
+#define TRACE_RECORD    7   //!< Trial recorder row
+#define TRACE_RELAY     8   //!< Forwarding to SDK2 clients
+#define TRACE_WAIT      9   //!< Waiting for the next frame
+#define TRACE_MONITOR   10  //!< Analog signal quality scan
+#define TRACE_N_STAGES  11
+
+//==================================================================
+
+/** This function starts tracing, forgetting earlier spans.
+ *
+ * \param nEvents - Spans kept per thread (65536 if 0); later ones are dropped.
+ *
+ * \return RC_Okay, RC_ApiError if the engine is not running or already tracing
+*/
+DLL int CortexEngine_TraceStart(int nEvents);
+
+//==================================================================
+
+/** This function stops tracing; the spans are kept for CortexEngine_TraceWrite.
+ *
+ * \return RC_Okay
+*/
+DLL int CortexEngine_TraceStop();
+
+//==================================================================
+
+/** These functions open and close a span of iStage on the calling thread.
+ *
+ * \param iStage - TRACE_FILTER, TRACE_CONTROL, ...
+ * \param iFrame - Cortex frame the span belongs to, shown with the span.
+ *
+ * \return RC_Okay
+*/
+DLL int CortexEngine_TraceBegin(int iStage);
+DLL int CortexEngine_TraceEnd(int iStage, int iFrame);
+
+//==================================================================
+
+/** This function names the calling thread in the trace, e.g. "MATLAB". */
+DLL int CortexEngine_TraceThreadName(char* szName);
+
+//==================================================================
+
+/** This function writes the spans recorded as Chrome trace JSON.
+ *
+ *  Times are microseconds since CortexEngine_Initialize, as frame times.
+ *
+ * \param szPath - The file to write.
+ * \param pnDropped - Spans lost because a buffer was full, or NULL.
+ *
+ * \return The number of spans written, -RC_ApiError if the file could not be written
+*/
+DLL int CortexEngine_TraceWrite(char* szPath, int* pnDropped);
+
+//==================================================================
+// Live metrics
+//==================================================================
+
+/*
+ *  Counters and histograms of loop health (frames, drops, frame intervals,
+ *  loop latency, commands, speed and Fp), kept with atomics only and served
+ *  in Prometheus text format at http://<host>:<port>/metrics. A scrape
+ *  takes no lock the data thread or the control loop takes. The counts
+ *  run for the life of the process, across trials.
+ */
+
+//==================================================================
+
+/** This function starts serving the metrics; a running server is replaced.
+ *
+ * \param iPort - TCP port, listened on at all interfaces.
+ *
+ * \return RC_Okay, RC_ApiError if the engine is not running or the port cannot be bound
+*/
+DLL int CortexEngine_MetricsStart(int iPort);
+
+//==================================================================
+
+/** This function stops serving the metrics; CortexEngine_Exit does too.
+ *
+ * \return RC_Okay, RC_ApiError if no server was running
+*/
+DLL int CortexEngine_MetricsStop();
+
+//==================================================================
+
+/** This function tells the metrics the control loop is done with a frame.
+ *
+ *  The loop latency is the time from the frame's arrival on the data
+ *  thread to this call; frames more than 64 behind are counted but not timed.
+ *  Speed and Fp come from CortexEngine_RelaySetState.
+ *
+ * \param iFrame - The Cortex frame number the loop worked on.
+ * \param bCommand - Nonzero if the loop sent the treadmill a new speed.
+ *
+ * \return RC_Okay
+*/
+DLL int CortexEngine_MetricsLoop(int iFrame, int bCommand);
+
+
+//==================================================================
+// Analog signal quality
+//==================================================================
+
+/*
+ *  A clipped, flat-lined or noisy force channel corrupts stance detection
+ *  and Fp without any sign in the forces themselves. The monitor checks
+ *  every analog sample of every channel on the data thread, as the frame
+ *  arrives: samples at the ADC rails, runs of identical samples, sample
+ *  to sample jumps and the RMS noise (from second differences, so the
+ *  force curves themselves hardly count). The counts are rolled up per
+ *  second of frame time and per trial; each second in which a monitored
+ *  channel crosses a limit raises an alert for it, also counted in the
+ *  live metrics.
+ */
+
+#define SIGNAL_RAIL   1  //!< Samples within the rail margin of +-32767
+#define SIGNAL_STUCK  2  //!< A run of identical samples longer than allowed
+#define SIGNAL_SPIKE  4  //!< A jump between consecutive samples
+#define SIGNAL_NOISE  8  //!< RMS noise above the limit
+
+#define SIGNAL_N_STATS  6  //!< Samples, rail, stuck, spikes, noise RMS, alerts
+
+//==================================================================
+
+/** This function starts monitoring; a running monitor is replaced.
+ *
+ *  Every channel is counted; alerts are raised for piChannels only.
+ *  A limit of 0 or less takes its default.
+ *
+ * \param piChannels - Channels to alert on, 0 based; NULL for the four
+ *                     treadmill force channels (F1Y, F1Z, F2Y, F2Z).
+ * \param nChannels - The number of channels.
+ * \param nRailMargin - Rail hit within this many bits of the rails (16).
+ * \param nStuckSamples - Stuck after this many identical samples in a row (100).
+ * \param nSpikeBits - Spike at a larger jump between samples (3000).
+ * \param fNoiseBits - Alert above this RMS noise, in bits (40).
+ *
+ * \return RC_Okay, RC_ApiError if the engine is not running
+*/
+DLL int CortexEngine_MonitorStart(int* piChannels, int nChannels, int nRailMargin,
+                                  int nStuckSamples, int nSpikeBits, double fNoiseBits);
+
+//==================================================================
+
+/** This function stops monitoring and releases its counts.
+ *
+ * \return RC_Okay, RC_ApiError if the monitor is not running
+*/
+DLL int CortexEngine_MonitorStop();
+
+//==================================================================
+
+/** This function returns the alerts raised since its last call.
+ *
+ *  Cheap enough to poll from the control loop; the alerts are cleared.
+ *
+ * \param piAlerts - Receives SIGNAL_RAIL | SIGNAL_STUCK | ... for each
+ *                   channel, 0 based.
+ * \param nMaxChannels - Length of piAlerts.
+ *
+ * \return The number of channels with alerts, -RC_ApiError if the monitor is not running
+*/
+DLL int CortexEngine_MonitorAlerts(int* piAlerts, int nMaxChannels);
+
+//==================================================================
+
+/** This function copies the counts of each channel.
+ *
+ *  pStats is [nMaxChannels x SIGNAL_N_STATS], column major: samples,
+ *  rail hits, stuck samples, spikes, RMS noise (bits) and the alerts
+ *  raised (of the second, or all of the trial).
+ *
+ * \param iScope - 0 for the last complete second, 1 for the trial so far.
+ * \param pStats - Receives the counts.
+ * \param nMaxChannels - Rows of pStats.
+ *
+ * \return The number of analog channels, -RC_ApiError if the monitor is not running
+*/
+DLL int CortexEngine_MonitorStats(int iScope, double* pStats, int nMaxChannels);
+
+
+//==================================================================
+// Treadmill link
+//==================================================================
+
+/*
+ *  TREADMILL_setSpeed gives no sign of what a command costs the loop or
+ *  whether its socket blocked. The engine's link sends the commands of
+ *  TREADMILL_setSpeed itself, over UDP as after TREADMILL_initializeUDP:
+ *  its packet is built once, each command patches only its speeds, and
+ *  goes out on a non-blocking socket. Each send is timed; its result is
+ *  TREADMILL_OK, TREADMILL_SEND (not sent, the buffer full or the network
+ *  down) or
+ *  TREADMILL_NOT_CONNECTED. After a failed send a thread of the link
+ *  opens a new socket and resends the latest command, while commands in
+ *  between return TREADMILL_NOT_CONNECTED at once. The link does not
+ *  need the rest of the engine; times and errors are also in the live
+ *  metrics.
+ *
+ *  The packet layout, rear belts included, has not been checked against
+ *  treadmill0x2Dremote; run TreadmillPacketCheck before opening the link
+ *  on a real treadmill (see the ReadMe).
+ */
+
+#define TREADMILL_N_STATS  9  //!< Values of CortexEngine_TreadmillStats
+#define TREADMILL_STOPPED 30  //!< Not sent: the watchdog has stopped the belt
+
+//==================================================================
+
+/** This function opens the treadmill link; an open link is replaced.
+ *
+ *  Call it from the control loop's thread: with iCore 0 or more, that
+ *  thread is pinned to the core until CortexEngine_TreadmillClose.
+ *
+ * \param szAddress - Address of the treadmill's control PC, as for TREADMILL_initializeUDP.
+ * \param szPort - Its port, "4000".
+ * \param iCore - Core of the control loop, 0 based, -1 to leave the affinity.
+ *
+ * \return TREADMILL_OK or the error of TREADMILL_initializeUDP
+*/
+DLL int CortexEngine_TreadmillOpen(char* szAddress, char* szPort, int iCore);
+
+//==================================================================
+
+/** This function commands the belt speeds, as TREADMILL_setSpeed.
+ *
+ *  Once the watchdog has stopped the belt (CortexEngine_WatchdogTripped)
+ *  only a stop, both speeds 0, is sent.
+ *
+ * \param fLeft - Left belt speed (m/s).
+ * \param fRight - Right belt speed (m/s).
+ * \param fAccel - Acceleration (m/s^2).
+ *
+ * \return TREADMILL_OK, TREADMILL_SEND, TREADMILL_NOT_CONNECTED while
+ *         reconnecting or if the link is not open, or TREADMILL_STOPPED
+*/
+DLL int CortexEngine_TreadmillSetSpeed(double fLeft, double fRight, double fAccel);
+
+//==================================================================
+
+/** This function copies the link's counts: the commands, those sent,
+ *  send errors, commands while not connected, reconnections, the mean
+ *  and longest send (us), 1 if connected and 1 if the control thread is
+ *  pinned.
+ *
+ * \param pStats - Receives up to TREADMILL_N_STATS values.
+ * \param nStats - Length of pStats.
+ *
+ * \return RC_Okay, RC_ApiError if the link was never opened
+*/
+DLL int CortexEngine_TreadmillStats(double* pStats, int nStats);
+
+//==================================================================
+
+/** This function closes the link; its counts remain readable.
+ *
+ *  Call it from the thread that opened the link to restore its affinity.
+ *
+ * \return RC_Okay, RC_ApiError if the link is not open
+*/
+DLL int CortexEngine_TreadmillClose();
+
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
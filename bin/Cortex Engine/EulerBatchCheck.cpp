@@ -0,0 +1,126 @@
+/*=========================================================
+//
+// File: EulerBatchCheck.cpp
+//
+// Checks the batch Euler kernels against Cortex_ConstructRotationMatrix
+// and Cortex_ExtractEulerAngles of the linked SDK for ZYX .. XZY, and times
+// both; XYX .. ZYZ, which the SDK does not implement, are checked by
+// rebuilding the matrices from the angles.
+//
+// Usage: EulerBatchCheck [nSegments (100000)]
+//
+=============================================================================*/
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "SegmentEuler.h"
+
+using namespace CortexEngine;
+
+namespace
+{
+
+const double MATRIX_TOL = 1e-12;
+const double ANGLE_TOL = 1e-9; // degrees
+const double DEG = 3.14159265358979323846 / 180.0;
+
+double Seconds(std::chrono::steady_clock::time_point t0)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    int n = argc > 1 ? std::atoi(argv[1]) : 100000;
+    if (n <= 0)
+        return 1;
+
+    std::mt19937 Rng(1);
+    std::uniform_real_distribution<double> Angle(-180.0, 180.0);
+    std::vector<double> Segments((size_t)n * 7);
+    for (int i = 0; i < n; i++)
+    {
+        double* p = &Segments[(size_t)i * 7];
+        for (int k = 0; k < 7; k++)
+            p[k] = Angle(Rng);
+        // a few exact and gimbal lock angles
+        if (i % 97 == 0)
+            p[3 + i % 3] = 90.0 * (i % 5 - 2);
+    }
+
+    std::vector<double> Batch((size_t)n * 9), Single((size_t)n * 9);
+    std::vector<double> BatchAngles((size_t)n * 3), SingleAngles((size_t)n * 3);
+    bool bOk = true;
+
+    printf("order  matrix err   angle err    single (ns)  batch (ns)\n");
+    for (int iOrder = ZYX_ORDER; iOrder <= ZYZ_ORDER; iOrder++)
+    {
+        // the SDK builds the identity for XYX .. ZYZ: those are checked by
+        // rebuilding the matrices from the angles instead
+        bool bSdk = iOrder <= XZY_ORDER;
+        double tSingle = 0.0;
+        auto t0 = std::chrono::steady_clock::now();
+        if (bSdk)
+        {
+            for (int i = 0; i < n; i++)
+                Cortex_ConstructRotationMatrix(&Segments[(size_t)i * 7 + 3], iOrder,
+                                               (double(*)[3])&Single[(size_t)i * 9]);
+            for (int i = 0; i < n; i++)
+                Cortex_ExtractEulerAngles((double(*)[3])&Single[(size_t)i * 9], iOrder,
+                                          &SingleAngles[(size_t)i * 3]);
+            tSingle = Seconds(t0);
+        }
+
+        t0 = std::chrono::steady_clock::now();
+        Euler::Matrices(iOrder, &Segments[3], 7, n, &Batch[0]);
+        Euler::Angles(iOrder, bSdk ? &Single[0] : &Batch[0], n, &BatchAngles[0], 3);
+        double tBatch = Seconds(t0);
+
+        if (!bSdk)
+        {
+            Euler::Matrices(iOrder, &BatchAngles[0], 3, n, &Single[0]);
+            SingleAngles = BatchAngles;
+        }
+
+        double MatrixErr = 0.0, AngleErr = 0.0;
+        int nSkipped = 0;
+        for (int i = 0; i < n; i++)
+        {
+            const double* a = &SingleAngles[(size_t)i * 3];
+            // the rebuilt matrix is only as close as GIMBAL within the
+            // gimbal lock band; the SDK's XZY is wrong at gimbal lock with
+            // aZ near -90 (SegmentEuler.h)
+            if ((!bSdk && std::fabs(std::sin(a[1] * DEG)) <= Euler::GIMBAL) ||
+                (iOrder == XZY_ORDER && a[2] < -89.99))
+            {
+                nSkipped++;
+                continue;
+            }
+            for (int k = 0; k < 9; k++)
+                MatrixErr = std::fmax(MatrixErr, std::fabs(Batch[(size_t)i * 9 + k] - Single[(size_t)i * 9 + k]));
+            for (int k = 0; k < 3; k++)
+            {
+                // +180 and -180 are the same angle
+                double d = std::fabs(BatchAngles[(size_t)i * 3 + k] - a[k]);
+                AngleErr = std::fmax(AngleErr, std::fmin(d, std::fabs(d - 360.0)));
+            }
+        }
+        bool bPass = MatrixErr < MATRIX_TOL && AngleErr < ANGLE_TOL;
+        bOk &= bPass;
+        printf("%5d  %.3g  %.3g  %11.1f  %10.1f  %s", iOrder, MatrixErr, AngleErr,
+               1e9 * tSingle / n, 1e9 * tBatch / n, bPass ? "" : "FAIL");
+        if (!bSdk)
+            printf("  (rebuilt, not in the SDK)");
+        if (nSkipped)
+            printf("  (%d at gimbal lock not compared)", nSkipped);
+        printf("\n");
+    }
+    return bOk ? 0 : 1;
+}
@@ -0,0 +1,175 @@
+/*=========================================================
+//
+// File: FrameConverter.cpp
+//
+// Treadmill signals derived from one Cortex frame.
+//
+=============================================================================*/
+
+#include "FrameConverter.h"
+
+#include <cmath>
+#include <cstddef>
+
+#include "Trace.h"
+
+namespace CortexEngine
+{
+
+ConverterParams::ConverterParams()
+{
+    // channels 4, 5, 11 and 12 in MATLAB
+    iChannel[0] = 3;
+    iChannel[1] = 4;
+    iChannel[2] = 10;
+    iChannel[3] = 11;
+
+    // Bertec scaling, Fy 500 and Fz 1000 N/V
+    Gain[0] = 500.0f;
+    Gain[1] = 1000.0f;
+    Gain[2] = 500.0f;
+    Gain[3] = 1000.0f;
+
+    VoltsPerBit = 10.0f / 65536.0f; // +-5 V over 16 bits
+    OnThresh = 25.0f;
+    OffThresh = 15.0f;
+
+    ZeroSeconds = 2.0f;
+    ZeroGuard = 0.1f;
+    ZeroBand = 10.0f;
+    FrameRate = 100.0f;
+}
+
+FrameConverter::FrameConverter(const ConverterParams& Params)
+    : m_Params(Params)
+    , m_iFirstFrame(-1)
+    , m_FrameRate(Params.FrameRate)
+{
+    for (int c = 0; c < 4; c++)
+        m_Offset[c] = 0.0f;
+    for (int j = 0; j < 2; j++)
+    {
+        m_bContact[j] = false;
+        m_Unloaded[j] = 0.0f;
+    }
+}
+
+void FrameConverter::Convert(const sFrameOfData& f, DerivedFrame& D)
+{
+    TraceScope Span(TRACE_CONVERT, f.iFrame);
+    const sAnalogData& A = f.AnalogData;
+    D.iFrame = f.iFrame;
+    D.fDelay = f.fDelay;
+    D.nSamples = A.nAnalogSamples;
+
+    // frame rate from the frame numbers, which count dropped frames, and
+    // the arrival times, once they span a second
+    const std::chrono::steady_clock::time_point Arrival = std::chrono::steady_clock::now();
+    if (m_iFirstFrame < 0 || f.iFrame < m_iFirstFrame)
+    {
+        m_iFirstFrame = f.iFrame;
+        m_FirstArrival = Arrival;
+    }
+    else
+    {
+        const double Span = std::chrono::duration<double>(Arrival - m_FirstArrival).count();
+        if (Span >= 1.0 && f.iFrame > m_iFirstFrame)
+            m_FrameRate = (double)(f.iFrame - m_iFirstFrame) / Span;
+    }
+
+    // analog samples are interleaved, nAnalogChannels per sample; the
+    // counts of each channel come out of the same loop
+    float MeanCounts[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    bool bValid = A.nAnalogSamples > 0;
+    for (int c = 0; c < 4; c++)
+    {
+        std::vector<float>& F = D.F[c];
+        F.resize(A.nAnalogSamples);
+        int iChannel = m_Params.iChannel[c];
+        float Scale = m_Params.VoltsPerBit * m_Params.Gain[c];
+        D.Zero[c] = Scale * m_Offset[c];
+        if (iChannel >= A.nAnalogChannels || !A.AnalogSamples)
+        {
+            for (int s = 0; s < A.nAnalogSamples; s++)
+                F[s] = 0.0f;
+            bValid = false;
+            continue;
+        }
+        const short* p = A.AnalogSamples + iChannel;
+        const float Offset = m_Offset[c];
+        float Sum = 0.0f;
+        for (int s = 0; s < A.nAnalogSamples; s++, p += A.nAnalogChannels)
+        {
+            const float x = (float)*p;
+            F[s] = Scale * (x - Offset);
+            Sum += x;
+        }
+        MeanCounts[c] = A.nAnalogSamples > 0 ? Sum / (float)A.nAnalogSamples : 0.0f;
+    }
+
+    // contact on every vertical sample, with ContactDetect's hysteresis,
+    // and how far the force varied within the frame
+    bool bTouched[2];
+    float Spread[2];
+    for (int j = 0; j < 2; j++)
+    {
+        const std::vector<float>& Fz = D.F[2 * j + 1];
+        bool bOn = m_bContact[j];
+        bTouched[j] = bOn;
+        float Sum = 0.0f;
+        float Min = Fz.empty() ? 0.0f : Fz[0];
+        float Max = Min;
+        for (std::size_t s = 0; s < Fz.size(); s++)
+        {
+            const float x = Fz[s];
+            Sum += x;
+            Min = std::fmin(Min, x);
+            Max = std::fmax(Max, x);
+            if (x > m_Params.OnThresh)
+                bOn = true;
+            else if (x < m_Params.OffThresh)
+                bOn = false;
+            bTouched[j] = bTouched[j] || bOn;
+        }
+        m_bContact[j] = bOn;
+        D.MeanFz[j] = Fz.empty() ? 0.0f : Sum / (float)Fz.size();
+        D.On[j] = bOn ? 1 : 0;
+        Spread[j] = Max - Min;
+    }
+
+    // a plate out of contact since before this frame, with a steady force
+    // at whatever offset, re-zeros its channels for the next one
+    const float Period = 1.0f / (float)m_FrameRate;
+    for (int j = 0; j < 2; j++)
+    {
+        const bool bOff = bValid && !bTouched[j];
+        if (bOff && m_Unloaded[j] >= m_Params.ZeroGuard && Spread[j] < m_Params.ZeroBand
+            && m_Params.ZeroSeconds > 0.0f)
+        {
+            const float a = 1.0f - std::exp(-Period / m_Params.ZeroSeconds);
+            for (int c = 2 * j; c < 2 * j + 2; c++)
+                m_Offset[c] += a * (MeanCounts[c] - m_Offset[c]);
+        }
+        m_Unloaded[j] = bOff ? m_Unloaded[j] + Period : 0.0f;
+    }
+
+    // CoPs as SelfPaceTM (Forces rows 3 and 4 in MATLAB), plates
+    // alternate within each force sample
+    for (int j = 0; j < 2; j++)
+    {
+        D.CoPy[j] = 0.0f;
+        D.CoPx[j] = 0.0f;
+        if (j >= A.nForcePlates || A.nForceSamples <= 0 || !A.Forces)
+            continue;
+        for (int s = 0; s < A.nForceSamples; s++)
+        {
+            const tForceData& P = A.Forces[s * A.nForcePlates + j];
+            D.CoPy[j] += P[2];
+            D.CoPx[j] += P[3];
+        }
+        D.CoPy[j] /= (float)A.nForceSamples;
+        D.CoPx[j] /= (float)A.nForceSamples;
+    }
+}
+
+} // namespace CortexEngine
@@ -0,0 +1,94 @@
+/*=========================================================
+//
+// File: FrameConverter.h
+//
+// Treadmill signals derived from one Cortex frame, as computed in
+// SelfPaceTM.m and FixedSpeedTM.m, less the plates' drifting zero
+// (PlateZero.m).
+//
+=============================================================================*/
+
+#ifndef FrameConverter_H
+#define FrameConverter_H
+
+#include <chrono>
+#include <vector>
+
+#include "MatlabCortex.h"
+
+namespace CortexEngine
+{
+
+/** Where the treadmill plates are in the frame and how to scale them */
+struct ConverterParams
+{
+    ConverterParams();
+
+    int   iChannel[4];  //!< analog channels (0 based) of F1Y, F1Z, F2Y, F2Z
+    float Gain[4];      //!< N per volt of each channel (LoadScale.m)
+    float VoltsPerBit;  //!< ADC resolution (bits2volts.m)
+    float OnThresh;     //!< vertical force (N) contact begins above, as ContactDetect.m
+    float OffThresh;    //!< and ends below
+
+    // zero tracking, as PlateZero.m
+    float ZeroSeconds;  //!< time constant of the offsets, in unloaded time (0 off)
+    float ZeroGuard;    //!< unloaded time (s) before a plate's frames count
+    float ZeroBand;     //!< largest spread (N) of an unloaded frame's vertical force
+    float FrameRate;    //!< Hz, until measured from the frames
+};
+
+/** Forces, CoPs and stance flags of one frame */
+struct DerivedFrame
+{
+    int   iFrame;
+    float fDelay;
+    int   nSamples;
+    std::vector<float> F[4];  //!< F1Y, F1Z, F2Y, F2Z per analog sample (N)
+    float MeanFz[2];          //!< mean vertical force, right (plate 1) and left (N)
+    float CoPy[2];            //!< mean fore/aft CoP, right and left (m)
+    float CoPx[2];            //!< mean lateral CoP, right and left (m)
+    int   On[2];              //!< contact at the last sample, right and left
+    float Zero[4];            //!< zero offsets taken off F1Y .. F2Z (N)
+};
+
+/** Scales the plate channels and follows the drift of their zero
+ *
+ *  The offsets are subtracted in the scaling loop, which also sums each
+ *  channel's counts. Contact is decided on every vertical sample with
+ *  hysteresis, between OnThresh and OffThresh, in the loop that averages
+ *  them. A plate with no contact in the frame, none for ZeroGuard before
+ *  it, and a vertical force that varied by less than ZeroBand, whatever
+ *  its level, then moves the offsets of its two channels toward the
+ *  frame's mean counts, with a time constant of ZeroSeconds of such
+ *  frames; the next frame is converted with them. No pass is added over
+ *  the samples. Offsets start at 0, from the plates as zeroed in Cortex.
+ *
+ *  The guard and time constant are counted in frames at the frame rate
+ *  measured from Cortex's frame numbers, which advance over dropped
+ *  frames too, and the arrival times, once they span a second; FrameRate
+ *  stands in until then.
+ */
+class FrameConverter
+{
+public:
+    explicit FrameConverter(const ConverterParams& Params = ConverterParams());
+
+    /** Fill D from f, a new frame; reuses D's buffers, so no allocation
+     *  once warmed up */
+    void Convert(const sFrameOfData& f, DerivedFrame& D);
+
+    const ConverterParams& Params() const { return m_Params; }
+
+private:
+    ConverterParams m_Params;
+    float m_Offset[4];   // counts
+    bool m_bContact[2];  // at the last sample converted
+    float m_Unloaded[2]; // s each plate has been out of contact
+    int m_iFirstFrame;   // and its arrival, for the frame rate
+    std::chrono::steady_clock::time_point m_FirstArrival;
+    double m_FrameRate;
+};
+
+} // namespace CortexEngine
+
+#endif
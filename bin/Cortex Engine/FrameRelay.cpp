@@ -0,0 +1,133 @@
+/*=========================================================
+//
+// File: FrameRelay.cpp
+//
+// SDK2 relay of augmented frames.
+//
+=============================================================================*/
+
+#include "FrameRelay.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace CortexEngine
+{
+
+namespace
+{
+
+short Saturate(float x)
+{
+    x = std::floor(x + 0.5f);
+    if (x > 32767.0f)
+        return 32767;
+    if (x < -32768.0f)
+        return -32768;
+    return (short)x;
+}
+
+} // namespace
+
+FrameRelay::FrameRelay(SendFunc Send, const ConverterParams& Params)
+    : m_Send(Send), m_Converter(Params), m_iLastFrame(-1),
+      m_Speed(0.0f), m_Fp(0.0f), m_nForwarded(0), m_nRepeated(0),
+      m_nFailed(0), m_TotalMicros(0), m_MaxMicros(0)
+{
+    if (!m_Send)
+        m_Send = Cortex_SendDataToClients;
+    std::memset(&m_Out, 0, sizeof(m_Out));
+}
+
+void FrameRelay::SetState(float Speed, float Fp)
+{
+    m_Speed.store(Speed);
+    m_Fp.store(Fp);
+}
+
+void FrameRelay::OnFrame(const sFrameOfData* pFrame)
+{
+    if (!pFrame)
+        return;
+    std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+
+    // forward each frame once
+    if (pFrame->iFrame == m_iLastFrame)
+    {
+        m_nRepeated++;
+        return;
+    }
+    m_iLastFrame = pFrame->iFrame;
+
+    m_Converter.Convert(*pFrame, m_Derived);
+
+    // share everything but the analog samples with the incoming frame
+    const sFrameOfData& In = *pFrame;
+    m_Out.iFrame = In.iFrame;
+    m_Out.fDelay = In.fDelay;
+    m_Out.nBodies = In.nBodies < MAX_N_BODIES ? In.nBodies : MAX_N_BODIES;
+    std::memcpy(m_Out.BodyData, In.BodyData, m_Out.nBodies * sizeof(sBodyData));
+    m_Out.nUnidentifiedMarkers = In.nUnidentifiedMarkers;
+    m_Out.UnidentifiedMarkers = In.UnidentifiedMarkers;
+    m_Out.AnalogData = In.AnalogData;
+    m_Out.RecordingStatus = In.RecordingStatus;
+    m_Out.TimeCode = In.TimeCode;
+
+    // widen each analog sample with the derived channels
+    const int nIn = In.AnalogData.nAnalogChannels;
+    const int nOut = nIn + RELAY_N_CHANNELS;
+    const int nSamples = In.AnalogData.nAnalogSamples;
+    if ((int)m_Samples.size() < nOut * nSamples)
+        m_Samples.resize(nOut * nSamples);
+
+    const DerivedFrame& D = m_Derived;
+    short Row[RELAY_N_CHANNELS];
+    Row[RELAY_COP1Y] = Saturate(1000.0f * D.CoPy[0]);
+    Row[RELAY_COP2Y] = Saturate(1000.0f * D.CoPy[1]);
+    Row[RELAY_RIGHTON] = (short)D.On[0];
+    Row[RELAY_LEFTON] = (short)D.On[1];
+    Row[RELAY_SPEED] = Saturate(1000.0f * m_Speed.load());
+    Row[RELAY_FP] = Saturate(10.0f * m_Fp.load());
+
+    const short* pIn = In.AnalogData.AnalogSamples;
+    short* pOut = nSamples > 0 ? &m_Samples[0] : NULL;
+    for (int s = 0; s < nSamples; s++)
+    {
+        if (nIn > 0 && pIn)
+            std::memcpy(pOut, pIn + s * nIn, nIn * sizeof(short));
+        Row[RELAY_F1Y] = Saturate(10.0f * D.F[0][s]);
+        Row[RELAY_F1Z] = Saturate(10.0f * D.F[1][s]);
+        Row[RELAY_F2Y] = Saturate(10.0f * D.F[2][s]);
+        Row[RELAY_F2Z] = Saturate(10.0f * D.F[3][s]);
+        std::memcpy(pOut + nIn, Row, sizeof(Row));
+        pOut += nOut;
+    }
+    m_Out.AnalogData.nAnalogChannels = nOut;
+    m_Out.AnalogData.AnalogSamples = nSamples > 0 ? &m_Samples[0] : NULL;
+
+    if (m_Send(&m_Out) == RC_Okay)
+        m_nForwarded++;
+    else
+        m_nFailed++;
+
+    long long Micros = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - Start).count();
+    m_TotalMicros += Micros;
+    if (Micros > m_MaxMicros.load())
+        m_MaxMicros.store(Micros); // only the data thread writes
+}
+
+RelayStats FrameRelay::Stats() const
+{
+    RelayStats S;
+    S.nForwarded = m_nForwarded.load();
+    S.nRepeated = m_nRepeated.load();
+    S.nFailed = m_nFailed.load();
+    int nSent = S.nForwarded + S.nFailed;
+    S.MeanMicros = nSent > 0 ? (double)m_TotalMicros.load() / nSent : 0.0;
+    S.MaxMicros = (double)m_MaxMicros.load();
+    return S;
+}
+
+} // namespace CortexEngine
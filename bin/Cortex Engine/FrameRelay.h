@@ -0,0 +1,91 @@
+/*=========================================================
+//
+// File: FrameRelay.h
+//
+// SDK2 relay: forwards each Cortex frame to SDK2 clients with the
+// treadmill signals appended as extra analog channels.
+//
+=============================================================================*/
+
+#ifndef FrameRelay_H
+#define FrameRelay_H
+
+#include <atomic>
+#include <functional>
+#include <vector>
+
+#include "FrameConverter.h"
+#include "MatlabCortex.h"
+
+namespace CortexEngine
+{
+
+/** Derived channels appended after Cortex's analog channels, in order */
+enum RelayChannel
+{
+    RELAY_F1Y,      //!< right fore/aft force, 0.1 N
+    RELAY_F1Z,      //!< right vertical force, 0.1 N
+    RELAY_F2Y,      //!< left fore/aft force, 0.1 N
+    RELAY_F2Z,      //!< left vertical force, 0.1 N
+    RELAY_COP1Y,    //!< right fore/aft CoP, mm
+    RELAY_COP2Y,    //!< left fore/aft CoP, mm
+    RELAY_RIGHTON,  //!< right stance flag
+    RELAY_LEFTON,   //!< left stance flag
+    RELAY_SPEED,    //!< last commanded belt speed, mm/s
+    RELAY_FP,       //!< latest mean peak propulsive force, 0.1 N
+    RELAY_N_CHANNELS
+};
+
+/** Relay statistics */
+struct RelayStats
+{
+    int    nForwarded;   //!< frames sent to clients
+    int    nRepeated;    //!< frames seen again and not re-sent
+    int    nFailed;      //!< sends that did not return RC_Okay
+    double MeanMicros;   //!< time from frame arrival to send returning (us)
+    double MaxMicros;
+};
+
+/** Builds the augmented frame in place and sends it once
+ *
+ *  OnFrame runs on the SDK's data thread. The outgoing frame shares
+ *  the incoming frame's body, marker and force data; only the analog
+ *  samples are rewritten, into a buffer reused from frame to frame.
+ *  One Cortex_SendDataToClients multicast serves every client, so the
+ *  cost is fixed per frame and does not grow with the number of clients.
+ */
+class FrameRelay
+{
+public:
+    typedef std::function<int(sFrameOfData*)> SendFunc;
+
+    explicit FrameRelay(SendFunc Send = SendFunc(),
+                        const ConverterParams& Params = ConverterParams());
+
+    void OnFrame(const sFrameOfData* pFrame);
+
+    /** Controller state carried on the next frames, any thread */
+    void SetState(float Speed, float Fp);
+
+    RelayStats Stats() const;
+
+private:
+    SendFunc m_Send;
+    FrameConverter m_Converter;
+    DerivedFrame m_Derived;
+    sFrameOfData m_Out;
+    std::vector<short> m_Samples;
+    int m_iLastFrame;
+    std::atomic<float> m_Speed;
+    std::atomic<float> m_Fp;
+
+    std::atomic<int> m_nForwarded;
+    std::atomic<int> m_nRepeated;
+    std::atomic<int> m_nFailed;
+    std::atomic<long long> m_TotalMicros;
+    std::atomic<long long> m_MaxMicros;
+};
+
+} // namespace CortexEngine
+
+#endif
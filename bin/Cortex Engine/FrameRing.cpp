@@ -0,0 +1,188 @@
+/*=========================================================
+//
+// File: FrameRing.cpp
+//
+// Ring of the last frames from Cortex, see FrameRing.h
+//
+=============================================================================*/
+
+#include "FrameRing.h"
+
+#include <cstddef>
+#include <cstring>
+#include <limits>
+
+namespace CortexEngine
+{
+
+RingLimits::RingLimits()
+    : nSlots(1024), nMaxMarkers(256), nMaxAnalog(64 * 32), nMaxForces(4 * 32)
+{
+}
+
+FrameRing::FrameRing(const RingLimits& Limits)
+    : m_Limits(Limits), m_iLastFrame(-1), m_nRepeated(0)
+{
+    RingLimits Defaults;
+    if (m_Limits.nSlots <= 0) m_Limits.nSlots = Defaults.nSlots;
+    if (m_Limits.nMaxMarkers <= 0) m_Limits.nMaxMarkers = Defaults.nMaxMarkers;
+    if (m_Limits.nMaxAnalog <= 0) m_Limits.nMaxAnalog = Defaults.nMaxAnalog;
+    if (m_Limits.nMaxForces <= 0) m_Limits.nMaxForces = Defaults.nMaxForces;
+
+    const std::size_t nSlots = (std::size_t)m_Limits.nSlots;
+    m_Headers.assign(nSlots, sRingFrame());
+    m_Markers.assign(nSlots * m_Limits.nMaxMarkers * 3, 0.0f);
+    m_Analog.assign(nSlots * m_Limits.nMaxAnalog, 0);
+    m_Forces.assign(nSlots * m_Limits.nMaxForces * 7, 0.0f);
+    m_Stamps.reset(new std::atomic<long long>[nSlots]);
+    for (std::size_t i = 0; i < nSlots; i++)
+        m_Stamps[i].store(0);
+}
+
+void FrameRing::Push(const sFrameOfData& f, double Time)
+{
+    if (f.iFrame == m_iLastFrame)
+    {
+        m_nRepeated++;
+        return;
+    }
+    m_iLastFrame = f.iFrame;
+
+    const long long Seq = m_Signal.Latest() + 1;
+    const int iSlot = Slot(Seq);
+    const RingLimits& L = m_Limits;
+
+    // readers that see 0 here, or a different Seq afterwards, drop the slot
+    m_Stamps[iSlot].store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    sRingFrame& H = m_Headers[iSlot];
+    H.Seq = 0;
+    H.iFrame = f.iFrame;
+    H.fDelay = f.fDelay;
+    H.fTime = Time;
+    H.bTruncated = 0;
+
+    float* pMarkers = &m_Markers[(std::size_t)iSlot * L.nMaxMarkers * 3];
+    int nMarkers = 0;
+    for (int b = 0; b < f.nBodies && b < MAX_N_BODIES; b++)
+    {
+        const sBodyData& B = f.BodyData[b];
+        int n = B.nMarkers;
+        if (nMarkers + n > L.nMaxMarkers)
+        {
+            n = L.nMaxMarkers - nMarkers;
+            H.bTruncated = 1;
+        }
+        if (n > 0 && B.Markers)
+            std::memcpy(pMarkers + nMarkers * 3, B.Markers, n * sizeof(tMarkerData));
+        nMarkers += n > 0 ? n : 0;
+    }
+    H.nMarkers = nMarkers;
+
+    const sAnalogData& A = f.AnalogData;
+    H.nAnalogChannels = A.nAnalogChannels;
+    H.nAnalogSamples = A.nAnalogSamples;
+    if (A.nAnalogChannels * A.nAnalogSamples > L.nMaxAnalog)
+    {
+        H.nAnalogSamples = A.nAnalogChannels > 0 ? L.nMaxAnalog / A.nAnalogChannels : 0;
+        H.bTruncated = 1;
+    }
+    if (A.AnalogSamples && H.nAnalogChannels * H.nAnalogSamples > 0)
+        std::memcpy(&m_Analog[(std::size_t)iSlot * L.nMaxAnalog], A.AnalogSamples,
+                    H.nAnalogChannels * H.nAnalogSamples * sizeof(short));
+
+    H.nForcePlates = A.nForcePlates;
+    H.nForceSamples = A.nForceSamples;
+    if (A.nForcePlates * A.nForceSamples > L.nMaxForces)
+    {
+        H.nForceSamples = A.nForcePlates > 0 ? L.nMaxForces / A.nForcePlates : 0;
+        H.bTruncated = 1;
+    }
+    if (A.Forces && H.nForcePlates * H.nForceSamples > 0)
+        std::memcpy(&m_Forces[(std::size_t)iSlot * L.nMaxForces * 7], A.Forces,
+                    H.nForcePlates * H.nForceSamples * sizeof(tForceData));
+
+    H.Seq = Seq;
+    m_Stamps[iSlot].store(Seq, std::memory_order_release);
+    m_Signal.Publish(Seq);
+}
+
+bool FrameRing::Valid(long long Seq) const
+{
+    if (Seq <= 0)
+        return false;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return m_Stamps[Slot(Seq)].load(std::memory_order_acquire) == Seq;
+}
+
+int FrameRing::Drain(long long Since, int nMaxFrames,
+                     const int* piChannels, int nChannels, int nMaxSamples,
+                     const int* piMarkers, int nMarkers,
+                     double* pInfo, double* pAnalog, double* pMarkers) const
+{
+    const double NaN = std::numeric_limits<double>::quiet_NaN();
+    const RingLimits& L = m_Limits;
+    const std::size_t nRows = (std::size_t)nMaxFrames;
+    const std::size_t nAnalogRows = nRows * (nMaxSamples > 0 ? nMaxSamples : 0);
+
+    long long Head = this->Head();
+    long long First = Since + 1;
+    if (First < Head - L.nSlots + 1)
+        First = Head - L.nSlots + 1;
+    if (First < 1)
+        First = 1;
+
+    int n = 0;
+    std::size_t iSample = 0;
+    for (long long Seq = First; Seq <= Head && n < nMaxFrames; Seq++)
+    {
+        if (!Valid(Seq))
+            continue;
+        const int iSlot = Slot(Seq);
+        const sRingFrame& H = m_Headers[iSlot];
+        const short* pSlotAnalog = &m_Analog[(std::size_t)iSlot * L.nMaxAnalog];
+        const float* pSlotMarkers = &m_Markers[(std::size_t)iSlot * L.nMaxMarkers * 3];
+
+        int nSamples = H.nAnalogSamples;
+        if (nSamples > nMaxSamples)
+            nSamples = nMaxSamples > 0 ? nMaxSamples : 0;
+        if (pAnalog)
+        {
+            for (int c = 0; c < nChannels; c++)
+            {
+                int iCh = piChannels[c];
+                double* pOut = pAnalog + c * nAnalogRows + iSample;
+                for (int s = 0; s < nSamples; s++)
+                    pOut[s] = iCh >= 0 && iCh < H.nAnalogChannels
+                        ? pSlotAnalog[s * H.nAnalogChannels + iCh] : NaN;
+            }
+        }
+        if (pMarkers)
+        {
+            for (int m = 0; m < nMarkers; m++)
+            {
+                int iMarker = piMarkers[m];
+                bool bHave = iMarker >= 0 && iMarker < H.nMarkers;
+                for (int k = 0; k < 3; k++)
+                    pMarkers[(3 * m + k) * nRows + n] = bHave ? pSlotMarkers[3 * iMarker + k] : NaN;
+            }
+        }
+        if (pInfo)
+        {
+            pInfo[0 * nRows + n] = (double)Seq;
+            pInfo[1 * nRows + n] = H.iFrame;
+            pInfo[2 * nRows + n] = H.fTime;
+            pInfo[3 * nRows + n] = nSamples;
+        }
+
+        // overwritten while we copied: drop it, the next frames are newer
+        if (!Valid(Seq))
+            continue;
+        iSample += nSamples;
+        n++;
+    }
+    return n;
+}
+
+} // namespace CortexEngine
@@ -0,0 +1,107 @@
+/*=========================================================
+//
+// File: FrameRing.h
+//
+// The last frames from Cortex, kept in preallocated slots so that readers
+// slower than the camera rate do not lose frames.
+//
+=============================================================================*/
+
+#ifndef FrameRing_H
+#define FrameRing_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "CortexEngine.h"
+#include "FrameSignal.h"
+
+namespace CortexEngine
+{
+
+/** Size of the ring; data beyond a slot's capacity is dropped */
+struct RingLimits
+{
+    RingLimits();
+
+    int nSlots;       //!< frames kept
+    int nMaxMarkers;  //!< markers per frame, all bodies
+    int nMaxAnalog;   //!< analog values per frame (channels * samples)
+    int nMaxForces;   //!< force samples per frame (plates * samples)
+};
+
+/** Single writer (the SDK's data thread), any number of readers
+ *
+ *  Frames are numbered by a sequence that starts at 1 and are stored in
+ *  slot (Seq - 1) % nSlots. Each of the headers, markers, analog samples
+ *  and forces is one contiguous array over all slots, so a reader can
+ *  view the whole ring without copying. A slot is overwritten nSlots
+ *  frames later; Valid tells a reader whether what it read is still
+ *  the frame it asked for.
+ */
+class FrameRing
+{
+public:
+    explicit FrameRing(const RingLimits& Limits = RingLimits());
+
+    /** Store a frame; repeats of the last Cortex frame number are skipped */
+    void Push(const sFrameOfData& f, double Time);
+
+    /** Sequence of the latest frame, 0 before the first */
+    long long Head() const { return m_Signal.Latest(); }
+
+    /** Wait until Head() > Seq or msTimeout passes, then return Head() */
+    long long Wait(long long Seq, int msTimeout) { return m_Signal.Wait(Seq, msTimeout); }
+
+    /** Spin before sleeping in Wait, see FrameSignal */
+    void SetSpin(int usSpin) { m_Signal.SetSpin(usSpin); }
+
+    /** Wake all waiters for good, before the ring is released */
+    void Close() { m_Signal.Close(); }
+
+    /** Slot i holds frame Seq, completely written */
+    bool Valid(long long Seq) const;
+
+    /** Copy selected data of the frames after Since, oldest first
+     *
+     *  Outputs are column major (MATLAB) with nMaxFrames rows:
+     *  pInfo [nMaxFrames x 4] Seq, Cortex frame, Time, analog samples;
+     *  pAnalog [nMaxFrames * nMaxSamples x nChannels], the frames'
+     *  samples one after the other; pMarkers [nMaxFrames x 3 * nMarkers],
+     *  X, Y, Z of each selected marker, NaN where a frame has fewer.
+     *  Frames already overwritten are skipped and show as gaps in Seq.
+     *
+     *  \return frames copied
+     */
+    int Drain(long long Since, int nMaxFrames,
+              const int* piChannels, int nChannels, int nMaxSamples,
+              const int* piMarkers, int nMarkers,
+              double* pInfo, double* pAnalog, double* pMarkers) const;
+
+    int Slot(long long Seq) const { return (int)((Seq - 1) % m_Limits.nSlots); }
+    const RingLimits& Limits() const { return m_Limits; }
+
+    sRingFrame* Headers() { return &m_Headers[0]; }
+    float* Markers() { return &m_Markers[0]; }   //!< [nSlots][nMaxMarkers][3]
+    short* Analog() { return &m_Analog[0]; }     //!< [nSlots][nMaxAnalog]
+    float* Forces() { return &m_Forces[0]; }     //!< [nSlots][nMaxForces][7]
+
+    int Repeated() const { return m_nRepeated.load(); }
+
+private:
+    RingLimits m_Limits;
+    std::vector<sRingFrame> m_Headers;
+    std::vector<float> m_Markers;
+    std::vector<short> m_Analog;
+    std::vector<float> m_Forces;
+    std::unique_ptr<std::atomic<long long>[]> m_Stamps; // Seq per slot, 0 while written
+
+    FrameSignal m_Signal; // the head
+    int m_iLastFrame;
+    std::atomic<int> m_nRepeated;
+};
+
+} // namespace CortexEngine
+
+#endif
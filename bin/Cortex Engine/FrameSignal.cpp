@@ -0,0 +1,131 @@
+/*=========================================================
+//
+// File: FrameSignal.cpp
+//
+// Spin-then-sleep wait for new frames, see FrameSignal.h
+//
+=============================================================================*/
+
+#include "FrameSignal.h"
+
+#include <chrono>
+#include <climits>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#pragma comment(lib, "Synchronization.lib")
+#else
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#include <immintrin.h>
+#define CPU_RELAX() _mm_pause()
+#else
+#define CPU_RELAX() std::this_thread::yield()
+#endif
+
+namespace CortexEngine
+{
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+/** Sleep while *pWord == Expected, at most ns; may return early */
+void SleepOn(std::atomic<uint32_t>* pWord, uint32_t Expected, long long ns)
+{
+#ifdef _WIN32
+    DWORD ms = (DWORD)((ns + 999999) / 1000000);
+    WaitOnAddress(pWord, &Expected, sizeof(Expected), ms);
+#else
+    timespec Ts;
+    Ts.tv_sec = (time_t)(ns / 1000000000LL);
+    Ts.tv_nsec = (long)(ns % 1000000000LL);
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(pWord), FUTEX_WAIT_PRIVATE,
+            Expected, &Ts, NULL, 0);
+#endif
+}
+
+void WakeAll(std::atomic<uint32_t>* pWord)
+{
+#ifdef _WIN32
+    WakeByAddressAll(pWord);
+#else
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(pWord), FUTEX_WAKE_PRIVATE,
+            INT_MAX, NULL, NULL, 0);
+#endif
+}
+
+} // namespace
+
+FrameSignal::FrameSignal()
+    : m_Seq(0), m_Word(0), m_nSleepers(0), m_bClosed(false), m_usSpin(0)
+{
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+                  "the futex word must be a plain 32 bit integer");
+}
+
+void FrameSignal::Publish(long long Seq)
+{
+    m_Seq.store(Seq, std::memory_order_release);
+    // sequentially consistent with the sleepers' count: either a sleeper
+    // sees the new word and does not sleep, or it is counted here
+    m_Word.fetch_add(1);
+    if (m_nSleepers.load() > 0)
+        WakeAll(&m_Word);
+}
+
+void FrameSignal::Close()
+{
+    m_bClosed.store(true);
+    m_Word.fetch_add(1);
+    WakeAll(&m_Word);
+}
+
+long long FrameSignal::Wait(long long Seq, int msTimeout)
+{
+    if (Ready(Seq) || msTimeout <= 0)
+        return Latest();
+    const Clock::time_point Start = Clock::now();
+    const Clock::time_point Deadline = Start + std::chrono::milliseconds(msTimeout);
+
+    const int usSpin = m_usSpin.load();
+    if (usSpin != 0)
+    {
+        const Clock::time_point SpinEnd = usSpin < 0 ? Deadline
+            : Start + std::chrono::microseconds(usSpin);
+        const Clock::time_point Until = SpinEnd < Deadline ? SpinEnd : Deadline;
+        // read the clock every few pauses only, it costs more than a pause
+        for (int i = 0; !Ready(Seq); i++)
+        {
+            CPU_RELAX();
+            if ((i & 15) == 15 && Clock::now() >= Until)
+                break;
+        }
+        if (Ready(Seq) || usSpin < 0)
+            return Latest();
+    }
+
+    m_nSleepers.fetch_add(1);
+    for (;;)
+    {
+        const uint32_t Word = m_Word.load();
+        if (Ready(Seq))
+            break;
+        long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Deadline - Clock::now()).count();
+        if (ns <= 0)
+            break;
+        SleepOn(&m_Word, Word, ns);
+    }
+    m_nSleepers.fetch_sub(1);
+    return Latest();
+}
+
+} // namespace CortexEngine
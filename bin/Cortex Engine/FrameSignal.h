@@ -0,0 +1,66 @@
+/*=========================================================
+//
+// File: FrameSignal.h
+//
+// Wakes threads waiting for the next frame, without a lock on the data
+// thread and without a system call when nobody waits.
+//
+=============================================================================*/
+
+#ifndef FrameSignal_H
+#define FrameSignal_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace CortexEngine
+{
+
+/** The latest frame sequence, with waiting for a newer one
+ *
+ *  Waiters spin for up to the configured time, then sleep on the address
+ *  of a 32 bit word (a futex on Linux, WaitOnAddress on Windows) that
+ *  Publish changes. Publish only makes the wake-up call when a waiter is
+ *  asleep, so the data thread pays one atomic increment per frame
+ *  otherwise.
+ *
+ *  Spin: 0 sleeps at once (no CPU between frames, wake-up latency of the
+ *  scheduler); n > 0 spins n microseconds first, catching frames that come
+ *  sooner at the cost of that much CPU per wait; SPIN_ALWAYS never sleeps
+ *  (lowest latency, one core busy).
+ */
+class FrameSignal
+{
+public:
+    enum { SPIN_ALWAYS = -1 };
+
+    FrameSignal();
+
+    void SetSpin(int usSpin) { m_usSpin.store(usSpin); }
+    int Spin() const { return m_usSpin.load(); }
+
+    /** Make Seq the latest and wake the waiters; from one thread only */
+    void Publish(long long Seq);
+
+    /** Wake all waiters for good */
+    void Close();
+    bool Closed() const { return m_bClosed.load(); }
+
+    long long Latest() const { return m_Seq.load(std::memory_order_acquire); }
+
+    /** Wait until Latest() > Seq, Close or msTimeout, then return Latest() */
+    long long Wait(long long Seq, int msTimeout);
+
+private:
+    bool Ready(long long Seq) const { return Latest() > Seq || Closed(); }
+
+    std::atomic<long long> m_Seq;
+    std::atomic<uint32_t> m_Word;     // changed by every Publish and Close
+    std::atomic<int> m_nSleepers;
+    std::atomic<bool> m_bClosed;
+    std::atomic<int> m_usSpin;
+};
+
+} // namespace CortexEngine
+
+#endif
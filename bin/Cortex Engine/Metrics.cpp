@@ -0,0 +1,239 @@
+/*=========================================================
+//
+// File: Metrics.cpp
+//
+// Loop health counters and their Prometheus exposition, see Metrics.h
+//
+=============================================================================*/
+
+#include "Metrics.h"
+
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+
+#include "treadmill0x2Dremote.h"
+
+namespace CortexEngine
+{
+
+namespace
+{
+
+const std::memory_order Relaxed = std::memory_order_relaxed;
+
+// frame intervals of 100 to 300 Hz fall in the middle buckets
+const double INTERVAL_BOUNDS[Histogram::N_BOUNDS] = {
+    0.002, 0.003, 0.004, 0.005, 0.006, 0.008, 0.01, 0.0125, 0.015, 0.02, 0.05, 0.1
+};
+const double HANDLER_BOUNDS[Histogram::N_BOUNDS] = {
+    5e-6, 1e-5, 2e-5, 5e-5, 1e-4, 2e-4, 5e-4, 1e-3, 2e-3, 5e-3, 1e-2, 5e-2
+};
+const double LOOP_BOUNDS[Histogram::N_BOUNDS] = {
+    5e-4, 1e-3, 2e-3, 3e-3, 5e-3, 7.5e-3, 0.01, 0.015, 0.02, 0.05, 0.1, 0.5
+};
+// a datagram handed to the socket takes microseconds
+const double SEND_BOUNDS[Histogram::N_BOUNDS] = {
+    2e-6, 5e-6, 1e-5, 2e-5, 5e-5, 1e-4, 2e-4, 5e-4, 1e-3, 2e-3, 5e-3, 1e-2
+};
+
+void Append(std::string& Out, const char* szFormat, ...)
+{
+    char Line[256];
+    va_list Args;
+    va_start(Args, szFormat);
+    int n = vsnprintf(Line, sizeof(Line), szFormat, Args);
+    va_end(Args);
+    if (n > 0)
+        Out.append(Line, n < (int)sizeof(Line) ? n : (int)sizeof(Line) - 1);
+}
+
+void Header(std::string& Out, const char* szName, const char* szType, const char* szHelp)
+{
+    Append(Out, "# HELP %s %s\n# TYPE %s %s\n", szName, szHelp, szName, szType);
+}
+
+void Counter(std::string& Out, const char* szName, const char* szHelp, unsigned long long n)
+{
+    Header(Out, szName, "counter", szHelp);
+    Append(Out, "%s %llu\n", szName, n);
+}
+
+void Gauge(std::string& Out, const char* szName, const char* szHelp, double Value)
+{
+    Header(Out, szName, "gauge", szHelp);
+    if (std::isnan(Value))
+        Append(Out, "%s NaN\n", szName);
+    else
+        Append(Out, "%s %.9g\n", szName, Value);
+}
+
+} // namespace
+
+//==================================================================
+
+Histogram::Histogram(const double (&Bounds)[N_BOUNDS])
+    : m_SumNs(0)
+{
+    for (int i = 0; i < N_BOUNDS; i++)
+    {
+        m_Bounds[i] = Bounds[i];
+        m_BoundsNs[i] = (long long)(Bounds[i] * 1e9 + 0.5);
+    }
+    for (int i = 0; i <= N_BOUNDS; i++)
+        m_Counts[i].store(0, Relaxed);
+}
+
+void Histogram::Observe(long long ns)
+{
+    int i = 0;
+    while (i < N_BOUNDS && ns > m_BoundsNs[i])
+        i++;
+    m_Counts[i].fetch_add(1, Relaxed);
+    m_SumNs.fetch_add(ns, Relaxed);
+}
+
+void Histogram::Render(std::string& Out, const char* szName, const char* szHelp) const
+{
+    Header(Out, szName, "histogram", szHelp);
+    // buckets are counted apart and summed here, so the count always
+    // matches the +Inf bucket; the sum may be a sample ahead
+    unsigned long long n = 0;
+    for (int i = 0; i < N_BOUNDS; i++)
+    {
+        n += m_Counts[i].load(Relaxed);
+        Append(Out, "%s_bucket{le=\"%g\"} %llu\n", szName, m_Bounds[i], n);
+    }
+    n += m_Counts[N_BOUNDS].load(Relaxed);
+    Append(Out, "%s_bucket{le=\"+Inf\"} %llu\n", szName, n);
+    Append(Out, "%s_sum %.9g\n", szName, 1e-9 * (double)m_SumNs.load(Relaxed));
+    Append(Out, "%s_count %llu\n", szName, n);
+}
+
+//==================================================================
+
+Metrics::Metrics()
+    : m_nFrames(0), m_nRepeated(0), m_nDropped(0), m_iLastFrame(-1), m_LastArrival(0),
+      m_Delay(0.0f), m_Interval(INTERVAL_BOUNDS), m_Handler(HANDLER_BOUNDS),
+      m_nLoops(0), m_nCommands(0), m_Loop(LOOP_BOUNDS),
+      m_Speed(NAN), m_Fp(NAN), m_Send(SEND_BOUNDS), m_nSendErrors(0), m_nNotConnected(0)
+{
+    for (int i = 0; i < N_ARRIVALS; i++)
+    {
+        m_ArrivalFrame[i].store(-1, Relaxed);
+        m_ArrivalTime[i].store(0, Relaxed);
+    }
+    for (int k = 0; k < 4; k++)
+        m_nSignalAlerts[k].store(0, Relaxed);
+}
+
+void Metrics::OnFrame(int iFrame, float fDelay, long long Now)
+{
+    // only the data thread writes these, loads and stores suffice
+    const int iLast = m_iLastFrame.load(Relaxed);
+    if (iFrame == iLast)
+    {
+        m_nRepeated.fetch_add(1, Relaxed);
+        return;
+    }
+    if (iLast >= 0 && iFrame > iLast + 1)
+        m_nDropped.fetch_add(iFrame - iLast - 1, Relaxed);
+    const long long Last = m_LastArrival.load(Relaxed);
+    if (Last > 0)
+        m_Interval.Observe(Now - Last);
+    m_nFrames.fetch_add(1, Relaxed);
+    m_iLastFrame.store(iFrame, Relaxed);
+    m_LastArrival.store(Now, Relaxed);
+    m_Delay.store(fDelay, Relaxed);
+
+    // frame last, OnLoop checks it before and after reading the time
+    const int i = iFrame & (N_ARRIVALS - 1);
+    m_ArrivalFrame[i].store(-1, std::memory_order_release);
+    m_ArrivalTime[i].store(Now, std::memory_order_release);
+    m_ArrivalFrame[i].store(iFrame, std::memory_order_release);
+}
+
+void Metrics::OnHandler(long long ns)
+{
+    m_Handler.Observe(ns);
+}
+
+void Metrics::OnLoop(int iFrame, bool bCommand, long long Now)
+{
+    m_nLoops.fetch_add(1, Relaxed);
+    if (bCommand)
+        m_nCommands.fetch_add(1, Relaxed);
+    if (iFrame < 0)
+        return;
+    // frames older than the table, or overwritten meanwhile, are not timed
+    const int i = iFrame & (N_ARRIVALS - 1);
+    if (m_ArrivalFrame[i].load(std::memory_order_acquire) != iFrame)
+        return;
+    const long long Arrival = m_ArrivalTime[i].load(std::memory_order_acquire);
+    if (m_ArrivalFrame[i].load(std::memory_order_acquire) != iFrame)
+        return;
+    if (Now >= Arrival)
+        m_Loop.Observe(Now - Arrival);
+}
+
+void Metrics::SetState(float Speed, float Fp)
+{
+    m_Speed.store(Speed, Relaxed);
+    m_Fp.store(Fp, Relaxed);
+}
+
+void Metrics::OnSignalAlerts(int Alerts)
+{
+    for (int k = 0; k < 4; k++)
+        if (Alerts & (1 << k))
+            m_nSignalAlerts[k].fetch_add(1, Relaxed);
+}
+
+void Metrics::OnTreadmillSend(int iResult, long long ns)
+{
+    if (ns >= 0)
+        m_Send.Observe(ns);
+    if (iResult == TREADMILL_SEND)
+        m_nSendErrors.fetch_add(1, Relaxed);
+    else if (iResult == TREADMILL_NOT_CONNECTED)
+        m_nNotConnected.fetch_add(1, Relaxed);
+}
+
+std::string Metrics::Render(long long Now) const
+{
+    std::string Out;
+    Out.reserve(8192);
+    Counter(Out, "cortex_frames_total", "Frames received from Cortex.", m_nFrames.load(Relaxed));
+    Counter(Out, "cortex_frames_repeated_total", "Frames received again with the same frame number.",
+            m_nRepeated.load(Relaxed));
+    Counter(Out, "cortex_frames_dropped_total", "Frame numbers skipped between received frames.",
+            m_nDropped.load(Relaxed));
+    m_Interval.Render(Out, "cortex_frame_interval_seconds", "Time between the arrivals of new frames.");
+    m_Handler.Render(Out, "cortex_frame_handler_seconds", "Time the engine spends on each frame on the data thread.");
+    Gauge(Out, "cortex_frame_delay_seconds", "Cortex's delay of the latest frame.", m_Delay.load(Relaxed));
+    const long long Last = m_LastArrival.load(Relaxed);
+    Gauge(Out, "cortex_frame_age_seconds", "Time since the latest frame arrived.",
+          Last > 0 ? 1e-9 * (double)(Now - Last) : NAN);
+    Gauge(Out, "cortex_frame_number", "Number of the latest frame.", (double)m_iLastFrame.load(Relaxed));
+
+    Counter(Out, "cortex_loop_iterations_total", "Frames the control loop reported done.", m_nLoops.load(Relaxed));
+    Counter(Out, "cortex_commands_total", "Speed commands the control loop sent.", m_nCommands.load(Relaxed));
+    m_Loop.Render(Out, "cortex_loop_latency_seconds", "Time from a frame's arrival to the control loop being done with it.");
+    Gauge(Out, "cortex_belt_speed_meters_per_second", "Last commanded belt speed.", m_Speed.load(Relaxed));
+    Gauge(Out, "cortex_fp_newtons", "Latest mean peak propulsive force.", m_Fp.load(Relaxed));
+
+    static const char* Kinds[4] = { "rail", "stuck", "spike", "noise" };
+    Header(Out, "cortex_analog_alert_seconds_total", "counter",
+           "Seconds in which a monitored analog channel raised an alert, summed over channels.");
+    for (int k = 0; k < 4; k++)
+        Append(Out, "cortex_analog_alert_seconds_total{kind=\"%s\"} %llu\n", Kinds[k],
+               m_nSignalAlerts[k].load(Relaxed));
+
+    m_Send.Render(Out, "cortex_treadmill_send_seconds", "Time the engine's treadmill link spends sending a command.");
+    Header(Out, "cortex_treadmill_errors_total", "counter", "Treadmill commands that were not sent.");
+    Append(Out, "cortex_treadmill_errors_total{error=\"send\"} %llu\n", m_nSendErrors.load(Relaxed));
+    Append(Out, "cortex_treadmill_errors_total{error=\"not_connected\"} %llu\n", m_nNotConnected.load(Relaxed));
+    return Out;
+}
+
+} // namespace CortexEngine
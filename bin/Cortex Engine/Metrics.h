@@ -0,0 +1,98 @@
+/*=========================================================
+//
+// File: Metrics.h
+//
+// Counters and histograms of loop health, in Prometheus text format.
+//
+=============================================================================*/
+
+#ifndef Metrics_H
+#define Metrics_H
+
+#include <atomic>
+#include <string>
+
+namespace CortexEngine
+{
+
+/** Fixed buckets of atomic counts; Observe takes no lock */
+class Histogram
+{
+public:
+    enum { N_BOUNDS = 12 };
+
+    /** Upper bounds in seconds, ascending; +Inf is added */
+    explicit Histogram(const double (&Bounds)[N_BOUNDS]);
+
+    void Observe(long long ns);
+
+    /** Append the _bucket, _sum and _count lines of metric szName */
+    void Render(std::string& Out, const char* szName, const char* szHelp) const;
+
+private:
+    double m_Bounds[N_BOUNDS];
+    long long m_BoundsNs[N_BOUNDS];
+    std::atomic<unsigned long long> m_Counts[N_BOUNDS + 1];
+    std::atomic<long long> m_SumNs;
+};
+
+/** What the scrape reports; written by the data thread and the control
+ *  loop with relaxed atomics only, read by the metrics server the same way
+ */
+class Metrics
+{
+public:
+    Metrics();
+
+    /** From the data thread as a frame arrives; Now in ns of steady_clock */
+    void OnFrame(int iFrame, float fDelay, long long Now);
+    void OnHandler(long long ns); //!< time the data handler took
+
+    /** From the control loop when it is done with frame iFrame */
+    void OnLoop(int iFrame, bool bCommand, long long Now);
+
+    void SetState(float Speed, float Fp);
+
+    /** From the signal monitor: a channel's second raised these SIGNAL_ alerts */
+    void OnSignalAlerts(int Alerts);
+
+    /** From the treadmill link: a command's TREADMILL_ result and the ns
+     *  its send took, -1 if it was not attempted */
+    void OnTreadmillSend(int iResult, long long ns);
+
+    /** Prometheus text exposition of everything, Now as above */
+    std::string Render(long long Now) const;
+
+private:
+    std::atomic<unsigned long long> m_nFrames;
+    std::atomic<unsigned long long> m_nRepeated;
+    std::atomic<unsigned long long> m_nDropped; // gaps in the frame numbers
+    std::atomic<int> m_iLastFrame;
+    std::atomic<long long> m_LastArrival;      // ns, 0 before the first frame
+    std::atomic<float> m_Delay;
+    Histogram m_Interval;
+    Histogram m_Handler;
+
+    // arrival of the last frames, to time the loop against
+    enum { N_ARRIVALS = 64 };
+    std::atomic<int> m_ArrivalFrame[N_ARRIVALS];
+    std::atomic<long long> m_ArrivalTime[N_ARRIVALS];
+
+    std::atomic<unsigned long long> m_nLoops;
+    std::atomic<unsigned long long> m_nCommands;
+    Histogram m_Loop;
+
+    std::atomic<float> m_Speed;
+    std::atomic<float> m_Fp;
+
+    // channel-seconds of rail, stuck, spike and noise alerts
+    std::atomic<unsigned long long> m_nSignalAlerts[4];
+
+    Histogram m_Send;
+    std::atomic<unsigned long long> m_nSendErrors;   // TREADMILL_SEND
+    std::atomic<unsigned long long> m_nNotConnected; // TREADMILL_NOT_CONNECTED
+};
+
+} // namespace CortexEngine
+
+#endif
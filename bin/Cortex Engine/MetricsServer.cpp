@@ -0,0 +1,210 @@
+/*=========================================================
+//
+// File: MetricsServer.cpp
+//
+// HTTP exposition of the engine's metrics, see MetricsServer.h
+//
+=============================================================================*/
+
+#include "MetricsServer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <windows.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef SOCKET Socket_t;
+#define CloseSocket closesocket
+#define SEND_FLAGS 0
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+typedef int Socket_t;
+#define INVALID_SOCKET (-1)
+#define CloseSocket close
+// a scraper hanging up must not raise SIGPIPE in the host process
+#define SEND_FLAGS MSG_NOSIGNAL
+#endif
+
+namespace CortexEngine
+{
+
+namespace
+{
+
+const int MS_POLL = 200;      // how soon Stop is noticed
+const int MS_RECEIVE = 1000;  // a client gets this long to send its request
+const int MAX_REQUEST = 4096;
+
+/** Waits up to ms for Socket to become readable */
+bool Readable(Socket_t Socket, int ms)
+{
+    fd_set Set;
+    FD_ZERO(&Set);
+    FD_SET(Socket, &Set);
+    timeval Timeout;
+    Timeout.tv_sec = ms / 1000;
+    Timeout.tv_usec = (ms % 1000) * 1000;
+    return select((int)Socket + 1, &Set, NULL, NULL, &Timeout) > 0;
+}
+
+bool SendAll(Socket_t Socket, const std::string& Data)
+{
+    size_t nSent = 0;
+    while (nSent < Data.size())
+    {
+        int n = send(Socket, Data.data() + nSent, (int)(Data.size() - nSent), SEND_FLAGS);
+        if (n <= 0)
+            return false;
+        nSent += n;
+    }
+    return true;
+}
+
+std::string Response(const char* szStatus, const char* szType, const std::string& Body)
+{
+    char Head[256];
+    snprintf(Head, sizeof(Head),
+             "HTTP/1.0 %s\r\nContent-Type: %s\r\nContent-Length: %u\r\nConnection: close\r\n\r\n",
+             szStatus, szType, (unsigned)Body.size());
+    return Head + Body;
+}
+
+long long SteadyNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+//==================================================================
+
+MetricsServer::MetricsServer(const Metrics& M)
+    : m_Metrics(M), m_Listen(-1), m_iPort(0), m_bStop(false), m_nScrapes(0)
+{
+}
+
+MetricsServer::~MetricsServer()
+{
+    Stop();
+}
+
+bool MetricsServer::Start(int iPort)
+{
+    if (m_Thread.joinable() || iPort <= 0 || iPort > 65535)
+        return false;
+#ifdef _WIN32
+    WSADATA Data;
+    if (WSAStartup(MAKEWORD(2, 2), &Data) != 0)
+        return false;
+#endif
+    Socket_t Listen = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    bool bOk = Listen != INVALID_SOCKET;
+    if (bOk)
+    {
+        // rebind at once after a trial, past the last scrape's TIME_WAIT
+        int iOn = 1;
+        setsockopt(Listen, SOL_SOCKET, SO_REUSEADDR, (const char*)&iOn, sizeof(iOn));
+        sockaddr_in Address;
+        std::memset(&Address, 0, sizeof(Address));
+        Address.sin_family = AF_INET;
+        Address.sin_addr.s_addr = htonl(INADDR_ANY);
+        Address.sin_port = htons((unsigned short)iPort);
+        bOk = bind(Listen, (sockaddr*)&Address, sizeof(Address)) == 0 && listen(Listen, 4) == 0;
+        if (!bOk)
+            CloseSocket(Listen);
+    }
+    if (!bOk)
+    {
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        return false;
+    }
+    m_Listen = (long long)Listen;
+    m_iPort = iPort;
+    m_bStop.store(false);
+    m_Thread = std::thread(&MetricsServer::Run, this);
+    return true;
+}
+
+void MetricsServer::Stop()
+{
+    if (!m_Thread.joinable())
+        return;
+    m_bStop.store(true);
+    m_Thread.join();
+    CloseSocket((Socket_t)m_Listen);
+    m_Listen = -1;
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+void MetricsServer::Run()
+{
+#ifdef _WIN32
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+#elif defined(SCHED_IDLE)
+    sched_param Param;
+    Param.sched_priority = 0;
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &Param);
+#endif
+    const Socket_t Listen = (Socket_t)m_Listen;
+    while (!m_bStop.load())
+    {
+        if (!Readable(Listen, MS_POLL))
+            continue;
+        Socket_t Client = accept(Listen, NULL, NULL);
+        if (Client == INVALID_SOCKET)
+            continue;
+        Serve((long long)Client);
+        CloseSocket(Client);
+    }
+}
+
+void MetricsServer::Serve(long long Socket)
+{
+    const Socket_t Client = (Socket_t)Socket;
+    std::string Request;
+    char Buffer[512];
+    while (Request.find("\r\n\r\n") == std::string::npos && Request.size() < MAX_REQUEST)
+    {
+        if (m_bStop.load() || !Readable(Client, MS_RECEIVE))
+            return;
+        int n = recv(Client, Buffer, sizeof(Buffer), 0);
+        if (n <= 0)
+            return;
+        Request.append(Buffer, n);
+    }
+
+    // only the request line matters: METHOD PATH VERSION
+    const std::string Line = Request.substr(0, Request.find("\r\n"));
+    const size_t iPath = Line.find(' ');
+    const size_t iEnd = iPath == std::string::npos ? iPath : Line.find_first_of(" ?", iPath + 1);
+    const std::string Method = Line.substr(0, iPath);
+    const std::string Path = iPath == std::string::npos ? "" : Line.substr(iPath + 1, iEnd - iPath - 1);
+    if (Method != "GET")
+        SendAll(Client, Response("405 Method Not Allowed", "text/plain", "GET only\n"));
+    else if (Path != "/metrics" && Path != "/")
+        SendAll(Client, Response("404 Not Found", "text/plain", "See /metrics\n"));
+    else
+    {
+        m_nScrapes.fetch_add(1);
+        SendAll(Client, Response("200 OK", "text/plain; version=0.0.4; charset=utf-8",
+                                 m_Metrics.Render(SteadyNs())));
+    }
+}
+
+} // namespace CortexEngine
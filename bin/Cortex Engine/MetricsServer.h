@@ -0,0 +1,59 @@
+/*=========================================================
+//
+// File: MetricsServer.h
+//
+// Minimal HTTP server of Metrics for Prometheus to scrape.
+//
+=============================================================================*/
+
+#ifndef MetricsServer_H
+#define MetricsServer_H
+
+#include <atomic>
+#include <thread>
+
+#include "Metrics.h"
+
+namespace CortexEngine
+{
+
+/** Serves GET /metrics on a TCP port, one request per connection
+ *
+ *  Runs on a thread of its own at low priority. A scrape only loads
+ *  the atomics of Metrics, so it neither blocks nor is blocked by the
+ *  data thread and the control loop, whatever the client does.
+ */
+class MetricsServer
+{
+public:
+    explicit MetricsServer(const Metrics& M);
+    ~MetricsServer();
+
+    /** Listen on all interfaces at iPort and start serving
+     *
+     * \return false if the port could not be bound
+     */
+    bool Start(int iPort);
+    void Stop();
+
+    int Port() const { return m_iPort; }
+    unsigned long long Scrapes() const { return m_nScrapes.load(); }
+
+private:
+    MetricsServer(const MetricsServer&);
+    MetricsServer& operator=(const MetricsServer&);
+
+    void Run();
+    void Serve(long long Socket);
+
+    const Metrics& m_Metrics;
+    long long m_Listen; // SOCKET or file descriptor, -1 when closed
+    int m_iPort;
+    std::atomic<bool> m_bStop;
+    std::atomic<unsigned long long> m_nScrapes;
+    std::thread m_Thread;
+};
+
+} // namespace CortexEngine
+
+#endif
@@ -0,0 +1,189 @@
+/*=========================================================
+//
+// File: RingWakeCheck.cpp
+//
+// Measures how long a reader of the frame ring takes to see a frame after
+// the data thread starts storing it, and how much CPU the reader uses
+// meanwhile, for each way of waiting: polling the head every millisecond
+// (as a MATLAB loop around mGetCurrentFrame does), sleeping at once,
+// spinning first, and spinning throughout.
+//
+// A thread of its own pushes synthetic frames (12 analog channels of 10
+// samples, 4 markers) at the frame rate; the reader takes usWork
+// microseconds per frame, as a control loop would.
+//
+// Usage: RingWakeCheck [FrameRate (200)] [Seconds per strategy (3)] [usWork (0)]
+//
+=============================================================================*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "FrameRing.h"
+
+using namespace CortexEngine;
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+const int POLL = -2; // not a FrameSignal spin: sleep 1 ms between looks at the head
+
+long long Nanos()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now().time_since_epoch()).count();
+}
+
+/** CPU time of the calling thread (s) */
+double ThreadCpu()
+{
+#ifdef _WIN32
+    FILETIME Create, Exit, Kernel, User;
+    GetThreadTimes(GetCurrentThread(), &Create, &Exit, &Kernel, &User);
+    ULARGE_INTEGER k, u;
+    k.LowPart = Kernel.dwLowDateTime;
+    k.HighPart = Kernel.dwHighDateTime;
+    u.LowPart = User.dwLowDateTime;
+    u.HighPart = User.dwHighDateTime;
+    return 1e-7 * (double)(k.QuadPart + u.QuadPart);
+#else
+    timespec t;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+    return (double)t.tv_sec + 1e-9 * (double)t.tv_nsec;
+#endif
+}
+
+struct Result
+{
+    int nFrames;
+    double Median, P99, Max; // us
+    double Cpu;              // fraction of one core
+};
+
+Result Run(int usSpin, double FrameRate, double Seconds, int usWork)
+{
+    const int nFrames = (int)(FrameRate * Seconds);
+    FrameRing Ring;
+    Ring.SetSpin(usSpin == POLL ? 0 : usSpin);
+    std::vector<long long> SentAt((std::size_t)nFrames + 2, 0);
+
+    std::vector<short> Analog(120, 100);
+    std::vector<float> Markers(12, 1.0f);
+    sFrameOfData f;
+    std::memset(&f, 0, sizeof(f));
+    f.nBodies = 1;
+    f.BodyData[0].nMarkers = 4;
+    f.BodyData[0].Markers = (tMarkerData*)&Markers[0];
+    f.AnalogData.nAnalogChannels = 12;
+    f.AnalogData.nAnalogSamples = 10;
+    f.AnalogData.AnalogSamples = &Analog[0];
+
+    std::atomic<bool> bDone(false);
+    std::vector<double> Latency;
+    Latency.reserve(nFrames);
+    double Cpu = 0.0;
+
+    std::thread Reader([&]
+    {
+        double Cpu0 = ThreadCpu();
+        Clock::time_point t0 = Clock::now();
+        long long Seq = 0;
+        while (!bDone.load())
+        {
+            long long Head;
+            if (usSpin == POLL)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                Head = Ring.Head();
+            }
+            else
+                Head = Ring.Wait(Seq, 100);
+            if (Head <= Seq)
+                continue;
+            long long Now = Nanos();
+            if (Seq + 1 <= nFrames)
+                Latency.push_back(1e-3 * (double)(Now - SentAt[(std::size_t)Seq + 1]));
+            Seq = Head;
+            // the control loop's own work
+            while (usWork > 0 && Nanos() - Now < 1000LL * usWork)
+                ;
+        }
+        double Wall = std::chrono::duration<double>(Clock::now() - t0).count();
+        Cpu = (ThreadCpu() - Cpu0) / Wall;
+    });
+
+    const Clock::duration Period = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / FrameRate));
+    Clock::time_point Due = Clock::now() + Period;
+    for (int i = 1; i <= nFrames; i++)
+    {
+        std::this_thread::sleep_until(Due);
+        Due += Period;
+        f.iFrame = i;
+        SentAt[i] = Nanos();
+        Ring.Push(f, 0.0);
+    }
+    bDone.store(true);
+    Ring.Close();
+    Reader.join();
+
+    Result R;
+    R.nFrames = (int)Latency.size();
+    R.Cpu = Cpu;
+    R.Median = R.P99 = R.Max = 0.0;
+    if (!Latency.empty())
+    {
+        std::sort(Latency.begin(), Latency.end());
+        R.Median = Latency[Latency.size() / 2];
+        R.P99 = Latency[(Latency.size() * 99) / 100];
+        R.Max = Latency.back();
+    }
+    return R;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    double FrameRate = argc > 1 ? std::atof(argv[1]) : 200.0;
+    double Seconds = argc > 2 ? std::atof(argv[2]) : 3.0;
+    int usWork = argc > 3 ? std::atoi(argv[3]) : 0;
+    if (FrameRate <= 0 || Seconds <= 0)
+    {
+        fprintf(stderr, "usage: %s [FrameRate] [Seconds] [usWork]\n", argv[0]);
+        return 1;
+    }
+
+    struct { const char* szName; int usSpin; } Strategies[] = {
+        { "poll 1 ms", POLL },
+        { "sleep", 0 },
+        { "spin 50 us", 50 },
+        { "spin 500 us", 500 },
+        { "spin always", FrameSignal::SPIN_ALWAYS },
+    };
+
+    printf("%g Hz, %g s each, %d us of work per frame, %u cores\n",
+           FrameRate, Seconds, usWork, std::thread::hardware_concurrency());
+    printf("strategy      frames  median (us)  p99 (us)  max (us)  reader CPU\n");
+    for (std::size_t i = 0; i < sizeof(Strategies) / sizeof(Strategies[0]); i++)
+    {
+        Result R = Run(Strategies[i].usSpin, FrameRate, Seconds, usWork);
+        printf("%-12s  %6d  %11.1f  %8.1f  %8.1f  %9.1f%%\n", Strategies[i].szName,
+               R.nFrames, R.Median, R.P99, R.Max, 100.0 * R.Cpu);
+    }
+    return 0;
+}
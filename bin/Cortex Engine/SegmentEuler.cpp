@@ -0,0 +1,60 @@
+/*=========================================================
+//
+// File: SegmentEuler.cpp
+//
+// Rotation order dispatch of the batch Euler kernels, see SegmentEuler.h
+//
+=============================================================================*/
+
+#include "SegmentEuler.h"
+
+namespace CortexEngine
+{
+namespace Euler
+{
+
+namespace
+{
+
+typedef void (*MatricesFunc)(const double*, int, int, double*);
+typedef void (*AnglesFunc)(const double*, int, double*, int);
+
+const MatricesFunc MatricesByOrder[12] = {
+    Matrices<ZYX_ORDER>, Matrices<XYZ_ORDER>, Matrices<YXZ_ORDER>,
+    Matrices<YZX_ORDER>, Matrices<ZXY_ORDER>, Matrices<XZY_ORDER>,
+    Matrices<XYX_ORDER>, Matrices<XZX_ORDER>, Matrices<YZY_ORDER>,
+    Matrices<YXY_ORDER>, Matrices<ZXZ_ORDER>, Matrices<ZYZ_ORDER>,
+};
+
+const AnglesFunc AnglesByOrder[12] = {
+    Angles<ZYX_ORDER>, Angles<XYZ_ORDER>, Angles<YXZ_ORDER>,
+    Angles<YZX_ORDER>, Angles<ZXY_ORDER>, Angles<XZY_ORDER>,
+    Angles<XYX_ORDER>, Angles<XZX_ORDER>, Angles<YZY_ORDER>,
+    Angles<YXY_ORDER>, Angles<ZXZ_ORDER>, Angles<ZYZ_ORDER>,
+};
+
+bool ValidOrder(int iRotationOrder)
+{
+    return iRotationOrder >= ZYX_ORDER && iRotationOrder <= ZYZ_ORDER;
+}
+
+} // namespace
+
+bool Matrices(int iRotationOrder, const double* pAngles, int nStride, int n, double* pMatrices)
+{
+    if (!ValidOrder(iRotationOrder))
+        return false;
+    MatricesByOrder[iRotationOrder - 1](pAngles, nStride, n, pMatrices);
+    return true;
+}
+
+bool Angles(int iRotationOrder, const double* pMatrices, int n, double* pAngles, int nStride)
+{
+    if (!ValidOrder(iRotationOrder))
+        return false;
+    AnglesByOrder[iRotationOrder - 1](pMatrices, n, pAngles, nStride);
+    return true;
+}
+
+} // namespace Euler
+} // namespace CortexEngine
@@ -0,0 +1,316 @@
+/*=========================================================
+//
+// File: SegmentEuler.h
+//
+// Batch versions of Cortex_ConstructRotationMatrix and
+// Cortex_ExtractEulerAngles for whole segment arrays.
+//
+//----------------------------------------------------------
+// The rotation order is a template parameter, so each order compiles to
+// straight-line code. Segments are gathered in blocks of BLOCK into
+// arrays per angle (structure of arrays); the trig and matrix loops then
+// run over the block with no branches and are vectorized by the
+// compiler. Sine, cosine and atan2 are polynomial versions (Cephes) that
+// vectorize, accurate to a few units in the last place.
+//
+// For ZYX .. XZY the conventions are those of Cortex_ConstructRotationMatrix
+// and Cortex_ExtractEulerAngles in Cortex_SDK.dll, checked against it (see
+// the ReadMe): the angles are indexed by axis (aX, aY, aZ of tSegmentData),
+// ZYX is Rz * Ry * Rx, gimbal lock is |cos| of the middle angle <= 1e-4
+// and is resolved as the SDK does for each order (Lock below), and a
+// matrix[0][0] of XEMPTY gives XEMPTY angles. The SDK does not
+// implement XYX .. ZYZ (it builds the identity), so for those the angles
+// are the first, second and third rotation, a convention of our own.
+// Angles are in degrees, matrices are [3][3] row major.
+=============================================================================*/
+
+#ifndef SegmentEuler_H
+#define SegmentEuler_H
+
+#include <cmath>
+
+#include "MatlabCortex.h"
+
+namespace CortexEngine
+{
+namespace Euler
+{
+
+const int BLOCK = 8;
+const double GIMBAL = 1e-4; // as Cortex_ExtractEulerAngles
+
+/** Axes of a rotation order: first I, second J, remaining K */
+template <int Order> struct Axes;
+template <> struct Axes<ZYX_ORDER> { enum { I = 2, J = 1, K = 0, Proper = 0 }; };
+template <> struct Axes<XYZ_ORDER> { enum { I = 0, J = 1, K = 2, Proper = 0 }; };
+template <> struct Axes<YXZ_ORDER> { enum { I = 1, J = 0, K = 2, Proper = 0 }; };
+template <> struct Axes<YZX_ORDER> { enum { I = 1, J = 2, K = 0, Proper = 0 }; };
+template <> struct Axes<ZXY_ORDER> { enum { I = 2, J = 0, K = 1, Proper = 0 }; };
+template <> struct Axes<XZY_ORDER> { enum { I = 0, J = 2, K = 1, Proper = 0 }; };
+template <> struct Axes<XYX_ORDER> { enum { I = 0, J = 1, K = 2, Proper = 1 }; };
+template <> struct Axes<XZX_ORDER> { enum { I = 0, J = 2, K = 1, Proper = 1 }; };
+template <> struct Axes<YZY_ORDER> { enum { I = 1, J = 2, K = 0, Proper = 1 }; };
+template <> struct Axes<YXY_ORDER> { enum { I = 1, J = 0, K = 2, Proper = 1 }; };
+template <> struct Axes<ZXZ_ORDER> { enum { I = 2, J = 0, K = 1, Proper = 1 }; };
+template <> struct Axes<ZYZ_ORDER> { enum { I = 2, J = 1, K = 0, Proper = 1 }; };
+
+/** Gimbal lock as in Cortex_ExtractEulerAngles: the first angle is set to
+ *  0 if First, else the third, and the other one is atan2(Sign * Y, X) of
+ *  the matrix elements E_JI (row J, column I), E_JJ, E_KI or E_KJ; Flip
+ *  negates it (NEGATE) or X (NEGATE_X) when the second angle is <= 0. The
+ *  SDK's XZY leaves out the NEGATE_X, so near aZ = -90 its aY is 180
+ *  degrees minus the right one; that case alone differs from the SDK. */
+enum { E_JI, E_JJ, E_KI, E_KJ };
+enum { NONE, NEGATE, NEGATE_X };
+template <int Order> struct Lock;
+template <> struct Lock<ZYX_ORDER> { enum { First = 1, Y = E_KJ, X = E_JJ, Sign = 1, Flip = NEGATE }; };
+template <> struct Lock<XYZ_ORDER> { enum { First = 0, Y = E_JI, X = E_JJ, Sign = 1, Flip = NEGATE }; };
+template <> struct Lock<YXZ_ORDER> { enum { First = 1, Y = E_JI, X = E_JJ, Sign = -1, Flip = NONE }; };
+template <> struct Lock<YZX_ORDER> { enum { First = 1, Y = E_JI, X = E_JJ, Sign = 1, Flip = NONE }; };
+template <> struct Lock<ZXY_ORDER> { enum { First = 1, Y = E_JI, X = E_JJ, Sign = 1, Flip = NONE }; };
+template <> struct Lock<XZY_ORDER> { enum { First = 1, Y = E_JI, X = E_KI, Sign = -1, Flip = NEGATE_X }; };
+template <> struct Lock<XYX_ORDER> { enum { First = 0, Y = E_KJ, X = E_JJ, Sign = 1, Flip = NONE }; };
+template <> struct Lock<XZX_ORDER> { enum { First = 0, Y = E_KJ, X = E_JJ, Sign = -1, Flip = NONE }; };
+template <> struct Lock<YZY_ORDER> { enum { First = 0, Y = E_KJ, X = E_JJ, Sign = 1, Flip = NONE }; };
+template <> struct Lock<YXY_ORDER> { enum { First = 0, Y = E_KJ, X = E_JJ, Sign = -1, Flip = NONE }; };
+template <> struct Lock<ZXZ_ORDER> { enum { First = 0, Y = E_KJ, X = E_JJ, Sign = 1, Flip = NONE }; };
+template <> struct Lock<ZYZ_ORDER> { enum { First = 0, Y = E_KJ, X = E_JJ, Sign = -1, Flip = NONE }; };
+
+/** Index in a row major matrix of the element E_JI .. E_KJ */
+template <int Order, int Element> struct LockIndex
+{
+    typedef Axes<Order> A;
+    enum { Row = Element == E_JI || Element == E_JJ ? A::J : A::K,
+           Column = Element == E_JJ || Element == E_KJ ? A::J : A::I,
+           Index = 3 * Row + Column };
+};
+
+//==================================================================
+// trig over a block
+
+/** s, c = sin and cos of x degrees */
+inline void SinCosDeg(const double* x, double* s, double* c)
+{
+    const double ROUND = 6755399441055744.0; // 1.5 * 2^52, rounds to integer
+    const double RAD = 3.14159265358979323846 / 180.0;
+    for (int l = 0; l < BLOCK; l++)
+    {
+        // reduce to [-45, 45] degrees; exact for multiples of 90
+        double q = (x[l] * (1.0 / 90.0) + ROUND) - ROUND;
+        double r = (x[l] - 90.0 * q) * RAD;
+        int iq = (int)q;
+        double z = r * r;
+
+        double sr = r + r * z * (((((1.58962301576546568060E-10 * z
+            - 2.50507477628578072866E-8) * z + 2.75573136213857245213E-6) * z
+            - 1.98412698295895385996E-4) * z + 8.33333333332211858878E-3) * z
+            - 1.66666666666666307295E-1);
+        double cr = 1.0 - 0.5 * z + z * z * (((((-1.13585365213876817300E-11 * z
+            + 2.08757008419747316778E-9) * z - 2.75573141792967388112E-7) * z
+            + 2.48015872888517045348E-5) * z - 1.38888888888730564116E-3) * z
+            + 4.16666666666665929218E-2);
+
+        // quadrant: sin(r + 90 q), cos(r + 90 q)
+        bool bSwap = (iq & 1) != 0;
+        double Sin = bSwap ? cr : sr;
+        double Cos = bSwap ? sr : cr;
+        s[l] = ((iq + 0) & 2) ? -Sin : Sin;
+        c[l] = ((iq + 1) & 2) ? -Cos : Cos;
+    }
+}
+
+/** a = atan2(y, x) in radians */
+inline void Atan2(const double* y, const double* x, double* a)
+{
+    const double PI = 3.14159265358979323846;
+    for (int l = 0; l < BLOCK; l++)
+    {
+        double ax = std::fabs(x[l]), ay = std::fabs(y[l]);
+        double Hi = ax > ay ? ax : ay;
+        double Lo = ax > ay ? ay : ax;
+        double t = Hi > 0.0 ? Lo / Hi : 0.0; // [0, 1]
+
+        // atan(t) = pi/4 + atan((t - 1) / (t + 1)) above tan(3 pi / 16)
+        bool bHigh = t > 0.66;
+        double u = bHigh ? (t - 1.0) / (t + 1.0) : t;
+        double z = u * u;
+        double P = (((-8.750608600031904122785E-1 * z - 1.615753718733365076637E1) * z
+            - 7.500855792314704667340E1) * z - 1.228866684490136173410E2) * z
+            - 6.485021904942025371773E1;
+        double Q = ((((z + 2.485846490142306297962E1) * z + 1.650270098316988542046E2) * z
+            + 4.328810604912902668951E2) * z + 4.853903996359136964868E2) * z
+            + 1.945506571482613964425E2;
+        double r = u + u * z * P / Q;
+        r += bHigh ? PI / 4.0 : 0.0;
+
+        r = ay > ax ? PI / 2.0 - r : r;
+        r = x[l] < 0.0 ? PI - r : r;
+        a[l] = std::copysign(r, y[l]); // -pi for -0, as std::atan2
+    }
+}
+
+//==================================================================
+// kernels
+
+/** Rotation matrices of n sets of angles
+ *
+ *  \param pAngles - angles of the first set; set i starts at pAngles + i * nStride
+ *                   (3 for packed triples, 7 with pSegments + 3 for tSegmentData)
+ *  \param pMatrices - n matrices of 9 doubles
+ */
+template <int Order>
+void Matrices(const double* pAngles, int nStride, int n, double* pMatrices)
+{
+    typedef Axes<Order> A;
+    const int I = A::I, J = A::J, K = A::K;
+    // first, second and third angle in the input
+    const int iA = A::Proper ? 0 : I, iB = A::Proper ? 1 : J, iC = A::Proper ? 2 : K;
+    // orders that are not cyclic in X, Y, Z are the cyclic formulas with
+    // the axes relabelled and the angles negated
+    const double e = (J == (I + 1) % 3) ? 1.0 : -1.0;
+    const int P[3] = { I, J, K };
+
+    double a[BLOCK], b[BLOCK], c[BLOCK];
+    double sa[BLOCK], ca[BLOCK], sb[BLOCK], cb[BLOCK], sc[BLOCK], cc[BLOCK];
+    double R[3][3][BLOCK];
+
+    for (int i0 = 0; i0 < n; i0 += BLOCK)
+    {
+        int m = n - i0 < BLOCK ? n - i0 : BLOCK;
+        for (int l = 0; l < BLOCK; l++)
+        {
+            const double* p = pAngles + (size_t)(i0 + (l < m ? l : 0)) * nStride;
+            a[l] = e * p[iA];
+            b[l] = e * p[iB];
+            c[l] = e * p[iC];
+        }
+        SinCosDeg(a, sa, ca);
+        SinCosDeg(b, sb, cb);
+        SinCosDeg(c, sc, cc);
+
+        for (int l = 0; l < BLOCK; l++)
+        {
+            if (A::Proper)
+            {
+                // Rx(a) Ry(b) Rx(c)
+                R[0][0][l] = cb[l];
+                R[0][1][l] = sb[l] * sc[l];
+                R[0][2][l] = sb[l] * cc[l];
+                R[1][0][l] = sa[l] * sb[l];
+                R[1][1][l] = ca[l] * cc[l] - sa[l] * cb[l] * sc[l];
+                R[1][2][l] = -ca[l] * sc[l] - sa[l] * cb[l] * cc[l];
+                R[2][0][l] = -ca[l] * sb[l];
+                R[2][1][l] = sa[l] * cc[l] + ca[l] * cb[l] * sc[l];
+                R[2][2][l] = -sa[l] * sc[l] + ca[l] * cb[l] * cc[l];
+            }
+            else
+            {
+                // Rx(a) Ry(b) Rz(c)
+                R[0][0][l] = cb[l] * cc[l];
+                R[0][1][l] = -cb[l] * sc[l];
+                R[0][2][l] = sb[l];
+                R[1][0][l] = ca[l] * sc[l] + sa[l] * sb[l] * cc[l];
+                R[1][1][l] = ca[l] * cc[l] - sa[l] * sb[l] * sc[l];
+                R[1][2][l] = -sa[l] * cb[l];
+                R[2][0][l] = sa[l] * sc[l] - ca[l] * sb[l] * cc[l];
+                R[2][1][l] = sa[l] * cc[l] + ca[l] * sb[l] * sc[l];
+                R[2][2][l] = ca[l] * cb[l];
+            }
+        }
+
+        for (int l = 0; l < m; l++)
+        {
+            double* M = pMatrices + (size_t)(i0 + l) * 9;
+            for (int r = 0; r < 3; r++)
+                for (int s = 0; s < 3; s++)
+                    M[3 * P[r] + P[s]] = R[r][s][l];
+        }
+    }
+}
+
+/** Euler angles of n rotation matrices, inverse of Matrices
+ *
+ *  \param pAngles - written as pAngles + i * nStride, as for Matrices
+ */
+template <int Order>
+void Angles(const double* pMatrices, int n, double* pAngles, int nStride)
+{
+    typedef Axes<Order> A;
+    typedef Lock<Order> G;
+    const int I = A::I, J = A::J, K = A::K;
+    const int iA = A::Proper ? 0 : I, iB = A::Proper ? 1 : J, iC = A::Proper ? 2 : K;
+    const int iY = LockIndex<Order, G::Y>::Index, iX = LockIndex<Order, G::X>::Index;
+    const double e = (J == (I + 1) % 3) ? 1.0 : -1.0;
+    const double DEG = 180.0 / 3.14159265358979323846;
+
+    double ya[BLOCK], xa[BLOCK], yb[BLOCK], xb[BLOCK], yc[BLOCK], xc[BLOCK];
+    double yg[BLOCK], xg[BLOCK], Lock[BLOCK], Empty[BLOCK];
+    double a[BLOCK], b[BLOCK], c[BLOCK], g[BLOCK];
+
+    for (int i0 = 0; i0 < n; i0 += BLOCK)
+    {
+        int m = n - i0 < BLOCK ? n - i0 : BLOCK;
+        for (int l = 0; l < BLOCK; l++)
+        {
+            const double* M = pMatrices + (size_t)(i0 + (l < m ? l : 0)) * 9;
+            const double II = M[3 * I + I], IJ = M[3 * I + J], IK = M[3 * I + K];
+            const double JI = M[3 * J + I], JK = M[3 * J + K];
+            const double KI = M[3 * K + I], KK = M[3 * K + K];
+            if (A::Proper)
+            {
+                double s = std::sqrt(IJ * IJ + IK * IK);
+                yb[l] = s;          xb[l] = II;
+                ya[l] = JI;         xa[l] = -e * KI;
+                yc[l] = IJ;         xc[l] = e * IK;
+                Lock[l] = s;
+            }
+            else
+            {
+                double s = std::sqrt(II * II + IJ * IJ);
+                yb[l] = e * IK;     xb[l] = s;
+                ya[l] = -e * JK;    xa[l] = KK;
+                yc[l] = -e * IJ;    xc[l] = II;
+                Lock[l] = s;
+            }
+            // the angle that is not set to 0 at gimbal lock
+            yg[l] = G::Sign * M[iY];
+            xg[l] = int(G::Flip) == NEGATE_X && yb[l] <= 0.0 ? -M[iX] : M[iX];
+            Empty[l] = M[0] == XEMPTY ? 1.0 : 0.0;
+        }
+        Atan2(ya, xa, a);
+        Atan2(yb, xb, b);
+        Atan2(yc, xc, c);
+        Atan2(yg, xg, g);
+
+        for (int l = 0; l < BLOCK; l++)
+        {
+            bool bLocked = Lock[l] <= GIMBAL;
+            bool bEmpty = Empty[l] != 0.0;
+            double Other = int(G::Flip) == NEGATE && b[l] <= 0.0 ? -g[l] : g[l];
+            double First = bLocked ? (G::First ? 0.0 : Other) : a[l];
+            double Third = bLocked ? (G::First ? Other : 0.0) : c[l];
+            a[l] = bEmpty ? XEMPTY : First * DEG;
+            b[l] = bEmpty ? XEMPTY : b[l] * DEG;
+            c[l] = bEmpty ? XEMPTY : Third * DEG;
+        }
+
+        for (int l = 0; l < m; l++)
+        {
+            double* p = pAngles + (size_t)(i0 + l) * nStride;
+            p[iA] = a[l];
+            p[iB] = b[l];
+            p[iC] = c[l];
+        }
+    }
+}
+
+//==================================================================
+
+/** Runtime order, checked once per batch; false if the order is unknown */
+bool Matrices(int iRotationOrder, const double* pAngles, int nStride, int n, double* pMatrices);
+bool Angles(int iRotationOrder, const double* pMatrices, int n, double* pAngles, int nStride);
+
+} // namespace Euler
+} // namespace CortexEngine
+
+#endif
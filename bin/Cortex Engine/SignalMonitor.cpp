@@ -0,0 +1,202 @@
+/*=========================================================
+//
+// File: SignalMonitor.cpp
+//
+// Analog channel quality, see SignalMonitor.h
+//
+=============================================================================*/
+
+#include "SignalMonitor.h"
+
+#include <cmath>
+#include <cstddef>
+
+#include "CortexEngine.h"
+#include "FrameConverter.h"
+
+namespace CortexEngine
+{
+
+namespace
+{
+
+const int RAIL_MAX = 32767;
+const int RAIL_MIN = -32768;
+
+void Add(SignalCounts& To, const SignalCounts& C)
+{
+    To.nSamples += C.nSamples;
+    To.nRail += C.nRail;
+    To.nStuck += C.nStuck;
+    To.nSpikes += C.nSpikes;
+    To.nNoise += C.nNoise;
+    To.SumSq += C.SumSq;
+    To.Alerts |= C.Alerts;
+}
+
+const SignalCounts ZERO = { 0, 0, 0, 0, 0, 0.0, 0 };
+
+} // namespace
+
+double SignalCounts::NoiseRms() const
+{
+    // second differences of white noise of RMS s have RMS s * sqrt(6)
+    return nNoise > 0 ? std::sqrt(SumSq / (6.0 * (double)nNoise)) : 0.0;
+}
+
+MonitorParams::MonitorParams()
+    : RailMargin(16), StuckSamples(100), SpikeBits(3000), NoiseBits(40.0f)
+{
+    ConverterParams Plates;
+    Channels.assign(Plates.iChannel, Plates.iChannel + 4);
+}
+
+SignalMonitor::SignalMonitor(const MonitorParams& Params, AlertFunc OnAlert)
+    : m_Params(Params), m_OnAlert(OnAlert), m_iLastFrame(-1), m_SecondStart(-1.0), m_nSeen(0)
+{
+}
+
+void SignalMonitor::Reset(int nChannels)
+{
+    // a new channel layout starts the counts over
+    const int nBlocks = (nChannels + LANES - 1) / LANES;
+    Lanes Zero = {};
+    m_Lanes.assign(nBlocks, Zero);
+    m_Row.assign((std::size_t)nBlocks * LANES, 0);
+    m_Second.assign(nChannels, ZERO);
+    m_Last.assign(nChannels, ZERO);
+    m_Trial.assign(nChannels, ZERO);
+    m_Pending.assign(nChannels, 0);
+    m_nSeen = 0;
+}
+
+void SignalMonitor::OnFrame(const sFrameOfData& f, double Time)
+{
+    if (f.iFrame == m_iLastFrame)
+        return;
+    const bool bGap = f.iFrame != m_iLastFrame + 1;
+    m_iLastFrame = f.iFrame;
+
+    if (m_SecondStart < 0.0)
+        m_SecondStart = Time;
+    else if (Time >= m_SecondStart + 1.0)
+    {
+        CloseSecond();
+        m_SecondStart += std::floor(Time - m_SecondStart);
+    }
+
+    const sAnalogData& A = f.AnalogData;
+    const int nc = A.nAnalogChannels;
+    const int ns = A.nAnalogSamples;
+    if (nc <= 0 || ns <= 0 || !A.AnalogSamples)
+        return;
+    if (nc != Channels())
+        Reset(nc);
+    if (bGap)
+        m_nSeen = 0; // no steps across missing samples
+
+    int nNoise = 0;
+    const int nBlocks = (int)m_Lanes.size();
+    int* Row = &m_Row[0];
+
+    // one row of channels per sample, widened to int and scanned a block
+    // of lanes at a time; the first sample after a gap has no step, the
+    // first two no second difference
+    for (int s = 0; s < ns; s++, m_nSeen++)
+    {
+        const short* x = A.AnalogSamples + (std::size_t)s * nc;
+        for (int c = 0; c < nc; c++)
+            Row[c] = x[c];
+        const int w1 = m_nSeen >= 1;
+        const int w2 = m_nSeen >= 2;
+        nNoise += w2;
+        for (int b = 0; b < nBlocks; b++)
+            Scan(m_Lanes[b], Row + b * LANES, w1, w2);
+    }
+
+    for (int c = 0; c < nc; c++)
+    {
+        Lanes& L = m_Lanes[c / LANES];
+        const int l = c % LANES;
+        SignalCounts& C = m_Second[c];
+        C.nSamples += ns;
+        C.nRail += L.nRail[l];
+        C.nStuck += L.nStuck[l];
+        C.nSpikes += L.nSpikes[l];
+        C.nNoise += nNoise;
+        C.SumSq += L.SumSq[l];
+        L.nRail[l] = L.nStuck[l] = L.nSpikes[l] = 0;
+        L.SumSq[l] = 0.0f;
+    }
+}
+
+void SignalMonitor::Scan(Lanes& L, const int* x, int w1, int w2) const
+{
+    const int Hi = RAIL_MAX - m_Params.RailMargin;
+    const int Lo = RAIL_MIN + m_Params.RailMargin;
+    const int Stuck = m_Params.StuckSamples;
+    const int Spike = m_Params.SpikeBits;
+    int v[LANES];
+    for (int l = 0; l < LANES; l++)
+        v[l] = x[l];
+    for (int l = 0; l < LANES; l++)
+    {
+        const int d1 = v[l] - L.Prev[l];
+        const int d2 = (d1 - (L.Prev[l] - L.Prev2[l])) * w2;
+        L.nRail[l] += (v[l] >= Hi) | (v[l] <= Lo);
+        L.Run[l] = ((d1 == 0) & w1) * (L.Run[l] + 1);
+        L.nStuck[l] += L.Run[l] >= Stuck;
+        L.nSpikes[l] += ((d1 > Spike) | (d1 < -Spike)) & w1;
+        L.SumSq[l] += (float)d2 * (float)d2;
+        L.Prev2[l] = L.Prev[l];
+        L.Prev[l] = v[l];
+    }
+}
+
+void SignalMonitor::CloseSecond()
+{
+    const int nc = Channels();
+    for (std::size_t i = 0; i < m_Params.Channels.size(); i++)
+    {
+        const int c = m_Params.Channels[i];
+        if (c < 0 || c >= nc)
+            continue;
+        SignalCounts& C = m_Second[c];
+        int Alerts = 0;
+        if (C.nRail > 0)
+            Alerts |= SIGNAL_RAIL;
+        if (C.nStuck > 0)
+            Alerts |= SIGNAL_STUCK;
+        if (C.nSpikes > 0)
+            Alerts |= SIGNAL_SPIKE;
+        if (C.NoiseRms() > m_Params.NoiseBits)
+            Alerts |= SIGNAL_NOISE;
+        C.Alerts = Alerts;
+        m_Pending[c] |= Alerts;
+        if (Alerts && m_OnAlert)
+            m_OnAlert(c, Alerts);
+    }
+    for (int c = 0; c < nc; c++)
+    {
+        Add(m_Trial[c], m_Second[c]);
+        m_Last[c] = m_Second[c];
+        m_Second[c] = ZERO;
+    }
+}
+
+std::vector<SignalCounts> SignalMonitor::Trial() const
+{
+    std::vector<SignalCounts> T(m_Trial);
+    for (std::size_t c = 0; c < T.size(); c++)
+        Add(T[c], m_Second[c]);
+    return T;
+}
+
+std::vector<int> SignalMonitor::TakeAlerts()
+{
+    std::vector<int> Alerts(m_Pending);
+    m_Pending.assign(m_Pending.size(), 0);
+    return Alerts;
+}
+
+} // namespace CortexEngine
@@ -0,0 +1,118 @@
+/*=========================================================
+//
+// File: SignalMonitor.h
+//
+// Quality of the analog channels: rail hits, flat-lining, spikes and
+// noise, counted on every sample and rolled up per second and per trial.
+//
+=============================================================================*/
+
+#ifndef SignalMonitor_H
+#define SignalMonitor_H
+
+#include <functional>
+#include <vector>
+
+#include "MatlabCortex.h"
+
+namespace CortexEngine
+{
+
+/** What makes a channel's second an alert; see CortexEngine_MonitorStart */
+struct MonitorParams
+{
+    MonitorParams();
+
+    std::vector<int> Channels; //!< alerted channels, 0 based (default the plates')
+    int   RailMargin;    //!< samples this close to +-32767 are rail hits
+    int   StuckSamples;  //!< equal samples in a row after which a channel is stuck
+    int   SpikeBits;     //!< larger sample to sample steps are spikes
+    float NoiseBits;     //!< alert above this RMS noise
+};
+
+/** Counts of one channel */
+struct SignalCounts
+{
+    long long nSamples;
+    long long nRail;
+    long long nStuck;    //!< samples of runs longer than StuckSamples
+    long long nSpikes;
+    long long nNoise;    //!< second differences in SumSq
+    double    SumSq;     //!< of the second differences
+    int       Alerts;    //!< SIGNAL_RAIL | SIGNAL_STUCK | ...
+
+    /** RMS noise in bits, from the second differences */
+    double NoiseRms() const;
+};
+
+/** Scans each frame's analog block for all channels at once
+ *
+ *  The samples of a block are interleaved, one row of channels per
+ *  sample, and the scan keeps them so: each step of it applies the same
+ *  branch-free test to a row, 16 channels at a time as the lanes of the
+ *  compiler's vector instructions, their state (last two samples,
+ *  current run) in fixed arrays. A frame costs about one pass over its
+ *  samples at vector width.
+ *
+ *  Counts build up over one second of frame time; when a second closes,
+ *  each alerted channel whose counts cross a limit is flagged, and the
+ *  second is added to the trial's counts. Everything runs on the data
+ *  thread under the engine's frame lock; readers take the same lock.
+ */
+class SignalMonitor
+{
+public:
+    /** Called as a second closes, for each channel it raised alerts on */
+    typedef std::function<void(int iChannel, int Alerts)> AlertFunc;
+
+    explicit SignalMonitor(const MonitorParams& Params = MonitorParams(),
+                           AlertFunc OnAlert = AlertFunc());
+
+    void OnFrame(const sFrameOfData& f, double Time);
+
+    int Channels() const { return (int)m_Trial.size(); }
+
+    /** The last complete second, or the trial including the current one */
+    const std::vector<SignalCounts>& LastSecond() const { return m_Last; }
+    std::vector<SignalCounts> Trial() const;
+
+    /** Alerts of each channel since the last call, then clears them */
+    std::vector<int> TakeAlerts();
+
+private:
+    void Reset(int nChannels);
+    void CloseSecond();
+
+    MonitorParams m_Params;
+    AlertFunc m_OnAlert;
+    int m_iLastFrame;
+    double m_SecondStart;
+    int m_nSeen;                 // samples since the last gap
+
+    // the scan's state, LANES channels per block; fixed size arrays in
+    // one struct let the compiler vectorize over them
+    enum { LANES = 16 };
+    struct Lanes
+    {
+        int   Prev[LANES];
+        int   Prev2[LANES];
+        int   Run[LANES];
+        int   nRail[LANES];
+        int   nStuck[LANES];
+        int   nSpikes[LANES];
+        float SumSq[LANES];
+    };
+    void Scan(Lanes& L, const int* x, int w1, int w2) const;
+
+    std::vector<Lanes> m_Lanes;
+    std::vector<int> m_Row;      // a sample's channels, padded to whole blocks
+
+    std::vector<SignalCounts> m_Second;
+    std::vector<SignalCounts> m_Last;
+    std::vector<SignalCounts> m_Trial;
+    std::vector<int> m_Pending;
+};
+
+} // namespace CortexEngine
+
+#endif
@@ -0,0 +1,273 @@
+/*=========================================================
+//
+// File: SkyQueue.cpp
+//
+// Asynchronous executor for Cortex Sky commands and requests.
+//
+=============================================================================*/
+
+#include "SkyQueue.h"
+
+#include <chrono>
+#include <cstring>
+
+namespace CortexEngine
+{
+
+SkyQueue::SkyQueue(const SkyBackend& Backend)
+    : m_Backend(Backend), m_nNextTicket(1), m_nRunning(0), m_bStop(false)
+{
+    if (!m_Backend.SkyCommand)
+        m_Backend.SkyCommand = Cortex_SkyCommand;
+    if (!m_Backend.Request)
+        m_Backend.Request = Cortex_Request;
+
+    // session constants of the Cortex context
+    m_Cacheable.insert("GetContextFrameRate");
+    m_Cacheable.insert("GetContextAnalogSampleRate");
+    m_Cacheable.insert("GetContextAnalogBitDepth");
+    m_Cacheable.insert("GetUpAxis");
+    m_Cacheable.insert("GetConversionToMillimeters");
+}
+
+SkyQueue::~SkyQueue()
+{
+    Stop();
+}
+
+void SkyQueue::Start()
+{
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    if (m_Worker.joinable())
+        return;
+    m_bStop = false;
+    m_Worker = std::thread(&SkyQueue::Run, this);
+}
+
+void SkyQueue::Stop()
+{
+    {
+        std::lock_guard<std::mutex> Lock(m_Mutex);
+        m_bStop = true;
+    }
+    m_Wake.notify_all();
+    if (m_Worker.joinable())
+        m_Worker.join();
+}
+
+int SkyQueue::SubmitSky(const std::string& szCommand, int msTimeout,
+                        SkyCallback Callback)
+{
+    Job J;
+    J.bSky = true;
+    J.szCommand = szCommand;
+    J.msTimeout = msTimeout;
+    J.Callback = Callback;
+    return Enqueue(J);
+}
+
+int SkyQueue::SubmitRequest(const std::string& szCommand, SkyCallback Callback)
+{
+    Job J;
+    J.bSky = false;
+    J.szCommand = szCommand;
+    J.msTimeout = 0;
+    J.Callback = Callback;
+
+    // cached responses complete at once, on the caller's thread
+    std::unique_lock<std::mutex> Lock(m_Mutex);
+    std::map<std::string, SkyResult>::const_iterator Hit = m_Cache.find(szCommand);
+    if (Hit == m_Cache.end())
+    {
+        Lock.unlock();
+        return Enqueue(J);
+    }
+    SkyResult R = Hit->second;
+    J.iTicket = R.iTicket = m_nNextTicket++;
+    J.Promise = std::make_shared<std::promise<SkyResult> >();
+    m_Tickets[J.iTicket] = J.Promise->get_future().share();
+    SkyCallback Handler = m_Handler;
+    Lock.unlock();
+
+    J.Promise->set_value(R);
+    if (J.Callback)
+        J.Callback(R);
+    if (Handler)
+        Handler(R);
+    return J.iTicket;
+}
+
+int SkyQueue::Enqueue(Job J)
+{
+    std::unique_lock<std::mutex> Lock(m_Mutex);
+    J.iTicket = m_nNextTicket++;
+    J.Promise = std::make_shared<std::promise<SkyResult> >();
+    m_Tickets[J.iTicket] = J.Promise->get_future().share();
+    m_Queue.push_back(J);
+    Lock.unlock();
+    m_Wake.notify_one();
+    return J.iTicket;
+}
+
+std::shared_future<SkyResult> SkyQueue::Future(int iTicket) const
+{
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    std::map<int, std::shared_future<SkyResult> >::const_iterator It = m_Tickets.find(iTicket);
+    if (It == m_Tickets.end())
+        return std::shared_future<SkyResult>();
+    return It->second;
+}
+
+int SkyQueue::Collect(int iTicket, int msTimeout, SkyResult* pResult)
+{
+    std::shared_future<SkyResult> F = Future(iTicket);
+    if (!F.valid())
+        return -1;
+    if (F.wait_for(std::chrono::milliseconds(msTimeout > 0 ? msTimeout : 0))
+        != std::future_status::ready)
+        return 0;
+    if (pResult)
+        *pResult = F.get();
+
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    m_Tickets.erase(iTicket);
+    return 1;
+}
+
+void SkyQueue::SetCacheable(const std::string& szCommand, bool bCacheable)
+{
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    if (bCacheable)
+    {
+        m_Cacheable.insert(szCommand);
+    }
+    else
+    {
+        m_Cacheable.erase(szCommand);
+        m_Cache.erase(szCommand);
+    }
+}
+
+void SkyQueue::ClearCache()
+{
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    m_Cache.clear();
+}
+
+void SkyQueue::SetHandler(SkyCallback Handler)
+{
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    m_Handler = Handler;
+}
+
+int SkyQueue::Pending() const
+{
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    return (int)m_Queue.size() + m_nRunning;
+}
+
+//==================================================================
+
+void SkyQueue::Run()
+{
+    std::deque<Job> Batch;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> Lock(m_Mutex);
+            m_Wake.wait(Lock, [this] { return m_bStop || !m_Queue.empty(); });
+            if (m_Queue.empty())
+                return; // stopping and nothing left to run
+            Batch.swap(m_Queue);
+            m_nRunning = (int)Batch.size();
+        }
+        Execute(Batch);
+        Batch.clear();
+    }
+}
+
+void SkyQueue::Execute(std::deque<Job>& Batch)
+{
+    // responses of requests already answered in this batch
+    std::map<std::string, SkyResult> Answered;
+
+    for (size_t i = 0; i < Batch.size(); i++)
+    {
+        Job& J = Batch[i];
+        SkyResult R;
+        R.iTicket = J.iTicket;
+        R.iReturnCode = RC_Okay;
+        std::memset(&R.Sky, 0, sizeof(R.Sky));
+        R.bCached = false;
+
+        if (J.bSky)
+        {
+            // Sky commands may change Cortex's state, never merged
+            std::vector<char> szCommand(J.szCommand.begin(), J.szCommand.end());
+            szCommand.push_back('\0');
+            sSkyReturn* pReturn = m_Backend.SkyCommand(&szCommand[0], J.msTimeout);
+            if (pReturn)
+            {
+                R.Sky = *pReturn;
+                R.iReturnCode = pReturn->ReturnCode;
+            }
+            else
+            {
+                R.iReturnCode = RC_GeneralError;
+                R.Sky.ReturnCode = RC_GeneralError;
+            }
+            Finish(J, R);
+            continue;
+        }
+
+        std::map<std::string, SkyResult>::const_iterator Done = Answered.find(J.szCommand);
+        if (Done != Answered.end())
+        {
+            R.iReturnCode = Done->second.iReturnCode;
+            R.Response = Done->second.Response;
+            Finish(J, R);
+            continue;
+        }
+
+        // the response pointer is only valid until the next request, copy it
+        std::vector<char> szCommand(J.szCommand.begin(), J.szCommand.end());
+        szCommand.push_back('\0');
+        void* pResponse = NULL;
+        int nBytes = 0;
+        R.iReturnCode = m_Backend.Request(&szCommand[0], &pResponse, &nBytes);
+        if (R.iReturnCode == RC_Okay && pResponse && nBytes > 0)
+        {
+            const char* p = (const char*)pResponse;
+            R.Response.assign(p, p + nBytes);
+        }
+        Answered[J.szCommand] = R;
+
+        if (R.iReturnCode == RC_Okay)
+        {
+            std::lock_guard<std::mutex> Lock(m_Mutex);
+            if (m_Cacheable.count(J.szCommand))
+            {
+                m_Cache[J.szCommand] = R;
+                m_Cache[J.szCommand].bCached = true;
+            }
+        }
+        Finish(J, R);
+    }
+}
+
+void SkyQueue::Finish(Job& J, SkyResult& R)
+{
+    SkyCallback Handler;
+    {
+        std::lock_guard<std::mutex> Lock(m_Mutex);
+        Handler = m_Handler;
+        m_nRunning--;
+    }
+    J.Promise->set_value(R);
+    if (J.Callback)
+        J.Callback(R);
+    if (Handler)
+        Handler(R);
+}
+
+} // namespace CortexEngine
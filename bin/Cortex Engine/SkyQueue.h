@@ -0,0 +1,112 @@
+/*=========================================================
+//
+// File: SkyQueue.h
+//
+// Asynchronous executor for Cortex Sky commands and requests.
+//
+=============================================================================*/
+
+#ifndef SkyQueue_H
+#define SkyQueue_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MatlabCortex.h"
+
+namespace CortexEngine
+{
+
+/** Result of one Sky command or request */
+struct SkyResult
+{
+    int iTicket;
+    int iReturnCode;            //!< maReturnCode of the call
+    sSkyReturn Sky;             //!< Sky commands: Cortex's response
+    std::vector<char> Response; //!< requests: copy of the response bytes
+    bool bCached;               //!< request answered from the session cache
+};
+
+typedef std::function<void(const SkyResult&)> SkyCallback;
+
+/** The calls the worker makes, replaceable for running without Cortex */
+struct SkyBackend
+{
+    std::function<sSkyReturn*(char*, int)> SkyCommand;
+    std::function<int(char*, void**, int*)> Request;
+};
+
+/** Runs Cortex_SkyCommand and Cortex_Request on a dedicated thread
+ *
+ *  Submit returns a ticket straight away. The result can be collected
+ *  with a future, a callback or by polling the ticket. The worker takes
+ *  everything queued in one batch per pass, answers repeated requests in
+ *  the batch with one call and keeps responses of cacheable (idempotent)
+ *  requests for the session.
+ */
+class SkyQueue
+{
+public:
+    explicit SkyQueue(const SkyBackend& Backend = SkyBackend());
+    ~SkyQueue();
+
+    void Start();
+    void Stop(); //!< runs what is queued, then joins the worker
+
+    int SubmitSky(const std::string& szCommand, int msTimeout,
+                  SkyCallback Callback = SkyCallback());
+    int SubmitRequest(const std::string& szCommand,
+                      SkyCallback Callback = SkyCallback());
+
+    std::shared_future<SkyResult> Future(int iTicket) const;
+
+    /** Collect a result: 1 done (ticket released), 0 pending, -1 unknown */
+    int Collect(int iTicket, int msTimeout, SkyResult* pResult);
+
+    void SetCacheable(const std::string& szCommand, bool bCacheable);
+    void ClearCache();
+    void SetHandler(SkyCallback Handler);
+    int Pending() const;
+
+private:
+    struct Job
+    {
+        int iTicket;
+        bool bSky;
+        std::string szCommand;
+        int msTimeout;
+        SkyCallback Callback;
+        std::shared_ptr<std::promise<SkyResult> > Promise;
+    };
+
+    void Run();
+    void Execute(std::deque<Job>& Batch);
+    void Finish(Job& J, SkyResult& R);
+    int Enqueue(Job J);
+
+    SkyBackend m_Backend;
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    std::deque<Job> m_Queue;
+    std::map<int, std::shared_future<SkyResult> > m_Tickets;
+    std::set<std::string> m_Cacheable;
+    std::map<std::string, SkyResult> m_Cache;
+    SkyCallback m_Handler;
+    std::thread m_Worker;
+    int m_nNextTicket;
+    int m_nRunning;
+    bool m_bStop;
+};
+
+} // namespace CortexEngine
+
+#endif
@@ -0,0 +1,245 @@
+/*=========================================================
+//
+// File: Trace.cpp
+//
+// Per-thread span buffers and their Chrome trace export, see Trace.h
+//
+=============================================================================*/
+
+#include "Trace.h"
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+namespace CortexEngine
+{
+namespace Trace
+{
+
+std::atomic<bool> g_bEnabled(false);
+
+namespace
+{
+
+const int MAX_THREADS = 16;
+const int DEFAULT_EVENTS = 1 << 16;
+
+struct TraceEvent
+{
+    long long Begin;    // ns since the epoch
+    long long Duration; // ns
+    int iStage;
+    int iArg;
+};
+
+/** One thread's events; written only by that thread */
+struct ThreadBuffer
+{
+    ThreadBuffer() : nCapacity(0), n(0), nDropped(0) { szName[0] = 0; }
+
+    std::unique_ptr<TraceEvent[]> pEvents;
+    int nCapacity;
+    std::atomic<int> n;
+    std::atomic<int> nDropped;
+    char szName[64];
+};
+
+/** What a thread remembers between its events */
+struct ThreadState
+{
+    unsigned Generation;    // of the Start its buffer belongs to
+    ThreadBuffer* pBuffer;  // NULL if all buffers were taken
+    long long Open[TRACE_N_STAGES];
+    char szName[64];
+};
+
+std::chrono::steady_clock::time_point g_Epoch = std::chrono::steady_clock::now();
+ThreadBuffer g_Buffers[MAX_THREADS];
+std::atomic<int> g_nThreads(0);
+std::atomic<unsigned> g_Generation(0);
+std::atomic<int> g_nLost(0); // events of threads without a buffer
+int g_nEvents = DEFAULT_EVENTS;
+
+thread_local ThreadState tl_State = { 0, NULL, { 0 }, { 0 } };
+
+/** The calling thread's buffer, claimed on its first event after Start */
+ThreadBuffer* Buffer()
+{
+    ThreadState& S = tl_State;
+    const unsigned Generation = g_Generation.load(std::memory_order_acquire);
+    if (S.Generation == Generation)
+        return S.pBuffer;
+    S.Generation = Generation;
+    S.pBuffer = NULL;
+    const int i = g_nThreads.fetch_add(1);
+    if (i >= MAX_THREADS)
+        return NULL;
+
+    ThreadBuffer& B = g_Buffers[i];
+    // kept from the last trial if the size is the same; not zeroed, so
+    // the pages are only touched as events are written
+    if (B.nCapacity != g_nEvents)
+    {
+        B.pEvents.reset(new TraceEvent[g_nEvents]);
+        B.nCapacity = g_nEvents;
+    }
+    B.nDropped.store(0);
+    if (S.szName[0])
+        std::memcpy(B.szName, S.szName, sizeof(B.szName));
+    else
+        snprintf(B.szName, sizeof(B.szName), "Thread %d", i + 1);
+    B.n.store(0, std::memory_order_release);
+    S.pBuffer = &B;
+    return S.pBuffer;
+}
+
+void WriteString(FILE* pFile, const char* sz)
+{
+    fputc('"', pFile);
+    for (; *sz; sz++)
+    {
+        if (*sz == '"' || *sz == '\\')
+            fputc('\\', pFile);
+        if ((unsigned char)*sz >= 0x20)
+            fputc(*sz, pFile);
+    }
+    fputc('"', pFile);
+}
+
+} // namespace
+
+void SetEpoch(std::chrono::steady_clock::time_point Epoch)
+{
+    g_Epoch = Epoch;
+}
+
+long long Now()
+{
+    if (!Enabled())
+        return -1;
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - g_Epoch).count();
+}
+
+bool Start(int nEvents)
+{
+    if (Enabled())
+        return false;
+    g_nEvents = nEvents > 0 ? nEvents : DEFAULT_EVENTS;
+    // threads claim buffers again; the previous events are forgotten
+    const int nThreads = g_nThreads.load();
+    for (int i = 0; i < nThreads && i < MAX_THREADS; i++)
+        g_Buffers[i].n.store(0);
+    g_nThreads.store(0);
+    g_nLost.store(0);
+    g_Generation.fetch_add(1, std::memory_order_release);
+    g_bEnabled.store(true);
+    return true;
+}
+
+void Stop()
+{
+    g_bEnabled.store(false);
+}
+
+void NameThread(const char* szName)
+{
+    ThreadState& S = tl_State;
+    snprintf(S.szName, sizeof(S.szName), "%s", szName ? szName : "");
+    if (S.Generation == g_Generation.load() && S.pBuffer)
+        std::memcpy(S.pBuffer->szName, S.szName, sizeof(S.szName));
+}
+
+void Record(int iStage, long long Begin, int iArg)
+{
+    if (!Enabled() || Begin < 0 || iStage < 0 || iStage >= TRACE_N_STAGES)
+        return;
+    const long long End = Now();
+    ThreadBuffer* pBuffer = Buffer();
+    if (!pBuffer)
+    {
+        g_nLost.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    const int i = pBuffer->n.load(std::memory_order_relaxed);
+    if (i >= pBuffer->nCapacity)
+    {
+        pBuffer->nDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    TraceEvent& E = pBuffer->pEvents[i];
+    E.Begin = Begin;
+    E.Duration = End - Begin;
+    E.iStage = iStage;
+    E.iArg = iArg;
+    pBuffer->n.store(i + 1, std::memory_order_release);
+}
+
+void Begin(int iStage)
+{
+    if (iStage >= 0 && iStage < TRACE_N_STAGES)
+        tl_State.Open[iStage] = Now();
+}
+
+void End(int iStage, int iArg)
+{
+    if (iStage < 0 || iStage >= TRACE_N_STAGES)
+        return;
+    long long& Open = tl_State.Open[iStage];
+    if (Open > 0)
+        Record(iStage, Open, iArg);
+    Open = -1;
+}
+
+int Write(const char* szPath, int* pnDropped)
+{
+    FILE* pFile = szPath ? fopen(szPath, "w") : NULL;
+    if (!pFile)
+        return -1;
+    int nThreads = g_nThreads.load();
+    if (nThreads > MAX_THREADS)
+        nThreads = MAX_THREADS;
+
+    fprintf(pFile, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(pFile, "{\"ph\":\"M\",\"pid\":1,\"tid\":0,\"name\":\"process_name\","
+                   "\"args\":{\"name\":\"Cortex engine\"}}");
+    int nEvents = 0;
+    int nDropped = g_nLost.load();
+    for (int t = 0; t < nThreads; t++)
+    {
+        const ThreadBuffer& B = g_Buffers[t];
+        fprintf(pFile, ",\n{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":", t + 1);
+        WriteString(pFile, B.szName);
+        fprintf(pFile, "}}");
+        const int n = B.n.load(std::memory_order_acquire);
+        for (int i = 0; i < n; i++)
+        {
+            const TraceEvent& E = B.pEvents[i];
+            fprintf(pFile, ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"name\":\"%s\",\"ts\":%.3f,\"dur\":%.3f,"
+                           "\"args\":{\"frame\":%d}}",
+                    t + 1, StageName(E.iStage), 1e-3 * (double)E.Begin, 1e-3 * (double)E.Duration, E.iArg);
+        }
+        nEvents += n;
+        nDropped += B.nDropped.load();
+    }
+    fprintf(pFile, "\n]}\n");
+    bool bOk = !ferror(pFile);
+    bOk = fclose(pFile) == 0 && bOk;
+    if (pnDropped)
+        *pnDropped = nDropped;
+    return bOk ? nEvents : -1;
+}
+
+const char* StageName(int iStage)
+{
+    static const char* Names[TRACE_N_STAGES] = {
+        "SDK callback", "Ring publish", "Conversion", "Filtering",
+        "Gait detection", "Control law", "Treadmill send", "Recorder append",
+        "Relay send", "Frame wait", "Signal monitor"
+    };
+    return iStage >= 0 && iStage < TRACE_N_STAGES ? Names[iStage] : "";
+}
+
+} // namespace Trace
+} // namespace CortexEngine
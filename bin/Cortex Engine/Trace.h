@@ -0,0 +1,96 @@
+/*=========================================================
+//
+// File: Trace.h
+//
+// Timing of the stages of each frame's way from Cortex to the treadmill,
+// written as a Chrome trace (chrome://tracing, ui.perfetto.dev).
+//
+=============================================================================*/
+
+#ifndef Trace_H
+#define Trace_H
+
+#include <atomic>
+#include <chrono>
+
+#include "CortexEngine.h"
+
+namespace CortexEngine
+{
+
+/** Stage spans in per-thread buffers
+ *
+ *  Each thread that records claims a buffer of its own on its first span
+ *  after Start and appends to it without locks; the buffer's memory is
+ *  allocated then, once, and reused by later traces of the same size.
+ *  Write reads the buffers. When tracing is off a span costs one relaxed
+ *  atomic load.
+ *
+ *  TraceStart and TraceStop must not run while another thread records:
+ *  the engine calls them under the frame lock, and spans from the API
+ *  come from the thread that starts and stops tracing.
+ */
+namespace Trace
+{
+
+extern std::atomic<bool> g_bEnabled;
+
+inline bool Enabled() { return g_bEnabled.load(std::memory_order_relaxed); }
+
+/** Times are ns since this point (CortexEngine_Initialize) */
+void SetEpoch(std::chrono::steady_clock::time_point Epoch);
+
+/** ns since the epoch, -1 while tracing is off */
+long long Now();
+
+/** Clear the buffers (nEvents per thread) and start recording */
+bool Start(int nEvents);
+void Stop();
+
+/** Name the calling thread in the trace; kept across Start */
+void NameThread(const char* szName);
+
+/** A span of iStage that began at Begin (from Now) and ends now */
+void Record(int iStage, long long Begin, int iArg);
+
+/** Spans opened and closed by separate calls, one open span per stage
+ *  and thread */
+void Begin(int iStage);
+void End(int iStage, int iArg);
+
+/** Chrome trace JSON of everything recorded
+ *
+ * \return events written, -1 if the file could not be written
+ */
+int Write(const char* szPath, int* pnDropped);
+
+const char* StageName(int iStage);
+
+} // namespace Trace
+
+/** Records a span from construction to destruction */
+class TraceScope
+{
+public:
+    explicit TraceScope(int iStage, int iArg = 0)
+        : m_iStage(iStage), m_iArg(iArg), m_Begin(Trace::Enabled() ? Trace::Now() : -1) {}
+    TraceScope(int iStage, int iArg, long long Begin)
+        : m_iStage(iStage), m_iArg(iArg), m_Begin(Begin) {}
+    ~TraceScope()
+    {
+        if (m_Begin >= 0)
+            Trace::Record(m_iStage, m_Begin, m_iArg);
+    }
+
+private:
+    TraceScope(const TraceScope&);
+    TraceScope& operator=(const TraceScope&);
+
+    int m_iStage;
+    int m_iArg;
+    long long m_Begin;
+};
+
+} // namespace CortexEngine
+
+#endif
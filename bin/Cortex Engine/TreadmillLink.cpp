@@ -0,0 +1,359 @@
+/*=========================================================
+//
+// File: TreadmillLink.cpp
+//
+// Timed, non-blocking belt commands, see TreadmillLink.h
+//
+=============================================================================*/
+
+#include "TreadmillLink.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef SOCKET Socket_t;
+#define CloseSocket closesocket
+#define SEND_FLAGS 0
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int Socket_t;
+#define INVALID_SOCKET (-1)
+#define CloseSocket close
+#define SEND_FLAGS MSG_NOSIGNAL
+#endif
+
+#include "treadmill0x2Dremote.h"
+
+namespace CortexEngine
+{
+
+namespace
+{
+
+// byte offsets in the packet; the complements of bytes 1 to 18 follow
+// them from byte 19 on. Reconstructed, not from a vendor document:
+// TreadmillPacketCheck compares them with treadmill0x2Dremote
+const int FORMAT = 0;
+const int SPEEDS = 1;     // front right, front left, rear right, rear left
+const int ACCELS = 9;     // in the same order
+const int COMPLEMENT = 18;
+const int N_FIELDS = 18;  // bytes of speeds, accelerations and incline
+
+/** m/s or m/s^2 to the packet's mm/s or mm/s^2; anything not finite is 0 */
+int Milli(double Value)
+{
+    if (!(Value > -32.768 && Value < 32.767))
+        return Value > 0.0 ? 32767 : (Value < 0.0 ? -32768 : 0);
+    return (int)std::floor(1000.0 * Value + 0.5);
+}
+
+/** A big-endian 16 bit field and its complement */
+void Put(unsigned char* Packet, int iOffset, int Value)
+{
+    Packet[iOffset] = (unsigned char)((Value >> 8) & 0xFF);
+    Packet[iOffset + 1] = (unsigned char)(Value & 0xFF);
+    Packet[iOffset + COMPLEMENT] = (unsigned char)~Packet[iOffset];
+    Packet[iOffset + 1 + COMPLEMENT] = (unsigned char)~Packet[iOffset + 1];
+}
+
+/** The send failed only because the socket's buffer is full */
+bool WouldBlock()
+{
+#ifdef _WIN32
+    const int iError = WSAGetLastError();
+    return iError == WSAEWOULDBLOCK || iError == WSAENOBUFS;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS || errno == EINTR;
+#endif
+}
+
+const TreadmillStats ZERO = { 0, 0, 0, 0, 0, 0.0, 0.0, 0, 0 };
+
+} // namespace
+
+TreadmillLinkParams::TreadmillLinkParams()
+    : Port("4000"), iCore(-1), msRetry(500)
+{
+}
+
+//==================================================================
+
+TreadmillLink::TreadmillLink(const TreadmillLinkParams& Params, SendFunc OnSend)
+    : m_Params(Params), m_OnSend(OnSend), m_mmAccel(0), m_bCommanded(false), m_Socket(-1),
+      m_bOpen(false), m_bWinsock(false), m_Stats(ZERO), m_SumMicros(0.0), m_nTimed(0),
+      m_bStop(false), m_OldMask(0)
+{
+    std::memset(m_Packet, 0, sizeof(m_Packet));
+    m_Packet[FORMAT] = 0;
+    for (int i = 1; i <= N_FIELDS; i++)
+        m_Packet[i + COMPLEMENT] = (unsigned char)~m_Packet[i];
+}
+
+TreadmillLink::~TreadmillLink()
+{
+    Close();
+}
+
+int TreadmillLink::Open()
+{
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    if (m_bOpen)
+        return TREADMILL_OK;
+#ifdef _WIN32
+    WSADATA Data;
+    if (WSAStartup(MAKEWORD(2, 2), &Data) != 0)
+        return TREADMILL_WSA_STARTUP;
+    m_bWinsock = true;
+#endif
+    long long Socket = -1;
+    const int iResult = Connect(Socket);
+    if (iResult != TREADMILL_OK)
+    {
+#ifdef _WIN32
+        WSACleanup();
+        m_bWinsock = false;
+#endif
+        return iResult;
+    }
+    m_Socket = Socket;
+    m_bOpen = true;
+    m_bStop.store(false);
+    Pin();
+    m_Thread = std::thread(&TreadmillLink::Run, this);
+    return TREADMILL_OK;
+}
+
+void TreadmillLink::Close()
+{
+    {
+        std::lock_guard<std::mutex> Lock(m_Mutex);
+        m_bStop.store(true);
+        m_bOpen = false;
+    }
+    m_Lost.notify_all();
+    if (m_Thread.joinable())
+        m_Thread.join();
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    if (m_Socket >= 0)
+        CloseSocket((Socket_t)m_Socket);
+    m_Socket = -1;
+#ifdef _WIN32
+    if (m_bWinsock)
+        WSACleanup();
+#endif
+    m_bWinsock = false;
+    Unpin();
+}
+
+bool TreadmillLink::IsOpen() const
+{
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    return m_bOpen;
+}
+
+int TreadmillLink::Connect(long long& Socket) const
+{
+    addrinfo Hints;
+    std::memset(&Hints, 0, sizeof(Hints));
+    Hints.ai_family = AF_INET;
+    Hints.ai_socktype = SOCK_DGRAM;
+    Hints.ai_protocol = IPPROTO_UDP;
+    addrinfo* pAddress = NULL;
+    if (getaddrinfo(m_Params.Address.c_str(), m_Params.Port.c_str(), &Hints, &pAddress) != 0 || !pAddress)
+        return TREADMILL_ADDRESS;
+    int iResult = TREADMILL_OK;
+    Socket_t s = socket(pAddress->ai_family, pAddress->ai_socktype, pAddress->ai_protocol);
+    if (s == INVALID_SOCKET)
+        iResult = TREADMILL_SOCKET;
+    else
+    {
+#ifdef _WIN32
+        u_long On = 1;
+        const bool bNonBlocking = ioctlsocket(s, FIONBIO, &On) == 0;
+#else
+        const int iFlags = fcntl(s, F_GETFL, 0);
+        const bool bNonBlocking = iFlags >= 0 && fcntl(s, F_SETFL, iFlags | O_NONBLOCK) == 0;
+#endif
+        // a connected datagram socket only fixes the peer, nothing is sent
+        if (!bNonBlocking)
+            iResult = TREADMILL_SETSOCKOPT;
+        else if (connect(s, pAddress->ai_addr, (int)pAddress->ai_addrlen) != 0)
+            iResult = TREADMILL_CONNECT;
+        if (iResult != TREADMILL_OK)
+            CloseSocket(s);
+    }
+    freeaddrinfo(pAddress);
+    if (iResult == TREADMILL_OK)
+        Socket = (long long)s;
+    return iResult;
+}
+
+int TreadmillLink::SetSpeed(double Left, double Right, double Accel)
+{
+    long long ns = -1;
+    int iResult = TREADMILL_NOT_CONNECTED;
+    {
+        std::lock_guard<std::mutex> Lock(m_Mutex);
+        const int mmLeft = Milli(Left);
+        const int mmRight = Milli(Right);
+        Put(m_Packet, SPEEDS, mmRight);
+        Put(m_Packet, SPEEDS + 2, mmLeft);
+        Put(m_Packet, SPEEDS + 4, mmRight);
+        Put(m_Packet, SPEEDS + 6, mmLeft);
+        const int mmAccel = Milli(Accel);
+        if (mmAccel != m_mmAccel)
+        {
+            for (int i = 0; i < 4; i++)
+                Put(m_Packet, ACCELS + 2 * i, mmAccel);
+            m_mmAccel = mmAccel;
+        }
+        m_bCommanded = true;
+        m_Stats.nCommands++;
+        if (m_Socket >= 0)
+            iResult = Send(ns);
+        else
+            m_Stats.nNotConnected++;
+    }
+    if (m_OnSend)
+        m_OnSend(iResult, ns);
+    return iResult;
+}
+
+int TreadmillLink::Send(long long& ns)
+{
+    const Socket_t s = (Socket_t)m_Socket;
+    const std::chrono::steady_clock::time_point Begin = std::chrono::steady_clock::now();
+    const int n = send(s, (const char*)m_Packet, PACKET_BYTES, SEND_FLAGS);
+    const bool bBlocked = n != PACKET_BYTES && WouldBlock();
+    ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - Begin).count();
+
+    const double Micros = 1e-3 * (double)ns;
+    m_SumMicros += Micros;
+    m_nTimed++;
+    if (Micros > m_Stats.MaxMicros)
+        m_Stats.MaxMicros = Micros;
+    if (n == PACKET_BYTES)
+    {
+        m_Stats.nSent++;
+        return TREADMILL_OK;
+    }
+    m_Stats.nSendErrors++;
+    if (!bBlocked)
+    {
+        // unreachable, refused (the treadmill's port closed), ...: a new
+        // socket, from the reconnection thread
+        CloseSocket(s);
+        m_Socket = -1;
+        m_Lost.notify_one();
+    }
+    return TREADMILL_SEND;
+}
+
+void TreadmillLink::Run()
+{
+#ifdef _WIN32
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+#elif defined(SCHED_IDLE)
+    sched_param Param;
+    Param.sched_priority = 0;
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &Param);
+#endif
+    const std::chrono::milliseconds Retry(m_Params.msRetry > 0 ? m_Params.msRetry : 1);
+    std::chrono::steady_clock::time_point Next = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> Lock(m_Mutex);
+    while (!m_bStop.load())
+    {
+        m_Lost.wait(Lock, [this] { return m_bStop.load() || m_Socket < 0; });
+        // at most one attempt per msRetry, however often the link drops
+        if (m_Lost.wait_until(Lock, Next, [this] { return m_bStop.load(); }))
+            break;
+        Next = std::chrono::steady_clock::now() + Retry;
+
+        // name lookup and socket calls may take a while, without the lock
+        Lock.unlock();
+        long long Socket = -1;
+        const int iResult = Connect(Socket);
+        Lock.lock();
+        if (iResult != TREADMILL_OK)
+            continue;
+        if (m_bStop.load())
+        {
+            CloseSocket((Socket_t)Socket);
+            break;
+        }
+        m_Socket = Socket;
+        m_Stats.nReconnects++;
+        long long ns;
+        if (m_bCommanded)
+            Send(ns);
+    }
+}
+
+TreadmillStats TreadmillLink::Stats() const
+{
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    TreadmillStats S = m_Stats;
+    S.MeanMicros = m_nTimed > 0 ? m_SumMicros / (double)m_nTimed : 0.0;
+    S.bConnected = m_bOpen && m_Socket >= 0 ? 1 : 0;
+    S.bPinned = m_PinnedThread != std::thread::id() ? 1 : 0;
+    return S;
+}
+
+void TreadmillLink::Pin()
+{
+    if (m_Params.iCore < 0 || m_Params.iCore >= 64)
+        return;
+#ifdef _WIN32
+    const DWORD_PTR Old = SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << m_Params.iCore);
+    if (!Old)
+        return;
+    m_OldMask = (unsigned long long)Old;
+#else
+    cpu_set_t Set;
+    if (pthread_getaffinity_np(pthread_self(), sizeof(Set), &Set) != 0)
+        return;
+    m_OldMask = 0;
+    for (int i = 0; i < 64; i++)
+        if (CPU_ISSET(i, &Set))
+            m_OldMask |= 1ull << i;
+    CPU_ZERO(&Set);
+    CPU_SET(m_Params.iCore, &Set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(Set), &Set) != 0)
+        return;
+#endif
+    m_PinnedThread = std::this_thread::get_id();
+}
+
+void TreadmillLink::Unpin()
+{
+    // the opening thread restores its own affinity; others leave it
+    if (m_PinnedThread != std::this_thread::get_id())
+        return;
+    m_PinnedThread = std::thread::id();
+#ifdef _WIN32
+    SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)m_OldMask);
+#else
+    cpu_set_t Set;
+    CPU_ZERO(&Set);
+    for (int i = 0; i < 64; i++)
+        if (m_OldMask & (1ull << i))
+            CPU_SET(i, &Set);
+    pthread_setaffinity_np(pthread_self(), sizeof(Set), &Set);
+#endif
+}
+
+} // namespace CortexEngine
@@ -0,0 +1,139 @@
+/*=========================================================
+//
+// File: TreadmillLink.h
+//
+// Belt speed commands sent by the engine itself, over UDP as after
+// TREADMILL_initializeUDP, timed and never blocking the control loop.
+//
+=============================================================================*/
+
+#ifndef TreadmillLink_H
+#define TreadmillLink_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace CortexEngine
+{
+
+struct TreadmillLinkParams
+{
+    TreadmillLinkParams();
+
+    std::string Address; //!< of the treadmill's control PC
+    std::string Port;    //!< "4000" as in the scripts
+    int iCore;           //!< core to pin the opening (control) thread to, -1 not to
+    int msRetry;         //!< between reconnection attempts
+};
+
+struct TreadmillStats
+{
+    long long nCommands;     //!< SetSpeed calls
+    long long nSent;
+    long long nSendErrors;   //!< TREADMILL_SEND
+    long long nNotConnected; //!< TREADMILL_NOT_CONNECTED, while reconnecting
+    long long nReconnects;
+    double MeanMicros;       //!< time in send(), of the sends attempted
+    double MaxMicros;
+    int bConnected;
+    int bPinned;             //!< the control thread is pinned to iCore
+};
+
+/** A speed command packet, sent on a non-blocking UDP socket
+ *
+ *  The 64 byte packet is built once: format 0, belt speeds (mm/s) and
+ *  accelerations (mm/s^2) as big-endian 16 bit integers, front right,
+ *  front left, rear right, rear left, then the incline, the one's
+ *  complement of those bytes, and zero padding. A command patches only
+ *  the speed bytes and their complements, and the accelerations when
+ *  they change; the rear belts are given the front ones' speeds.
+ *
+ *  This layout is our reconstruction, with no vendor document behind it,
+ *  and the copy of the speeds onto the rear belts an assumption. Until
+ *  TreadmillPacketCheck finds it the same, byte for byte, as what
+ *  treadmill0x2Dremote's TREADMILL_setSpeed sends, the scripts leave the
+ *  link closed (Settings.TreadmillLink false).
+ *
+ *  SetSpeed returns as soon as the datagram is handed to the socket, or
+ *  would have to wait for it, with TREADMILL_OK or TREADMILL_SEND; the
+ *  time that took is recorded. A failed send other than a full buffer
+ *  marks the link lost, and until a thread of its own, at low priority,
+ *  has opened a new socket, commands return TREADMILL_NOT_CONNECTED at
+ *  once. The new socket resends the latest command, so the belt catches
+ *  up with the loop.
+ *
+ *  Sends, from the control loop and the watchdog, and the swap of a
+ *  reconnected socket share one lock, held only for the send itself.
+ */
+class TreadmillLink
+{
+public:
+    /** Called after each command with its TREADMILL_ result and the ns
+     *  spent in send(), -1 if it was not attempted */
+    typedef std::function<void(int iResult, long long ns)> SendFunc;
+
+    explicit TreadmillLink(const TreadmillLinkParams& Params, SendFunc OnSend = SendFunc());
+    ~TreadmillLink();
+
+    /** Resolves the address and opens the socket on the caller's thread,
+     *  which is pinned to iCore, then starts the reconnection thread
+     *
+     * \return TREADMILL_OK or the error, as for TREADMILL_initializeUDP
+     */
+    int Open();
+
+    /** Stops reconnecting and closes the socket; on the thread that
+     *  opened the link, also restores its affinity */
+    void Close();
+
+    bool IsOpen() const;
+
+    /** Speeds in m/s, acceleration in m/s^2
+     *
+     * \return TREADMILL_OK, TREADMILL_SEND or TREADMILL_NOT_CONNECTED
+     */
+    int SetSpeed(double Left, double Right, double Accel);
+
+    TreadmillStats Stats() const;
+
+private:
+    TreadmillLink(const TreadmillLink&);
+    TreadmillLink& operator=(const TreadmillLink&);
+
+    int Connect(long long& Socket) const;
+    int Send(long long& ns); // under m_Mutex
+    void Run();
+    void Pin();
+    void Unpin();
+
+    enum { PACKET_BYTES = 64 };
+
+    TreadmillLinkParams m_Params;
+    SendFunc m_OnSend;
+
+    mutable std::mutex m_Mutex;  // everything below but the thread
+    std::condition_variable m_Lost;
+    unsigned char m_Packet[PACKET_BYTES];
+    int m_mmAccel;               // in the packet
+    bool m_bCommanded;           // the packet holds a command to resend
+    long long m_Socket;          // SOCKET or file descriptor, -1 when lost
+    bool m_bOpen;
+    bool m_bWinsock;
+    TreadmillStats m_Stats;
+    double m_SumMicros;
+    long long m_nTimed;
+
+    std::thread m_Thread;        // reconnection
+    std::atomic<bool> m_bStop;
+
+    std::thread::id m_PinnedThread;
+    unsigned long long m_OldMask; // affinity before pinning, one bit per core
+};
+
+} // namespace CortexEngine
+
+#endif
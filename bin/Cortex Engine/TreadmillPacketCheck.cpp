@@ -0,0 +1,208 @@
+/*=========================================================
+//
+// File: TreadmillPacketCheck.cpp
+//
+// Compares, byte for byte, the packet TreadmillLink sends with the one
+// TREADMILL_setSpeed of treadmill0x2Dremote sends for the same left,
+// right and acceleration, rear belt bytes included. Both go to sockets of
+// this program on 127.0.0.1; no treadmill is needed.
+//
+// Usage: TreadmillPacketCheck [library (treadmill0x2Dremote.dll)]
+//
+=============================================================================*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef SOCKET Socket_t;
+#define CloseSocket closesocket
+#else
+#include <arpa/inet.h>
+#include <dlfcn.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int Socket_t;
+#define INVALID_SOCKET (-1)
+#define CloseSocket close
+#endif
+
+#include "TreadmillLink.h"
+#include "treadmill0x2Dremote.h"
+
+using namespace CortexEngine;
+
+namespace
+{
+
+struct Command
+{
+    double Left, Right, Accel;
+};
+
+// equal and unequal belts, negative, rounding and an unchanged acceleration
+const Command COMMANDS[] = {
+    { 0.0, 0.0, 0.25 },
+    { 1.0, 1.0, 0.5 },
+    { 0.8, 1.2, 0.5 },
+    { 1.234, 0.567, 1.0 },
+    { -0.5, 0.3, 0.25 },
+    { 2.0, 1.5, 2.0 },
+    { 0.0005, 0.0015, 0.25 },
+    { 0.0, 0.0, 0.25 },
+};
+
+const int MS_WAIT = 200; // for the datagrams of one command
+
+/** A UDP socket on 127.0.0.1 and a port of the system's choosing */
+Socket_t Receiver(std::string& Port)
+{
+    Socket_t s = socket(AF_INET, SOCK_DGRAM, 0);
+    if (s == INVALID_SOCKET)
+        return s;
+    sockaddr_in Address;
+    std::memset(&Address, 0, sizeof(Address));
+    Address.sin_family = AF_INET;
+    Address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t Length = sizeof(Address);
+    if (bind(s, (sockaddr*)&Address, sizeof(Address)) != 0 ||
+        getsockname(s, (sockaddr*)&Address, &Length) != 0)
+    {
+        CloseSocket(s);
+        return INVALID_SOCKET;
+    }
+#ifdef _WIN32
+    DWORD ms = 10;
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, (const char*)&ms, sizeof(ms));
+#else
+    timeval tv = { 0, 10000 };
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+#endif
+    Port = std::to_string(ntohs(Address.sin_port));
+    return s;
+}
+
+/** The datagrams that arrive within MS_WAIT */
+std::vector<std::vector<unsigned char> > Receive(Socket_t s)
+{
+    std::vector<std::vector<unsigned char> > Packets;
+    auto End = std::chrono::steady_clock::now() + std::chrono::milliseconds(MS_WAIT);
+    while (std::chrono::steady_clock::now() < End)
+    {
+        unsigned char Buffer[2048];
+        int n = (int)recv(s, (char*)Buffer, sizeof(Buffer), 0);
+        if (n > 0)
+            Packets.push_back(std::vector<unsigned char>(Buffer, Buffer + n));
+    }
+    return Packets;
+}
+
+void Print(const char* Name, const std::vector<unsigned char>& Packet)
+{
+    printf("  %-8s", Name);
+    for (size_t i = 0; i < Packet.size(); i++)
+        printf("%s%02x", i && i % 16 == 0 ? "\n          " : " ", Packet[i]);
+    printf("\n");
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    const char* Library = argc > 1 ? argv[1] : "treadmill0x2Dremote.dll";
+#ifdef _WIN32
+    WSADATA Data;
+    WSAStartup(MAKEWORD(2, 2), &Data);
+    HMODULE hLibrary = LoadLibraryA(Library);
+    if (!hLibrary)
+    {
+        printf("cannot load %s\n", Library);
+        return 2;
+    }
+    t_TREADMILL_initializeUDP pInitialize =
+        (t_TREADMILL_initializeUDP)GetProcAddress(hLibrary, "TREADMILL_initializeUDP");
+    t_TREADMILL_setSpeed pSetSpeed = (t_TREADMILL_setSpeed)GetProcAddress(hLibrary, "TREADMILL_setSpeed");
+#else
+    void* hLibrary = dlopen(Library, RTLD_NOW);
+    if (!hLibrary)
+    {
+        printf("cannot load %s\n", Library);
+        return 2;
+    }
+    t_TREADMILL_initializeUDP pInitialize =
+        (t_TREADMILL_initializeUDP)dlsym(hLibrary, "TREADMILL_initializeUDP");
+    t_TREADMILL_setSpeed pSetSpeed = (t_TREADMILL_setSpeed)dlsym(hLibrary, "TREADMILL_setSpeed");
+#endif
+    if (!pInitialize || !pSetSpeed)
+    {
+        printf("%s has no TREADMILL_initializeUDP or TREADMILL_setSpeed\n", Library);
+        return 2;
+    }
+
+    std::string VendorPort, LinkPort;
+    Socket_t Vendor = Receiver(VendorPort);
+    Socket_t Link = Receiver(LinkPort);
+    if (Vendor == INVALID_SOCKET || Link == INVALID_SOCKET)
+    {
+        printf("cannot open the receiving sockets\n");
+        return 2;
+    }
+
+    char Address[] = "127.0.0.1";
+    int iResult = pInitialize(Address, &VendorPort[0]);
+    if (iResult != TREADMILL_OK)
+    {
+        printf("TREADMILL_initializeUDP returned %d\n", iResult);
+        return 2;
+    }
+    TreadmillLinkParams Params;
+    Params.Address = Address;
+    Params.Port = LinkPort;
+    TreadmillLink TheLink(Params);
+    if ((iResult = TheLink.Open()) != TREADMILL_OK)
+    {
+        printf("TreadmillLink::Open returned %d\n", iResult);
+        return 2;
+    }
+    Receive(Vendor); // anything sent on initialization
+    Receive(Link);
+
+    bool bSame = true;
+    for (size_t c = 0; c < sizeof(COMMANDS) / sizeof(COMMANDS[0]); c++)
+    {
+        const Command& C = COMMANDS[c];
+        pSetSpeed(C.Left, C.Right, C.Accel);
+        std::vector<std::vector<unsigned char> > FromVendor = Receive(Vendor);
+        TheLink.SetSpeed(C.Left, C.Right, C.Accel);
+        std::vector<std::vector<unsigned char> > FromLink = Receive(Link);
+
+        bool bCommandSame = FromVendor.size() == 1 && FromLink.size() == 1 &&
+                            FromVendor[0] == FromLink[0];
+        bSame &= bCommandSame;
+        printf("left %g right %g accel %g: %d and %d datagrams, %s\n", C.Left, C.Right, C.Accel,
+               (int)FromVendor.size(), (int)FromLink.size(), bCommandSame ? "same" : "DIFFERENT");
+        if (!bCommandSame || c == 0)
+        {
+            for (size_t i = 0; i < FromVendor.size(); i++)
+                Print("library", FromVendor[i]);
+            for (size_t i = 0; i < FromLink.size(); i++)
+                Print("link", FromLink[i]);
+        }
+    }
+
+    TheLink.Close();
+    CloseSocket(Vendor);
+    CloseSocket(Link);
+    printf(bSame ? "the link sends the library's packets\n"
+                 : "the link's packets differ: keep Settings.TreadmillLink false\n");
+    return bSame ? 0 : 1;
+}
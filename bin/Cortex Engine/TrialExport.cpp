@@ -0,0 +1,697 @@
+/*=========================================================
+//
+// File: TrialExport.cpp
+//
+// MATLAB v5 and NumPy writers for recorded trials, see TrialExport.h
+//
+// MAT files are Level 5 (MATLAB 5 and later) with uncompressed miMATRIX
+// elements; .npy files are NumPy format 1.0, stored (not deflated) in a
+// zip archive for .npz.
+//
+=============================================================================*/
+
+#include "TrialExport.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <ctime>
+
+namespace CortexEngine
+{
+
+namespace
+{
+
+#ifdef _WIN32
+int Seek(FILE* pFile, long long Offset, int iOrigin) { return _fseeki64(pFile, Offset, iOrigin); }
+long long Tell(FILE* pFile) { return _ftelli64(pFile); }
+#else
+int Seek(FILE* pFile, long long Offset, int iOrigin) { return fseeko(pFile, (off_t)Offset, iOrigin); }
+long long Tell(FILE* pFile) { return (long long)ftello(pFile); }
+#endif
+
+const long long MAX_32 = 0xFFFFFFFFLL;
+const std::size_t FILE_BUFFER = 1 << 20;
+const std::size_t LOG_BLOCK = 32 << 20; // bytes of trial log read at a time
+
+// MAT-file data types and array classes
+const unsigned miINT8 = 1;
+const unsigned miINT32 = 5;
+const unsigned miUINT16 = 4;
+const unsigned miUINT32 = 6;
+const unsigned miDOUBLE = 9;
+const unsigned miMATRIX = 14;
+const unsigned mxSTRUCT_CLASS = 2;
+const unsigned mxCHAR_CLASS = 4;
+const unsigned mxDOUBLE_CLASS = 6;
+const int MAT_FIELD_LENGTH = 32; // field names up to 31 characters
+
+// zip records
+const unsigned ZIP_LOCAL = 0x04034b50;
+const unsigned ZIP_CENTRAL = 0x02014b50;
+const unsigned ZIP_END = 0x06054b50;
+const int ZIP_LOCAL_SIZE = 30;
+const int ZIP_CRC_AT = 14;
+
+void Put16(std::string& s, unsigned v)
+{
+    s += (char)(v & 0xFF);
+    s += (char)((v >> 8) & 0xFF);
+}
+
+void Put32(std::string& s, unsigned v)
+{
+    Put16(s, v & 0xFFFF);
+    Put16(s, v >> 16);
+}
+
+void Pad(std::string& s, std::size_t nAlign)
+{
+    s.append((nAlign - s.size() % nAlign) % nAlign, '\0');
+}
+
+std::string Timestamp(const char* szFormat)
+{
+    char sz[64];
+    time_t t = time(NULL);
+    strftime(sz, sizeof(sz), szFormat, localtime(&t));
+    return sz;
+}
+
+/** MATLAB names: a letter, then letters, digits and underscores */
+std::string MatName(const std::string& Name, std::size_t nMax)
+{
+    std::string s;
+    for (std::size_t i = 0; i < Name.size() && s.size() < nMax; ++i)
+    {
+        char c = Name[i];
+        bool bAlpha = (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+        bool bDigit = c >= '0' && c <= '9';
+        if (s.empty() && !bAlpha)
+            s += 'x';
+        if (s.size() < nMax)
+            s += bAlpha || bDigit ? c : '_';
+    }
+    return s.empty() ? "x" : s;
+}
+
+//==================================================================
+// CRC-32 of zip members, built up column by column
+
+// slicing by 8: table k advances a byte k bytes further back
+unsigned g_CrcTable[8][256];
+
+void MakeCrcTable()
+{
+    for (unsigned n = 0; n < 256; ++n)
+    {
+        unsigned c = n;
+        for (int k = 0; k < 8; ++k)
+            c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        g_CrcTable[0][n] = c;
+    }
+    for (unsigned n = 0; n < 256; ++n)
+        for (int k = 1; k < 8; ++k)
+            g_CrcTable[k][n] = g_CrcTable[0][g_CrcTable[k - 1][n] & 0xFF] ^ (g_CrcTable[k - 1][n] >> 8);
+}
+
+unsigned Crc32(unsigned Crc, const void* p, std::size_t n)
+{
+    if (!g_CrcTable[0][1])
+        MakeCrcTable();
+    const unsigned (*T)[256] = g_CrcTable;
+    const unsigned char* b = (const unsigned char*)p;
+    unsigned c = Crc ^ 0xFFFFFFFFu;
+    for (; n >= 8; n -= 8, b += 8)
+    {
+        unsigned Lo, Hi;
+        memcpy(&Lo, b, 4);
+        memcpy(&Hi, b + 4, 4);
+        Lo ^= c;
+        c = T[7][Lo & 0xFF] ^ T[6][(Lo >> 8) & 0xFF] ^ T[5][(Lo >> 16) & 0xFF] ^ T[4][Lo >> 24]
+            ^ T[3][Hi & 0xFF] ^ T[2][(Hi >> 8) & 0xFF] ^ T[1][(Hi >> 16) & 0xFF] ^ T[0][Hi >> 24];
+    }
+    for (; n > 0; --n, ++b)
+        c = T[0][(c ^ *b) & 0xFF] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFu;
+}
+
+unsigned Gf2Times(const unsigned* Mat, unsigned Vec)
+{
+    unsigned Sum = 0;
+    for (; Vec; Vec >>= 1, ++Mat)
+        if (Vec & 1)
+            Sum ^= *Mat;
+    return Sum;
+}
+
+void Gf2Square(unsigned* Square, const unsigned* Mat)
+{
+    for (int n = 0; n < 32; ++n)
+        Square[n] = Gf2Times(Mat, Mat[n]);
+}
+
+/** CRC of A followed by B, from their CRCs and B's length (as zlib's
+ *  crc32_combine) */
+unsigned Crc32Combine(unsigned CrcA, unsigned CrcB, long long nB)
+{
+    if (nB <= 0)
+        return CrcA;
+    unsigned Even[32], Odd[32];
+    Odd[0] = 0xEDB88320u; // one zero bit
+    unsigned Row = 1;
+    for (int n = 1; n < 32; ++n, Row <<= 1)
+        Odd[n] = Row;
+    Gf2Square(Even, Odd); // two zero bits
+    Gf2Square(Odd, Even); // four
+    do
+    {
+        Gf2Square(Even, Odd);
+        if (nB & 1)
+            CrcA = Gf2Times(Even, CrcA);
+        nB >>= 1;
+        if (!nB)
+            break;
+        Gf2Square(Odd, Even);
+        if (nB & 1)
+            CrcA = Gf2Times(Odd, CrcA);
+        nB >>= 1;
+    } while (nB);
+    return CrcA ^ CrcB;
+}
+
+//==================================================================
+// MAT elements
+
+void MatTag(std::string& s, unsigned Type, std::size_t nBytes)
+{
+    Put32(s, Type);
+    Put32(s, (unsigned)nBytes);
+}
+
+/** miMATRIX header up to its data: flags, dimensions and name */
+std::string MatArrayHeader(unsigned Class, long long nRows, long long nColumns, const std::string& Name)
+{
+    std::string s;
+    MatTag(s, miUINT32, 8);
+    Put32(s, Class);
+    Put32(s, 0);
+    MatTag(s, miINT32, 8);
+    Put32(s, (unsigned)nRows);
+    Put32(s, (unsigned)nColumns);
+    MatTag(s, miINT8, Name.size());
+    s += Name;
+    Pad(s, 8);
+    return s;
+}
+
+std::string MatElement(const std::string& Body)
+{
+    std::string s;
+    MatTag(s, miMATRIX, Body.size());
+    return s + Body;
+}
+
+/** Info as a 1 x 1 struct of char rows and scalars */
+std::string MatInfo(const std::vector<ExportField>& Info)
+{
+    std::string Body = MatArrayHeader(mxSTRUCT_CLASS, 1, 1, "Info");
+    Put32(Body, (4u << 16) | miINT32); // small element: field name length
+    Put32(Body, MAT_FIELD_LENGTH);
+    MatTag(Body, miINT8, Info.size() * MAT_FIELD_LENGTH);
+    for (std::size_t i = 0; i < Info.size(); ++i)
+    {
+        std::string Name = MatName(Info[i].Name, MAT_FIELD_LENGTH - 1);
+        Body += Name;
+        Body.append(MAT_FIELD_LENGTH - Name.size(), '\0');
+    }
+    Pad(Body, 8);
+    for (std::size_t i = 0; i < Info.size(); ++i)
+    {
+        const ExportField& F = Info[i];
+        std::string Field;
+        if (F.bText)
+        {
+            Field = MatArrayHeader(mxCHAR_CLASS, 1, F.Text.size(), "");
+            MatTag(Field, miUINT16, 2 * F.Text.size());
+            for (std::size_t j = 0; j < F.Text.size(); ++j)
+                Put16(Field, (unsigned char)F.Text[j]);
+            Pad(Field, 8);
+        }
+        else
+        {
+            Field = MatArrayHeader(mxDOUBLE_CLASS, 1, 1, "");
+            MatTag(Field, miDOUBLE, 8);
+            Field.append((const char*)&F.Value, 8);
+        }
+        Body += MatElement(Field);
+    }
+    return MatElement(Body);
+}
+
+std::string MatFileHeader()
+{
+    std::string s = "MATLAB 5.0 MAT-file, Platform: CortexEngine, Created on: "
+        + Timestamp("%a %b %d %H:%M:%S %Y");
+    s.resize(116, ' ');
+    s.append(8, '\0'); // no subsystem data
+    Put16(s, 0x0100);
+    s += "IM";
+    return s;
+}
+
+//==================================================================
+// NumPy
+
+std::string NpyHeader(const std::string& Descr, const std::string& Shape, bool bFortran)
+{
+    std::string Dict = "{'descr': " + Descr + ", 'fortran_order': "
+        + (bFortran ? "True" : "False") + ", 'shape': " + Shape + ", }";
+    // magic, version and length, then the dict padded to 64 bytes
+    const std::size_t nFixed = 10;
+    Dict.append((64 - (nFixed + Dict.size() + 1) % 64) % 64, ' ');
+    Dict += '\n';
+    std::string s("\x93NUMPY\x01\x00", 8);
+    Put16(s, (unsigned)Dict.size());
+    return s + Dict;
+}
+
+std::string NpyShape(long long nRows, int nColumns, bool bMatrix)
+{
+    char sz[64];
+    if (bMatrix)
+        sprintf(sz, "(%lld, %d)", nRows, nColumns);
+    else
+        sprintf(sz, "(%lld,)", nRows);
+    return sz;
+}
+
+/** Info as a 0-d structured array: text fields '<U', numbers '<f8' */
+std::string NpyInfo(const std::vector<ExportField>& Info)
+{
+    std::string Descr = "[", Data;
+    for (std::size_t i = 0; i < Info.size(); ++i)
+    {
+        const ExportField& F = Info[i];
+        char sz[32];
+        if (F.bText)
+        {
+            std::size_t n = std::max<std::size_t>(F.Text.size(), 1);
+            sprintf(sz, "'<U%u'", (unsigned)n);
+            for (std::size_t j = 0; j < n; ++j)
+                Put32(Data, j < F.Text.size() ? (unsigned char)F.Text[j] : 0);
+        }
+        else
+        {
+            strcpy(sz, "'<f8'");
+            Data.append((const char*)&F.Value, 8);
+        }
+        Descr += (i ? ", ('" : "('") + F.Name + "', " + sz + ")";
+    }
+    Descr += "]";
+    return NpyHeader(Descr, "()", false) + Data;
+}
+
+void DosTime(unsigned& Time, unsigned& Date)
+{
+    time_t t = time(NULL);
+    struct tm* T = localtime(&t);
+    Time = (T->tm_hour << 11) | (T->tm_min << 5) | (T->tm_sec / 2);
+    Date = ((T->tm_year - 80) << 9) | ((T->tm_mon + 1) << 5) | T->tm_mday;
+}
+
+/** Local file header of a stored member */
+std::string ZipLocal(const std::string& Name, unsigned Crc, long long nBytes)
+{
+    unsigned Time, Date;
+    DosTime(Time, Date);
+    std::string s;
+    Put32(s, ZIP_LOCAL);
+    Put16(s, 20); // version needed
+    Put16(s, 0);  // flags
+    Put16(s, 0);  // stored
+    Put16(s, Time);
+    Put16(s, Date);
+    Put32(s, Crc);
+    Put32(s, (unsigned)nBytes);
+    Put32(s, (unsigned)nBytes);
+    Put16(s, (unsigned)Name.size());
+    Put16(s, 0);
+    return s + Name;
+}
+
+/** Central directory entry of a member whose local header is Local */
+std::string ZipCentral(const std::string& Local, long long Offset)
+{
+    std::string s;
+    Put32(s, ZIP_CENTRAL);
+    Put16(s, 20);                          // version made by
+    s += Local.substr(4, ZIP_LOCAL_SIZE - 4 - 2); // needed .. name length
+    Put16(s, 0);                           // extra
+    Put16(s, 0);                           // comment
+    Put16(s, 0);                           // disk
+    Put16(s, 0);                           // internal attributes
+    Put32(s, 0);                           // external attributes
+    Put32(s, (unsigned)Offset);
+    return s + Local.substr(ZIP_LOCAL_SIZE);
+}
+
+} // namespace
+
+//==================================================================
+
+ExportFormat ExportFormatOf(const char* szPath)
+{
+    const char* szDot = szPath ? strrchr(szPath, '.') : NULL;
+    if (!szDot)
+        return EXPORT_UNKNOWN;
+    std::string Ext(szDot + 1);
+    for (std::size_t i = 0; i < Ext.size(); ++i)
+        Ext[i] = (char)tolower((unsigned char)Ext[i]);
+    if (Ext == "mat")
+        return EXPORT_MAT;
+    if (Ext == "npz")
+        return EXPORT_NPZ;
+    if (Ext == "npy")
+        return EXPORT_NPY;
+    return EXPORT_UNKNOWN;
+}
+
+TrialExport::TrialExport()
+    : m_Format(EXPORT_UNKNOWN), m_pFile(NULL), m_End(0), m_bFailed(false)
+{
+}
+
+TrialExport::~TrialExport()
+{
+    if (m_pFile)
+        Abandon();
+}
+
+bool TrialExport::Open(const char* szPath, const std::vector<ExportVariable>& Variables,
+                       const std::vector<ExportField>& Info)
+{
+    if (m_pFile || !szPath)
+        return false;
+    m_Format = ExportFormatOf(szPath);
+    if (m_Format == EXPORT_UNKNOWN)
+        return false;
+    m_Placed.clear();
+    m_Info = Info;
+    m_bFailed = false;
+
+    // a .npy holds one array: the variables side by side
+    int nNpyColumns = 0;
+    for (std::size_t i = 0; i < Variables.size(); ++i)
+    {
+        const ExportVariable& V = Variables[i];
+        if (V.nRows < 0 || V.nColumns < 0 || V.nRows > 0x7FFFFFFF)
+            return false;
+        if (m_Format == EXPORT_NPY && V.nRows != Variables[0].nRows)
+            return false;
+        nNpyColumns += V.nColumns;
+    }
+
+    long long At = 0;
+    if (m_Format == EXPORT_MAT)
+        At = (long long)MatFileHeader().size();
+    for (std::size_t i = 0; i < Variables.size(); ++i)
+    {
+        Placed P = { Variables[i], At, 0, std::string(),
+                     std::vector<long long>(Variables[i].nColumns, 0),
+                     std::vector<unsigned>(Variables[i].nColumns, 0) };
+        const long long nData = 8 * P.V.nRows * P.V.nColumns;
+        if (m_Format == EXPORT_MAT)
+        {
+            std::string Body = MatArrayHeader(mxDOUBLE_CLASS, P.V.nRows, P.V.nColumns,
+                                              MatName(P.V.Name, 63));
+            MatTag(Body, miDOUBLE, (std::size_t)nData);
+            if ((long long)Body.size() + nData > MAX_32)
+                return false;
+            std::string Tag;
+            MatTag(Tag, miMATRIX, Body.size() + (std::size_t)nData);
+            P.Header = Tag + Body;
+        }
+        else if (m_Format == EXPORT_NPZ)
+        {
+            std::string Npy = NpyHeader("'<f8'", NpyShape(P.V.nRows, P.V.nColumns, P.V.nColumns != 1),
+                                        true);
+            P.Header = ZipLocal(P.V.Name + ".npy", 0, (long long)Npy.size() + nData) + Npy;
+        }
+        else if (i == 0)
+        {
+            P.Header = NpyHeader("'<f8'", NpyShape(P.V.nRows, nNpyColumns, true), true);
+        }
+        P.DataOffset = At + (long long)P.Header.size();
+        At = P.DataOffset + nData;
+        m_Placed.push_back(P);
+    }
+    m_End = At;
+    if (m_Format == EXPORT_NPY && Variables.empty())
+        m_End = (long long)NpyHeader("'<f8'", "(0, 0)", true).size();
+    if (m_Format == EXPORT_NPZ && m_End > MAX_32)
+        return false;
+
+    m_pFile = fopen(szPath, "wb");
+    if (!m_pFile)
+        return false;
+    m_Path = szPath;
+    setvbuf(m_pFile, NULL, _IOFBF, FILE_BUFFER);
+    return true;
+}
+
+bool TrialExport::WriteAt(long long Offset, const void* p, std::size_t nBytes)
+{
+    if (nBytes == 0)
+        return true;
+    if (Tell(m_pFile) != Offset && Seek(m_pFile, Offset, SEEK_SET) != 0)
+        return false;
+    return fwrite(p, 1, nBytes, m_pFile) == nBytes;
+}
+
+bool TrialExport::Write(int iVariable, int iColumn, const double* p, long long n)
+{
+    if (!m_pFile || m_bFailed || iVariable < 0 || iVariable >= (int)m_Placed.size())
+        return false;
+    Placed& P = m_Placed[iVariable];
+    if (iColumn < 0 || iColumn >= P.V.nColumns || n < 0 || P.Written[iColumn] + n > P.V.nRows)
+        return false;
+    const long long Offset = P.DataOffset + 8 * ((long long)iColumn * P.V.nRows + P.Written[iColumn]);
+    if (!WriteAt(Offset, p, (std::size_t)(8 * n)))
+    {
+        m_bFailed = true;
+        return false;
+    }
+    if (m_Format == EXPORT_NPZ)
+        P.Crc[iColumn] = Crc32(P.Crc[iColumn], p, (std::size_t)(8 * n));
+    P.Written[iColumn] += n;
+    return true;
+}
+
+bool TrialExport::Close()
+{
+    if (!m_pFile)
+        return false;
+    bool bOk = !m_bFailed;
+    for (std::size_t i = 0; bOk && i < m_Placed.size(); ++i)
+        for (int c = 0; c < m_Placed[i].V.nColumns; ++c)
+            bOk = bOk && m_Placed[i].Written[c] == m_Placed[i].V.nRows;
+
+    if (bOk && m_Format == EXPORT_MAT)
+    {
+        std::string Head = MatFileHeader();
+        bOk = WriteAt(0, Head.data(), Head.size());
+        for (std::size_t i = 0; bOk && i < m_Placed.size(); ++i)
+            bOk = WriteAt(m_Placed[i].Offset, m_Placed[i].Header.data(), m_Placed[i].Header.size());
+        std::string Info = MatInfo(m_Info);
+        bOk = bOk && WriteAt(m_End, Info.data(), Info.size());
+    }
+    else if (bOk && m_Format == EXPORT_NPZ)
+    {
+        std::string Directory;
+        int nMembers = 0;
+        for (std::size_t i = 0; bOk && i < m_Placed.size(); ++i, ++nMembers)
+        {
+            Placed& P = m_Placed[i];
+            const std::size_t nLocal = ZIP_LOCAL_SIZE + P.V.Name.size() + 4;
+            unsigned Crc = Crc32(0, P.Header.data() + nLocal, P.Header.size() - nLocal);
+            for (int c = 0; c < P.V.nColumns; ++c)
+                Crc = Crc32Combine(Crc, P.Crc[c], 8 * P.V.nRows);
+            memcpy(&P.Header[ZIP_CRC_AT], &Crc, 4);
+            bOk = WriteAt(P.Offset, P.Header.data(), P.Header.size());
+            Directory += ZipCentral(P.Header.substr(0, nLocal), P.Offset);
+        }
+        std::string Npy = NpyInfo(m_Info);
+        std::string Local = ZipLocal("Info.npy", Crc32(0, Npy.data(), Npy.size()), (long long)Npy.size());
+        bOk = bOk && WriteAt(m_End, Local.data(), Local.size())
+            && WriteAt(m_End + (long long)Local.size(), Npy.data(), Npy.size());
+        Directory += ZipCentral(Local, m_End);
+        ++nMembers;
+
+        const long long DirectoryAt = m_End + (long long)(Local.size() + Npy.size());
+        std::string End;
+        Put32(End, ZIP_END);
+        Put16(End, 0);
+        Put16(End, 0);
+        Put16(End, nMembers);
+        Put16(End, nMembers);
+        Put32(End, (unsigned)Directory.size());
+        Put32(End, (unsigned)DirectoryAt);
+        Put16(End, 0);
+        bOk = bOk && DirectoryAt + (long long)Directory.size() <= MAX_32
+            && WriteAt(DirectoryAt, Directory.data(), Directory.size())
+            && WriteAt(DirectoryAt + (long long)Directory.size(), End.data(), End.size());
+    }
+    else if (bOk && m_Format == EXPORT_NPY)
+    {
+        std::string Head = m_Placed.empty() ? NpyHeader("'<f8'", "(0, 0)", true) : m_Placed[0].Header;
+        bOk = WriteAt(0, Head.data(), Head.size());
+    }
+
+    if (!bOk)
+    {
+        Abandon();
+        return false;
+    }
+    bOk = fclose(m_pFile) == 0;
+    m_pFile = NULL;
+    if (!bOk)
+        std::remove(m_Path.c_str());
+    return bOk;
+}
+
+void TrialExport::Abandon()
+{
+    fclose(m_pFile);
+    m_pFile = NULL;
+    std::remove(m_Path.c_str());
+}
+
+//==================================================================
+
+long long ExportRecorder(const TrialRecorder& Recorder, const char* szPath)
+{
+    // rows below Rows() are complete and stay where they are
+    const int nRows = Recorder.Rows();
+    std::vector<ExportVariable> Variables;
+    for (int c = 0; c < REC_N_COLUMNS; ++c)
+        Variables.push_back(ExportVariable(RecorderColumnName(c), nRows));
+    std::vector<ExportField> Info;
+    Info.push_back(ExportField("Source", "CortexEngine recorder"));
+    Info.push_back(ExportField("Created", Timestamp("%Y-%m-%d %H:%M:%S")));
+    Info.push_back(ExportField("Rows", (double)nRows));
+    Info.push_back(ExportField("Dropped", (double)Recorder.Dropped()));
+
+    TrialExport Export;
+    if (!Export.Open(szPath, Variables, Info))
+        return -1;
+    for (int c = 0; c < REC_N_COLUMNS; ++c)
+        if (!Export.Write(c, 0, Recorder.Data() + (std::size_t)c * Recorder.Capacity(), nRows))
+            return -1;
+    return Export.Close() ? nRows : -1;
+}
+
+long long ExportTrialLog(const char* szLog, const char* szPath)
+{
+    FILE* pLog = szLog ? fopen(szLog, "rb") : NULL;
+    if (!pLog)
+        return -1;
+
+    // "TrialLog 1 <samples per frame> <scalar columns>", then the rows
+    char szLine[4096];
+    int nVersion = 0, nSamples = -1, nChars = 0;
+    if (!fgets(szLine, sizeof(szLine), pLog)
+        || sscanf(szLine, "TrialLog %d %d %n", &nVersion, &nSamples, &nChars) < 2
+        || nVersion != 1 || nSamples < 0 || nChars == 0)
+    {
+        fclose(pLog);
+        return -1;
+    }
+    std::vector<ExportVariable> Variables;
+    std::string Names(szLine + nChars);
+    Names.erase(Names.find_last_not_of(" \r\n") + 1);
+    for (std::size_t i = 0; i < Names.size();)
+    {
+        std::size_t j = std::min(Names.find(',', i), Names.size());
+        Variables.push_back(ExportVariable(Names.substr(i, j - i), 0));
+        i = j + 1;
+    }
+    const int nScalars = (int)Variables.size();
+    const char* SampleNames[4] = { "F1Y", "F1Z", "F2Y", "F2Z" };
+    for (int s = 0; s < 4; ++s)
+        Variables.push_back(ExportVariable(SampleNames[s], 0, nSamples));
+    const int nColumns = nScalars + 4 * nSamples;
+    if (nColumns == 0)
+    {
+        fclose(pLog);
+        return -1;
+    }
+
+    // whole rows only, the log of a trial that stopped abruptly included
+    const long long Start = Tell(pLog);
+    Seek(pLog, 0, SEEK_END);
+    const long long nRows = (Tell(pLog) - Start) / (8LL * nColumns);
+    Seek(pLog, Start, SEEK_SET);
+    for (std::size_t i = 0; i < Variables.size(); ++i)
+        Variables[i].nRows = nRows;
+
+    // stances: Side (1 R, 2 L), Frame, Time, Fp, Fz, StanceTime,
+    // StartFrame, StartTime
+    const int nStanceColumns = 8;
+    std::vector<double> Stances;
+    FILE* pSteps = fopen((std::string(szLog) + ".steps").c_str(), "rb");
+    if (pSteps && ExportFormatOf(szPath) != EXPORT_NPY)
+    {
+        double Row[nStanceColumns];
+        while (fread(Row, sizeof(Row), 1, pSteps) == 1)
+            Stances.insert(Stances.end(), Row, Row + nStanceColumns);
+        Variables.push_back(ExportVariable("Stances", (long long)Stances.size() / nStanceColumns,
+                                           nStanceColumns));
+    }
+    if (pSteps)
+        fclose(pSteps);
+
+    std::vector<ExportField> Info;
+    Info.push_back(ExportField("Source", szLog));
+    Info.push_back(ExportField("Created", Timestamp("%Y-%m-%d %H:%M:%S")));
+    Info.push_back(ExportField("Rows", (double)nRows));
+    Info.push_back(ExportField("Samples", (double)nSamples));
+    Info.push_back(ExportField("StanceColumns", "Side,Frame,Time,Fp,Fz,StanceTime,StartFrame,StartTime"));
+
+    TrialExport Export;
+    bool bOk = Export.Open(szPath, Variables, Info);
+
+    // rows in blocks; each block goes out as one run per column
+    const long long nBlock = std::max<long long>(1, (long long)LOG_BLOCK / (8LL * nColumns));
+    std::vector<double> Block((std::size_t)(std::min(nBlock, std::max(nRows, 1LL)) * nColumns));
+    std::vector<double> Column(Block.size() / nColumns);
+    for (long long r = 0; bOk && r < nRows; r += nBlock)
+    {
+        const long long nb = std::min(nBlock, nRows - r);
+        bOk = fread(&Block[0], 8 * nColumns, (std::size_t)nb, pLog) == (std::size_t)nb;
+        for (int c = 0; bOk && c < nColumns; ++c)
+        {
+            for (long long i = 0; i < nb; ++i)
+                Column[i] = Block[i * nColumns + c];
+            if (c < nScalars)
+                bOk = Export.Write(c, 0, &Column[0], nb);
+            else
+                bOk = Export.Write(nScalars + (c - nScalars) / nSamples, (c - nScalars) % nSamples,
+                                   &Column[0], nb);
+        }
+    }
+    fclose(pLog);
+
+    const long long nStances = (long long)Stances.size() / nStanceColumns;
+    for (int c = 0; bOk && (int)Variables.size() > nScalars + 4 && c < nStanceColumns; ++c)
+    {
+        std::vector<double> S((std::size_t)nStances);
+        for (long long i = 0; i < nStances; ++i)
+            S[i] = Stances[i * nStanceColumns + c];
+        bOk = Export.Write(nScalars + 4, c, S.empty() ? NULL : &S[0], nStances);
+    }
+    return bOk && Export.Close() ? nRows : -1;
+}
+
+} // namespace CortexEngine
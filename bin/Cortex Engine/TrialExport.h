@@ -0,0 +1,125 @@
+/*=========================================================
+//
+// File: TrialExport.h
+//
+// Export of recorded trials to MATLAB v5 .mat and NumPy .npy/.npz files,
+// written directly, without MATLAB or Python.
+//
+=============================================================================*/
+
+#ifndef TrialExport_H
+#define TrialExport_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "TrialRecorder.h"
+
+namespace CortexEngine
+{
+
+enum ExportFormat
+{
+    EXPORT_MAT,    //!< MATLAB v5: one double matrix per variable, Info struct
+    EXPORT_NPZ,    //!< NumPy archive: one .npy per variable, Info record
+    EXPORT_NPY,    //!< one n x (all columns) array, variables side by side
+    EXPORT_UNKNOWN
+};
+
+/** The format an export path's extension names */
+ExportFormat ExportFormatOf(const char* szPath);
+
+/** nRows x nColumns doubles */
+struct ExportVariable
+{
+    ExportVariable(const std::string& Name_, long long nRows_, int nColumns_ = 1)
+        : Name(Name_), nRows(nRows_), nColumns(nColumns_) {}
+
+    std::string Name;
+    long long nRows;
+    int nColumns;
+};
+
+/** A field of the Info metadata, text or a number */
+struct ExportField
+{
+    ExportField(const std::string& Name_, const std::string& Text_)
+        : Name(Name_), Text(Text_), Value(0.0), bText(true) {}
+    ExportField(const std::string& Name_, double Value_)
+        : Name(Name_), Value(Value_), bText(false) {}
+
+    std::string Name;
+    std::string Text;
+    double Value;
+    bool bText;
+};
+
+/** Streams columns of doubles to a .mat, .npz or .npy file
+ *
+ *  Open lays the whole file out from the variables' sizes, so that each
+ *  column has its place in it. Write then appends the next rows of one
+ *  column at that place: columns may be written in any order and
+ *  interleaving, the rows of each column in order. Headers, the Info
+ *  metadata and the archive directory are written by Close, which fails
+ *  (and removes the file) unless every column is complete.
+ *
+ *  Data go from the caller's buffer to the file without conversion, so
+ *  an export costs about what writing its bytes does; large blocks per
+ *  Write keep it that way. A .mat variable and a whole .npz must stay
+ *  under 4 GB. Little-endian hosts only.
+ */
+class TrialExport
+{
+public:
+    TrialExport();
+    ~TrialExport();
+
+    bool Open(const char* szPath, const std::vector<ExportVariable>& Variables,
+              const std::vector<ExportField>& Info);
+
+    bool Write(int iVariable, int iColumn, const double* p, long long n);
+
+    bool Close();
+
+private:
+    TrialExport(const TrialExport&);
+    TrialExport& operator=(const TrialExport&);
+
+    struct Placed
+    {
+        ExportVariable V;
+        long long Offset;       // of its MAT element or archive member
+        long long DataOffset;   // of column 0, row 0
+        std::string Header;     // everything from Offset to DataOffset, less CRC
+        std::vector<long long> Written;
+        std::vector<unsigned> Crc;
+    };
+
+    bool WriteAt(long long Offset, const void* p, std::size_t nBytes);
+    void Abandon();
+
+    ExportFormat m_Format;
+    std::string m_Path;
+    FILE* m_pFile;
+    std::vector<Placed> m_Placed;
+    std::vector<ExportField> m_Info;
+    long long m_End;
+    bool m_bFailed;
+};
+
+/** Columns of a recorder, the rows recorded when it is called
+ *
+ * \return rows written, -1 if the file could not be written
+ */
+long long ExportRecorder(const TrialRecorder& Recorder, const char* szPath);
+
+/** Rows and stances of a trial log (bin/TrialLog.m), read in large blocks
+ *
+ * \return rows written, -1 if the log could not be read or the file written
+ */
+long long ExportTrialLog(const char* szLog, const char* szPath);
+
+} // namespace CortexEngine
+
+#endif
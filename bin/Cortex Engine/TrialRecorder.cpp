@@ -0,0 +1,74 @@
+/*=========================================================
+//
+// File: TrialRecorder.cpp
+//
+// Column recording of the treadmill signals, see TrialRecorder.h
+//
+=============================================================================*/
+
+#include "TrialRecorder.h"
+
+#include <cstddef>
+
+namespace CortexEngine
+{
+
+const char* RecorderColumnName(int iColumn)
+{
+    static const char* Names[REC_N_COLUMNS] = {
+        "Frame", "Time", "Delay", "FzR", "FzL", "CoPyR", "CoPyL",
+        "CoPxR", "CoPxL", "OnR", "OnL", "Speed", "Fp", "ZeroR", "ZeroL"
+    };
+    return iColumn >= 0 && iColumn < REC_N_COLUMNS ? Names[iColumn] : "";
+}
+
+TrialRecorder::TrialRecorder(int nCapacity, const ConverterParams& Params)
+    : m_nCapacity(nCapacity > 0 ? nCapacity : 1), m_Converter(Params),
+      m_iLastFrame(-1), m_Speed(0.0f), m_Fp(0.0f), m_nRows(0), m_nDropped(0)
+{
+    m_Data.assign((std::size_t)m_nCapacity * REC_N_COLUMNS, 0.0);
+}
+
+void TrialRecorder::SetState(float Speed, float Fp)
+{
+    m_Speed.store(Speed);
+    m_Fp.store(Fp);
+}
+
+void TrialRecorder::OnFrame(const sFrameOfData& f, double Time)
+{
+    if (f.iFrame == m_iLastFrame)
+        return;
+    m_iLastFrame = f.iFrame;
+
+    const int iRow = m_nRows.load(std::memory_order_relaxed);
+    if (iRow >= m_nCapacity)
+    {
+        m_nDropped++;
+        return;
+    }
+
+    m_Converter.Convert(f, m_Derived);
+    const DerivedFrame& D = m_Derived;
+    double* p = &m_Data[iRow];
+    const std::size_t n = (std::size_t)m_nCapacity;
+    p[REC_FRAME * n] = f.iFrame;
+    p[REC_TIME * n] = Time;
+    p[REC_DELAY * n] = f.fDelay;
+    p[REC_FZ_R * n] = D.MeanFz[0];
+    p[REC_FZ_L * n] = D.MeanFz[1];
+    p[REC_COPY_R * n] = D.CoPy[0];
+    p[REC_COPY_L * n] = D.CoPy[1];
+    p[REC_COPX_R * n] = D.CoPx[0];
+    p[REC_COPX_L * n] = D.CoPx[1];
+    p[REC_ON_R * n] = D.On[0];
+    p[REC_ON_L * n] = D.On[1];
+    p[REC_SPEED * n] = m_Speed.load();
+    p[REC_FP * n] = m_Fp.load();
+    p[REC_ZERO_R * n] = D.Zero[1];
+    p[REC_ZERO_L * n] = D.Zero[3];
+
+    m_nRows.store(iRow + 1, std::memory_order_release);
+}
+
+} // namespace CortexEngine
@@ -0,0 +1,81 @@
+/*=========================================================
+//
+// File: TrialRecorder.h
+//
+// Per-frame treadmill signals of a trial, recorded as columns from the
+// SDK's data thread.
+//
+=============================================================================*/
+
+#ifndef TrialRecorder_H
+#define TrialRecorder_H
+
+#include <atomic>
+#include <vector>
+
+#include "FrameConverter.h"
+#include "MatlabCortex.h"
+
+namespace CortexEngine
+{
+
+/** Recorded columns, in order */
+enum RecorderColumn
+{
+    REC_FRAME,     //!< Cortex frame number
+    REC_TIME,      //!< arrival, s since CortexEngine_Initialize
+    REC_DELAY,     //!< Cortex's fDelay, s
+    REC_FZ_R,      //!< mean vertical force, right (N)
+    REC_FZ_L,      //!< mean vertical force, left (N)
+    REC_COPY_R,    //!< mean fore/aft CoP, right (m)
+    REC_COPY_L,    //!< mean fore/aft CoP, left (m)
+    REC_COPX_R,    //!< mean lateral CoP, right (m)
+    REC_COPX_L,    //!< mean lateral CoP, left (m)
+    REC_ON_R,      //!< right stance flag
+    REC_ON_L,      //!< left stance flag
+    REC_SPEED,     //!< last commanded belt speed (m/s)
+    REC_FP,        //!< latest mean peak propulsive force (N)
+    REC_ZERO_R,    //!< zero offset taken off the right vertical force (N)
+    REC_ZERO_L,    //!< zero offset taken off the left vertical force (N)
+    REC_N_COLUMNS
+};
+
+const char* RecorderColumnName(int iColumn);
+
+/** Fixed capacity column store, one writer
+ *
+ *  Column c is Data() + c * Capacity(), double, contiguous; rows
+ *  0 .. Rows() - 1 are complete. Storage never moves, so readers may
+ *  keep pointers into it while recording goes on. Frames after the
+ *  last row are counted in Dropped().
+ */
+class TrialRecorder
+{
+public:
+    explicit TrialRecorder(int nCapacity, const ConverterParams& Params = ConverterParams());
+
+    void OnFrame(const sFrameOfData& f, double Time);
+
+    /** Controller state recorded with the next frames, any thread */
+    void SetState(float Speed, float Fp);
+
+    const double* Data() const { return &m_Data[0]; }
+    int Capacity() const { return m_nCapacity; }
+    int Rows() const { return m_nRows.load(std::memory_order_acquire); }
+    int Dropped() const { return m_nDropped.load(); }
+
+private:
+    int m_nCapacity;
+    std::vector<double> m_Data;
+    FrameConverter m_Converter;
+    DerivedFrame m_Derived;
+    int m_iLastFrame;
+    std::atomic<float> m_Speed;
+    std::atomic<float> m_Fp;
+    std::atomic<int> m_nRows;
+    std::atomic<int> m_nDropped;
+};
+
+} // namespace CortexEngine
+
+#endif
@@ -0,0 +1,261 @@
+/*=========================================================
+//
+// File: Watchdog.cpp
+//
+// Stall detection for the control loop, see Watchdog.h
+//
+=============================================================================*/
+
+#include "Watchdog.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <mmsystem.h>
+#pragma comment(lib, "winmm.lib")
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#else
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#endif
+
+namespace CortexEngine
+{
+
+namespace
+{
+
+/** Sleeps the calling thread until absolute times of WatchdogClock
+ *
+ *  Created on the thread that sleeps, which it raises to the highest
+ *  priority it is allowed. Windows: 1 ms timer resolution, a high
+ *  resolution waitable timer (Windows 10 1803 and later, else a normal
+ *  one) and THREAD_PRIORITY_TIME_CRITICAL. Linux: SCHED_FIFO where
+ *  permitted (CAP_SYS_NICE or an rtprio limit) and clock_nanosleep to
+ *  an absolute CLOCK_MONOTONIC time, the clock of steady_clock.
+ */
+class Sleeper
+{
+public:
+    Sleeper()
+    {
+#ifdef _WIN32
+        timeBeginPeriod(1);
+        SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+        m_hTimer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+        if (!m_hTimer)
+            m_hTimer = CreateWaitableTimerExW(NULL, NULL, 0, TIMER_ALL_ACCESS);
+#else
+        sched_param Param;
+        Param.sched_priority = sched_get_priority_min(SCHED_FIFO) + 10;
+        pthread_setschedparam(pthread_self(), SCHED_FIFO, &Param);
+#endif
+    }
+
+    ~Sleeper()
+    {
+#ifdef _WIN32
+        if (m_hTimer)
+            CloseHandle(m_hTimer);
+        timeEndPeriod(1);
+#endif
+    }
+
+    void Until(WatchdogClock::time_point t)
+    {
+#ifdef _WIN32
+        long long Ticks = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            t - WatchdogClock::now()).count() / 100;
+        if (Ticks <= 0)
+            return;
+        LARGE_INTEGER Due;
+        Due.QuadPart = -Ticks; // relative, in 100 ns
+        if (m_hTimer && SetWaitableTimer(m_hTimer, &Due, 0, NULL, NULL, FALSE))
+            WaitForSingleObject(m_hTimer, INFINITE);
+        else
+            std::this_thread::sleep_until(t);
+#else
+        long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            t.time_since_epoch()).count();
+        timespec Ts;
+        Ts.tv_sec = (time_t)(ns / 1000000000LL);
+        Ts.tv_nsec = (long)(ns % 1000000000LL);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &Ts, NULL) == EINTR)
+            ;
+#endif
+    }
+
+    bool RealTime() const
+    {
+#ifdef _WIN32
+        return GetThreadPriority(GetCurrentThread()) == THREAD_PRIORITY_TIME_CRITICAL;
+#else
+        int iPolicy = 0;
+        sched_param Param;
+        return pthread_getschedparam(pthread_self(), &iPolicy, &Param) == 0 && iPolicy == SCHED_FIFO;
+#endif
+    }
+
+private:
+#ifdef _WIN32
+    HANDLE m_hTimer;
+#endif
+};
+
+} // namespace
+
+WatchdogParams::WatchdogParams()
+    : msLoop(500), msFrames(500), msPeriod(5), Accel(0.25)
+{
+}
+
+Watchdog::Watchdog(const WatchdogParams& Params, const BeltCommand& Stop,
+                   WatchdogClock::time_point Epoch)
+    : m_Params(Params), m_StopBelt(Stop), m_Epoch(Epoch),
+      m_LastBeat(0), m_LastFrame(0), m_bTripped(false), m_bStop(false),
+      m_SumLateMicros(0.0)
+{
+    if (m_Params.msPeriod <= 0)
+        m_Params.msPeriod = 1;
+    m_Event.iReason = 0;
+    m_Event.Time = 0.0;
+    m_Event.Gap = 0.0;
+    m_Event.iStopResult = 0;
+    m_Stats.nChecks = 0;
+    m_Stats.MaxLoopGap = 0.0;
+    m_Stats.MaxFrameGap = 0.0;
+    m_Stats.MeanLateMicros = 0.0;
+    m_Stats.MaxLateMicros = 0.0;
+    m_Stats.bRealTime = 0;
+}
+
+Watchdog::~Watchdog()
+{
+    Stop();
+}
+
+long long Watchdog::Now() const
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        WatchdogClock::now() - m_Epoch).count();
+}
+
+void Watchdog::Start()
+{
+    if (m_Thread.joinable())
+        return;
+    m_LastBeat.store(Now());
+    m_LastFrame.store(0);
+    m_bStop.store(false);
+    m_Thread = std::thread(&Watchdog::Run, this);
+}
+
+void Watchdog::Stop()
+{
+    m_bStop.store(true);
+    if (m_Thread.joinable())
+        m_Thread.join();
+}
+
+void Watchdog::Beat()
+{
+    m_LastBeat.store(Now(), std::memory_order_relaxed);
+}
+
+void Watchdog::OnFrame()
+{
+    m_LastFrame.store(Now(), std::memory_order_relaxed);
+}
+
+WatchdogEvent Watchdog::Event() const
+{
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    return m_Event;
+}
+
+WatchdogStats Watchdog::Stats() const
+{
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    return m_Stats;
+}
+
+void Watchdog::Run()
+{
+    Sleeper Sleep;
+    {
+        std::lock_guard<std::mutex> Lock(m_Mutex);
+        m_Stats.bRealTime = Sleep.RealTime() ? 1 : 0;
+    }
+    const std::chrono::milliseconds Period(m_Params.msPeriod);
+    WatchdogClock::time_point Next = WatchdogClock::now() + Period;
+    while (!m_bStop.load())
+    {
+        Sleep.Until(Next);
+        WatchdogClock::time_point Woke = WatchdogClock::now();
+        double LateMicros = std::chrono::duration<double, std::micro>(Woke - Next).count();
+        if (Check(std::chrono::duration_cast<std::chrono::nanoseconds>(Woke - m_Epoch).count(),
+                  LateMicros))
+            return;
+        // a late wake-up does not bunch up the checks that follow
+        Next += Period;
+        if (Next <= Woke)
+            Next = Woke + Period;
+    }
+}
+
+bool Watchdog::Check(long long Now, double LateMicros)
+{
+    const long long Beat = m_LastBeat.load(std::memory_order_relaxed);
+    const long long Frame = m_LastFrame.load(std::memory_order_relaxed);
+    const double LoopGap = 1e-9 * (double)(Now - Beat);
+    const double FrameGap = Frame > 0 ? 1e-9 * (double)(Now - Frame) : 0.0;
+
+    int iReason = 0;
+    double Gap = 0.0;
+    {
+        std::lock_guard<std::mutex> Lock(m_Mutex);
+        WatchdogStats& S = m_Stats;
+        S.nChecks++;
+        m_SumLateMicros += LateMicros;
+        S.MeanLateMicros = m_SumLateMicros / S.nChecks;
+        if (LateMicros > S.MaxLateMicros)
+            S.MaxLateMicros = LateMicros;
+        if (LoopGap > S.MaxLoopGap)
+            S.MaxLoopGap = LoopGap;
+        if (FrameGap > S.MaxFrameGap)
+            S.MaxFrameGap = FrameGap;
+
+        if (m_Params.msLoop > 0 && LoopGap > 1e-3 * m_Params.msLoop)
+        {
+            iReason = WATCHDOG_LOOP;
+            Gap = LoopGap;
+        }
+        else if (m_Params.msFrames > 0 && FrameGap > 1e-3 * m_Params.msFrames)
+        {
+            iReason = WATCHDOG_FRAMES;
+            Gap = FrameGap;
+        }
+        if (!iReason)
+            return false;
+        m_Event.iReason = iReason;
+        m_Event.Time = 1e-9 * (double)Now;
+        m_Event.Gap = Gap;
+        m_Event.iStopResult = -1;
+    }
+
+    // flag first: CortexEngine_TreadmillSetSpeed, and CortexTreadmill.m
+    // for the library, refuse new speeds from a loop that resumes
+    m_bTripped.store(true);
+    if (m_StopBelt)
+    {
+        int iResult = m_StopBelt(0.0, 0.0, m_Params.Accel);
+        std::lock_guard<std::mutex> Lock(m_Mutex);
+        m_Event.iStopResult = iResult;
+    }
+    return true;
+}
+
+} // namespace CortexEngine
@@ -0,0 +1,108 @@
+/*=========================================================
+//
+// File: Watchdog.h
+//
+// Stops the belt when the control loop or the Cortex frames stall.
+//
+=============================================================================*/
+
+#ifndef Watchdog_H
+#define Watchdog_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "CortexEngine.h"
+
+namespace CortexEngine
+{
+
+typedef std::chrono::steady_clock WatchdogClock;
+
+/** Belt command, TREADMILL_setSpeed(left, right, acceleration) */
+typedef std::function<int(double Left, double Right, double Accel)> BeltCommand;
+
+struct WatchdogParams
+{
+    WatchdogParams();
+
+    int msLoop;     //!< longest gap between heartbeats, 0 not watched
+    int msFrames;   //!< longest gap between frames, 0 not watched
+    int msPeriod;   //!< interval of the checks
+    double Accel;   //!< acceleration of the stop (m/s^2)
+};
+
+/** What stopped the belt; iReason is 0 while nothing has */
+struct WatchdogEvent
+{
+    int iReason;      //!< WATCHDOG_LOOP or WATCHDOG_FRAMES
+    double Time;      //!< seconds since the watchdog's epoch
+    double Gap;       //!< seconds since the last heartbeat or frame
+    int iStopResult;  //!< return of the belt command, -1 if there is none
+};
+
+struct WatchdogStats
+{
+    int nChecks;
+    double MaxLoopGap;      //!< s, longest gap seen between heartbeats
+    double MaxFrameGap;     //!< s, between frames, after the first
+    double MeanLateMicros;  //!< wake-up after the scheduled check time
+    double MaxLateMicros;
+    int bRealTime;          //!< the thread runs at real-time priority
+};
+
+/** A thread of its own checking, at fixed times, that heartbeats and
+ *  frames keep coming
+ *
+ *  The thread wakes at absolute times msPeriod apart, at the highest
+ *  priority the process may set, so that a stall is detected within
+ *  msPeriod plus the wake-up latency, whatever MATLAB is doing. On the
+ *  first gap beyond its deadline it sends the belt command once, with
+ *  both speeds 0, records the event and stops checking. The frame
+ *  deadline applies from the first frame after Start.
+ */
+class Watchdog
+{
+public:
+    Watchdog(const WatchdogParams& Params, const BeltCommand& Stop,
+             WatchdogClock::time_point Epoch);
+    ~Watchdog();
+
+    void Start(); //!< the loop deadline runs from here
+    void Stop();
+
+    void Beat();    //!< from the control loop
+    void OnFrame(); //!< from the SDK's data thread
+
+    bool Armed() const { return m_Thread.joinable(); }
+    bool Tripped() const { return m_bTripped.load(); }
+    WatchdogEvent Event() const;
+    WatchdogStats Stats() const;
+
+private:
+    void Run();
+    bool Check(long long Now, double LateMicros);
+    long long Now() const;
+
+    WatchdogParams m_Params;
+    BeltCommand m_StopBelt;
+    WatchdogClock::time_point m_Epoch;
+
+    std::atomic<long long> m_LastBeat;  // ns since epoch
+    std::atomic<long long> m_LastFrame; // ns since epoch, 0 before the first
+    std::atomic<bool> m_bTripped;
+    std::atomic<bool> m_bStop;
+    std::thread m_Thread;
+
+    mutable std::mutex m_Mutex; // event and stats
+    WatchdogEvent m_Event;
+    WatchdogStats m_Stats;
+    double m_SumLateMicros;
+};
+
+} // namespace CortexEngine
+
+#endif
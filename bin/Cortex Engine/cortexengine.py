@@ -0,0 +1,491 @@
+"""NumPy access to the Cortex engine's frame ring and trial recorder.
+
+The engine keeps the last frames from Cortex and the per-frame treadmill
+signals of a trial in native buffers (FrameRing.h, TrialRecorder.h). The
+arrays handed out here are views of those buffers: nothing is copied, so
+reading every frame at the camera rate costs the same however much data a
+frame carries.
+
+    import cortexengine
+
+    engine = cortexengine.Engine()
+    engine.connect()                      # Cortex, then the engine
+    engine.start_ring()
+    engine.start_recorder(rows=100 * 600) # 10 min at 100 Hz
+
+    for frame in engine.frames():
+        fz = frame.analog[:, 3]           # all samples of channel 4
+        ...
+        if not frame.valid():             # overwritten while we worked
+            ...
+
+    columns = engine.recorded()           # {"Frame": array, "FzR": ...}
+    engine.close()
+
+A frame's arrays hold its data until the ring wraps, nSlots frames later
+(1024 by default); frame.valid() tells whether that has happened. Copy
+what must be kept longer. Recorded columns grow in place while the
+recorder runs and keep the rows recorded after it stops.
+
+Every array holds a reference to the engine buffer it views, so stopping
+the ring or recorder, starting a new one or closing the engine never
+frees memory an array still points to; the engine releases the buffer
+when the last such array is gone.
+
+The engine is loaded next to the Cortex SDK: Cortex_SDK.dll and
+CortexEngine.dll on Windows, libCortexLinux.so and libCortexEngine.so on
+Linux (see "CortexEngine ReadMe.txt").
+"""
+
+import contextlib
+import ctypes
+import os
+import sys
+
+import numpy as np
+
+RC_OKAY = 0
+
+# TRACE_* of CortexEngine.h, the stages a script can mark with Engine.span
+TRACE_CONVERT, TRACE_FILTER, TRACE_GAIT, TRACE_CONTROL, TRACE_SEND = 2, 3, 4, 5, 6
+TRACE_WAIT = 9
+
+# SIGNAL_* of CortexEngine.h, alerts of the analog signal monitor
+SIGNAL_RAIL, SIGNAL_STUCK, SIGNAL_SPIKE, SIGNAL_NOISE = 1, 2, 4, 8
+SIGNAL_STATS = ("samples", "rail", "stuck", "spikes", "noise_rms", "alerts")
+
+# TREADMILL_* of treadmill0x2Dremote.h, results of Engine.set_speed
+TREADMILL_OK, TREADMILL_NOT_CONNECTED, TREADMILL_SEND = 0, 20, 21
+TREADMILL_STOPPED = 30  # of CortexEngine.h: not sent, the watchdog has tripped
+TREADMILL_STATS = ("commands", "sent", "send_errors", "not_connected", "reconnects",
+                   "mean_us", "max_us", "connected", "pinned")
+
+
+class RingFrame(ctypes.Structure):
+    """sRingFrame of CortexEngine.h"""
+    _fields_ = [
+        ("Seq", ctypes.c_longlong),
+        ("iFrame", ctypes.c_int),
+        ("fDelay", ctypes.c_float),
+        ("fTime", ctypes.c_double),
+        ("nMarkers", ctypes.c_int),
+        ("nAnalogChannels", ctypes.c_int),
+        ("nAnalogSamples", ctypes.c_int),
+        ("nForcePlates", ctypes.c_int),
+        ("nForceSamples", ctypes.c_int),
+        ("bTruncated", ctypes.c_int),
+    ]
+
+
+def _default_paths():
+    here = os.path.dirname(os.path.abspath(__file__))
+    if sys.platform.startswith("win"):
+        return (os.path.join(here, "..", "Matlab Cortex SDK", "Cortex_SDK.dll"),
+                os.path.join(here, "CortexEngine.dll"))
+    return (os.path.join(here, "..", "Cortex SDK Linux", "libCortexLinux.so"),
+            os.path.join(here, "libCortexEngine.so"))
+
+
+def _declare(lib, name, restype, *argtypes):
+    f = getattr(lib, name)
+    f.restype = restype
+    f.argtypes = list(argtypes)
+
+
+class _Hold(object):
+    """An engine handle from RingAcquire or RecorderAcquire, released
+    when the last array viewing the buffer is gone"""
+
+    def __init__(self, release, handle):
+        self._release = release
+        self._handle = handle
+
+    def __del__(self):
+        try:
+            self._release(self._handle)
+        except Exception:  # the library is already unloaded at shutdown
+            pass
+
+
+class _Buffer(object):
+    """Engine memory as the base of a numpy array, keeping its _Hold"""
+
+    def __init__(self, hold, pointer, ctype, shape):
+        self._hold = hold
+        self.__array_interface__ = {
+            "version": 3,
+            "shape": shape,
+            "typestr": np.dtype(ctype).str,
+            "data": (ctypes.cast(pointer, ctypes.c_void_p).value or 0, False),
+        }
+
+
+def _view(hold, pointer, ctype, shape):
+    return np.asarray(_Buffer(hold, pointer, ctype, shape))
+
+
+class Frame(object):
+    """One frame in the ring; the arrays are views of its slot.
+
+    analog   (nAnalogSamples, nAnalogChannels) int16
+    forces   (nForceSamples, nForcePlates, 7) float32: X,Y,Z, fX,fY,fZ, mZ
+    markers  (nMarkers, 3) float32, all bodies in body order
+    """
+
+    __slots__ = ("seq", "iframe", "delay", "time", "truncated",
+                 "analog", "forces", "markers", "_engine", "_ring")
+
+    def valid(self):
+        """True while the slot still holds this frame, in a ring still running"""
+        return (self._engine._ring is self._ring and
+                self._engine._lib.CortexEngine_RingValid(self.seq) == 1)
+
+
+class Engine(object):
+    """The Cortex SDK and the engine, loaded into this process"""
+
+    def __init__(self, sdk_path=None, engine_path=None):
+        default_sdk, default_engine = _default_paths()
+        # the engine resolves the SDK's functions from the loaded SDK
+        self._sdk = ctypes.CDLL(sdk_path or default_sdk, mode=ctypes.RTLD_GLOBAL)
+        self._lib = ctypes.CDLL(engine_path or default_engine)
+        self._declare()
+        self._ring = None
+        self._connected = False
+        self.missed = 0  # frames overwritten before frames() reached them
+
+    def _declare(self):
+        sdk, lib = self._sdk, self._lib
+        c_int, c_ll, c_float = ctypes.c_int, ctypes.c_longlong, ctypes.c_float
+        P = ctypes.POINTER
+        _declare(sdk, "Cortex_Initialize", c_int, *([ctypes.c_char_p] * 5))
+        _declare(sdk, "Cortex_Exit", c_int)
+        _declare(lib, "CortexEngine_Initialize", c_int)
+        _declare(lib, "CortexEngine_Exit", c_int)
+        _declare(lib, "CortexEngine_RingStart", c_int, c_int, c_int, c_int, c_int)
+        _declare(lib, "CortexEngine_RingStop", c_int)
+        _declare(lib, "CortexEngine_RingLayout", c_int,
+                 P(c_int), P(c_int), P(c_int), P(c_int),
+                 P(P(RingFrame)), P(P(c_float)), P(P(ctypes.c_short)), P(P(c_float)))
+        _declare(lib, "CortexEngine_RingAcquire", ctypes.c_void_p)
+        _declare(lib, "CortexEngine_RingRelease", c_int, ctypes.c_void_p)
+        _declare(lib, "CortexEngine_RingHead", c_ll)
+        _declare(lib, "CortexEngine_RingWait", c_ll, c_ll, c_int)
+        _declare(lib, "CortexEngine_RingValid", c_int, c_ll)
+        _declare(lib, "CortexEngine_RingSetSpin", c_int, c_int)
+        _declare(lib, "CortexEngine_RecorderStart", c_int, c_int)
+        _declare(lib, "CortexEngine_RecorderStop", c_int)
+        _declare(lib, "CortexEngine_RecorderColumns", c_int,
+                 P(P(ctypes.c_double)), P(c_int), P(c_int))
+        _declare(lib, "CortexEngine_RecorderAcquire", ctypes.c_void_p)
+        _declare(lib, "CortexEngine_RecorderRelease", c_int, ctypes.c_void_p)
+        _declare(lib, "CortexEngine_RecorderRows", c_int, P(c_int))
+        _declare(lib, "CortexEngine_RecorderColumnName", ctypes.c_char_p, c_int)
+        _declare(lib, "CortexEngine_RecorderExport", c_int, ctypes.c_char_p)
+        _declare(lib, "CortexEngine_ExportTrialLog", c_int, ctypes.c_char_p, ctypes.c_char_p)
+        _declare(lib, "CortexEngine_RelaySetState", c_int, c_float, c_float)
+        _declare(lib, "CortexEngine_TraceStart", c_int, c_int)
+        _declare(lib, "CortexEngine_TraceStop", c_int)
+        _declare(lib, "CortexEngine_TraceBegin", c_int, c_int)
+        _declare(lib, "CortexEngine_TraceEnd", c_int, c_int, c_int)
+        _declare(lib, "CortexEngine_TraceThreadName", c_int, ctypes.c_char_p)
+        _declare(lib, "CortexEngine_TraceWrite", c_int, ctypes.c_char_p, P(c_int))
+        _declare(lib, "CortexEngine_MetricsStart", c_int, c_int)
+        _declare(lib, "CortexEngine_MetricsStop", c_int)
+        _declare(lib, "CortexEngine_MetricsLoop", c_int, c_int, c_int)
+        _declare(lib, "CortexEngine_MonitorStart", c_int, P(c_int), c_int,
+                 c_int, c_int, c_int, ctypes.c_double)
+        _declare(lib, "CortexEngine_MonitorStop", c_int)
+        _declare(lib, "CortexEngine_MonitorAlerts", c_int, P(c_int), c_int)
+        _declare(lib, "CortexEngine_MonitorStats", c_int, c_int, P(ctypes.c_double), c_int)
+        _declare(lib, "CortexEngine_TreadmillOpen", c_int,
+                 ctypes.c_char_p, ctypes.c_char_p, c_int)
+        _declare(lib, "CortexEngine_TreadmillSetSpeed", c_int,
+                 ctypes.c_double, ctypes.c_double, ctypes.c_double)
+        _declare(lib, "CortexEngine_TreadmillStats", c_int, P(ctypes.c_double), c_int)
+        _declare(lib, "CortexEngine_TreadmillClose", c_int)
+
+    # -----------------------------------------------------------------
+    # connection
+
+    def connect(self, talk_to_host_nic="", host_nic="", host_multicast=None,
+                talk_to_clients_nic=None, clients_multicast=None):
+        """Cortex_Initialize, then CortexEngine_Initialize"""
+        def arg(s):
+            return None if s is None else s.encode()
+        rc = self._sdk.Cortex_Initialize(arg(talk_to_host_nic), arg(host_nic),
+                                         arg(host_multicast), arg(talk_to_clients_nic),
+                                         arg(clients_multicast))
+        if rc != RC_OKAY:
+            raise RuntimeError("Cortex_Initialize failed (%d)" % rc)
+        rc = self._lib.CortexEngine_Initialize()
+        if rc != RC_OKAY:
+            self._sdk.Cortex_Exit()
+            raise RuntimeError("CortexEngine_Initialize failed (%d)" % rc)
+        self._connected = True
+
+    def close(self):
+        """Stop the engine, then Cortex; arrays keep their last data"""
+        self._ring = None
+        if self._connected:
+            self._lib.CortexEngine_Exit()
+            self._sdk.Cortex_Exit()
+            self._connected = False
+
+    # -----------------------------------------------------------------
+    # frame ring
+
+    def start_ring(self, slots=0, max_markers=0, max_analog=0, max_forces=0):
+        """Keep the last frames; 0 selects the engine's default sizes"""
+        rc = self._lib.CortexEngine_RingStart(slots, max_markers, max_analog, max_forces)
+        if rc != RC_OKAY:
+            raise RuntimeError("CortexEngine_RingStart failed (%d)" % rc)
+        self._map_ring()
+
+    def stop_ring(self):
+        self._ring = None
+        self._lib.CortexEngine_RingStop()
+
+    def _map_ring(self):
+        handle = self._lib.CortexEngine_RingAcquire()
+        if not handle:
+            raise RuntimeError("the ring is not running")
+        hold = _Hold(self._lib.CortexEngine_RingRelease, handle)
+        n = [ctypes.c_int() for _ in range(4)]
+        headers = ctypes.POINTER(RingFrame)()
+        markers = ctypes.POINTER(ctypes.c_float)()
+        analog = ctypes.POINTER(ctypes.c_short)()
+        forces = ctypes.POINTER(ctypes.c_float)()
+        rc = self._lib.CortexEngine_RingLayout(
+            *[ctypes.byref(x) for x in n + [headers, markers, analog, forces]])
+        if rc != RC_OKAY:
+            raise RuntimeError("CortexEngine_RingLayout failed (%d)" % rc)
+        slots, max_markers, max_analog, max_forces = [x.value for x in n]
+        self._ring = {
+            "slots": slots,
+            "hold": hold,  # headers are read only through the ring
+            "headers": ctypes.cast(headers, ctypes.POINTER(RingFrame * slots)).contents,
+            "markers": _view(hold, markers, np.float32, (slots, max_markers, 3)),
+            "analog": _view(hold, analog, np.int16, (slots, max_analog)),
+            "forces": _view(hold, forces, np.float32, (slots, max_forces, 7)),
+        }
+
+    def set_spin(self, microseconds):
+        """Spin this long before sleeping in frames(); -1 spins throughout"""
+        self._lib.CortexEngine_RingSetSpin(microseconds)
+
+    def head(self):
+        """Sequence of the latest frame in the ring"""
+        return self._lib.CortexEngine_RingHead()
+
+    def frame(self, seq):
+        """Views of frame seq, which must still be in the ring"""
+        ring = self._ring
+        slot = (seq - 1) % ring["slots"]
+        h = ring["headers"][slot]
+        f = Frame()
+        f._engine = self
+        f._ring = ring
+        f.seq = seq
+        f.iframe = h.iFrame
+        f.delay = h.fDelay
+        f.time = h.fTime
+        f.truncated = bool(h.bTruncated)
+        nch, ns = h.nAnalogChannels, h.nAnalogSamples
+        f.analog = ring["analog"][slot, :nch * ns].reshape(ns, nch)
+        f.forces = ring["forces"][slot, :h.nForcePlates * h.nForceSamples].reshape(
+            h.nForceSamples, h.nForcePlates, 7)
+        f.markers = ring["markers"][slot, :h.nMarkers]
+        return f
+
+    def frames(self, timeout=1.0, since=None):
+        """Yield every frame after `since` (default: the latest) as it arrives
+
+        Blocks in the engine, without holding the interpreter lock, until
+        the next frame. Frames overwritten before the loop reached them are
+        skipped and counted in self.missed. Ends when the ring is stopped.
+        """
+        if self._ring is None:
+            raise RuntimeError("the ring is not running")
+        slots = self._ring["slots"]
+        seq = self.head() if since is None else since
+        ms = int(timeout * 1000)
+        while True:
+            head = self._lib.CortexEngine_RingWait(seq, ms)
+            if head < 0:
+                return
+            first = max(seq + 1, head - slots + 1)
+            self.missed += first - (seq + 1)
+            for s in range(first, head + 1):
+                yield self.frame(s)
+            seq = max(seq, head)
+
+    # -----------------------------------------------------------------
+    # trial recorder
+
+    def start_recorder(self, rows):
+        rc = self._lib.CortexEngine_RecorderStart(rows)
+        if rc != RC_OKAY:
+            raise RuntimeError("CortexEngine_RecorderStart failed (%d)" % rc)
+
+    def stop_recorder(self):
+        self._lib.CortexEngine_RecorderStop()
+
+    def set_state(self, speed, fp):
+        """Belt speed (m/s) and mean peak Fp (N) recorded with the next frames"""
+        self._lib.CortexEngine_RelaySetState(speed, fp)
+
+    def recorded(self):
+        """{column name: view of the rows recorded so far}"""
+        handle = self._lib.CortexEngine_RecorderAcquire()
+        if not handle:
+            raise RuntimeError("the recorder is not running")
+        hold = _Hold(self._lib.CortexEngine_RecorderRelease, handle)
+        data = ctypes.POINTER(ctypes.c_double)()
+        capacity, ncols = ctypes.c_int(), ctypes.c_int()
+        rc = self._lib.CortexEngine_RecorderColumns(
+            ctypes.byref(data), ctypes.byref(capacity), ctypes.byref(ncols))
+        if rc != RC_OKAY:
+            raise RuntimeError("the recorder is not running")
+        rows = self._lib.CortexEngine_RecorderRows(None)
+        table = _view(hold, data, np.float64, (ncols.value, capacity.value))
+        return dict((self._lib.CortexEngine_RecorderColumnName(c).decode(), table[c, :rows])
+                    for c in range(ncols.value))
+
+    def recorder_dropped(self):
+        """Frames not recorded because the columns were full"""
+        dropped = ctypes.c_int()
+        self._lib.CortexEngine_RecorderRows(ctypes.byref(dropped))
+        return dropped.value
+
+    def export_recorded(self, path):
+        """Write the rows recorded so far to a .mat, .npz or .npy file;
+        returns the rows written"""
+        n = self._lib.CortexEngine_RecorderExport(path.encode())
+        if n < 0:
+            raise IOError("could not write %s" % path)
+        return n
+
+    def export_trial_log(self, log, path):
+        """Convert a trial log written by TrialLog.m to a .mat, .npz or .npy
+        file; needs neither MATLAB nor a Cortex connection"""
+        n = self._lib.CortexEngine_ExportTrialLog(log.encode(), path.encode())
+        if n < 0:
+            raise IOError("could not convert %s to %s" % (log, path))
+        return n
+
+    # -----------------------------------------------------------------
+    # pipeline tracing
+
+    def start_trace(self, events=0, thread_name="Python"):
+        """Time the engine's stages, and spans marked with span(), per thread"""
+        rc = self._lib.CortexEngine_TraceStart(events)
+        if rc != RC_OKAY:
+            raise RuntimeError("CortexEngine_TraceStart failed (%d)" % rc)
+        self._lib.CortexEngine_TraceThreadName(thread_name.encode())
+
+    def stop_trace(self):
+        self._lib.CortexEngine_TraceStop()
+
+    @contextlib.contextmanager
+    def span(self, stage, frame=0):
+        """with engine.span(cortexengine.TRACE_CONTROL, f.iframe): ..."""
+        self._lib.CortexEngine_TraceBegin(stage)
+        try:
+            yield
+        finally:
+            self._lib.CortexEngine_TraceEnd(stage, frame)
+
+    def write_trace(self, path):
+        """Chrome trace JSON of the spans; returns (spans, dropped)"""
+        dropped = ctypes.c_int()
+        n = self._lib.CortexEngine_TraceWrite(path.encode(), ctypes.byref(dropped))
+        if n < 0:
+            raise IOError("could not write %s" % path)
+        return n, dropped.value
+
+    # -----------------------------------------------------------------
+    # live metrics
+
+    def start_metrics(self, port=9464):
+        """Serve loop health at http://<host>:port/metrics for Prometheus"""
+        rc = self._lib.CortexEngine_MetricsStart(port)
+        if rc != RC_OKAY:
+            raise RuntimeError("CortexEngine_MetricsStart failed on port %d" % port)
+
+    def stop_metrics(self):
+        self._lib.CortexEngine_MetricsStop()
+
+    def loop_done(self, frame, command=False):
+        """Count a control loop pass over Cortex frame `frame`, timing it
+        from the frame's arrival; command: a new speed was sent"""
+        self._lib.CortexEngine_MetricsLoop(frame, 1 if command else 0)
+
+    # -----------------------------------------------------------------
+    # analog signal quality
+
+    def start_monitor(self, channels=None, rail_margin=0, stuck_samples=0,
+                      spike_bits=0, noise_bits=0.0):
+        """Check every analog sample for rail hits, flat runs, spikes and
+        noise; alerts for `channels` (0 based, default the plates'), 0
+        limits take the engine's defaults"""
+        if channels is None:
+            ids, n = None, 0
+        else:
+            n = len(channels)
+            ids = (ctypes.c_int * max(n, 1))(*channels)
+        rc = self._lib.CortexEngine_MonitorStart(ids, n, rail_margin, stuck_samples,
+                                                 spike_bits, noise_bits)
+        if rc != RC_OKAY:
+            raise RuntimeError("CortexEngine_MonitorStart failed (%d)" % rc)
+
+    def stop_monitor(self):
+        self._lib.CortexEngine_MonitorStop()
+
+    def signal_alerts(self, max_channels=64):
+        """{channel: SIGNAL_* bits} raised since the last call"""
+        alerts = (ctypes.c_int * max_channels)()
+        n = self._lib.CortexEngine_MonitorAlerts(alerts, max_channels)
+        if n < 0:
+            return {}
+        return {c: alerts[c] for c in range(max_channels) if alerts[c]}
+
+    def signal_stats(self, trial=False, max_channels=64):
+        """Per channel counts of the last second, or of the trial: a dict
+        of arrays named as SIGNAL_STATS"""
+        stats = np.zeros((len(SIGNAL_STATS), max_channels))
+        n = self._lib.CortexEngine_MonitorStats(
+            1 if trial else 0, stats.ctypes.data_as(ctypes.POINTER(ctypes.c_double)),
+            max_channels)
+        if n < 0:
+            return {}
+        n = min(n, max_channels)
+        return {name: stats[i, :n].copy() for i, name in enumerate(SIGNAL_STATS)}
+
+    # -----------------------------------------------------------------
+    # treadmill link
+
+    def open_treadmill(self, address, port="4000", core=-1):
+        """Send belt commands from the engine, as TREADMILL_initializeUDP;
+        core >= 0 pins the calling thread to that core until
+        close_treadmill. The packet layout is unverified: run
+        TreadmillPacketCheck first (see the ReadMe)"""
+        rc = self._lib.CortexEngine_TreadmillOpen(address.encode(), str(port).encode(), core)
+        if rc != TREADMILL_OK:
+            raise IOError("CortexEngine_TreadmillOpen failed (%d)" % rc)
+
+    def close_treadmill(self):
+        self._lib.CortexEngine_TreadmillClose()
+
+    def set_speed(self, left, right, accel):
+        """TREADMILL_setSpeed without blocking: TREADMILL_OK,
+        TREADMILL_SEND or TREADMILL_NOT_CONNECTED, or TREADMILL_STOPPED
+        for a non-zero speed once the watchdog has tripped"""
+        return self._lib.CortexEngine_TreadmillSetSpeed(left, right, accel)
+
+    def treadmill_stats(self):
+        """Counts and send times of the link, named as TREADMILL_STATS"""
+        stats = (ctypes.c_double * len(TREADMILL_STATS))()
+        if self._lib.CortexEngine_TreadmillStats(stats, len(stats)) != RC_OKAY:
+            return {}
+        return dict(zip(TREADMILL_STATS, stats))
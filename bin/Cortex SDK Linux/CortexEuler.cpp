@@ -0,0 +1,202 @@
+/*=========================================================
+//
+// File: CortexEuler.cpp
+//
+// Cortex_ConstructRotationMatrix and Cortex_ExtractEulerAngles.
+//
+//----------------------------------------------------------
+// For the orders ZYX .. XZY the angles are indexed by axis, as aX, aY, aZ
+// in tSegmentData, and the matrix of order "ABC" is
+//
+//   R = R_A(angle about A) * R_B(angle about B) * R_C(angle about C)
+//
+// (column vectors, matrix[row][column]), so ZYX is Rz * Ry * Rx. For the
+// orders XYX .. ZYZ the angles are the first, second and third rotation:
+// XYX is Rx(angles[0]) * Ry(angles[1]) * Rx(angles[2]).
+//
+// Extraction returns the middle angle in [-90, 90] (ZYX .. XZY) or
+// [0, 180] (XYX .. ZYZ) degrees, and XEMPTY angles for a matrix[0][0] of
+// XEMPTY. Gimbal lock is |cos| (|sin| for XYX .. ZYZ) of the middle angle
+// <= 1e-4; the first angle is then 0, or the third for XYZ and XYX .. ZYZ,
+// and the other comes from the matrix elements the DLL uses for that order.
+//
+// ZYX .. XZY behave as Cortex_SDK.dll, checked against it (see the
+// CortexEngine ReadMe), but for XZY at gimbal lock with aZ near -90, where
+// the DLL's aY is 180 degrees minus the right one. The DLL does not
+// implement XYX .. ZYZ: it builds the identity, extracts only YXY, as
+// (a, b, a + c), and leaves the other angles unwritten; those orders here
+// are the plain Euler rotations.
+=============================================================================*/
+
+#include "MatlabCortex.h"
+
+#include <cmath>
+
+namespace
+{
+
+const double DEG = 3.14159265358979323846 / 180.0;
+const double GIMBAL = 1e-4;
+
+enum { E_JI, E_JJ, E_KI, E_KJ };  // matrix elements: E_JI is row J, column I
+enum { NONE, NEGATE, NEGATE_X };
+
+struct Order
+{
+    int I, J, K;      // first, second and remaining axis
+    bool bProper;     // first axis repeated as the third rotation
+    // gimbal lock as in the DLL: the first angle is 0 if bLockFirst, else
+    // the third; the other is atan2(Sign * Y, X), Flip negating it or X
+    // when the second angle is <= 0
+    bool bLockFirst;
+    int Y, X;
+    double Sign;
+    int Flip;
+};
+
+bool Lookup(int iRotationOrder, Order& O)
+{
+    static const Order Orders[12] = {
+        { 2, 1, 0, false, true,  E_KJ, E_JJ, 1, NEGATE },   // ZYX
+        { 0, 1, 2, false, false, E_JI, E_JJ, 1, NEGATE },   // XYZ
+        { 1, 0, 2, false, true,  E_JI, E_JJ, -1, NONE },    // YXZ
+        { 1, 2, 0, false, true,  E_JI, E_JJ, 1, NONE },     // YZX
+        { 2, 0, 1, false, true,  E_JI, E_JJ, 1, NONE },     // ZXY
+        { 0, 2, 1, false, true,  E_JI, E_KI, -1, NEGATE_X }, // XZY
+        { 0, 1, 2, true,  false, E_KJ, E_JJ, 1, NONE },     // XYX
+        { 0, 2, 1, true,  false, E_KJ, E_JJ, -1, NONE },    // XZX
+        { 1, 2, 0, true,  false, E_KJ, E_JJ, 1, NONE },     // YZY
+        { 1, 0, 2, true,  false, E_KJ, E_JJ, -1, NONE },    // YXY
+        { 2, 0, 1, true,  false, E_KJ, E_JJ, 1, NONE },     // ZXZ
+        { 2, 1, 0, true,  false, E_KJ, E_JJ, -1, NONE },    // ZYZ
+    };
+    if (iRotationOrder < ZYX_ORDER || iRotationOrder > ZYZ_ORDER)
+        return false;
+    O = Orders[iRotationOrder - 1];
+    return true;
+}
+
+void Rotation(int iAxis, double Angle, double R[3][3])
+{
+    double s = std::sin(Angle * DEG), c = std::cos(Angle * DEG);
+    int a = (iAxis + 1) % 3, b = (iAxis + 2) % 3;
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            R[i][j] = i == j ? 1.0 : 0.0;
+    R[a][a] = c;  R[a][b] = -s;
+    R[b][a] = s;  R[b][b] = c;
+}
+
+void Multiply(const double A[3][3], const double B[3][3], double C[3][3])
+{
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            C[i][j] = A[i][0] * B[0][j] + A[i][1] * B[1][j] + A[i][2] * B[2][j];
+}
+
+double Element(const Order& O, int iElement, double matrix[3][3])
+{
+    int Row = iElement == E_JI || iElement == E_JJ ? O.J : O.K;
+    int Column = iElement == E_JJ || iElement == E_KJ ? O.J : O.I;
+    return matrix[Row][Column];
+}
+
+/** The angle that is not 0 at gimbal lock, b the second angle */
+double Locked(const Order& O, double matrix[3][3], double b)
+{
+    double y = O.Sign * Element(O, O.Y, matrix);
+    double x = Element(O, O.X, matrix);
+    if (O.Flip == NEGATE_X && b <= 0.0)
+        x = -x;
+    double g = std::atan2(y, x);
+    return O.Flip == NEGATE && b <= 0.0 ? -g : g;
+}
+
+} // namespace
+
+void Cortex_ConstructRotationMatrix(double angles[3], int iRotationOrder, double matrix[3][3])
+{
+    Order O;
+    if (!Lookup(iRotationOrder, O))
+    {
+        Rotation(0, 0.0, matrix);
+        return;
+    }
+    double A[3][3], B[3][3], C[3][3], AB[3][3];
+    if (O.bProper)
+    {
+        Rotation(O.I, angles[0], A);
+        Rotation(O.J, angles[1], B);
+        Rotation(O.I, angles[2], C);
+    }
+    else
+    {
+        Rotation(O.I, angles[O.I], A);
+        Rotation(O.J, angles[O.J], B);
+        Rotation(O.K, angles[O.K], C);
+    }
+    Multiply(A, B, AB);
+    Multiply(AB, C, matrix);
+}
+
+void Cortex_ExtractEulerAngles(double matrix[3][3], int iRotationOrder, double angles[3])
+{
+    Order O;
+    angles[0] = angles[1] = angles[2] = 0.0;
+    if (!Lookup(iRotationOrder, O))
+        return;
+    if (matrix[0][0] == XEMPTY)
+    {
+        angles[0] = angles[1] = angles[2] = XEMPTY;
+        return;
+    }
+
+    // +1 when I, J, K is a cyclic order of X, Y, Z
+    double e = (O.J == (O.I + 1) % 3) ? 1.0 : -1.0;
+    int I = O.I, J = O.J, K = O.K;
+    double a, b, c;
+    if (O.bProper)
+    {
+        double sb = std::sqrt(matrix[I][J] * matrix[I][J] + matrix[I][K] * matrix[I][K]);
+        b = std::atan2(sb, matrix[I][I]);
+        if (sb > GIMBAL)
+        {
+            a = std::atan2(matrix[J][I], -e * matrix[K][I]);
+            c = std::atan2(matrix[I][J], e * matrix[I][K]);
+        }
+        else
+        {
+            a = Locked(O, matrix, b);
+            c = 0.0;
+        }
+    }
+    else
+    {
+        double cb = std::sqrt(matrix[I][I] * matrix[I][I] + matrix[I][J] * matrix[I][J]);
+        b = std::atan2(e * matrix[I][K], cb);
+        if (cb > GIMBAL)
+        {
+            a = std::atan2(-e * matrix[J][K], matrix[K][K]);
+            c = std::atan2(-e * matrix[I][J], matrix[I][I]);
+        }
+        else
+        {
+            double g = Locked(O, matrix, b);
+            a = O.bLockFirst ? 0.0 : g;
+            c = O.bLockFirst ? g : 0.0;
+        }
+    }
+
+    if (O.bProper)
+    {
+        angles[0] = a / DEG;
+        angles[1] = b / DEG;
+        angles[2] = c / DEG;
+    }
+    else
+    {
+        angles[I] = a / DEG;
+        angles[J] = b / DEG;
+        angles[K] = c / DEG;
+    }
+}
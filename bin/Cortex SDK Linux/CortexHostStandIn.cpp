@@ -0,0 +1,296 @@
+/*=========================================================
+//
+// File: CortexHostStandIn.cpp
+//
+// Stand-in for Cortex on the loopback interface, for testing the Linux
+// client without the motion capture system.
+//
+// Multicasts synthetic frames to 225.1.1.1:1001 at a fixed rate: one body
+// (LASI, RASI, LPSI, RPSI walking forward and back), 12 analog channels of
+// 10 samples per frame and 2 force plates. Answers GetHostInfo,
+// GetBodyDefs and the GetContext* requests on port 1510 and echoes Sky
+// commands back as their string result.
+//
+// Usage: CortexHostStandIn [FrameRate (100)] [Seconds (run until killed)]
+//
+=============================================================================*/
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "CortexWire.h"
+
+using namespace CortexWire;
+
+namespace
+{
+
+const int N_MARKERS = 4;
+const int N_CHANNELS = 12;
+const int N_SAMPLES = 10;
+const int N_PLATES = 2;
+
+const char* MarkerNames[N_MARKERS] = { "LASI", "RASI", "LPSI", "RPSI" };
+
+double Now()
+{
+    timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + 1e-9 * (double)t.tv_nsec;
+}
+
+sBodyDefs MakeBodyDefs(std::vector<std::string>& Names, std::vector<char*>& pNames)
+{
+    Names.clear();
+    for (int m = 0; m < N_MARKERS; m++)
+        Names.push_back(MarkerNames[m]);
+    for (int c = 0; c < N_CHANNELS; c++)
+    {
+        char sz[16];
+        snprintf(sz, sizeof(sz), "Ch%d", c + 1);
+        Names.push_back(sz);
+    }
+    Names.push_back("Subject");
+    pNames.clear();
+    for (size_t i = 0; i < Names.size(); i++)
+        pNames.push_back(&Names[i][0]);
+
+    sBodyDefs Defs;
+    std::memset(&Defs, 0, sizeof(Defs));
+    Defs.nBodyDefs = 1;
+    Defs.BodyDefs[0].szName = pNames.back();
+    Defs.BodyDefs[0].nMarkers = N_MARKERS;
+    Defs.BodyDefs[0].szMarkerNames = &pNames[0];
+    Defs.nAnalogChannels = N_CHANNELS;
+    Defs.szAnalogChannelNames = &pNames[N_MARKERS];
+    Defs.nForcePlates = N_PLATES;
+    Defs.AnalogBitDepth = 16;
+    return Defs;
+}
+
+/** Pelvis markers and plate forces of a walker at 1 Hz strides */
+void FillFrame(sFrameOfData& f, int iFrame, double FrameRate,
+               std::vector<float>& Markers, std::vector<short>& Analog,
+               std::vector<float>& Forces)
+{
+    double t = iFrame / FrameRate;
+    double y = 200.0 * std::sin(2.0 * M_PI * 0.1 * t); // drifting fore/aft
+    const double Offsets[N_MARKERS][2] = { { -120, 60 }, { 120, 60 }, { -80, -100 }, { 80, -100 } };
+    for (int m = 0; m < N_MARKERS; m++)
+    {
+        Markers[3 * m + 0] = (float)Offsets[m][0];
+        Markers[3 * m + 1] = (float)(y + Offsets[m][1]);
+        Markers[3 * m + 2] = 1000.0f;
+    }
+
+    for (int s = 0; s < N_SAMPLES; s++)
+    {
+        double ts = t + s / (N_SAMPLES * FrameRate);
+        double Phase = std::fmod(ts, 1.0);
+        double Right = Phase < 0.6 ? std::sin(M_PI * Phase / 0.6) : 0.0;
+        double Left = Phase > 0.5 || Phase < 0.1
+            ? std::sin(M_PI * std::fmod(Phase + 0.5, 1.0) / 0.6) : 0.0;
+        for (int c = 0; c < N_CHANNELS; c++)
+        {
+            // plate vertical forces on the channels FrameConverter reads,
+            // about 750 N at the peak
+            double v = c == 4 ? Right : c == 11 ? Left : 0.0;
+            Analog[s * N_CHANNELS + c] = (short)(5000.0 * std::fmax(v, 0.0));
+        }
+        float* F0 = &Forces[(s * N_PLATES + 0) * 7];
+        float* F1 = &Forces[(s * N_PLATES + 1) * 7];
+        std::memset(F0, 0, 7 * sizeof(float));
+        std::memset(F1, 0, 7 * sizeof(float));
+        F0[5] = (float)(700.0 * std::fmax(Right, 0.0));
+        F1[5] = (float)(700.0 * std::fmax(Left, 0.0));
+    }
+
+    f.iFrame = iFrame;
+    f.fDelay = 0.003f;
+    f.nBodies = 1;
+    sBodyData& B = f.BodyData[0];
+    snprintf(B.szName, sizeof(B.szName), "Subject");
+    B.nMarkers = N_MARKERS;
+    B.Markers = (tMarkerData*)&Markers[0];
+    f.AnalogData.nAnalogChannels = N_CHANNELS;
+    f.AnalogData.nAnalogSamples = N_SAMPLES;
+    f.AnalogData.AnalogSamples = &Analog[0];
+    f.AnalogData.nForcePlates = N_PLATES;
+    f.AnalogData.nForceSamples = N_SAMPLES;
+    f.AnalogData.Forces = (tForceData*)&Forces[0];
+}
+
+void Reply(int Sock, const sockaddr_in& To, uint32_t Id, int32_t Rc,
+           const void* p, uint32_t n, std::vector<char>& Buf)
+{
+    Writer W(Buf);
+    W.Head(PKT_REPLY, Id);
+    W.Put(Rc);
+    W.Put(n);
+    W.Put(p, n);
+    sendto(Sock, &Buf[0], Buf.size(), 0, (const sockaddr*)&To, sizeof(To));
+}
+
+void Serve(int Sock, double FrameRate, const sBodyDefs& Defs, std::vector<char>& Buf)
+{
+    char In[MAX_PACKET];
+    sockaddr_in From;
+    socklen_t nFrom = sizeof(From);
+    ssize_t n = recvfrom(Sock, In, sizeof(In), 0, (sockaddr*)&From, &nFrom);
+    if (n <= 0)
+        return;
+    Reader R(In, (size_t)n);
+    Header H;
+    std::string szCommand;
+    if (!R.Head(H))
+        return;
+
+    if (H.Type == PKT_SKY)
+    {
+        int32_t msTimeout = 0;
+        R.Get(msTimeout);
+        R.Str(szCommand);
+        Writer W(Buf);
+        W.Head(PKT_SKY_REPLY, H.Id);
+        W.Put((int32_t)RC_Okay);
+        W.Put((int32_t)SKY_STRING);
+        char Data[sizeof(((sSkyReturn*)0)->ReturnData)];
+        std::memset(Data, 0, sizeof(Data));
+        snprintf(Data, sizeof(Data), "%s", szCommand.c_str());
+        W.Put(Data, sizeof(Data));
+        sendto(Sock, &Buf[0], Buf.size(), 0, (sockaddr*)&From, sizeof(From));
+        return;
+    }
+    if (H.Type != PKT_REQUEST || !R.Str(szCommand))
+        return;
+
+    if (szCommand == "GetBodyDefs")
+    {
+        EncodeBodyDefs(Defs, H.Id, Buf);
+        sendto(Sock, &Buf[0], Buf.size(), 0, (sockaddr*)&From, sizeof(From));
+    }
+    else if (szCommand == "GetHostInfo")
+    {
+        sHostInfo Info;
+        std::memset(&Info, 0, sizeof(Info));
+        Info.bFoundHost = 1;
+        snprintf(Info.szHostMachineName, sizeof(Info.szHostMachineName), "localhost");
+        snprintf(Info.szHostProgramName, sizeof(Info.szHostProgramName), "CortexHostStandIn");
+        Info.HostProgramVersion[1] = 2;
+        Reply(Sock, From, H.Id, RC_Okay, &Info, sizeof(Info), Buf);
+    }
+    else if (szCommand == "GetContextFrameRate")
+    {
+        float f = (float)FrameRate;
+        Reply(Sock, From, H.Id, RC_Okay, &f, sizeof(f), Buf);
+    }
+    else if (szCommand == "GetContextAnalogSampleRate")
+    {
+        float f = (float)(FrameRate * N_SAMPLES);
+        Reply(Sock, From, H.Id, RC_Okay, &f, sizeof(f), Buf);
+    }
+    else if (szCommand == "GetContextAnalogBitDepth")
+    {
+        int i = 16;
+        Reply(Sock, From, H.Id, RC_Okay, &i, sizeof(i), Buf);
+    }
+    else if (szCommand == "GetUpAxis")
+    {
+        int i = 2;
+        Reply(Sock, From, H.Id, RC_Okay, &i, sizeof(i), Buf);
+    }
+    else if (szCommand == "GetConversionToMillimeters")
+    {
+        float f = 1.0f;
+        Reply(Sock, From, H.Id, RC_Okay, &f, sizeof(f), Buf);
+    }
+    else
+        Reply(Sock, From, H.Id, RC_Unrecognized, NULL, 0, Buf);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    double FrameRate = argc > 1 ? std::atof(argv[1]) : 100.0;
+    double Seconds = argc > 2 ? std::atof(argv[2]) : 0.0;
+    if (FrameRate <= 0)
+    {
+        fprintf(stderr, "usage: %s [FrameRate] [Seconds]\n", argv[0]);
+        return 1;
+    }
+
+    int ReqSock = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in Sa;
+    std::memset(&Sa, 0, sizeof(Sa));
+    Sa.sin_family = AF_INET;
+    Sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    Sa.sin_port = htons(1510);
+    if (bind(ReqSock, (sockaddr*)&Sa, sizeof(Sa)) < 0)
+    {
+        perror("bind 1510");
+        return 1;
+    }
+
+    int DataSock = socket(AF_INET, SOCK_DGRAM, 0);
+    in_addr Loopback;
+    Loopback.s_addr = htonl(INADDR_LOOPBACK);
+    setsockopt(DataSock, IPPROTO_IP, IP_MULTICAST_IF, &Loopback, sizeof(Loopback));
+    unsigned char Loop = 1;
+    setsockopt(DataSock, IPPROTO_IP, IP_MULTICAST_LOOP, &Loop, sizeof(Loop));
+    sockaddr_in Group = Sa;
+    Group.sin_addr.s_addr = inet_addr("225.1.1.1");
+    Group.sin_port = htons(1001);
+
+    std::vector<std::string> Names;
+    std::vector<char*> pNames;
+    sBodyDefs Defs = MakeBodyDefs(Names, pNames);
+
+    sFrameOfData Frame;
+    std::memset(&Frame, 0, sizeof(Frame));
+    std::vector<float> Markers(3 * N_MARKERS);
+    std::vector<short> Analog(N_CHANNELS * N_SAMPLES);
+    std::vector<float> Forces(7 * N_PLATES * N_SAMPLES);
+    std::vector<char> FrameBuf, ReplyBuf;
+
+    printf("CortexHostStandIn: %g Hz to 225.1.1.1:1001, requests on 127.0.0.1:1510\n", FrameRate);
+    fflush(stdout);
+
+    double Start = Now();
+    double Period = 1.0 / FrameRate;
+    for (int iFrame = 1; Seconds <= 0 || iFrame <= Seconds * FrameRate; iFrame++)
+    {
+        // answer requests until the frame is due
+        double Due = Start + iFrame * Period;
+        for (;;)
+        {
+            int msLeft = (int)std::ceil(1e3 * (Due - Now()));
+            if (msLeft <= 0)
+                break;
+            pollfd Pfd = { ReqSock, POLLIN, 0 };
+            if (poll(&Pfd, 1, msLeft) > 0)
+                Serve(ReqSock, FrameRate, Defs, ReplyBuf);
+        }
+        while (Now() < Due)
+            ;
+
+        FillFrame(Frame, iFrame, FrameRate, Markers, Analog, Forces);
+        EncodeFrame(Frame, (uint32_t)iFrame, FrameBuf);
+        sendto(DataSock, &FrameBuf[0], FrameBuf.size(), 0, (sockaddr*)&Group, sizeof(Group));
+    }
+
+    close(ReqSock);
+    close(DataSock);
+    return 0;
+}
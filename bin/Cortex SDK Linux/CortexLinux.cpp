@@ -0,0 +1,954 @@
+/*=========================================================
+//
+// File: CortexLinux.cpp
+//
+// Linux implementation of the SDK2 client API in MatlabCortex.h.
+//
+// Frames arrive on the host multicast group and are read in batches
+// with recvmmsg, each with its kernel receive time (SO_TIMESTAMPNS),
+// and decoded into preallocated frame buffers. Requests, body
+// definitions and Sky commands go to the host as unicast datagrams.
+// The packet layout is in CortexWire.h.
+//
+=============================================================================*/
+
+#include "CortexLinux.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CortexWire.h"
+
+using namespace CortexWire;
+
+namespace
+{
+
+const int RX_BATCH = 16;        // datagrams per recvmmsg call
+const int RX_POLL_MS = 100;     // receive thread checks for Exit this often
+const int RX_SOCKET_BUFFER = 4 << 20;
+
+//==================================================================
+// settings that may be changed before Cortex_Initialize
+
+struct Settings
+{
+    Settings()
+        : TalkToHostPort(0), HostPort(1510), HostMulticastPort(1001),
+          TalkToClientsRequestPort(0), TalkToClientsMulticastPort(0),
+          ClientsMulticastPort(1001), bClients(0), Verbosity(VL_Warning),
+          MinTimeout(500) {}
+
+    int TalkToHostPort;
+    int HostPort;
+    int HostMulticastPort;
+    int TalkToClientsRequestPort;
+    int TalkToClientsMulticastPort;
+    int ClientsMulticastPort;
+    int bClients;
+    int Verbosity;
+    int MinTimeout;
+};
+
+Settings g_Settings;
+std::atomic<void (*)(int, char*)> g_ErrorHandler(NULL);
+std::atomic<void (*)(sFrameOfData*)> g_DataHandler(NULL);
+std::atomic<void (*)(sFrameOfData*, double)> g_TimedDataHandler(NULL);
+
+void Log(int iLevel, const char* szFormat, ...)
+{
+    if (iLevel > g_Settings.Verbosity)
+        return;
+    char szMessage[512];
+    va_list Args;
+    va_start(Args, szFormat);
+    vsnprintf(szMessage, sizeof(szMessage), szFormat, Args);
+    va_end(Args);
+    void (*Handler)(int, char*) = g_ErrorHandler.load();
+    if (Handler)
+        Handler(iLevel, szMessage);
+    else
+        fprintf(stderr, "Cortex: %s\n", szMessage);
+}
+
+double Seconds(const timespec& t)
+{
+    return (double)t.tv_sec + 1e-9 * (double)t.tv_nsec;
+}
+
+double Now()
+{
+    timespec t;
+    clock_gettime(CLOCK_REALTIME, &t);
+    return Seconds(t);
+}
+
+/** "a.b.c.d" or host name; "" or NULL give Default */
+bool Resolve(const std::string& szAddress, in_addr_t Default, in_addr* pAddr)
+{
+    if (szAddress.empty() || szAddress == "0")
+    {
+        pAddr->s_addr = Default;
+        return true;
+    }
+    if (inet_pton(AF_INET, szAddress.c_str(), pAddr) == 1)
+        return true;
+    addrinfo Hints;
+    std::memset(&Hints, 0, sizeof(Hints));
+    Hints.ai_family = AF_INET;
+    addrinfo* pInfo = NULL;
+    if (getaddrinfo(szAddress.c_str(), NULL, &Hints, &pInfo) != 0 || !pInfo)
+        return false;
+    *pAddr = ((sockaddr_in*)pInfo->ai_addr)->sin_addr;
+    freeaddrinfo(pInfo);
+    return true;
+}
+
+sockaddr_in SocketAddress(in_addr Addr, int iPort)
+{
+    sockaddr_in Sa;
+    std::memset(&Sa, 0, sizeof(Sa));
+    Sa.sin_family = AF_INET;
+    Sa.sin_addr = Addr;
+    Sa.sin_port = htons((uint16_t)iPort);
+    return Sa;
+}
+
+/** The local address the kernel would use to reach Host */
+in_addr RouteTo(in_addr Host)
+{
+    in_addr Local;
+    Local.s_addr = htonl(INADDR_ANY);
+    int Sock = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in Sa = SocketAddress(Host, 9);
+    socklen_t n = sizeof(Sa);
+    if (Sock >= 0 && connect(Sock, (sockaddr*)&Sa, sizeof(Sa)) == 0
+        && getsockname(Sock, (sockaddr*)&Sa, &n) == 0)
+        Local = Sa.sin_addr;
+    if (Sock >= 0)
+        close(Sock);
+    return Local;
+}
+
+//==================================================================
+// the connection, created by Cortex_Initialize
+
+struct Client
+{
+    Client()
+        : ReqSock(-1), DataSock(-1), ClientSock(-1), bRun(false), NextId(1),
+          pRx(new FrameBuffer()), pLatest(new FrameBuffer()),
+          bHaveLatest(false), PolledRxTime(0.0)
+    {
+        std::memset(&HostAddr, 0, sizeof(HostAddr));
+        std::memset(&ClientsAddr, 0, sizeof(ClientsAddr));
+        std::memset(&Sky, 0, sizeof(Sky));
+        std::memset(&Polled, 0, sizeof(Polled));
+        std::memset(&Stats, 0, sizeof(Stats));
+        std::memset(&HostInfo, 0, sizeof(HostInfo));
+    }
+
+    std::string szTalkToHostNic, szHostNic, szHostMulticast;
+    std::string szTalkToClientsNic, szClientsMulticast;
+
+    int ReqSock;      // requests to the host and their replies
+    int DataSock;     // frames multicast by the host
+    int ClientSock;   // frames multicast to our SDK2 clients
+    sockaddr_in HostAddr;
+    sockaddr_in ClientsAddr;
+
+    std::thread Rx;
+    std::atomic<bool> bRun;
+
+    std::mutex ReqMutex;
+    uint32_t NextId;
+    std::vector<char> ReqBuf;
+    std::vector<char> ReplyBuf;
+    std::vector<char> Response; // "hot" response of Cortex_Request
+    sSkyReturn Sky;
+
+    std::mutex FrameMutex;
+    std::unique_ptr<FrameBuffer> pRx;     // being decoded
+    std::unique_ptr<FrameBuffer> pLatest; // last complete frame, handed to the handler
+    bool bHaveLatest;
+    sFrameOfData Polled;                  // returned by Cortex_GetCurrentFrame
+    double PolledRxTime;
+    sReceiveStats Stats;
+
+    std::mutex SendMutex;
+    std::vector<char> SendBuf;
+
+    sHostInfo HostInfo;
+};
+
+Client* g_pClient = NULL;
+std::mutex g_ApiMutex; // Initialize / Exit
+
+//==================================================================
+// requests
+
+/** Send the request in ReqBuf and wait for the reply with the same Id
+ *
+ *  The reply is left in ReplyBuf; R is set to read it past its header.
+ */
+bool Exchange(Client& C, uint32_t Id, int msTimeout, Header& H, Reader& R)
+{
+    if (sendto(C.ReqSock, &C.ReqBuf[0], C.ReqBuf.size(), 0,
+               (sockaddr*)&C.HostAddr, sizeof(C.HostAddr)) < 0)
+    {
+        Log(VL_Error, "request send failed: %s", strerror(errno));
+        return false;
+    }
+
+    double Deadline = Now() + 1e-3 * msTimeout;
+    C.ReplyBuf.resize(MAX_PACKET);
+    for (;;)
+    {
+        int msLeft = (int)(1e3 * (Deadline - Now()));
+        if (msLeft <= 0)
+            return false;
+        pollfd Pfd = { C.ReqSock, POLLIN, 0 };
+        if (poll(&Pfd, 1, msLeft) <= 0)
+            continue;
+        ssize_t n = recv(C.ReqSock, &C.ReplyBuf[0], C.ReplyBuf.size(), 0);
+        if (n <= 0)
+            continue;
+        R = Reader(&C.ReplyBuf[0], (size_t)n);
+        if (R.Head(H) && H.Id == Id)
+            return true;
+        // a late reply to an earlier request, drop it
+    }
+}
+
+int Request(Client& C, const char* szCommand, int msTimeout, PacketType ReplyType,
+            Header& H, Reader& R)
+{
+    uint32_t Id = C.NextId++;
+    Writer W(C.ReqBuf);
+    W.Head(PKT_REQUEST, Id);
+    W.Str(szCommand);
+    if (!Exchange(C, Id, msTimeout, H, R))
+        return RC_TimeOut;
+    if (H.Type != ReplyType)
+        return RC_GeneralError;
+    return RC_Okay;
+}
+
+//==================================================================
+// receive thread
+
+void Receive(Client& C)
+{
+    std::vector<char> Data((size_t)RX_BATCH * MAX_PACKET);
+    mmsghdr Msgs[RX_BATCH];
+    iovec Iov[RX_BATCH];
+    char Control[RX_BATCH][CMSG_SPACE(sizeof(timespec)) + CMSG_SPACE(sizeof(uint32_t))];
+
+    while (C.bRun.load())
+    {
+        for (int i = 0; i < RX_BATCH; i++)
+        {
+            Iov[i].iov_base = &Data[(size_t)i * MAX_PACKET];
+            Iov[i].iov_len = MAX_PACKET;
+            std::memset(&Msgs[i], 0, sizeof(Msgs[i]));
+            Msgs[i].msg_hdr.msg_iov = &Iov[i];
+            Msgs[i].msg_hdr.msg_iovlen = 1;
+            Msgs[i].msg_hdr.msg_control = Control[i];
+            Msgs[i].msg_hdr.msg_controllen = sizeof(Control[i]);
+        }
+
+        // blocks for the first datagram (up to SO_RCVTIMEO), then takes
+        // whatever else is already queued
+        int n = recvmmsg(C.DataSock, Msgs, RX_BATCH, MSG_WAITFORONE, NULL);
+        if (n <= 0)
+            continue;
+
+        C.Stats.nBatches++;
+        if (n > C.Stats.nMaxBatch)
+            C.Stats.nMaxBatch = n;
+
+        for (int i = 0; i < n; i++)
+        {
+            C.Stats.nPackets++;
+            double RxTime = 0.0;
+            msghdr& M = Msgs[i].msg_hdr;
+            for (cmsghdr* Cm = CMSG_FIRSTHDR(&M); Cm; Cm = CMSG_NXTHDR(&M, Cm))
+            {
+                if (Cm->cmsg_level != SOL_SOCKET)
+                    continue;
+                if (Cm->cmsg_type == SCM_TIMESTAMPNS)
+                {
+                    timespec t;
+                    std::memcpy(&t, CMSG_DATA(Cm), sizeof(t));
+                    RxTime = Seconds(t);
+                }
+                else if (Cm->cmsg_type == SO_RXQ_OVFL)
+                {
+                    uint32_t nDrops;
+                    std::memcpy(&nDrops, CMSG_DATA(Cm), sizeof(nDrops));
+                    C.Stats.nKernelDrops = (int)nDrops;
+                }
+            }
+            if (RxTime == 0.0)
+                RxTime = Now();
+
+            Reader R((const char*)Iov[i].iov_base, Msgs[i].msg_len);
+            Header H;
+            if (!R.Head(H) || H.Type != PKT_FRAME || !DecodeFrame(R, *C.pRx))
+            {
+                C.Stats.nBadPackets++;
+                continue;
+            }
+            C.pRx->RxTime = RxTime;
+            C.Stats.nFrames++;
+
+            // current before the handler runs, so that a thread the handler
+            // wakes gets this frame from Cortex_GetCurrentFrame
+            {
+                std::lock_guard<std::mutex> Lock(C.FrameMutex);
+                C.pRx.swap(C.pLatest);
+                C.bHaveLatest = true;
+            }
+
+            // handler gets the hot frame, only read by GetCurrentFrame
+            // until the next one
+            void (*Timed)(sFrameOfData*, double) = g_TimedDataHandler.load();
+            void (*Plain)(sFrameOfData*) = g_DataHandler.load();
+            if (Timed || Plain)
+            {
+                double Start = Now();
+                if (Start - RxTime > C.Stats.MaxRxToHandler)
+                    C.Stats.MaxRxToHandler = Start - RxTime;
+                if (Timed)
+                    Timed(&C.pLatest->Frame, RxTime);
+                else
+                    Plain(&C.pLatest->Frame);
+                double Took = Now() - Start;
+                if (Took > C.Stats.MaxHandlerTime)
+                    C.Stats.MaxHandlerTime = Took;
+            }
+        }
+    }
+}
+
+int OpenSockets(Client& C)
+{
+    const Settings& S = g_Settings;
+    in_addr TalkToHost, Host, Group, TalkToClients, ClientsGroup;
+    if (!Resolve(C.szTalkToHostNic, htonl(INADDR_ANY), &TalkToHost)
+        || !Resolve(C.szHostNic, htonl(INADDR_LOOPBACK), &Host)
+        || !Resolve(C.szHostMulticast, inet_addr("225.1.1.1"), &Group)
+        || !Resolve(C.szTalkToClientsNic, htonl(INADDR_ANY), &TalkToClients)
+        || !Resolve(C.szClientsMulticast, inet_addr("225.1.1.2"), &ClientsGroup))
+    {
+        Log(VL_Error, "could not resolve an address");
+        return RC_ApiError;
+    }
+
+    // requests
+    C.ReqSock = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in Sa = SocketAddress(TalkToHost, S.TalkToHostPort);
+    if (C.ReqSock < 0 || bind(C.ReqSock, (sockaddr*)&Sa, sizeof(Sa)) < 0)
+    {
+        Log(VL_Error, "request socket: %s", strerror(errno));
+        return RC_NetworkError;
+    }
+    C.HostAddr = SocketAddress(Host, S.HostPort);
+
+    // frames from the host
+    C.DataSock = socket(AF_INET, SOCK_DGRAM, 0);
+    int On = 1;
+    setsockopt(C.DataSock, SOL_SOCKET, SO_REUSEADDR, &On, sizeof(On));
+    setsockopt(C.DataSock, SOL_SOCKET, SO_TIMESTAMPNS, &On, sizeof(On));
+    setsockopt(C.DataSock, SOL_SOCKET, SO_RXQ_OVFL, &On, sizeof(On));
+    int nBuffer = RX_SOCKET_BUFFER;
+    setsockopt(C.DataSock, SOL_SOCKET, SO_RCVBUF, &nBuffer, sizeof(nBuffer));
+    timeval Tv = { 0, RX_POLL_MS * 1000 };
+    setsockopt(C.DataSock, SOL_SOCKET, SO_RCVTIMEO, &Tv, sizeof(Tv));
+    in_addr Any;
+    Any.s_addr = htonl(INADDR_ANY);
+    Sa = SocketAddress(Any, S.HostMulticastPort);
+    if (C.DataSock < 0 || bind(C.DataSock, (sockaddr*)&Sa, sizeof(Sa)) < 0)
+    {
+        Log(VL_Error, "data socket: %s", strerror(errno));
+        return RC_NetworkError;
+    }
+    ip_mreq Mreq;
+    Mreq.imr_multiaddr = Group;
+    // join on the interface facing the host when none was given
+    Mreq.imr_interface = TalkToHost.s_addr == htonl(INADDR_ANY) ? RouteTo(Host) : TalkToHost;
+    if (setsockopt(C.DataSock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &Mreq, sizeof(Mreq)) < 0)
+    {
+        Log(VL_Error, "joining %s: %s", inet_ntoa(Group), strerror(errno));
+        return RC_NetworkError;
+    }
+
+    // frames to our clients
+    if (S.bClients)
+    {
+        C.ClientSock = socket(AF_INET, SOCK_DGRAM, 0);
+        Sa = SocketAddress(TalkToClients, S.TalkToClientsMulticastPort);
+        if (C.ClientSock < 0 || bind(C.ClientSock, (sockaddr*)&Sa, sizeof(Sa)) < 0)
+        {
+            Log(VL_Error, "client socket: %s", strerror(errno));
+            return RC_NetworkError;
+        }
+        setsockopt(C.ClientSock, IPPROTO_IP, IP_MULTICAST_IF, &TalkToClients, sizeof(TalkToClients));
+        unsigned char Loop = 1;
+        setsockopt(C.ClientSock, IPPROTO_IP, IP_MULTICAST_LOOP, &Loop, sizeof(Loop));
+        C.ClientsAddr = SocketAddress(ClientsGroup, S.ClientsMulticastPort);
+    }
+    return RC_Okay;
+}
+
+void CloseSockets(Client& C)
+{
+    if (C.ReqSock >= 0) close(C.ReqSock);
+    if (C.DataSock >= 0) close(C.DataSock);
+    if (C.ClientSock >= 0) close(C.ClientSock);
+    C.ReqSock = C.DataSock = C.ClientSock = -1;
+}
+
+void FreeNames(char** szNames, int n)
+{
+    if (!szNames)
+        return;
+    for (int i = 0; i < n; i++)
+        std::free(szNames[i]);
+    std::free(szNames);
+}
+
+} // namespace
+
+//==================================================================
+// version, logging and settings
+
+int Cortex_GetSdkVersion(unsigned char Version[4])
+{
+    Version[0] = 0; // ModuleID
+    Version[1] = 2;
+    Version[2] = 0;
+    Version[3] = 0;
+    return RC_Okay;
+}
+
+int Cortex_SetVerbosityLevel(int iLevel)
+{
+    g_Settings.Verbosity = iLevel;
+    return RC_Okay;
+}
+
+int Cortex_GetVerbosityLevel()
+{
+    return g_Settings.Verbosity;
+}
+
+int Cortex_SetMinTimeout(int msTimeout)
+{
+    g_Settings.MinTimeout = msTimeout;
+    return RC_Okay;
+}
+
+int Cortex_GetMinTimeout()
+{
+    return g_Settings.MinTimeout;
+}
+
+int Cortex_SetErrorMsgHandlerFunc(void (*MyFunction)(int iLogLevel, char* szLogMessage))
+{
+    g_ErrorHandler.store(MyFunction);
+    return RC_Okay;
+}
+
+int Cortex_SetDataHandlerFunc(void (*MyFunction)(sFrameOfData* pFrameOfData))
+{
+    g_DataHandler.store(MyFunction);
+    return RC_Okay;
+}
+
+int Cortex_SetTimedDataHandlerFunc(void (*MyFunction)(sFrameOfData* pFrameOfData, double fRxTime))
+{
+    g_TimedDataHandler.store(MyFunction);
+    return RC_Okay;
+}
+
+void Cortex_SetClientCommunicationEnabled(int bEnabled)
+{
+    g_Settings.bClients = bEnabled;
+}
+
+int Cortex_IsClientCommunicationEnabled()
+{
+    return g_Settings.bClients;
+}
+
+void Cortex_SetThreadPriorities(maThreadPriority ListenForHost, maThreadPriority ListenForData, maThreadPriority ListenForClients)
+{
+    // the receive thread runs at the default priority
+    (void)ListenForHost;
+    (void)ListenForData;
+    (void)ListenForClients;
+}
+
+int Cortex_ConfigurePortNumbers(int TalkToHostPort, int HostPort, int HostMulticastPort,
+                                int TalkToClientsRequestPort, int TalkToClientsMulticastPort,
+                                int ClientsMulticastPort)
+{
+    std::lock_guard<std::mutex> Lock(g_ApiMutex);
+    if (g_pClient)
+        return RC_ApiError;
+    int* Ports[6] = { &g_Settings.TalkToHostPort, &g_Settings.HostPort,
+                      &g_Settings.HostMulticastPort, &g_Settings.TalkToClientsRequestPort,
+                      &g_Settings.TalkToClientsMulticastPort, &g_Settings.ClientsMulticastPort };
+    int Values[6] = { TalkToHostPort, HostPort, HostMulticastPort, TalkToClientsRequestPort,
+                      TalkToClientsMulticastPort, ClientsMulticastPort };
+    bool AnyAllowed[6] = { true, false, false, true, true, false };
+    for (int i = 0; i < 6; i++)
+    {
+        if (Values[i] == -1)
+            continue;
+        if (Values[i] > 65535 || Values[i] < (AnyAllowed[i] ? 0 : 1))
+            return RC_ApiError;
+    }
+    for (int i = 0; i < 6; i++)
+        if (Values[i] != -1)
+            *Ports[i] = Values[i];
+    return RC_Okay;
+}
+
+//==================================================================
+// connection
+
+int Cortex_Initialize(char* szTalkToHostNicCardAddress, char* szHostNicCardAddress,
+                      char* szHostMulticastAddress, char* szTalkToClientsNicCardAddress,
+                      char* szClientsMulticastAddress)
+{
+    std::lock_guard<std::mutex> Lock(g_ApiMutex);
+    if (g_pClient)
+        return RC_ApiError;
+
+    Client* pC = new Client();
+    Client& C = *pC;
+    C.szTalkToHostNic = szTalkToHostNicCardAddress ? szTalkToHostNicCardAddress : "";
+    C.szHostNic = szHostNicCardAddress ? szHostNicCardAddress : "";
+    C.szHostMulticast = szHostMulticastAddress ? szHostMulticastAddress : "";
+    C.szTalkToClientsNic = szTalkToClientsNicCardAddress ? szTalkToClientsNicCardAddress : "";
+    C.szClientsMulticast = szClientsMulticastAddress ? szClientsMulticastAddress : "";
+
+    int iResult = OpenSockets(C);
+    if (iResult == RC_Okay)
+    {
+        // the host must answer before we report a connection
+        Header H;
+        Reader R(NULL, 0);
+        iResult = Request(C, "GetHostInfo", g_Settings.MinTimeout, PKT_REPLY, H, R);
+        int32_t Rc = RC_GeneralError;
+        uint32_t nBytes = 0;
+        if (iResult == RC_Okay && R.Get(Rc) && R.Get(nBytes)
+            && Rc == RC_Okay && nBytes == sizeof(sHostInfo))
+        {
+            R.Get(C.HostInfo);
+            C.HostInfo.bFoundHost = 1;
+            C.HostInfo.LatestConfirmationTime = (int)time(NULL);
+            Log(VL_Info, "connected to %s on %s", C.HostInfo.szHostProgramName,
+                C.HostInfo.szHostMachineName);
+        }
+        else
+        {
+            Log(VL_Error, "no answer from the host at %s:%d",
+                inet_ntoa(C.HostAddr.sin_addr), ntohs(C.HostAddr.sin_port));
+            iResult = RC_NetworkError;
+        }
+    }
+    if (iResult != RC_Okay)
+    {
+        CloseSockets(C);
+        delete pC;
+        return iResult;
+    }
+
+    C.bRun.store(true);
+    C.Rx = std::thread(Receive, std::ref(C));
+    g_pClient = pC;
+    return RC_Okay;
+}
+
+int Cortex_GetPortNumbers(int* TalkToHostPort, int* HostPort, int* HostMulticastPort,
+                          int* TalkToClientsRequestPort, int* TalkToClientsMulticastPort,
+                          int* ClientsMulticastPort)
+{
+    const Settings& S = g_Settings;
+    if (TalkToHostPort) *TalkToHostPort = S.TalkToHostPort;
+    if (HostPort) *HostPort = S.HostPort;
+    if (HostMulticastPort) *HostMulticastPort = S.HostMulticastPort;
+    if (TalkToClientsRequestPort) *TalkToClientsRequestPort = S.TalkToClientsRequestPort;
+    if (TalkToClientsMulticastPort) *TalkToClientsMulticastPort = S.TalkToClientsMulticastPort;
+    if (ClientsMulticastPort) *ClientsMulticastPort = S.ClientsMulticastPort;
+
+    // report the port actually bound when any was allowed
+    std::lock_guard<std::mutex> Lock(g_ApiMutex);
+    if (g_pClient && TalkToHostPort)
+    {
+        sockaddr_in Sa;
+        socklen_t n = sizeof(Sa);
+        if (getsockname(g_pClient->ReqSock, (sockaddr*)&Sa, &n) == 0)
+            *TalkToHostPort = ntohs(Sa.sin_port);
+    }
+    return RC_Okay;
+}
+
+int Cortex_GetAddresses(char* szTalkToHostNicCardAddress, char* szHostNicCardAddress,
+                        char* szHostMulticastAddress, char* szTalkToClientsNicCardAddress,
+                        char* szClientsMulticastAddress)
+{
+    std::lock_guard<std::mutex> Lock(g_ApiMutex);
+    if (!g_pClient)
+        return RC_ApiError;
+    const Client& C = *g_pClient;
+    if (szTalkToHostNicCardAddress) snprintf(szTalkToHostNicCardAddress, 128, "%s", C.szTalkToHostNic.c_str());
+    if (szHostNicCardAddress) snprintf(szHostNicCardAddress, 128, "%s", C.szHostNic.c_str());
+    if (szHostMulticastAddress) snprintf(szHostMulticastAddress, 128, "%s", C.szHostMulticast.c_str());
+    if (szTalkToClientsNicCardAddress) snprintf(szTalkToClientsNicCardAddress, 128, "%s", C.szTalkToClientsNic.c_str());
+    if (szClientsMulticastAddress) snprintf(szClientsMulticastAddress, 128, "%s", C.szClientsMulticast.c_str());
+    return RC_Okay;
+}
+
+int Cortex_GetHostInfo(sHostInfo* pHostInfo)
+{
+    std::lock_guard<std::mutex> Lock(g_ApiMutex);
+    if (!g_pClient)
+        return RC_NetworkError;
+    *pHostInfo = g_pClient->HostInfo;
+    return RC_Okay;
+}
+
+int Cortex_Exit()
+{
+    std::lock_guard<std::mutex> Lock(g_ApiMutex);
+    if (!g_pClient)
+        return RC_Okay;
+    Client* pC = g_pClient;
+    g_pClient = NULL;
+    pC->bRun.store(false);
+    if (pC->Rx.joinable())
+        pC->Rx.join();
+    CloseSockets(*pC);
+    Cortex_FreeFrame(&pC->Polled);
+    delete pC;
+    return RC_Okay;
+}
+
+//==================================================================
+// requests and Sky commands
+
+int Cortex_Request(char* szCommand, void** ppResponse, int* pnBytes)
+{
+    Client* pC = g_pClient;
+    if (!pC || !szCommand)
+        return RC_ApiError;
+    std::lock_guard<std::mutex> Lock(pC->ReqMutex);
+    Header H;
+    Reader R(NULL, 0);
+    int iResult = Request(*pC, szCommand, g_Settings.MinTimeout, PKT_REPLY, H, R);
+    if (iResult != RC_Okay)
+        return iResult;
+
+    int32_t Rc = RC_GeneralError;
+    uint32_t nBytes = 0;
+    if (!R.Get(Rc) || !R.Get(nBytes) || nBytes > MAX_PACKET)
+        return RC_GeneralError;
+    pC->Response.resize(nBytes + 1);
+    R.Get(&pC->Response[0], nBytes);
+    if (ppResponse)
+        *ppResponse = &pC->Response[0];
+    if (pnBytes)
+        *pnBytes = (int)nBytes;
+    return Rc;
+}
+
+sSkyReturn* Cortex_SkyCommand(char* szCommand, int msTimeout)
+{
+    static sSkyReturn NotConnected;
+    Client* pC = g_pClient;
+    if (!pC || !szCommand)
+    {
+        std::memset(&NotConnected, 0, sizeof(NotConnected));
+        NotConnected.ReturnCode = RC_ApiError;
+        return &NotConnected;
+    }
+
+    std::lock_guard<std::mutex> Lock(pC->ReqMutex);
+    sSkyReturn& Sky = pC->Sky;
+    std::memset(&Sky, 0, sizeof(Sky));
+    uint32_t Id = pC->NextId++;
+    Writer W(pC->ReqBuf);
+    W.Head(PKT_SKY, Id);
+    W.Put((int32_t)msTimeout);
+    W.Str(szCommand);
+
+    Header H;
+    Reader R(NULL, 0);
+    int msWait = msTimeout > g_Settings.MinTimeout ? msTimeout : g_Settings.MinTimeout;
+    if (!Exchange(*pC, Id, msWait, H, R))
+    {
+        Sky.ReturnCode = RC_TimeOut;
+        return &Sky;
+    }
+    int32_t Rc = RC_GeneralError, Type = SKY_VOID;
+    if (H.Type != PKT_SKY_REPLY || !R.Get(Rc) || !R.Get(Type)
+        || !R.Get(&Sky.ReturnData, sizeof(Sky.ReturnData)))
+    {
+        Sky.ReturnCode = RC_GeneralError;
+        return &Sky;
+    }
+    Sky.ReturnCode = (maReturnCode)Rc;
+    Sky.ReturnType = (maSkyReturnType)Type;
+    return &Sky;
+}
+
+//==================================================================
+// body definitions
+
+sBodyDefs* Cortex_GetBodyDefs()
+{
+    Client* pC = g_pClient;
+    if (!pC)
+        return NULL;
+    std::lock_guard<std::mutex> Lock(pC->ReqMutex);
+    Header H;
+    Reader R(NULL, 0);
+    if (Request(*pC, "GetBodyDefs", g_Settings.MinTimeout, PKT_BODYDEFS, H, R) != RC_Okay)
+        return NULL;
+    sBodyDefs* pDefs = DecodeBodyDefs(R);
+    if (!R.Ok())
+    {
+        Log(VL_Warning, "incomplete body definitions");
+        Cortex_FreeBodyDefs(pDefs);
+        return NULL;
+    }
+    return pDefs;
+}
+
+int Cortex_FreeBodyDefs(sBodyDefs* pBodyDefs)
+{
+    if (!pBodyDefs)
+        return RC_Okay;
+    for (int b = 0; b < pBodyDefs->nBodyDefs; b++)
+    {
+        sBodyDef& B = pBodyDefs->BodyDefs[b];
+        std::free(B.szName);
+        FreeNames(B.szMarkerNames, B.nMarkers);
+        FreeNames(B.Hierarchy.szSegmentNames, B.Hierarchy.nSegments);
+        std::free(B.Hierarchy.iParents);
+        FreeNames(B.szDofNames, B.nDofs);
+    }
+    FreeNames(pBodyDefs->szAnalogChannelNames, pBodyDefs->nAnalogChannels);
+    std::free(pBodyDefs->AnalogLoVoltage);
+    std::free(pBodyDefs->AnalogHiVoltage);
+    std::free(pBodyDefs);
+    return RC_Okay;
+}
+
+//==================================================================
+// frames
+
+sFrameOfData* Cortex_GetCurrentFrame()
+{
+    Client* pC = g_pClient;
+    if (!pC)
+        return NULL;
+    std::lock_guard<std::mutex> Lock(pC->FrameMutex);
+    if (pC->bHaveLatest)
+    {
+        Cortex_CopyFrame(&pC->pLatest->Frame, &pC->Polled);
+        pC->PolledRxTime = pC->pLatest->RxTime;
+    }
+    return &pC->Polled;
+}
+
+double Cortex_GetCurrentFrameRxTime()
+{
+    Client* pC = g_pClient;
+    return pC ? pC->PolledRxTime : 0.0;
+}
+
+int Cortex_GetReceiveStats(sReceiveStats* pStats)
+{
+    Client* pC = g_pClient;
+    if (!pC || !pStats)
+        return RC_ApiError;
+    std::lock_guard<std::mutex> Lock(pC->FrameMutex);
+    *pStats = pC->Stats;
+    return RC_Okay;
+}
+
+namespace
+{
+
+/** Resize a malloc'ed array; keeps the old block when it fails */
+bool Realloc(void** pp, size_t nBytes)
+{
+    if (nBytes == 0)
+        return true;
+    void* p = std::realloc(*pp, nBytes);
+    if (!p)
+        return false;
+    *pp = p;
+    return true;
+}
+
+} // namespace
+
+int Cortex_CopyFrame(const sFrameOfData* pSrc, sFrameOfData* pDst)
+{
+    if (!pSrc || !pDst)
+        return RC_ApiError;
+    const sFrameOfData& S = *pSrc;
+    sFrameOfData& D = *pDst;
+    bool bOk = true;
+
+    D.iFrame = S.iFrame;
+    D.fDelay = S.fDelay;
+    D.nBodies = S.nBodies;
+    for (int b = 0; b < S.nBodies && b < MAX_N_BODIES; b++)
+    {
+        const sBodyData& Sb = S.BodyData[b];
+        sBodyData& Db = D.BodyData[b];
+
+        // event names are owned strings, free the old ones first
+        for (int e = 0; e < Db.nEvents; e++)
+            std::free(Db.Events[e]);
+
+        tMarkerData* Markers = Db.Markers;
+        tSegmentData* Segments = Db.Segments;
+        tDofData* Dofs = Db.Dofs;
+        char** Events = Db.Events;
+        bOk &= Realloc((void**)&Markers, Sb.nMarkers * sizeof(tMarkerData));
+        bOk &= Realloc((void**)&Segments, Sb.nSegments * sizeof(tSegmentData));
+        bOk &= Realloc((void**)&Dofs, Sb.nDofs * sizeof(tDofData));
+        bOk &= Realloc((void**)&Events, Sb.nEvents * sizeof(char*));
+
+        Db = Sb;
+        Db.Markers = Markers;
+        Db.Segments = Segments;
+        Db.Dofs = Dofs;
+        Db.Events = Events;
+        if (!bOk)
+        {
+            Db.nMarkers = Db.nSegments = Db.nDofs = Db.nEvents = 0;
+            continue;
+        }
+        if (Sb.nMarkers) std::memcpy(Markers, Sb.Markers, Sb.nMarkers * sizeof(tMarkerData));
+        if (Sb.nSegments) std::memcpy(Segments, Sb.Segments, Sb.nSegments * sizeof(tSegmentData));
+        if (Sb.nDofs) std::memcpy(Dofs, Sb.Dofs, Sb.nDofs * sizeof(tDofData));
+        for (int e = 0; e < Sb.nEvents; e++)
+            Events[e] = strdup(Sb.Events[e] ? Sb.Events[e] : "");
+    }
+
+    tMarkerData* Unidentified = D.UnidentifiedMarkers;
+    bOk &= Realloc((void**)&Unidentified, S.nUnidentifiedMarkers * sizeof(tMarkerData));
+    D.UnidentifiedMarkers = Unidentified;
+    D.nUnidentifiedMarkers = bOk ? S.nUnidentifiedMarkers : 0;
+    if (D.nUnidentifiedMarkers)
+        std::memcpy(Unidentified, S.UnidentifiedMarkers, S.nUnidentifiedMarkers * sizeof(tMarkerData));
+
+    const sAnalogData& Sa = S.AnalogData;
+    sAnalogData& Da = D.AnalogData;
+    short* Samples = Da.AnalogSamples;
+    tForceData* Forces = Da.Forces;
+    double* Encoders = Da.AngleEncoderSamples;
+    size_t nSamples = (size_t)Sa.nAnalogChannels * Sa.nAnalogSamples;
+    size_t nForces = (size_t)Sa.nForcePlates * Sa.nForceSamples;
+    size_t nEncoders = (size_t)Sa.nAngleEncoders * Sa.nAngleEncoderSamples;
+    bOk &= Realloc((void**)&Samples, nSamples * sizeof(short));
+    bOk &= Realloc((void**)&Forces, nForces * sizeof(tForceData));
+    bOk &= Realloc((void**)&Encoders, nEncoders * sizeof(double));
+    Da = Sa;
+    Da.AnalogSamples = Samples;
+    Da.Forces = Forces;
+    Da.AngleEncoderSamples = Encoders;
+    if (!bOk)
+    {
+        Da.nAnalogSamples = Da.nForceSamples = Da.nAngleEncoderSamples = 0;
+        return RC_MemoryError;
+    }
+    if (nSamples) std::memcpy(Samples, Sa.AnalogSamples, nSamples * sizeof(short));
+    if (nForces) std::memcpy(Forces, Sa.Forces, nForces * sizeof(tForceData));
+    if (nEncoders) std::memcpy(Encoders, Sa.AngleEncoderSamples, nEncoders * sizeof(double));
+
+    D.RecordingStatus = S.RecordingStatus;
+    D.TimeCode = S.TimeCode;
+    return RC_Okay;
+}
+
+int Cortex_FreeFrame(sFrameOfData* pFrame)
+{
+    if (!pFrame)
+        return RC_Okay;
+    sFrameOfData& F = *pFrame;
+    for (int b = 0; b < MAX_N_BODIES; b++)
+    {
+        sBodyData& B = F.BodyData[b];
+        for (int e = 0; e < B.nEvents; e++)
+            std::free(B.Events[e]);
+        std::free(B.Markers);
+        std::free(B.Segments);
+        std::free(B.Dofs);
+        std::free(B.Events);
+        B.Markers = NULL;
+        B.Segments = NULL;
+        B.Dofs = NULL;
+        B.Events = NULL;
+        B.nMarkers = B.nSegments = B.nDofs = B.nEvents = 0;
+    }
+    std::free(F.UnidentifiedMarkers);
+    std::free(F.AnalogData.AnalogSamples);
+    std::free(F.AnalogData.Forces);
+    std::free(F.AnalogData.AngleEncoderSamples);
+    std::memset(pFrame, 0, sizeof(*pFrame));
+    return RC_Okay;
+}
+
+//==================================================================
+// acting as an SDK2 host
+
+int Cortex_SendDataToClients(sFrameOfData* pFrameOfData)
+{
+    Client* pC = g_pClient;
+    if (!pC || pC->ClientSock < 0 || !pFrameOfData)
+        return RC_ApiError;
+    std::lock_guard<std::mutex> Lock(pC->SendMutex);
+    EncodeFrame(*pFrameOfData, (uint32_t)pFrameOfData->iFrame, pC->SendBuf);
+    if (pC->SendBuf.size() > MAX_PACKET)
+        return RC_GeneralError;
+    if (sendto(pC->ClientSock, &pC->SendBuf[0], pC->SendBuf.size(), 0,
+               (sockaddr*)&pC->ClientsAddr, sizeof(pC->ClientsAddr)) < 0)
+        return RC_NetworkError;
+    return RC_Okay;
+}
+
+int Cortex_SendHtr(sHierarchy* pHierarchy, tSegmentData* pFrame)
+{
+    // pushing skeletons to Cortex is not supported by this client
+    (void)pHierarchy;
+    (void)pFrame;
+    return RC_Unrecognized;
+}
@@ -0,0 +1,64 @@
+/*=========================================================
+//
+// File: CortexLinux.h
+//
+// Additions of the Linux SDK2 client to the MatlabCortex.h API.
+//
+=============================================================================*/
+
+#ifndef CortexLinux_H
+#define CortexLinux_H
+
+#include "MatlabCortex.h"
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+/** Receive path statistics */
+typedef struct sReceiveStats
+{
+    int    nPackets;        //!< datagrams read
+    int    nFrames;         //!< frames decoded
+    int    nBadPackets;     //!< datagrams that failed to decode
+    int    nBatches;        //!< recvmmsg calls that returned data
+    int    nMaxBatch;       //!< most datagrams returned by one call
+    int    nKernelDrops;    //!< datagrams dropped by a full socket buffer
+    double MaxHandlerTime;  //!< longest data handler call (s)
+    double MaxRxToHandler;  //!< longest kernel receive to handler call (s)
+
+} sReceiveStats;
+
+//==================================================================
+
+/** The user supplied function is called whenever a frame arrives, with
+ *  the kernel receive time of its datagram.
+ *
+ *  As Cortex_SetDataHandlerFunc; set either, not both.
+ *
+ *  \param MyFunction - The handler; fRxTime is seconds on CLOCK_REALTIME.
+ *
+ *  \return RC_Okay
+*/
+DLL int Cortex_SetTimedDataHandlerFunc(void (*MyFunction)(sFrameOfData* pFrameOfData, double fRxTime));
+
+//==================================================================
+
+/** This function returns the kernel receive time of the frame returned by
+ *  the latest Cortex_GetCurrentFrame call (s, CLOCK_REALTIME).
+*/
+DLL double Cortex_GetCurrentFrameRxTime();
+
+//==================================================================
+
+/** This function copies the receive path statistics.
+ *
+ *  \return RC_Okay, RC_ApiError if not initialized
+*/
+DLL int Cortex_GetReceiveStats(sReceiveStats* pStats);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
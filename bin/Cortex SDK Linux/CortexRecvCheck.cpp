@@ -0,0 +1,121 @@
+/*=========================================================
+//
+// File: CortexRecvCheck.cpp
+//
+// Connects to Cortex (or CortexHostStandIn) with the Linux client and
+// reports what arrived: body definitions, frame rate, frames received
+// and missed, and the time from kernel receive to the data handler.
+//
+// Usage: CortexRecvCheck [Seconds (5)] [HostAddress (127.0.0.1)]
+//
+=============================================================================*/
+
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "CortexLinux.h"
+
+namespace
+{
+
+const int MAX_LATENCIES = 1 << 20;
+
+std::vector<double> g_Latency; // handler only
+std::atomic<int> g_nFrames(0);
+int g_LastFrame = 0;
+int g_nMissed = 0;
+int g_nMarkers = 0;
+
+double Now()
+{
+    timespec t;
+    clock_gettime(CLOCK_REALTIME, &t);
+    return (double)t.tv_sec + 1e-9 * (double)t.tv_nsec;
+}
+
+void OnFrame(sFrameOfData* pFrame, double fRxTime)
+{
+    if ((int)g_Latency.size() < MAX_LATENCIES)
+        g_Latency.push_back(Now() - fRxTime);
+    if (g_LastFrame && pFrame->iFrame > g_LastFrame + 1)
+        g_nMissed += pFrame->iFrame - g_LastFrame - 1;
+    g_LastFrame = pFrame->iFrame;
+    g_nMarkers = pFrame->nBodies ? pFrame->BodyData[0].nMarkers : 0;
+    g_nFrames++;
+}
+
+double Percentile(std::vector<double>& x, double p)
+{
+    if (x.empty())
+        return 0.0;
+    size_t i = (size_t)(p * (x.size() - 1));
+    std::nth_element(x.begin(), x.begin() + i, x.end());
+    return x[i];
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    double Seconds = argc > 1 ? std::atof(argv[1]) : 5.0;
+    char* szHost = argc > 2 ? argv[2] : (char*)"127.0.0.1";
+    g_Latency.reserve(MAX_LATENCIES);
+
+    Cortex_SetVerbosityLevel(VL_Info);
+    Cortex_SetTimedDataHandlerFunc(OnFrame);
+    int iResult = Cortex_Initialize((char*)"", szHost, NULL, NULL, NULL);
+    if (iResult != RC_Okay)
+    {
+        printf("Cortex_Initialize failed (%d)\n", iResult);
+        return 1;
+    }
+
+    sBodyDefs* pDefs = Cortex_GetBodyDefs();
+    if (pDefs)
+    {
+        for (int b = 0; b < pDefs->nBodyDefs; b++)
+            printf("Body %s: %d markers\n", pDefs->BodyDefs[b].szName, pDefs->BodyDefs[b].nMarkers);
+        printf("%d analog channels, %d force plates\n", pDefs->nAnalogChannels, pDefs->nForcePlates);
+        Cortex_FreeBodyDefs(pDefs);
+    }
+    else
+        printf("no body definitions\n");
+
+    void* pResponse = NULL;
+    int nBytes = 0;
+    if (Cortex_Request((char*)"GetContextFrameRate", &pResponse, &nBytes) == RC_Okay
+        && nBytes == sizeof(float))
+        printf("Frame rate %g Hz\n", *(float*)pResponse);
+
+    sSkyReturn* pSky = Cortex_SkyCommand((char*)"Echo", 500);
+    printf("Sky command returned %d\n", pSky->ReturnCode);
+
+    usleep((useconds_t)(Seconds * 1e6));
+
+    // a polled copy, as the MATLAB scripts read frames
+    sFrameOfData Copy = {};
+    sFrameOfData* pFrame = Cortex_GetCurrentFrame();
+    if (pFrame)
+        Cortex_CopyFrame(pFrame, &Copy);
+
+    sReceiveStats Stats;
+    Cortex_GetReceiveStats(&Stats);
+    Cortex_Exit();
+
+    printf("Frames %d (last %d, %d markers), missed %d\n",
+           g_nFrames.load(), Copy.iFrame, g_nMarkers, g_nMissed);
+    printf("Packets %d, bad %d, batches %d (max %d), kernel drops %d\n",
+           Stats.nPackets, Stats.nBadPackets, Stats.nBatches, Stats.nMaxBatch, Stats.nKernelDrops);
+    printf("Receive to handler: median %.1f us, 99%% %.1f us, max %.1f us\n",
+           1e6 * Percentile(g_Latency, 0.5), 1e6 * Percentile(g_Latency, 0.99),
+           1e6 * Stats.MaxRxToHandler);
+    printf("Handler: max %.1f us\n", 1e6 * Stats.MaxHandlerTime);
+    Cortex_FreeFrame(&Copy);
+    return g_nFrames.load() > 0 ? 0 : 1;
+}
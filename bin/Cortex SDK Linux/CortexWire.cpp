@@ -0,0 +1,371 @@
+/*=========================================================
+//
+// File: CortexWire.cpp
+//
+// Packet encoding and decoding for the Linux SDK2 client.
+// Values are copied in host order; the client and hosts it is used
+// with are little endian.
+//
+=============================================================================*/
+
+#include "CortexWire.h"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace CortexWire
+{
+
+//==================================================================
+// Writer / Reader
+
+void Writer::Head(PacketType Type, uint32_t Id)
+{
+    Header H;
+    H.Magic = MAGIC;
+    H.Version = VERSION;
+    H.Type = (uint16_t)Type;
+    H.Id = Id;
+    Put(&H, sizeof(H));
+}
+
+void Writer::Put(const void* p, size_t n)
+{
+    if (n == 0)
+        return;
+    const char* c = (const char*)p;
+    m_Buf.insert(m_Buf.end(), c, c + n);
+}
+
+void Writer::Str(const char* sz)
+{
+    size_t n = sz ? std::strlen(sz) : 0;
+    if (n > 0xFFFF)
+        n = 0xFFFF;
+    Put((uint16_t)n);
+    Put(sz, n);
+}
+
+bool Reader::Head(Header& H)
+{
+    return Get(H) && H.Magic == MAGIC && H.Version == VERSION;
+}
+
+bool Reader::Get(void* p, size_t n)
+{
+    if (!m_bOk || (size_t)(m_End - m_p) < n)
+    {
+        m_bOk = false;
+        return false;
+    }
+    std::memcpy(p, m_p, n);
+    m_p += n;
+    return true;
+}
+
+bool Reader::Str(std::string& s)
+{
+    uint16_t n = 0;
+    if (!Get(n) || (size_t)(m_End - m_p) < n)
+    {
+        m_bOk = false;
+        return false;
+    }
+    s.assign(m_p, n);
+    m_p += n;
+    return true;
+}
+
+bool Reader::Str(char* sz, size_t nMax)
+{
+    uint16_t n = 0;
+    if (!Get(n) || (size_t)(m_End - m_p) < n)
+    {
+        m_bOk = false;
+        return false;
+    }
+    size_t nCopy = n < nMax - 1 ? n : nMax - 1;
+    std::memcpy(sz, m_p, nCopy);
+    sz[nCopy] = '\0';
+    m_p += n;
+    return true;
+}
+
+int32_t Reader::Count(size_t ElementSize)
+{
+    int32_t n = 0;
+    if (!Get(n) || n < 0 || (ElementSize > 0 && (size_t)n > (size_t)(m_End - m_p) / ElementSize))
+    {
+        m_bOk = false;
+        return 0;
+    }
+    return n;
+}
+
+//==================================================================
+// frames
+
+FrameBuffer::FrameBuffer() : RxTime(0.0)
+{
+    std::memset(&Frame, 0, sizeof(Frame));
+}
+
+void EncodeFrame(const sFrameOfData& f, uint32_t Id, std::vector<char>& Buf)
+{
+    Writer W(Buf);
+    W.Head(PKT_FRAME, Id);
+    W.Put((int32_t)f.iFrame);
+    W.Put(f.fDelay);
+
+    int nBodies = f.nBodies < MAX_N_BODIES ? f.nBodies : MAX_N_BODIES;
+    W.Put((int32_t)nBodies);
+    for (int b = 0; b < nBodies; b++)
+    {
+        const sBodyData& B = f.BodyData[b];
+        W.Str(B.szName);
+        W.Put((int32_t)B.nMarkers);
+        W.Put(B.Markers, B.nMarkers * sizeof(tMarkerData));
+        W.Put(B.fAvgMarkerResidual);
+        W.Put((int32_t)B.nSegments);
+        W.Put(B.Segments, B.nSegments * sizeof(tSegmentData));
+        W.Put((int32_t)B.nDofs);
+        W.Put(B.Dofs, B.nDofs * sizeof(tDofData));
+        W.Put(B.fAvgDofResidual);
+        W.Put((int32_t)B.nIterations);
+        W.Put((int32_t)B.ZoomEncoderValue);
+        W.Put((int32_t)B.FocusEncoderValue);
+        W.Put((int32_t)B.IrisEncoderValue);
+        W.Put((int32_t)B.nEvents);
+        for (int e = 0; e < B.nEvents; e++)
+            W.Str(B.Events[e]);
+    }
+
+    W.Put((int32_t)f.nUnidentifiedMarkers);
+    W.Put(f.UnidentifiedMarkers, f.nUnidentifiedMarkers * sizeof(tMarkerData));
+
+    const sAnalogData& A = f.AnalogData;
+    W.Put((int32_t)A.nAnalogChannels);
+    W.Put((int32_t)A.nAnalogSamples);
+    W.Put(A.AnalogSamples, A.nAnalogChannels * A.nAnalogSamples * sizeof(short));
+    W.Put((int32_t)A.nForcePlates);
+    W.Put((int32_t)A.nForceSamples);
+    W.Put(A.Forces, A.nForcePlates * A.nForceSamples * sizeof(tForceData));
+    W.Put((int32_t)A.nAngleEncoders);
+    W.Put((int32_t)A.nAngleEncoderSamples);
+    W.Put(A.AngleEncoderSamples, A.nAngleEncoders * A.nAngleEncoderSamples * sizeof(double));
+
+    const sRecordingStatus& S = f.RecordingStatus;
+    W.Put((int32_t)S.bRecording);
+    W.Put((int32_t)S.iFirstFrame);
+    W.Put((int32_t)S.iLastFrame);
+    W.Str(S.szFilename);
+
+    const sTimeCode& T = f.TimeCode;
+    W.Put((int32_t)T.iStandard);
+    W.Put((int32_t)T.iHours);
+    W.Put((int32_t)T.iMinutes);
+    W.Put((int32_t)T.iSeconds);
+    W.Put((int32_t)T.iFrames);
+}
+
+bool DecodeFrame(Reader& R, FrameBuffer& Buf)
+{
+    sFrameOfData& f = Buf.Frame;
+    int32_t i32 = 0;
+    R.Get(i32);
+    f.iFrame = i32;
+    R.Get(f.fDelay);
+
+    int32_t nBodies = R.Count(0);
+    if (nBodies > MAX_N_BODIES)
+        return false;
+    f.nBodies = nBodies;
+    for (int b = 0; b < nBodies && R.Ok(); b++)
+    {
+        sBodyData& B = f.BodyData[b];
+        R.Str(B.szName, sizeof(B.szName));
+
+        B.nMarkers = R.Count(sizeof(tMarkerData));
+        Buf.Markers[b].resize(3 * B.nMarkers + 3);
+        B.Markers = (tMarkerData*)&Buf.Markers[b][0];
+        R.Get(B.Markers, B.nMarkers * sizeof(tMarkerData));
+        R.Get(B.fAvgMarkerResidual);
+
+        B.nSegments = R.Count(sizeof(tSegmentData));
+        Buf.Segments[b].resize(7 * B.nSegments + 7);
+        B.Segments = (tSegmentData*)&Buf.Segments[b][0];
+        R.Get(B.Segments, B.nSegments * sizeof(tSegmentData));
+
+        B.nDofs = R.Count(sizeof(tDofData));
+        Buf.Dofs[b].resize(B.nDofs + 1);
+        B.Dofs = &Buf.Dofs[b][0];
+        R.Get(B.Dofs, B.nDofs * sizeof(tDofData));
+        R.Get(B.fAvgDofResidual);
+
+        R.Get(i32); B.nIterations = i32;
+        R.Get(i32); B.ZoomEncoderValue = i32;
+        R.Get(i32); B.FocusEncoderValue = i32;
+        R.Get(i32); B.IrisEncoderValue = i32;
+
+        B.nEvents = R.Count(sizeof(uint16_t));
+        std::vector<std::string>& Names = Buf.EventNames[b];
+        std::vector<char*>& Events = Buf.Events[b];
+        if ((int)Names.size() < B.nEvents)
+            Names.resize(B.nEvents);
+        Events.resize(B.nEvents + 1);
+        for (int e = 0; e < B.nEvents; e++)
+        {
+            R.Str(Names[e]);
+            Events[e] = &Names[e][0];
+        }
+        B.Events = B.nEvents > 0 ? &Events[0] : NULL;
+    }
+
+    f.nUnidentifiedMarkers = R.Count(sizeof(tMarkerData));
+    Buf.Unidentified.resize(3 * f.nUnidentifiedMarkers + 3);
+    f.UnidentifiedMarkers = (tMarkerData*)&Buf.Unidentified[0];
+    R.Get(f.UnidentifiedMarkers, f.nUnidentifiedMarkers * sizeof(tMarkerData));
+
+    sAnalogData& A = f.AnalogData;
+    A.nAnalogChannels = R.Count(0);
+    A.nAnalogSamples = R.Count(0);
+    size_t n = (size_t)A.nAnalogChannels * A.nAnalogSamples;
+    if (n > MAX_PACKET)
+        return false;
+    Buf.Analog.resize(n + 1);
+    A.AnalogSamples = &Buf.Analog[0];
+    R.Get(A.AnalogSamples, n * sizeof(short));
+
+    A.nForcePlates = R.Count(0);
+    A.nForceSamples = R.Count(0);
+    n = (size_t)A.nForcePlates * A.nForceSamples;
+    if (n > MAX_PACKET)
+        return false;
+    Buf.Forces.resize(7 * n + 7);
+    A.Forces = (tForceData*)&Buf.Forces[0];
+    R.Get(A.Forces, n * sizeof(tForceData));
+
+    A.nAngleEncoders = R.Count(0);
+    A.nAngleEncoderSamples = R.Count(0);
+    n = (size_t)A.nAngleEncoders * A.nAngleEncoderSamples;
+    if (n > MAX_PACKET)
+        return false;
+    Buf.Encoders.resize(n + 1);
+    A.AngleEncoderSamples = &Buf.Encoders[0];
+    R.Get(A.AngleEncoderSamples, n * sizeof(double));
+
+    sRecordingStatus& S = f.RecordingStatus;
+    R.Get(i32); S.bRecording = i32;
+    R.Get(i32); S.iFirstFrame = i32;
+    R.Get(i32); S.iLastFrame = i32;
+    R.Str(S.szFilename, sizeof(S.szFilename));
+
+    sTimeCode& T = f.TimeCode;
+    R.Get(i32); T.iStandard = i32;
+    R.Get(i32); T.iHours = i32;
+    R.Get(i32); T.iMinutes = i32;
+    R.Get(i32); T.iSeconds = i32;
+    R.Get(i32); T.iFrames = i32;
+
+    return R.Ok();
+}
+
+//==================================================================
+// body definitions
+
+namespace
+{
+
+void PutNames(Writer& W, char** szNames, int n)
+{
+    W.Put((int32_t)n);
+    for (int i = 0; i < n; i++)
+        W.Str(szNames ? szNames[i] : NULL);
+}
+
+char* GetString(Reader& R)
+{
+    std::string s;
+    R.Str(s);
+    char* sz = (char*)std::malloc(s.size() + 1);
+    std::memcpy(sz, s.c_str(), s.size() + 1);
+    return sz;
+}
+
+char** GetNames(Reader& R, int* pn)
+{
+    int n = R.Count(sizeof(uint16_t));
+    *pn = n;
+    if (n == 0)
+        return NULL;
+    char** szNames = (char**)std::calloc(n, sizeof(char*));
+    for (int i = 0; i < n; i++)
+        szNames[i] = GetString(R);
+    return szNames;
+}
+
+} // namespace
+
+void EncodeBodyDefs(const sBodyDefs& Defs, uint32_t Id, std::vector<char>& Buf)
+{
+    Writer W(Buf);
+    W.Head(PKT_BODYDEFS, Id);
+    int nDefs = Defs.nBodyDefs < MAX_N_BODIES ? Defs.nBodyDefs : MAX_N_BODIES;
+    W.Put((int32_t)nDefs);
+    for (int b = 0; b < nDefs; b++)
+    {
+        const sBodyDef& B = Defs.BodyDefs[b];
+        W.Str(B.szName);
+        PutNames(W, B.szMarkerNames, B.nMarkers);
+        PutNames(W, B.Hierarchy.szSegmentNames, B.Hierarchy.nSegments);
+        W.Put(B.Hierarchy.iParents, B.Hierarchy.nSegments * sizeof(int));
+        PutNames(W, B.szDofNames, B.nDofs);
+    }
+    PutNames(W, Defs.szAnalogChannelNames, Defs.nAnalogChannels);
+    W.Put((int32_t)Defs.nForcePlates);
+    W.Put((int32_t)Defs.AnalogBitDepth);
+    int32_t bRange = Defs.AnalogLoVoltage && Defs.AnalogHiVoltage ? 1 : 0;
+    W.Put(bRange);
+    if (bRange)
+    {
+        W.Put(Defs.AnalogLoVoltage, Defs.nAnalogChannels * sizeof(float));
+        W.Put(Defs.AnalogHiVoltage, Defs.nAnalogChannels * sizeof(float));
+    }
+}
+
+sBodyDefs* DecodeBodyDefs(Reader& R)
+{
+    sBodyDefs* pDefs = (sBodyDefs*)std::calloc(1, sizeof(sBodyDefs));
+    sBodyDefs& Defs = *pDefs;
+    int nDefs = R.Count(0);
+    Defs.nBodyDefs = nDefs < MAX_N_BODIES ? nDefs : MAX_N_BODIES;
+    for (int b = 0; b < Defs.nBodyDefs && R.Ok(); b++)
+    {
+        sBodyDef& B = Defs.BodyDefs[b];
+        B.szName = GetString(R);
+        B.szMarkerNames = GetNames(R, &B.nMarkers);
+        B.Hierarchy.szSegmentNames = GetNames(R, &B.Hierarchy.nSegments);
+        if (B.Hierarchy.nSegments > 0)
+        {
+            B.Hierarchy.iParents = (int*)std::calloc(B.Hierarchy.nSegments, sizeof(int));
+            R.Get(B.Hierarchy.iParents, B.Hierarchy.nSegments * sizeof(int));
+        }
+        B.szDofNames = GetNames(R, &B.nDofs);
+    }
+    Defs.szAnalogChannelNames = GetNames(R, &Defs.nAnalogChannels);
+    int32_t i32 = 0;
+    R.Get(i32); Defs.nForcePlates = i32;
+    R.Get(i32); Defs.AnalogBitDepth = i32;
+    int32_t bRange = 0;
+    R.Get(bRange);
+    if (bRange && Defs.nAnalogChannels > 0)
+    {
+        Defs.AnalogLoVoltage = (float*)std::calloc(Defs.nAnalogChannels, sizeof(float));
+        Defs.AnalogHiVoltage = (float*)std::calloc(Defs.nAnalogChannels, sizeof(float));
+        R.Get(Defs.AnalogLoVoltage, Defs.nAnalogChannels * sizeof(float));
+        R.Get(Defs.AnalogHiVoltage, Defs.nAnalogChannels * sizeof(float));
+    }
+    return pDefs;
+}
+
+} // namespace CortexWire
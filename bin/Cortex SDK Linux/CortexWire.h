@@ -0,0 +1,129 @@
+/*=========================================================
+//
+// File: CortexWire.h
+//
+// Packet layout used by the Linux SDK2 client and the stand-in host.
+//
+//----------------------------------------------------------
+// All values are little endian. Every datagram starts with
+//
+//   uint32 Magic ('CXS2'), uint16 Version, uint16 Type, uint32 Id
+//
+// followed by the payload of its type:
+//
+//   PKT_FRAME         one sFrameOfData (EncodeFrame), multicast
+//   PKT_REQUEST       string command                  client -> host
+//   PKT_REPLY         int32 ReturnCode, uint32 nBytes, bytes
+//   PKT_SKY           int32 msTimeout, string command client -> host
+//   PKT_SKY_REPLY     int32 ReturnCode, int32 ReturnType, 2048 bytes data
+//   PKT_BODYDEFS      sBodyDefs (EncodeBodyDefs), reply to "GetBodyDefs"
+//
+// Strings are uint16 length then the characters. Replies carry the Id
+// of their request. A frame must fit in one datagram (64 kB).
+=============================================================================*/
+
+#ifndef CortexWire_H
+#define CortexWire_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "MatlabCortex.h"
+
+namespace CortexWire
+{
+
+enum
+{
+    MAGIC = 0x32535843, // "CXS2"
+    VERSION = 1,
+    MAX_PACKET = 65507
+};
+
+enum PacketType
+{
+    PKT_FRAME = 1,
+    PKT_REQUEST,
+    PKT_REPLY,
+    PKT_SKY,
+    PKT_SKY_REPLY,
+    PKT_BODYDEFS
+};
+
+struct Header
+{
+    uint32_t Magic;
+    uint16_t Version;
+    uint16_t Type;
+    uint32_t Id;
+};
+
+/** Appends values to a packet */
+class Writer
+{
+public:
+    explicit Writer(std::vector<char>& Buf) : m_Buf(Buf) { m_Buf.clear(); }
+
+    void Head(PacketType Type, uint32_t Id);
+    void Put(const void* p, size_t n);
+    template <typename T> void Put(T x) { Put(&x, sizeof(x)); }
+    void Str(const char* sz);
+
+private:
+    std::vector<char>& m_Buf;
+};
+
+/** Reads values from a packet, failing softly past the end */
+class Reader
+{
+public:
+    Reader(const char* p, size_t n) : m_p(p), m_End(p + n), m_bOk(true) {}
+
+    bool Head(Header& H);
+    bool Get(void* p, size_t n);
+    template <typename T> bool Get(T& x) { return Get(&x, sizeof(x)); }
+    bool Str(std::string& s);
+    bool Str(char* sz, size_t nMax);
+    int32_t Count(size_t ElementSize); //!< a count, checked against what is left
+    bool Ok() const { return m_bOk; }
+
+private:
+    const char* m_p;
+    const char* m_End;
+    bool m_bOk;
+};
+
+/** Storage behind one decoded frame, reused from frame to frame
+ *
+ *  Frame's pointers point into the vectors below, which only ever grow,
+ *  so decoding a frame of the usual size does not allocate.
+ */
+struct FrameBuffer
+{
+    FrameBuffer();
+
+    sFrameOfData Frame;
+    double RxTime; //!< kernel receive time (s, CLOCK_REALTIME)
+
+    std::vector<float> Markers[MAX_N_BODIES];
+    std::vector<double> Segments[MAX_N_BODIES];
+    std::vector<double> Dofs[MAX_N_BODIES];
+    std::vector<std::string> EventNames[MAX_N_BODIES];
+    std::vector<char*> Events[MAX_N_BODIES];
+    std::vector<float> Unidentified;
+    std::vector<short> Analog;
+    std::vector<float> Forces;
+    std::vector<double> Encoders;
+};
+
+void EncodeFrame(const sFrameOfData& f, uint32_t Id, std::vector<char>& Buf);
+bool DecodeFrame(Reader& R, FrameBuffer& B);
+
+void EncodeBodyDefs(const sBodyDefs& Defs, uint32_t Id, std::vector<char>& Buf);
+/** Allocates with malloc, for Cortex_FreeBodyDefs */
+sBodyDefs* DecodeBodyDefs(Reader& R);
+
+} // namespace CortexWire
+
+#endif
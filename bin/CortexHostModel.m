@@ -0,0 +1,109 @@
+function [Host, f, Arrival] = CortexHostModel(Action, Host, varargin)
+% Simulated Cortex host for offline trials, the counterpart of
+% CortexHostStandIn in MATLAB: turns a WalkerModel measurement into the
+% frame mGetCurrentFrame would return and decides when, and whether, the
+% frame reaches the control loop
+%
+% Host = CortexHostModel('Init', [], FrameRate, Rand)
+%   Rand is the RandStream for delays and drops; Host.Params may be
+%   changed after 'Init' (see below)
+% [~, BodyDefs] = CortexHostModel('BodyDefs', Host)
+%   the body definitions mGetBodyDefs would return: one body, Pelvis,
+%   with markers LASI, RASI, LPSI and RPSI
+% [Host, f, Arrival] = CortexHostModel('Frame', Host, Meas, Capture)
+%   frame of Meas, captured at virtual time Capture (s); f is [] for a
+%   lost frame, else Arrival is the virtual time it reaches the loop.
+%   Frames arrive in order
+%
+% f holds iFrame, fDelay and AnalogData.AnalogSamples (16 bit counts of
+% F1Y, F1Z, F2Y, F2Z on channels 4, 5, 11, 12) and AnalogData.Forces
+% (plate 1 and 2 samples interleaved, CoP y in row 3, CoP x in row 4),
+% as SelfPaceTM reads them, and the pelvis markers (mm) in
+% BodyData(1).Markers: Meas.Pos along y, less MarkerOrigin, with the
+% ASIS ahead of the PSIS, and XEMPTY for a marker that drops out
+
+switch Action
+
+    case 'Init'
+        Host = struct();
+        Host.FrameRate = varargin{1};
+        Host.Rand = varargin{2};
+        Host.Params.Delay = 0.003; % camera to host send (s), as the stand-in
+        Host.Params.Jitter = 0.0005; % std of network delay (s)
+        Host.Params.DropRate = 0; % fraction of frames lost
+        Host.Params.BurstLength = 1; % mean frames per loss
+        Host.Params.Drift = [0 0 0 0]; % zero drift of F1Y F1Z F2Y F2Z (N/min)
+        Host.Params.MarkerOrigin = 0.5; % treadmill CoP y of the markers' y = 0 (m)
+        Host.Params.MarkerNoise = 0.001; % std of marker position (m)
+        Host.Params.MarkerDropRate = 0; % fraction of frames each marker is missing
+        Host.iFrame = 0;
+        Host.Dropping = false;
+        Host.LastArrival = -Inf;
+
+    case 'BodyDefs'
+        f.nBodyDefs = 1;
+        f.Body(1).szName = 'Pelvis';
+        f.Body(1).nMarkers = 4;
+        f.Body(1).szMarkerNames = {'LASI','RASI','LPSI','RPSI'};
+
+    case 'Frame'
+        Meas = varargin{1};
+        Capture = varargin{2};
+        P = Host.Params;
+        Host.iFrame = Host.iFrame + 1;
+        f = [];
+        Arrival = NaN;
+
+        % losses come in bursts of BurstLength frames on average
+        if Host.Dropping
+            Host.Dropping = rand(Host.Rand) > 1 / P.BurstLength;
+        else
+            Host.Dropping = P.DropRate > 0 && ...
+                rand(Host.Rand) < P.DropRate / P.BurstLength;
+        end
+        Jitter = abs(P.Jitter * randn(Host.Rand));
+        if Host.Dropping
+            return
+        end
+        Arrival = max(Capture + P.Delay + Jitter, Host.LastArrival);
+        Host.LastArrival = Arrival;
+
+        % forces back to counts, the inverse of LoadScale(bits2volts()),
+        % with the plates' zero drifted since the start
+        Volts = 10 / 2^16; % per count
+        Drift = P.Drift * Capture / 60;
+        n = length(Meas.F1Z);
+        Samples = zeros(12, n);
+        Samples(4,:) = Counts((Meas.F1Y + Drift(1)) / 500 / Volts);
+        Samples(5,:) = Counts((Meas.F1Z + Drift(2)) / 1000 / Volts);
+        Samples(11,:) = Counts((Meas.F2Y + Drift(3)) / 500 / Volts);
+        Samples(12,:) = Counts((Meas.F2Z + Drift(4)) / 1000 / Volts);
+        Forces = zeros(7, 2 * n);
+        Forces(3, 1:2:end) = Meas.CoP1y;
+        Forces(3, 2:2:end) = Meas.CoP2y;
+
+        % pelvis markers, the ASIS 0.1 m ahead of the body and the PSIS behind
+        Markers = [-0.12 0.1 0.95; 0.12 0.1 0.95; -0.06 -0.1 1; 0.06 -0.1 1];
+        Markers(:,2) = Markers(:,2) + Meas.Pos - P.MarkerOrigin ...
+            + P.MarkerNoise * randn(Host.Rand, 4, 1);
+        Markers = 1000 * Markers;
+        if P.MarkerDropRate > 0
+            Markers(rand(Host.Rand, 4, 1) < P.MarkerDropRate, :) = 9999999; % XEMPTY
+        end
+
+        f.iFrame = Host.iFrame;
+        f.fDelay = P.Delay;
+        f.AnalogData.AnalogSamples = Samples;
+        f.AnalogData.Forces = Forces;
+        f.nBodies = 1;
+        f.BodyData(1).Markers = Markers;
+
+end
+
+end
+
+function [c] = Counts(x)
+% 16 bit converter counts, saturated
+c = min(max(round(x), -2^15), 2^15 - 1);
+
+end
@@ -0,0 +1,43 @@
+function [Out] = CortexMetrics(Action, varargin)
+% Live loop health from CortexEngine.dll for a Prometheus dashboard:
+% frames, drops, frame intervals, loop latency, commands, speed and Fp,
+% served at http://<this PC>:Port/metrics while a trial runs
+%
+% CortexMetrics('Start', Port)            after CortexSky('Start')
+% CortexMetrics('Loop', Frame, Commanded) once per new frame, when the
+%                                         loop is done with it
+% CortexMetrics('Stop')
+%
+% Speed and Fp come from CortexRelay('State', ...). 'Loop' returns at
+% once unless the metrics were started here
+
+persistent On
+Lib = 'CortexEngine';
+Out = [];
+switch Action
+
+    case 'Loop'
+        if isempty(On) || ~On
+            return
+        end
+        calllib(Lib, 'CortexEngine_MetricsLoop', varargin{1}, double(varargin{2}));
+
+    case 'Start'
+        if ~libisloaded(Lib)
+            return
+        end
+        Out = calllib(Lib, 'CortexEngine_MetricsStart', varargin{1});
+        On = Out == 0;
+        if ~On
+            fprintf('Metrics not served, port %d in use? \n', varargin{1});
+        end
+
+    case 'Stop'
+        On = false;
+        if libisloaded(Lib)
+            Out = calllib(Lib, 'CortexEngine_MetricsStop');
+        end
+
+end
+
+end
@@ -0,0 +1,102 @@
+function [Out] = CortexMonitor(Action, varargin)
+% Quality of the analog channels from CortexEngine.dll: rail hits, stuck
+% (flat-lined) channels, spikes and RMS noise, checked on every sample
+% as the frames arrive and rolled up per second and per trial
+%
+% CortexMonitor('Start', Settings)     after CortexSky('Start')
+%   Settings.MonitorChannels    channels to alert on (1 based, default
+%                               the treadmill force channels 4 5 11 12)
+%   Settings.MonitorRailMargin  rail hit this close to the rails (bits, 16)
+%   Settings.MonitorStuck       identical samples in a row (100)
+%   Settings.MonitorSpike       jump between samples (bits, 3000)
+%   Settings.MonitorNoise       RMS noise (bits, 40)
+%   Settings.Monitor = false leaves it off
+% Alerts = CortexMonitor('Check', Time) every iteration; asks the engine
+%   at most once per second of Time (s) and prints the alerts raised
+%   since; Alerts has SIGNAL_ bits (rail 1, stuck 2, spike 4, noise 8)
+%   per channel, [] between checks
+% Stats = CortexMonitor('Stats', Scope) Scope 'Second' (the last one) or
+%   'Trial': Samples, Rail, Stuck, Spikes, NoiseRms and Alerts, one row
+%   per channel
+% Stats = CortexMonitor('Summary')      the trial's Stats, then stops
+% CortexMonitor('Stop')
+
+persistent On LastCheck
+Lib = 'CortexEngine';
+MaxChannels = 64;
+Kinds = {'rail', 'stuck', 'spike', 'noise'};
+Out = [];
+switch Action
+
+    case 'Check'
+        if isempty(On) || ~On || varargin{1} < LastCheck + 1
+            return
+        end
+        LastCheck = varargin{1};
+        [n, Out] = calllib(Lib, 'CortexEngine_MonitorAlerts', ...
+            zeros(MaxChannels, 1, 'int32'), MaxChannels);
+        Out = double(Out);
+        if n > 0
+            for c = find(Out)'
+                fprintf('Analog channel %d: %s \n', c, ...
+                    strjoin(Kinds(bitand(Out(c), [1 2 4 8]) > 0), ', '));
+            end
+        end
+
+    case 'Start'
+        S = varargin{1};
+        On = false;
+        if ~libisloaded(Lib) || (isfield(S, 'Monitor') && ~S.Monitor)
+            return
+        end
+        Channels = [];
+        if isfield(S, 'MonitorChannels')
+            Channels = int32(S.MonitorChannels(:) - 1);
+        end
+        Limits = [0 0 0 0];
+        Names = {'MonitorRailMargin', 'MonitorStuck', 'MonitorSpike', 'MonitorNoise'};
+        for i = 1:4
+            if isfield(S, Names{i})
+                Limits(i) = S.(Names{i});
+            end
+        end
+        Out = calllib(Lib, 'CortexEngine_MonitorStart', Channels, ...
+            numel(Channels), Limits(1), Limits(2), Limits(3), Limits(4));
+        On = Out == 0;
+        LastCheck = -Inf;
+
+    case {'Stats', 'Summary'}
+        if isempty(On) || ~On
+            return
+        end
+        Scope = 1;
+        if strcmp(Action, 'Stats') && strcmp(varargin{1}, 'Second')
+            Scope = 0;
+        end
+        [n, X] = calllib(Lib, 'CortexEngine_MonitorStats', Scope, ...
+            zeros(MaxChannels, 6), MaxChannels);
+        n = min(n, MaxChannels);
+        if n < 0
+            return
+        end
+        Fields = {'Samples', 'Rail', 'Stuck', 'Spikes', 'NoiseRms', 'Alerts'};
+        for j = 1:length(Fields)
+            Out.(Fields{j}) = X(1:n, j);
+        end
+        if strcmp(Action, 'Summary')
+            for c = find(Out.Alerts)'
+                fprintf('Analog channel %d had %s alerts \n', c, ...
+                    strjoin(Kinds(bitand(Out.Alerts(c), [1 2 4 8]) > 0), ', '));
+            end
+            CortexMonitor('Stop');
+        end
+
+    case 'Stop'
+        On = false;
+        if libisloaded(Lib)
+            Out = calllib(Lib, 'CortexEngine_MonitorStop');
+        end
+
+end
+
+end
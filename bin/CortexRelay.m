@@ -0,0 +1,48 @@
+function [Out] = CortexRelay(Action, varargin)
+% SDK2 relay of Cortex frames with treadmill channels, via CortexEngine.dll
+% Other lab tools connect to this host as SDK2 clients and receive each
+% frame with scaled forces, CoPs, stance flags, commanded speed and the
+% latest Fp appended as extra analog channels (see CortexEngine ReadMe)
+%
+% CortexRelay('Enable')              before mCortexInitialize
+% CortexRelay('Start')               after CortexSky('Load')
+% CortexRelay('State', Speed, Fp)    controller state for the next frames
+% Stats = CortexRelay('Stats')
+% CortexRelay('Stop')
+
+Lib = 'CortexEngine';
+Out = [];
+if ~libisloaded(Lib)
+    return
+end
+switch Action
+
+    case 'Enable'
+        Out = calllib(Lib, 'CortexEngine_RelayEnable');
+
+    case 'Start'
+        Out = calllib(Lib, 'CortexEngine_RelayStart');
+        if Out ~= 0
+            disp('SDK2 relay not started, enable client communication first');
+        end
+
+    case 'State'
+        Fp = varargin{2};
+        if isempty(Fp) || isnan(Fp)
+            Fp = 0;
+        end
+        Out = calllib(Lib, 'CortexEngine_RelaySetState', varargin{1}, Fp);
+
+    case 'Stats'
+        [Code, Out.Forwarded, Out.Repeated, Out.Failed, Out.MeanMicros, ...
+            Out.MaxMicros] = calllib(Lib, 'CortexEngine_RelayStats', 0, 0, 0, 0, 0);
+        if Code ~= 0
+            Out = [];
+        end
+
+    case 'Stop'
+        Out = calllib(Lib, 'CortexEngine_RelayStop');
+
+end
+
+end
@@ -0,0 +1,83 @@
+function [Ring, Frames] = CortexRing(Action, varargin)
+% Every Cortex frame for MATLAB loops slower than the camera, via
+% CortexEngine.dll. The engine keeps the last frames; 'Drain' copies the
+% selected channels and markers of all frames since the previous call in
+% one calllib
+%
+% CortexRing('Start')                 after CortexSky('Start')
+% CortexRing('Start', nSlots)         frames kept (default 1024)
+% Seq = CortexRing('Wait', Seq, Timeout)
+%   sleeps until a frame after Seq arrives or Timeout (s) passes and
+%   returns the latest Seq (-1 if the ring is not running); start from 0
+% CortexRing('Spin', us)              spin this long before sleeping in
+%   'Wait' (default 0, -1 spins throughout), see CortexEngine ReadMe
+% Ring = CortexRing('Open', Channels, Markers, nMaxFrames, nMaxSamples)
+%   Channels are analog channels and Markers marker indices (over all
+%   bodies, in body order), both 1 based; buffers for nMaxFrames frames
+%   of up to nMaxSamples analog samples are allocated once here
+% [Ring, Frames] = CortexRing('Drain', Ring)
+%   Frames.Seq, .Frame, .Time (s), .nSamples     one row per frame
+%   Frames.Analog     one row per analog sample, one column per channel
+%   Frames.Markers    one row per frame, X Y Z per marker, NaN if missing
+%   Frames.Missed     frames lost since the last drain (ring overrun)
+% CortexRing('Stop')
+
+Lib = 'CortexEngine';
+Ring = [];
+Frames = [];
+if ~libisloaded(Lib)
+    return
+end
+switch Action
+
+    case 'Start'
+        nSlots = 0;
+        if ~isempty(varargin)
+            nSlots = varargin{1};
+        end
+        Ring = calllib(Lib, 'CortexEngine_RingStart', nSlots, 0, 0, 0);
+
+    case 'Wait'
+        Ring = calllib(Lib, 'CortexEngine_RingWait', varargin{1}, ...
+            round(1000 * varargin{2}));
+
+    case 'Spin'
+        Ring = calllib(Lib, 'CortexEngine_RingSetSpin', varargin{1});
+
+    case 'Open'
+        Ring.Channels = int32(varargin{1}(:)' - 1);
+        Ring.Markers = int32(varargin{2}(:)' - 1);
+        Ring.nMaxFrames = varargin{3};
+        Ring.nMaxSamples = varargin{4};
+        Ring.Info = zeros(Ring.nMaxFrames, 4);
+        Ring.Analog = zeros(Ring.nMaxFrames*Ring.nMaxSamples, numel(Ring.Channels));
+        Ring.MarkerData = zeros(Ring.nMaxFrames, 3*numel(Ring.Markers));
+        % start from the newest frame
+        Ring.Since = calllib(Lib, 'CortexEngine_RingHead');
+
+    case 'Drain'
+        Ring = varargin{1};
+        [n, ~, ~, Ring.Info, Ring.Analog, Ring.MarkerData] = calllib(Lib, ...
+            'CortexEngine_RingDrain', Ring.Since, Ring.nMaxFrames, ...
+            Ring.Channels, numel(Ring.Channels), Ring.nMaxSamples, ...
+            Ring.Markers, numel(Ring.Markers), Ring.Info, Ring.Analog, ...
+            Ring.MarkerData);
+        n = max(n, 0);
+        Frames.Seq = Ring.Info(1:n,1);
+        Frames.Frame = Ring.Info(1:n,2);
+        Frames.Time = Ring.Info(1:n,3);
+        Frames.nSamples = Ring.Info(1:n,4);
+        Frames.Analog = Ring.Analog(1:sum(Frames.nSamples),:);
+        Frames.Markers = Ring.MarkerData(1:n,:);
+        Frames.Missed = 0;
+        if n > 0
+            Frames.Missed = double(Frames.Seq(end) - double(Ring.Since)) - n;
+            Ring.Since = int64(Frames.Seq(end));
+        end
+
+    case 'Stop'
+        Ring = calllib(Lib, 'CortexEngine_RingStop');
+
+end
+
+end
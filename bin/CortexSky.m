@@ -0,0 +1,74 @@
+function [Out, Reply] = CortexSky(Action, varargin)
+% Asynchronous Cortex Sky commands and requests through CortexEngine.dll
+% Commands run on the engine's worker thread, so the control loop never
+% waits on Cortex
+%
+% CortexSky('Load')                      load CortexEngine.dll
+% CortexSky('Start')                     start the engine after mCortexInitialize
+% Ticket = CortexSky('Sky', Command, msTimeout)   queue a Sky command
+% Ticket = CortexSky('Request', Command)          queue a request
+% [Done, Code] = CortexSky('Poll', Ticket)        check a Sky command
+% [Done, Code] = CortexSky('Wait', Ticket, msTimeout)
+% [Done, Value] = CortexSky('RequestWait', Ticket, msTimeout, Type)
+%   Type is the class of the response, e.g. 'single' for frame rates
+% FrameRate = CortexSky('FrameRate')     cached for the session
+% CortexSky('Stop')                      stop the engine before mCortexExit
+% CortexSky('Unload')                    stop the engine and unload
+
+Lib = 'CortexEngine';
+Out = [];
+Reply = [];
+switch Action
+
+    case 'Load'
+        if ~libisloaded(Lib)
+            loadlibrary('CortexEngine.dll', 'CortexEngine.h');
+        end
+
+    case 'Start'
+        Out = calllib(Lib, 'CortexEngine_Initialize');
+
+    case 'Stop'
+        Out = calllib(Lib, 'CortexEngine_Exit');
+
+    case 'Sky'
+        Out = calllib(Lib, 'CortexEngine_SkySubmit', varargin{1}, varargin{2});
+
+    case 'Request'
+        Out = calllib(Lib, 'CortexEngine_RequestSubmit', varargin{1});
+
+    case 'Poll'
+        [Out, Reply] = calllib(Lib, 'CortexEngine_SkyPoll', varargin{1}, 0, []);
+
+    case 'Wait'
+        [Out, Reply] = calllib(Lib, 'CortexEngine_SkyWait', varargin{1}, ...
+            varargin{2}, 0, []);
+
+    case 'RequestWait'
+        nMax = 256;
+        Buf = libpointer('voidPtr', zeros(1, nMax, 'uint8'));
+        [Out, Code, ~, nBytes] = calllib(Lib, 'CortexEngine_RequestWait', ...
+            varargin{1}, varargin{2}, 0, Buf, nMax, 0);
+        if Out == 1 && Code == 0
+            setdatatype(Buf, 'uint8Ptr', 1, nMax);
+            Bytes = Buf.Value;
+            Reply = typecast(Bytes(1:min(nBytes, nMax)), varargin{3});
+        end
+
+    case 'FrameRate'
+        Ticket = CortexSky('Request', 'GetContextFrameRate');
+        [Done, Out] = CortexSky('RequestWait', Ticket, 1000, 'single');
+        if Done ~= 1 || isempty(Out)
+            Out = NaN;
+        end
+        Out = double(Out(1));
+
+    case 'Unload'
+        if libisloaded(Lib)
+            calllib(Lib, 'CortexEngine_Exit');
+            unloadlibrary(Lib);
+        end
+
+end
+
+end
@@ -0,0 +1,69 @@
+function [Out, Dropped] = CortexTrace(Action, varargin)
+% Per-frame pipeline tracing via CortexEngine.dll. The engine times its
+% own stages on the SDK's data thread; the control loop marks its stages
+% with 'Begin' and 'End'. Written at the end of a trial as a Chrome trace
+% (open in chrome://tracing or ui.perfetto.dev)
+%
+% CortexTrace('Start', nEvents)       spans kept per thread (0: 65536)
+% CortexTrace('Begin', Stage)         Stage: 'Wait', 'Conversion',
+% CortexTrace('End', Stage, Frame)      'Filtering', 'Gait', 'Control', 'Send'
+% CortexTrace('Stop')
+% [n, Dropped] = CortexTrace('Write', File)
+%
+% 'Begin' and 'End' return at once unless tracing was started here
+
+persistent On Stages
+Lib = 'CortexEngine';
+Out = [];
+Dropped = 0;
+switch Action
+
+    case 'Begin'
+        if isempty(On) || ~On
+            return
+        end
+        calllib(Lib, 'CortexEngine_TraceBegin', Stages.(varargin{1}));
+
+    case 'End'
+        if isempty(On) || ~On
+            return
+        end
+        calllib(Lib, 'CortexEngine_TraceEnd', Stages.(varargin{1}), varargin{2});
+
+    case 'Start'
+        if ~libisloaded(Lib)
+            return
+        end
+        % TRACE_* of CortexEngine.h
+        Stages = struct('Conversion',2, 'Filtering',3, 'Gait',4, ...
+            'Control',5, 'Send',6, 'Wait',9);
+        nEvents = 0;
+        if ~isempty(varargin)
+            nEvents = varargin{1};
+        end
+        Out = calllib(Lib, 'CortexEngine_TraceStart', nEvents);
+        On = Out == 0;
+        if On
+            calllib(Lib, 'CortexEngine_TraceThreadName', 'MATLAB');
+        end
+
+    case 'Stop'
+        On = false;
+        if libisloaded(Lib)
+            Out = calllib(Lib, 'CortexEngine_TraceStop');
+        end
+
+    case 'Write'
+        if ~libisloaded(Lib)
+            return
+        end
+        [Out, ~, Dropped] = calllib(Lib, 'CortexEngine_TraceWrite', varargin{1}, 0);
+        if Out < 0
+            fprintf('Trace not written to %s \n', varargin{1});
+        elseif Dropped > 0
+            fprintf('Trace: %d spans dropped, start with more events \n', Dropped);
+        end
+
+end
+
+end
@@ -0,0 +1,75 @@
+function [Out] = CortexTreadmill(Action, varargin)
+% Belt speed commands through the treadmill link of CortexEngine.dll: the
+% packet of TREADMILL_setSpeed sent without blocking the loop, each send
+% timed, and the link reopened in the background after a failure; falls
+% back to treadmill0x2Dremote when the link is not open
+%
+% CortexTreadmill('Open', Address, Port, Settings)   before CortexWatchdog('Start'),
+%   whose stop then goes through the link too
+%   Settings.TreadmillLink = true   opens the link; without it the commands
+%                          stay on treadmill0x2Dremote, as the link's
+%                          packet is unverified (see TreadmillPacketCheck)
+%   Settings.ControlCore   core to pin MATLAB's thread to (0 based,
+%                          default none)
+% Result = CortexTreadmill('Speed', Left, Right, Accel)   as
+%   TREADMILL_setSpeed; 21 (TREADMILL_SEND) if not sent, 20
+%   (TREADMILL_NOT_CONNECTED) while the link reconnects, 30
+%   (TREADMILL_STOPPED) for a speed other than 0 once CortexWatchdog has
+%   stopped the belt, through the link or the library
+% Stats = CortexTreadmill('Stats')   Commands, Sent, SendErrors,
+%   NotConnected, Reconnects, MeanMicros, MaxMicros, Connected, Pinned
+% Stats = CortexTreadmill('Close')   the Stats, then closes the link
+
+persistent On
+Lib = 'CortexEngine';
+Out = [];
+switch Action
+
+    case 'Speed'
+        if (varargin{1} ~= 0 || varargin{2} ~= 0) && libisloaded(Lib) ...
+                && calllib(Lib, 'CortexEngine_WatchdogTripped') == 1
+            Out = 30; % a loop that stalled after its heartbeat
+        elseif ~isempty(On) && On
+            Out = calllib(Lib, 'CortexEngine_TreadmillSetSpeed', ...
+                varargin{1}, varargin{2}, varargin{3});
+        else
+            Out = calllib('treadmill0x2Dremote', 'TREADMILL_setSpeed', ...
+                varargin{1}, varargin{2}, varargin{3});
+        end
+
+    case 'Open'
+        S = varargin{3};
+        On = false;
+        if ~libisloaded(Lib) || ~isfield(S, 'TreadmillLink') || ~S.TreadmillLink
+            return
+        end
+        Core = -1;
+        if isfield(S, 'ControlCore')
+            Core = S.ControlCore;
+        end
+        Out = calllib(Lib, 'CortexEngine_TreadmillOpen', varargin{1}, varargin{2}, Core);
+        On = Out == 0;
+        if ~On
+            fprintf('Treadmill link not opened (%d), using treadmill0x2Dremote \n', Out);
+        end
+
+    case {'Stats', 'Close'}
+        if ~libisloaded(Lib)
+            return
+        end
+        [Code, X] = calllib(Lib, 'CortexEngine_TreadmillStats', zeros(1, 9), 9);
+        if Code == 0
+            Fields = {'Commands', 'Sent', 'SendErrors', 'NotConnected', 'Reconnects', ...
+                'MeanMicros', 'MaxMicros', 'Connected', 'Pinned'};
+            for j = 1:length(Fields)
+                Out.(Fields{j}) = X(j);
+            end
+        end
+        if strcmp(Action, 'Close') && ~isempty(On) && On
+            On = false;
+            calllib(Lib, 'CortexEngine_TreadmillClose');
+        end
+
+end
+
+end
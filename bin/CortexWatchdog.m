@@ -0,0 +1,60 @@
+function [Out] = CortexWatchdog(Action, varargin)
+% Stops the belt from a thread of CortexEngine.dll when the control loop
+% or the Cortex frames stall (a breakpoint, a slow redraw, a long garbage
+% collection), instead of relying on the loop reaching its own stop
+%
+% CortexWatchdog('Start', Settings)     just before the control loop
+%   Settings.WatchdogLoop    longest loop iteration (s, default 0.5)
+%   Settings.WatchdogFrames  longest time without a frame (s, default 0.5)
+%   Settings.WatchdogAccel   acceleration of the stop (m/s^2, default 0.25)
+%   Settings.Watchdog = false leaves it off
+% Tripped = CortexWatchdog('Beat')      every iteration; true once the
+%                                       watchdog has stopped the belt
+% CortexWatchdog('Stop')                after the loop
+% Status = CortexWatchdog('Status')     Reason ('' if it never tripped),
+%                                       Time, Gap, MaxLoopGap, ...
+
+Lib = 'CortexEngine';
+Out = [];
+if ~libisloaded(Lib)
+    return
+end
+switch Action
+
+    case 'Start'
+        S = varargin{1};
+        if isfield(S, 'Watchdog') && ~S.Watchdog
+            return
+        end
+        Loop = 0.5;
+        Frames = 0.5;
+        Accel = .25;
+        if isfield(S, 'WatchdogLoop'), Loop = S.WatchdogLoop; end
+        if isfield(S, 'WatchdogFrames'), Frames = S.WatchdogFrames; end
+        if isfield(S, 'WatchdogAccel'), Accel = S.WatchdogAccel; end
+        Out = calllib(Lib, 'CortexEngine_WatchdogStart', ...
+            round(1000 * Loop), round(1000 * Frames), Accel);
+        if Out ~= 0
+            disp('Watchdog not started, load treadmill0x2Dremote first');
+        end
+
+    case 'Beat'
+        Out = calllib(Lib, 'CortexEngine_WatchdogBeat') == 1;
+
+    case 'Stop'
+        Out = calllib(Lib, 'CortexEngine_WatchdogStop');
+
+    case 'Status'
+        [Code, Reason, Out.Time, Out.Gap, Out.StopResult, Out.MaxLoopGap, ...
+            Out.MaxFrameGap, Out.MaxLateMicros] = calllib(Lib, ...
+            'CortexEngine_WatchdogStatus', 0, 0, 0, 0, 0, 0, 0);
+        if Code ~= 0
+            Out = [];
+            return
+        end
+        Reasons = {'', 'Control loop stalled', 'Cortex frames stalled'};
+        Out.Reason = Reasons{Reason + 1};
+
+end
+
+end
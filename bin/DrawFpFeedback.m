@@ -0,0 +1,41 @@
+function DrawFpFeedback(Fig, Settings, MeanPeakFp, ElapsedTime, Label, TargetWidth)
+% Draw the Fp biofeedback bar against the target Fp
+% Green when within 5% of Settings.TargetFp, red otherwise
+% Label starts the title, followed by the minutes elapsed (up to 4)
+% TargetWidth is the target line's width (default 4, as the bar)
+
+if nargin < 6
+    TargetWidth = 4;
+end
+
+set(0,'CurrentFigure',Fig);
+x = [0 1 2];
+y1 = [Settings.TargetFp Settings.TargetFp  Settings.TargetFp];
+y2 = [MeanPeakFp MeanPeakFp MeanPeakFp];
+if abs(1 - MeanPeakFp / Settings.TargetFp) > 0.05
+    Color = '-r';
+else
+    Color = '-g';
+end
+plot(x, y1, '-k', 'LineWidth', TargetWidth);
+hold on;
+plot(x, y2, Color, 'LineWidth', 4);
+hold off;
+
+% update title based on minutes completed
+Minutes = min(floor(ElapsedTime / 60), 4);
+if Minutes < 1
+    TitleStr = Label;
+else
+    TitleStr = [Label, ' - ', num2str(Minutes), ' min elapsed'];
+end
+title(TitleStr);
+
+ax = gca; % edit axes
+ax.XTick = [];
+ax.YTick = [];
+Lo = Settings.NormFp * 0.5;
+Hi = Settings.NormFp * 1.5;
+ax.YLim = [Lo Hi];
+
+end
@@ -0,0 +1,61 @@
+function [Fill] = FillFrameGap(Prev, Next, Gap, FrameRate, Contact)
+% Linearly interpolate rows for frames missing between two saved frames
+% Prev is the last saved row of the trial data structure
+% Next holds the converted forces and CoPs of the frame after the gap
+% Gap is the number of missing frames
+% Contact is the loop's ContactDetect state after Prev; a copy of it
+% classifies the interpolated samples, so the stance flags follow the
+% same thresholds and hysteresis as the frames around the gap. The
+% loop's own detector is not advanced
+% Filled rows are flagged with Interp = 1; the body position, velocity
+% and marker position, which only the controller measures, are NaN
+
+Fill = repmat(Prev, 1, Gap);
+nSamples = length(Prev.F1Z);
+
+% interpolate sample-wise across the gap, from the last sample of the
+% previous frame to the first sample of the next one
+w = (1:Gap*nSamples) ./ (Gap*nSamples + 1);
+Forces = {'F1Y','F1Z','F2Y','F2Z'};
+for j = 1:length(Forces)
+    a = Prev.(Forces{j})(end);
+    b = Next.(Forces{j})(1);
+    Samples = reshape(a + w .* (b - a), nSamples, Gap)';
+    for i = 1:Gap
+        Fill(i).(Forces{j}) = Samples(i,:);
+    end
+end
+
+% interpolate frame-wise values
+CoPs = {'CoP1y','CoP2y','CoP1x','CoP2x'};
+for i = 1:Gap
+    r = i / (Gap + 1);
+    for j = 1:length(CoPs)
+        Fill(i).(CoPs{j}) = Prev.(CoPs{j}) + r * (Next.(CoPs{j}) - Prev.(CoPs{j}));
+    end
+    Fill(i).Frame = Prev.Frame + i;
+    Fill(i).Time = Prev.Time + i / FrameRate;
+    if isfield(Fill, 'FrameTime')
+        Fill(i).FrameTime = Prev.FrameTime + i / FrameRate;
+    end
+    if isfield(Fill, 'CmdTime')
+        Fill(i).CmdTime = [];
+    end
+    Contact = ContactDetect('Frame', Contact, [Fill(i).F1Z; Fill(i).F2Z], ...
+        Prev.FrameTime + i / FrameRate);
+    Fill(i).RightOn = double(Contact.On(1));
+    Fill(i).LeftOn = double(Contact.On(2));
+    if isfield(Fill, 'CoPy')
+        Fill(i).CoPy = [];
+    end
+    Unmeasured = {'BodyPos','BodyVel','MarkerPos'};
+    for j = find(isfield(Fill, Unmeasured))
+        Fill(i).(Unmeasured{j}) = NaN;
+    end
+    Fill(i).Fp = [];
+    Fill(i).MeanPeakFp = [];
+    Fill(i).Gap = 0;
+    Fill(i).Interp = 1;
+end
+
+end
@@ -1,4 +1,4 @@
-function [Data] = FixedSpeedTM(Settings)
+function [Data, Summary] = FixedSpeedTM(Settings)
 
 %% Define IP addresses
 % IP.Talk2HostNic = '10.1.1.192'; %Cortex computer top port
@@ -29,6 +29,11 @@ initializeStruct.TalkToClientsNicCardAddress = '0';
 initializeStruct.ClientsMulticastAddress = '225.1.1.2';
 
 % Load the SDK libraries
+UseEngine = libisloaded('CortexEngine');
+if UseEngine
+    CortexSky('Stop'); % engine follows the Cortex connection
+    CortexRelay('Enable'); % SDK2 clients, set before initializing
+end
 r = mCortexExit();
 returnValue = mCortexInitialize(initializeStruct);
 if returnValue ~= 0
@@ -36,12 +41,46 @@ if returnValue ~= 0
 else
     disp('Connected to Cortex'); 
 end
+if UseEngine
+    CortexSky('Start');
+    CortexRelay('Start');
+    CortexRing('Start', 64); % wakes the loop when a frame arrives
+    if isfield(Settings, 'FrameWaitSpin')
+        CortexRing('Spin', Settings.FrameWaitSpin);
+    end
+    if isfield(Settings, 'TraceFile') % stage timings, see CortexTrace
+        CortexTrace('Start');
+    end
+    if isfield(Settings, 'MetricsPort') % live dashboard, see CortexMetrics
+        CortexMetrics('Start', Settings.MetricsPort);
+    end
+    CortexMonitor('Start', Settings); % clipped, stuck or noisy analog channels
+end
 
 %% Initialize data structure and figures
+% frame gap repair
+if ~isfield(Settings, 'FillGaps')
+    Settings.FillGaps = 'No';
+end
+MaxFillGap = 5; % longest gap (frames) to fill by interpolation
+
 Frame = 1;
 k = 0;
+Integ = []; % frame integrity record
 
-L = Settings.FrameRate .* Settings.Duration; 
+% the last WindowSeconds of rows stay in memory; every row goes to the
+% trial log as it completes (see TrialLog)
+Window = 30;
+if isfield(Settings, 'WindowSeconds')
+    Window = Settings.WindowSeconds;
+end
+Keep = ceil(Window * Settings.FrameRate);
+L = 2 * Keep + MaxFillGap + 1; 
+if ~isfield(Settings, 'LogFile')
+    Settings.LogFile = fullfile(tempdir, ['TrialLog_' datestr(now, 'yyyymmdd_HHMMSS') '.bin']);
+end
+Log = TrialLog('Open', [], Settings.LogFile);
+fprintf('Trial log: %s \n', Settings.LogFile);
 Data = struct([]); 
 % Data(L).AnalogForces = [];
 Data(L).Frame = [];
@@ -59,6 +98,9 @@ Data(L).Time = [];
 Data(L).Speed = [];
 Data(L).Fp = [];
 Data(L).MeanPeakFp = [];
+Data(L).Gap = [];
+Data(L).Interp = [];
+Data(L).FrameTime = [];
 
 StopFig = figure(1);
 uicontrol(StopFig, 'Style', 'PushButton', 'String', 'Exit Figure to Stop', ...
@@ -67,30 +109,117 @@ uicontrol(StopFig, 'Style', 'PushButton', 'String', 'Exit Figure to Stop', ...
 FeedbackFig = figure(2);
 set(FeedbackFig, 'Position',[1000 100 800 550]); % create biofeedback figure
 
+% per-step gait events; Fp feedback redraws once per completed stance
+% and the stance force curves are averaged as they complete
+Steps = StepEvents('Init', 3 * Settings.FrameRate); % stances up to 3 s
+Contact = ContactDetect('Init', Settings.FrameRate); % 25 N on, 15 N off
+if isfield(Settings, 'ContactThresh') % [on off] (N)
+    Contact = ContactDetect('Init', Settings.FrameRate, ...
+        Settings.ContactThresh(1), Settings.ContactThresh(2));
+end
+Zero = PlateZero('Init', Settings.FrameRate, Settings); % follows plate drift
+Steps.MaxLog = 100; % older stances are in the trial log
+Phases = 0;
+if isfield(Settings, 'EnsemblePhases') % phase start times (s)
+    Phases = Settings.EnsemblePhases;
+end
+Ens = StanceEnsemble('Init', [], 101, Phases);
+if strcmp(Settings.Biofeedback, 'Fp')
+    Steps = StepEvents('Subscribe', Steps, 'Stance', ...
+        @(Event, Steps) DrawFpFeedback(FeedbackFig, Settings, ...
+        Steps.MeanPeakFp, Event.Time, 'Fixed Speed', 2));
+end
+
 disp('Starting Trial');
 tic; % start timer
-startTime = datevec(now); % create elapsed timer
+Clock = TrialClock('Init', [], Settings.FrameRate); % trial timeline
+
+% queue Cortex commands (e.g. start recording) without waiting on Cortex
+% and carry the controller state on frames relayed to SDK2 clients
+Sky = struct('Command',{}, 'Ticket',{}, 'Code',{});
+if UseEngine
+    CortexRelay('State', currentSpeed, NaN);
+end
+if UseEngine && isfield(Settings, 'SkyStart')
+    Sky(end+1).Command = Settings.SkyStart;
+    Sky(end).Ticket = CortexSky('Sky', Settings.SkyStart, 1000);
+end
+
+% stop the belt from the engine if this loop or the frames stall
+if UseEngine
+    CortexWatchdog('Start', Settings);
+end
+Seq = 0; % latest frame seen in the engine's ring
 
 %% Fixed Speed Treadmill Controller Loop
 % stops with button click
 while isempty(StopFig) == 0
     drawnow;
+    if UseEngine
+        CortexTrace('Begin', 'Wait');
+        Seq = CortexRing('Wait', Seq, .02); % sleep until the next frame
+        CortexTrace('End', 'Wait', Frame);
+    end
     f = mGetCurrentFrame();
     timer = toc;   
+    if UseEngine && CortexWatchdog('Beat')
+        close(StopFig);
+        disp('Watchdog stopped the treadmill');
+        break
+    end
+    if UseEngine
+        CortexMonitor('Check', timer); % prints analog alerts once a second
+    end
     
-    if f.iFrame>Frame
-        k = k+1;
+    %% check frame sequence
+    if f.iFrame ~= Frame && f.iFrame > 0
         Frame = f.iFrame;
+        [Integ, FrameStatus] = FrameIntegrity(Integ, f);
+    else
+        FrameStatus = 'Old';
+    end
+    NewStance = 0;
+    
+    if strcmp(FrameStatus, 'New')
+        
+        % extract analog forces, less the plates' drifting zero (PlateZero)
+        CortexTrace('Begin', 'Conversion');
+        [Zero, F] = PlateZero('Convert', Zero, f.AnalogData.AnalogSamples);
+        F1y = F(1,:);
+        F1z = F(2,:);
+        F2y = F(3,:);
+        F2z = F(4,:);
         
-        % extract analog forces
-        F1Y = f.AnalogData.AnalogSamples(4,:);
-        F1y = LoadScale('Fy', bits2volts(F1Y));
-        F1Z = f.AnalogData.AnalogSamples(5,:);
-        F1z = LoadScale('Fz', bits2volts(F1Z));
-        F2Y = f.AnalogData.AnalogSamples(11,:);
-        F2y = LoadScale('Fy', bits2volts(F2Y));
-        F2Z = f.AnalogData.AnalogSamples(12,:);
-        F2z = LoadScale('Fz', bits2volts(F2Z));
+        % calculate CoPs
+        CoP1y = mean(f.AnalogData.Forces(3,1:2:end));
+        CoP2y = mean(f.AnalogData.Forces(3,2:2:end));
+        CoP1x = mean(f.AnalogData.Forces(4,1:2:end));
+        CoP2x = mean(f.AnalogData.Forces(4,2:2:end));
+        CortexTrace('End', 'Conversion', Frame);
+        
+        %% roll the window: keep the last Keep rows, the log has the rest
+        if k + MaxFillGap + 1 > L
+            Data(1:Keep) = Data(k-Keep+1:k);
+            k = Keep;
+        end
+        
+        %% repair short gaps in the frame sequence
+        if Integ.Gap > 0 && k > 0 && strcmp(Settings.FillGaps, 'Yes') ...
+                && Integ.Gap <= MaxFillGap
+            Next = struct('F1Y',F1y, 'F1Z',F1z, 'F2Y',F2y, 'F2Z',F2z, ...
+                'CoP1y',CoP1y, 'CoP2y',CoP2y, 'CoP1x',CoP1x, 'CoP2x',CoP2x);
+            Data(k+1:k+Integ.Gap) = FillFrameGap(Data(k), Next, Integ.Gap, ...
+                Settings.FrameRate, Contact);
+            for i = k+1:k+Integ.Gap
+                Log = TrialLog('Row', Log, Data(i));
+            end
+            k = k + Integ.Gap;
+            Integ.Filled = Integ.Filled + Integ.Gap;
+        end
+        k = k+1;
+        
+        % place frame on the trial timeline
+        [Clock, Data(k).FrameTime] = TrialClock('Frame', Clock, f);
         
         %% Save Treadmill data in structure
         % save force data in structure
@@ -106,74 +235,55 @@ while isempty(StopFig) == 0
         Data(k).F2Z = F2z;
         
         % save CoPs
-        Data(k).CoP1y = mean(f.AnalogData.Forces(3,1:2:end));
-        Data(k).CoP2y = mean(f.AnalogData.Forces(3,2:2:end));
-        Data(k).CoP1x = mean(f.AnalogData.Forces(4,1:2:end));
-        Data(k).CoP2x = mean(f.AnalogData.Forces(4,2:2:end));
+        Data(k).CoP1y = CoP1y;
+        Data(k).CoP2y = CoP2y;
+        Data(k).CoP1x = CoP1x;
+        Data(k).CoP2x = CoP2x;
+        
+        % flag frames preceded by missing frames
+        Data(k).Gap = Integ.Gap;
+        Data(k).Interp = 0;
         
         % save whether time point is swing or stance for left and right
-        Thresh = 25; % threshold for determining if a true vGRF
-        if mean(Data(k).F1Z) > Thresh
-            Data(k).RightOn = 1;
-        else
-            Data(k).RightOn = 0;
+        CortexTrace('Begin', 'Gait');
+        % on every analog sample, with hysteresis (see ContactDetect)
+        Contact = ContactDetect('Frame', Contact, [Data(k).F1Z; Data(k).F2Z], ...
+            Data(k).FrameTime);
+        Data(k).RightOn = double(Contact.On(1));
+        Data(k).LeftOn = double(Contact.On(2));
+        Zero = PlateZero('Swing', Zero, Contact); % re-zero unloaded plates
+        
+        % publish heel strikes, toe-offs and completed stances, timed to
+        % the sample crossings
+        [Steps, NewSteps] = StepEvents('Frame', Steps, Data(k), Data(k).FrameTime, Contact);
+        NewStance = any(strcmp({NewSteps.Type}, 'Stance'));
+        Data(k).Fp = []; % peak Fp (N) of a stance ending on this frame
+        if NewStance
+            Fp = [];
+            for Event = NewSteps(strcmp({NewSteps.Type}, 'Stance'))
+                Ens = StanceEnsemble('Stance', Ens, Steps, Event.Side);
+                Log = TrialLog('Stance', Log, Steps.Latest.(Event.Side));
+                Fp(end+1) = Steps.Latest.(Event.Side).Fp; %#ok<AGROW>
+            end
+            Data(k).Fp = mean(Fp);
         end
-        if mean(Data(k).F2Z) > Thresh
-            Data(k).LeftOn = 1;
-        else
-            Data(k).LeftOn = 0;
+        Data(k).MeanPeakFp = Steps.MeanPeakFp;
+        CortexTrace('End', 'Gait', Frame);
+        if UseEngine && NewStance
+            CortexRelay('State', currentSpeed, Steps.MeanPeakFp);
         end
+        CortexMetrics('Loop', Frame, false);
         
         %% Get current time
-        currTime = datevec(now);
-        ElapsedTime = etime(currTime, startTime);
+        [~, ElapsedTime] = TrialClock('Local', Clock);
         Data(k).Time = ElapsedTime; 
+        Log = TrialLog('Row', Log, Data(k));
         
     end
     
     %% Fp Biofeedback if desired
-    if strcmp(Settings.Biofeedback, 'Fp') && length(Data) > 200
-        
-        % find peak propulsive force from previous step
-        [Fp] = FindPrevFp(Data);
-        MeanPeakFp = mean([Fp.LyPeak, Fp.RyPeak]);
-        Data(k).Fp = Fp;
-        Data(k).MeanPeakFp = MeanPeakFp;
-        
-        % plot biofeedback
-        set(0,'CurrentFigure',FeedbackFig)
-        
-        plot([0 1 2] ,[Settings.TargetFp Settings.TargetFp  Settings.TargetFp],...
-            '-k', 'LineWidth',2);
-        hold on;
-        L = plot([0 1 2],[MeanPeakFp MeanPeakFp MeanPeakFp],...
-            '-k', 'LineWidth',4);
-        if abs(1 - MeanPeakFp / Settings.TargetFp) > 0.05
-            L.Color = 'r';
-        else
-            L.Color = 'g';
-        end
-        hold off;
-        
-        if ElapsedTime < 60
-            TitleStr = 'Fixed Speed';
-        elseif ElapsedTime >= 60 && ElapsedTime < 120
-            TitleStr = 'Fixed Speed - 1 min elapsed';
-        elseif ElapsedTime >= 120 && ElapsedTime < 180
-            TitleStr = 'Fixed Speed - 2 min elapsed';
-        elseif ElapsedTime >= 180 && ElapsedTime < 240
-            TitleStr = 'Fixed Speed - 3 min elapsed';
-        elseif ElapsedTime >= 240
-            TitleStr = 'Fixed Speed - 4 min elapsed';
-        end
-        title(TitleStr);
-        
-        ax = gca; % edit axes
-        ax.XTick = [];
-        ax.YTick = [];
-        Lo = Settings.NormFp * 0.5;
-        Hi = Settings.NormFp * 1.5;
-        ax.YLim = [Lo Hi];
+    % redrawn by the Stance subscriber; update the elapsed time once per step
+    if strcmp(Settings.Biofeedback, 'Fp') && NewStance
         
         % put elapsed time in contolfig
         if ishandle(StopFig)
@@ -242,22 +352,74 @@ while isempty(StopFig) == 0
 end
 
 %% stop treadmill after handle deleted
+if UseEngine
+    CortexWatchdog('Stop');
+    CortexTrace('Stop');
+    CortexMetrics('Stop');
+end
 disp('Stopping Treadmill');
 speed = 0;
+[~, SendStart] = TrialClock('Local', Clock);
 calllib('treadmill0x2Dremote','TREADMILL_initializeUDP',IP.Treadmill,'4000');
 calllib('treadmill0x2Dremote','TREADMILL_setSpeed',speed, speed,.25);
+Clock = TrialClock('Command', Clock, SendStart, speed);
+if UseEngine
+    CortexRelay('State', speed, Steps.MeanPeakFp);
+end
+if UseEngine && isfield(Settings, 'SkyStop')
+    Sky(end+1).Command = Settings.SkyStop;
+    Sky(end).Ticket = CortexSky('Sky', Settings.SkyStop, 1000);
+end
 close all;
 
-% remove 1st row if empty
-if isempty(Data(1).Frame)
-    Data(1) = []; 
+% the whole trial from the log, or only the rows still in memory
+Log = TrialLog('Close', Log);
+Summary.LogFile = Settings.LogFile;
+if UseEngine && isfield(Settings, 'ExportFile') % .mat, .npz or .npy copy
+    TrialLog('Export', [], Settings.LogFile, Settings.ExportFile);
 end
-
-% remove empty rows at end
-F = length([Data.Frame]) + 1;
-if length(Data) > F
-    Data(F:end) = []; 
+if isfield(Settings, 'ReadBack') && strcmp(Settings.ReadBack, 'No')
+    [~, Data] = TrialLog('Columns', [], Data(1:k)); % the same fields as 'Read'
+    Summary.Steps = Steps.Log; % the last stances
+else
+    [~, Data, Summary.Steps] = TrialLog('Read', [], Settings.LogFile); % every completed stance
 end
 
+%% report timeline alignment and frame sequence integrity
+Summary.Stance = StanceEnsemble('Summary', Ens); % mean stance curves
+Summary.PlateOffset = Zero.Offset .* Zero.Scale; % zero drift at the end (N)
+fprintf('Plate zero drift: F1Y %.1f, F1Z %.1f, F2Y %.1f, F2Z %.1f N \n', ...
+    Summary.PlateOffset);
+
+% outcome of queued Cortex commands, off the control path now
+for i = 1:length(Sky)
+    [Done, Sky(i).Code] = CortexSky('Wait', Sky(i).Ticket, 2000);
+    if Done ~= 1 || Sky(i).Code ~= 0
+        fprintf('Cortex command %s did not complete \n', Sky(i).Command);
+    end
+end
+Summary.Sky = Sky;
+if UseEngine
+    Summary.Relay = CortexRelay('Stats');
+    Summary.Watchdog = CortexWatchdog('Status');
+    Summary.Signal = CortexMonitor('Summary');
+    if isfield(Settings, 'TraceFile')
+        [Summary.TraceSpans, Summary.TraceDropped] = CortexTrace('Write', Settings.TraceFile);
+    end
+    if ~isempty(Summary.Watchdog) && ~isempty(Summary.Watchdog.Reason)
+        fprintf('Watchdog: %s for %.0f ms at %.1f s \n', Summary.Watchdog.Reason, ...
+            1000 * Summary.Watchdog.Gap, Summary.Watchdog.Time);
+    end
+end
+Summary.Clock = TrialClock('Summary', Clock);
+fprintf('Cortex clock drift: %.1f ppm, %d treadmill commands stamped \n', ...
+    Summary.Clock.DriftPPM, Summary.Clock.nCommands);
+Summary.Integrity = FrameIntegrity(Integ);
+fprintf('Frames: %d received, %d dropped (%.2f%%), %d duplicate, %d reordered (%d late), %d filled \n', ...
+    Summary.Integrity.Received, Summary.Integrity.Drops, ...
+    100 * Summary.Integrity.DropRate, Summary.Integrity.Duplicates, ...
+    Summary.Integrity.Reorders, Summary.Integrity.Late, Summary.Integrity.Filled);
+fprintf('Frame delay: mean %.1f ms, max %.1f ms \n', ...
+    1000 * Summary.Integrity.DelayMean, 1000 * Summary.Integrity.DelayMax);
 
 end
\ No newline at end of file
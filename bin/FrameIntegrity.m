@@ -0,0 +1,96 @@
+function [Integ, Status] = FrameIntegrity(Integ, f)
+% Track continuity of Cortex frame numbers and frame delay statistics
+% Integ is the integrity record from the previous call (start with [])
+% f is the frame returned by mGetCurrentFrame
+% Status is 'New' for a frame to process, 'Duplicate' for a frame number
+% that was already processed, or 'Reorder' for a late frame
+% Integ.Gap holds the number of frames missing just before a 'New' frame
+% A late frame that fills a gap within the recent history is taken off
+% Integ.Drops and counted in Integ.Late; one older than that is only
+% counted in Integ.Reorders
+% Call with one input to finalize the record for the trial summary
+
+History = 32; % number of recent frame numbers kept for duplicate checks
+
+%% start a new record
+if isempty(Integ)
+    Integ.FirstFrame = [];
+    Integ.LastFrame = [];
+    Integ.Recent = NaN(1, History);
+    Integ.Received = 0;
+    Integ.Drops = 0;
+    Integ.Duplicates = 0;
+    Integ.Reorders = 0;
+    Integ.Late = 0;
+    Integ.Gaps = 0;
+    Integ.MaxGap = 0;
+    Integ.Gap = 0;
+    Integ.Filled = 0;
+    Integ.DropRate = 0;
+    Integ.DelayN = 0;
+    Integ.DelayMean = 0;
+    Integ.DelayM2 = 0;
+    Integ.DelayStd = 0;
+    Integ.DelayMin = Inf;
+    Integ.DelayMax = -Inf;
+end
+
+%% finalize rates for the trial summary
+if nargin < 2
+    Expected = Integ.Received + Integ.Late + Integ.Drops;
+    if Expected > 0
+        Integ.DropRate = Integ.Drops / Expected;
+    end
+    if Integ.DelayN > 1
+        Integ.DelayStd = sqrt(Integ.DelayM2 / (Integ.DelayN - 1));
+    end
+    Status = 'Summary';
+    return
+end
+
+%% classify frame number
+iFrame = double(f.iFrame);
+Integ.Gap = 0;
+if isempty(Integ.LastFrame)
+    Status = 'New';
+    Integ.FirstFrame = iFrame;
+elseif iFrame > Integ.LastFrame
+    Status = 'New';
+    Gap = iFrame - Integ.LastFrame - 1;
+    if Gap > 0
+        Integ.Gap = Gap;
+        Integ.Gaps = Integ.Gaps + 1;
+        Integ.Drops = Integ.Drops + Gap;
+        Integ.MaxGap = max(Integ.MaxGap, Gap);
+    end
+elseif any(Integ.Recent == iFrame)
+    Status = 'Duplicate';
+    Integ.Duplicates = Integ.Duplicates + 1;
+    return
+else
+    % older frame arriving after a newer one; one newer than the oldest
+    % recent frame was counted as dropped when its gap opened
+    Status = 'Reorder';
+    Integ.Reorders = Integ.Reorders + 1;
+    if iFrame > min(Integ.Recent)
+        Integ.Drops = Integ.Drops - 1;
+        Integ.Late = Integ.Late + 1;
+        Integ.Recent = [iFrame, Integ.Recent(1:end-1)];
+    end
+    return
+end
+
+Integ.LastFrame = iFrame;
+Integ.Recent = [iFrame, Integ.Recent(1:end-1)];
+Integ.Received = Integ.Received + 1;
+
+%% running frame delay statistics (Welford)
+Delay = double(f.fDelay);
+Integ.DelayN = Integ.DelayN + 1;
+d = Delay - Integ.DelayMean;
+Integ.DelayMean = Integ.DelayMean + d / Integ.DelayN;
+Integ.DelayM2 = Integ.DelayM2 + d * (Delay - Integ.DelayMean);
+Integ.DelayMin = min(Integ.DelayMin, Delay);
+Integ.DelayMax = max(Integ.DelayMax, Delay);
+
+end
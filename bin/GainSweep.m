@@ -0,0 +1,180 @@
+function [Sweep] = GainSweep(Settings, Space, Options)
+% Sweep of the self-pace controller constants against a population of
+% simulated walkers (SimulateSelfPace), in parallel, with the Pareto
+% front of stability, responsiveness and comfort
+%
+% Settings - base settings of SimulateSelfPace (Duration, FrameRate,
+%            StartSpeed, Controller, ...)
+% Space    - one field per SelfPaceParams constant to vary, e.g.
+%            TreadmillCenter, DeadZone, Linear, realtimeAccel,
+%            MinBeltSpeed, MaxBeltSpeed; the values of a grid, or
+%            [Low High] for random samples
+% Options  - optional fields
+%   Mode       'Grid' (default) or 'Random'
+%   nSamples   configurations drawn in 'Random' mode (default 200)
+%   nWalkers   walkers in the population (default 8)
+%   Objectives metrics to minimize for the Pareto front (default
+%              {'Reversals','SettlingTime','MaxAccel'})
+%   Workers    most parfor workers (default all of the pool)
+%   Seed       of the samples and the population (default 0)
+%
+% Sweep.Configs(i) holds configuration i, Sweep.Results(i) its metrics
+% averaged over the walkers, Sweep.Pareto the indices of the
+% configurations no other one beats on every objective.
+% Every configuration meets the same walkers with the same noise, so
+% differences come from the constants alone.
+%
+% Metrics: stability - Reversals (belt speed reversals/min),
+% MaxExcursion (worst over walkers), TimeOutside, Unsettled (fraction of
+% speed changes never settled); responsiveness - SettlingTime (s, an
+% unsettled change counts as the rest of its segment), SpeedRMS;
+% comfort - MaxAccel (m/s^2), Overshoot (m/s), CommandRate (1/s)
+%
+% Example:
+%   S = struct('Duration',120, 'FrameRate',100, 'StartSpeed',1.0);
+%   Space = struct('DeadZone',[0.05 0.1 0.15], 'Linear',[0.05 0.1 0.2], ...
+%       'realtimeAccel',[0.3 0.6 1.0]);
+%   Sweep = GainSweep(S, Space);
+
+if nargin < 3
+    Options = struct();
+end
+Defaults = struct('Mode','Grid', 'nSamples',200, 'nWalkers',8, ...
+    'Objectives',{{'Reversals','SettlingTime','MaxAccel'}}, ...
+    'Workers',Inf, 'Seed',0);
+Fields = fieldnames(Defaults);
+for i = 1:length(Fields)
+    if ~isfield(Options, Fields{i})
+        Options.(Fields{i}) = Defaults.(Fields{i});
+    end
+end
+Rand = RandStream('mt19937ar', 'Seed', Options.Seed);
+
+%% configurations and walkers
+Configs = SweepConfigs(Space, Options, Rand);
+Walkers = WalkerPopulation(Options.nWalkers, Settings.Duration, Rand);
+nConfigs = length(Configs);
+nWalkers = length(Walkers);
+fprintf('Gain sweep: %d configurations x %d walkers \n', nConfigs, nWalkers);
+
+%% simulate every pair, spread over the workers
+nRuns = nConfigs * nWalkers;
+Runs = cell(1, nRuns);
+parfor (r = 1:nRuns, Options.Workers)
+    [c, w] = ind2sub([nConfigs, nWalkers], r);
+    Run = Settings;
+    Run.Ctrl = Configs(c);
+    if isfield(Settings, 'Ctrl')
+        Base = fieldnames(Settings.Ctrl);
+        for i = 1:length(Base)
+            if ~isfield(Run.Ctrl, Base{i})
+                Run.Ctrl.(Base{i}) = Settings.Ctrl.(Base{i});
+            end
+        end
+    end
+    Run.Walker = Walkers(w);
+    Run.Seed = w; % same noise for a walker in every configuration
+    Sim = SimulateSelfPace(Run);
+    Settle = Sim.Settle;
+    Unsettled = isnan(Settle);
+    Settle(Unsettled) = Sim.SegmentTime(Unsettled); % the rest of the segment
+    Runs{r} = [Sim.Reversals, Sim.MaxExcursion, Sim.TimeOutside, ...
+        mean(Unsettled), mean(Settle), Sim.SpeedRMS, ...
+        Sim.MaxAccel, Sim.Overshoot, Sim.CommandRate];
+end
+
+%% per configuration metrics and Pareto front
+Names = {'Reversals','MaxExcursion','TimeOutside','Unsettled', ...
+    'SettlingTime','SpeedRMS','MaxAccel','Overshoot','CommandRate'};
+M = reshape(cat(1, Runs{:}), nConfigs, nWalkers, length(Names));
+Mean = reshape(mean(M, 2), nConfigs, length(Names));
+Mean(:, strcmp(Names, 'MaxExcursion')) = max(M(:,:,strcmp(Names, 'MaxExcursion')), [], 2);
+Results = cell2struct(num2cell(Mean), Names, 2);
+
+Obj = zeros(nConfigs, length(Options.Objectives));
+for j = 1:length(Options.Objectives)
+    Obj(:,j) = Mean(:, strcmp(Names, Options.Objectives{j}));
+end
+Pareto = ParetoFront(Obj);
+[~, Order] = sort(Obj(Pareto, 1));
+Pareto = Pareto(Order);
+
+Sweep.Configs = Configs;
+Sweep.Results = Results;
+Sweep.Walkers = Walkers;
+Sweep.Objectives = Options.Objectives;
+Sweep.Pareto = Pareto;
+
+%% report the front
+Params = fieldnames(Configs);
+fprintf('Pareto front, %d of %d configurations: \n', length(Pareto), nConfigs);
+fprintf('%s', sprintf('%14s', Params{:}, Options.Objectives{:}));
+fprintf('\n');
+for i = Pareto(:)'
+    Values = cellfun(@(p) Configs(i).(p), Params);
+    fprintf('%14.3f', Values, Obj(i,:));
+    fprintf('\n');
+end
+
+end
+
+function [Configs] = SweepConfigs(Space, Options, Rand)
+% the grid, or random samples, of the constants in Space
+Params = fieldnames(Space);
+n = length(Params);
+if strcmp(Options.Mode, 'Random')
+    X = zeros(Options.nSamples, n);
+    for j = 1:n
+        Range = Space.(Params{j});
+        X(:,j) = Range(1) + (Range(end) - Range(1)) .* rand(Rand, Options.nSamples, 1);
+    end
+else
+    Axes = cellfun(@(p) Space.(p)(:)', Params, 'UniformOutput', false);
+    Grids = cell(1, n);
+    [Grids{:}] = ndgrid(Axes{:});
+    X = cell2mat(cellfun(@(g) g(:), Grids, 'UniformOutput', false));
+end
+
+% a belt speed range must not be empty
+iMin = find(strcmp(Params, 'MinBeltSpeed'));
+iMax = find(strcmp(Params, 'MaxBeltSpeed'));
+if ~isempty(iMin) && ~isempty(iMax)
+    X = X(X(:,iMin) < X(:,iMax), :);
+end
+Configs = cell2struct(num2cell(X), Params, 2);
+
+end
+
+function [Walkers] = WalkerPopulation(n, Duration, Rand)
+% WalkerModel parameters of n walkers: body mass, preferred speed and a
+% change of it a third into the trial, stride, and how they drift
+Walkers = struct([]);
+for i = 1:n
+    Speed = 0.9 + 0.6 * rand(Rand);
+    Change = 0.4 * (rand(Rand) - 0.5);
+    W.BodyMass = min(max(75 + 12 * randn(Rand), 45), 120);
+    W.Schedule = [0, Speed; Duration / 3, Speed + Change];
+    W.StrideTime = 1.1 * (1.2 / Speed)^0.3 * (0.95 + 0.1 * rand(Rand));
+    W.SpeedNoise = 0.02 + 0.03 * rand(Rand);
+    W.Centering = 0.02 + 0.08 * rand(Rand);
+    if isempty(Walkers)
+        Walkers = W;
+    else
+        Walkers(i) = W;
+    end
+end
+
+end
+
+function [Front] = ParetoFront(Obj)
+% rows of Obj (to minimize) that no other row is at least as good as on
+% every objective and better on one
+n = size(Obj, 1);
+Dominated = false(n, 1);
+for i = 1:n
+    Better = all(Obj <= Obj(i,:), 2) & any(Obj < Obj(i,:), 2);
+    Dominated(i) = any(Better);
+end
+Front = find(~Dominated);
+
+end
@@ -0,0 +1,116 @@
+function [Mk, Pos] = MarkerPosition(Action, Mk, varargin)
+% Robust fore/aft body position from streamed Cortex markers
+%
+% Mk = MarkerPosition('Init', BodyDefs, Settings)
+%   find the selected markers in the body definitions from mGetBodyDefs
+%   Settings.Markers     - marker names (default pelvis LASI RASI LPSI RPSI)
+%   Settings.MarkerBody  - body name to search (default any)
+%   Settings.MarkerAxis  - fore/aft axis, 1-3 (default 2, as CoPy)
+%   Settings.MarkerScale - marker units to m (default 0.001)
+%   Settings.MarkerOffset - marker to treadmill offset (m); calibrated
+%                          against the double support CoP when not given
+% [Mk, Pos] = MarkerPosition('Frame', Mk, f)
+%   position (m, treadmill CoP coordinates) from frame f, NaN if the
+%   markers have been missing too long or the offset is not calibrated
+% Mk = MarkerPosition('Calibrate', Mk, CoPy)
+%   update the marker to treadmill offset from a double support CoP
+%
+% Each marker's offset from the centroid is learned while all markers
+% are visible, so the centroid stays put when some drop out (XEMPTY)
+
+MaxHold = 25; % frames to hold the last position when all markers drop
+nCalibrate = 50; % double support frames averaged for the offset
+
+Pos = NaN;
+switch Action
+
+    %% locate markers
+    case 'Init'
+        BodyDefs = Mk;
+        Settings = varargin{1};
+        Mk = struct();
+        Mk.Names = {'LASI','RASI','LPSI','RPSI'};
+        Mk.Body = '';
+        Mk.Axis = 2;
+        Mk.Scale = 0.001;
+        Mk.Offset = NaN;
+        if isfield(Settings, 'Markers'); Mk.Names = Settings.Markers; end
+        if isfield(Settings, 'MarkerBody'); Mk.Body = Settings.MarkerBody; end
+        if isfield(Settings, 'MarkerAxis'); Mk.Axis = Settings.MarkerAxis; end
+        if isfield(Settings, 'MarkerScale'); Mk.Scale = Settings.MarkerScale; end
+        if isfield(Settings, 'MarkerOffset'); Mk.Offset = Settings.MarkerOffset; end
+
+        % body with the most selected markers
+        Mk.iBody = 0;
+        Mk.Idx = [];
+        for b = 1:BodyDefs.nBodyDefs
+            Body = BodyDefs.Body(b);
+            if ~isempty(Mk.Body) && ~strcmp(Body.szName, Mk.Body)
+                continue
+            end
+            [Found, Idx] = ismember(Mk.Names, Body.szMarkerNames);
+            if sum(Found) > length(Mk.Idx)
+                Mk.iBody = b;
+                Mk.Idx = Idx(Found);
+            end
+        end
+        if Mk.iBody == 0
+            disp('Selected markers not found in body definitions');
+        else
+            fprintf('Using %d markers from %s \n', length(Mk.Idx), ...
+                BodyDefs.Body(Mk.iBody).szName);
+        end
+
+        Mk.Rel = zeros(length(Mk.Idx), 1); % marker offset from centroid
+        Mk.nRel = 0;
+        Mk.Raw = NaN;
+        Mk.Held = 0;
+        Mk.Dropouts = 0;
+        Mk.nCal = 0;
+        if ~isnan(Mk.Offset)
+            Mk.nCal = nCalibrate;
+        end
+
+    %% position from one frame
+    case 'Frame'
+        f = varargin{1};
+        if Mk.iBody == 0 || Mk.iBody > f.nBodies
+            return
+        end
+        x = double(f.BodyData(Mk.iBody).Markers(Mk.Idx, Mk.Axis));
+        Valid = abs(x) < 0.5 * 9999999; % XEMPTY means no data
+
+        if all(Valid)
+            % learn each marker's offset from the centroid
+            Mk.nRel = Mk.nRel + 1;
+            Mk.Rel = Mk.Rel + ((x - mean(x)) - Mk.Rel) ./ min(Mk.nRel, 100);
+        end
+        if any(Valid) && (all(Valid) || Mk.nRel > 0)
+            Mk.Raw = Mk.Scale * mean(x(Valid) - Mk.Rel(Valid));
+            Mk.Held = 0;
+        else
+            Mk.Dropouts = Mk.Dropouts + 1;
+            Mk.Held = Mk.Held + 1;
+            if Mk.Held > MaxHold
+                Mk.Raw = NaN;
+            end
+        end
+        if Mk.nCal >= nCalibrate
+            Pos = Mk.Raw + Mk.Offset;
+        end
+
+    %% calibrate against double support CoP
+    case 'Calibrate'
+        CoPy = varargin{1};
+        if Mk.nCal < nCalibrate && ~isnan(Mk.Raw)
+            Mk.nCal = Mk.nCal + 1;
+            if Mk.nCal == 1
+                Mk.Offset = CoPy - Mk.Raw;
+            else
+                Mk.Offset = Mk.Offset + ((CoPy - Mk.Raw) - Mk.Offset) / Mk.nCal;
+            end
+        end
+
+end
+
+end
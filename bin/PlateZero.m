@@ -0,0 +1,78 @@
+function [Z, F] = PlateZero(Action, Z, varargin)
+% Force conversion of the treadmill plates less zero offsets that follow
+% the plates' drift, re-estimated while each plate is unloaded in swing,
+% so stance thresholds and Fp keep their zero over long sessions
+%
+% Z = PlateZero('Init', FrameRate, Settings)
+%   Settings.PlateZero = false  keeps the offsets at 0
+%   Settings.ZeroSeconds  time constant of the estimate, in unloaded
+%                         time (s, default 2)
+%   Settings.ZeroGuard    unloaded time after toe-off before a plate's
+%                         samples count (s, default 0.1)
+%   Settings.ZeroBand     largest spread (max - min, N) of a frame's
+%                         vertical force for it to count (default 10)
+% [Z, F] = PlateZero('Convert', Z, AnalogSamples)
+%   F is F1Y; F1Z; F2Y; F2Z (N, one column per sample) of channels 4, 5,
+%   11 and 12, as LoadScale(bits2volts()), less the current offsets
+% Z = PlateZero('Swing', Z, Contact)
+%   after ContactDetect('Frame', ...) on F: each plate out of contact for
+%   the whole frame, and for ZeroGuard before it, whose vertical force
+%   varied by less than ZeroBand moves the offsets of its two channels
+%   toward the frame's mean counts; they apply from the next 'Convert'.
+%   The force's level is not gated, so an offset is corrected however
+%   far it has drifted, up to where ContactDetect reads it as contact
+%
+% Z.Offset (4 x 1) is in counts and Z.Offset .* Z.Scale in N. The
+% offsets start at 0, from the plates as zeroed before the trial.
+
+switch Action
+
+    case 'Init'
+        FrameRate = Z;
+        Settings = varargin{1};
+        Z = struct();
+        Z.FrameRate = FrameRate;
+        Z.Channels = [4 5 11 12];
+        Z.Scale = [LoadScale('Fy', bits2volts(1)); LoadScale('Fz', bits2volts(1)); ...
+            LoadScale('Fy', bits2volts(1)); LoadScale('Fz', bits2volts(1))];
+        Z.On = ~isfield(Settings, 'PlateZero') || Settings.PlateZero;
+        Z.Tau = 2;
+        if isfield(Settings, 'ZeroSeconds')
+            Z.Tau = Settings.ZeroSeconds;
+        end
+        Z.Guard = 0.1;
+        if isfield(Settings, 'ZeroGuard')
+            Z.Guard = Settings.ZeroGuard;
+        end
+        Z.Band = 10;
+        if isfield(Settings, 'ZeroBand')
+            Z.Band = Settings.ZeroBand;
+        end
+        Z.Offset = zeros(4, 1);
+        Z.Unloaded = zeros(2, 1); % time each plate has been out of contact
+        Z.nUpdates = zeros(2, 1);
+        Z.X = [];
+        Z.Spread = zeros(2, 1);
+
+    case 'Convert'
+        Z.X = double(varargin{1}(Z.Channels, :));
+        F = bsxfun(@times, bsxfun(@minus, Z.X, Z.Offset), Z.Scale);
+        Z.Spread = max(F([2 4], :), [], 2) - min(F([2 4], :), [], 2);
+
+    case 'Swing'
+        Contact = varargin{1};
+        Off = ~any(Contact.Mask, 2);
+        % the frame counts if the plate was already off before it began
+        Use = Off & Z.Unloaded >= Z.Guard & Z.Spread < Z.Band;
+        Z.Unloaded = (Z.Unloaded + 1 / Z.FrameRate) .* Off;
+        if ~Z.On || ~any(Use)
+            return
+        end
+        a = 1 - exp(-1 / (Z.FrameRate * Z.Tau));
+        Rows = reshape([Use'; Use'], [], 1); % Y and Z of each plate
+        Z.Offset(Rows) = Z.Offset(Rows) + a .* (mean(Z.X(Rows, :), 2) - Z.Offset(Rows));
+        Z.nUpdates = Z.nUpdates + Use;
+
+end
+
+end
@@ -0,0 +1,93 @@
+function [MPC, newSpeed] = PredictiveSpeed(MPC, Pos, Vel, prevSpeed, dt, Ctrl)
+% Latency compensating predictive self-pace speed controller
+% MPC is the controller state from the previous frame (start with [])
+% Pos and Vel are the body position on the treadmill (m) and its rate of
+% change (m/s), e.g. from BodyPositionKF; NaN Pos holds the current target
+% prevSpeed is the last commanded speed and dt the frame interval (s)
+% MPC.SendDelay can be updated by the caller with the measured time a
+% command takes to leave the host; it adds to Ctrl.Latency
+%
+% An internal TreadmillModel tracks what the belt is doing under the
+% commands already sent. Every Ctrl.PlanInterval, candidate speed targets
+% within the acceleration and speed bounds are simulated over the
+% horizon, assuming the walker keeps its (smoothed) speed over ground, and
+% the target with the lowest cost (position outside the dead zone,
+% belt/walker speed mismatch and target change) is returned
+
+%% initialize belt model
+if isempty(MPC)
+    MPC.TM = TreadmillModel('Init', [], prevSpeed, Ctrl.Latency);
+    MPC.TM.Accel = Ctrl.realtimeAccel;
+    MPC.SendDelay = 0;
+    MPC.Cost = NaN;
+    MPC.Walker = NaN;
+    MPC.SincePlan = Inf;
+end
+
+% advance belt model to this frame
+MPC.TM = TreadmillModel('Step', MPC.TM, dt);
+MPC.SincePlan = MPC.SincePlan + dt;
+newSpeed = prevSpeed;
+if isnan(Pos)
+    return
+end
+if isnan(Vel)
+    Vel = 0;
+end
+
+% walker speed over ground, smoothed over the within-step CoP swing
+Walker = Vel + MPC.TM.Speed;
+if isnan(MPC.Walker)
+    MPC.Walker = Walker;
+else
+    MPC.Walker = MPC.Walker + min(1, dt / Ctrl.WalkerSmoothing) * (Walker - MPC.Walker);
+end
+if MPC.SincePlan < Ctrl.PlanInterval
+    return
+end
+MPC.SincePlan = 0;
+
+N = Ctrl.HorizonSteps;
+tau = Ctrl.Horizon / N;
+Latency = Ctrl.Latency + MPC.SendDelay;
+
+%% belt speed under commands already sent
+Base = MPC.TM;
+vb = zeros(1, N);
+for h = 1:N
+    Base = TreadmillModel('Step', Base, tau);
+    vb(h) = Base.Speed;
+end
+
+%% candidate speed targets
+Reach = Ctrl.realtimeAccel * max(Ctrl.Horizon - Latency, tau);
+Lo = max(Ctrl.MinBeltSpeed, prevSpeed - Reach);
+Hi = min(Ctrl.MaxBeltSpeed, prevSpeed + Reach);
+c = [linspace(Lo, Hi, Ctrl.nCandidates)'; prevSpeed];
+
+% belt speed profile for each candidate, ramping once the command lands
+V = repmat(vb, length(c), 1);
+iLand = min(N, max(1, ceil(Latency / tau)));
+MaxStep = Ctrl.realtimeAccel * tau;
+for h = iLand+1:N
+    dv = c - V(:,h-1);
+    V(:,h) = V(:,h-1) + sign(dv) .* min(abs(dv), MaxStep);
+end
+
+%% predicted body position, walker speed over ground held constant
+Walker = MPC.Walker;
+P = Pos + cumsum((Walker - V) .* tau, 2);
+Outside = max(0, abs(P - Ctrl.TreadmillCenter) - Ctrl.DeadZone);
+J = Ctrl.PosWeight .* sum(Outside.^2, 2) .* tau ...
+    + Ctrl.SpeedWeight .* (V(:,end) - Walker).^2 ...
+    + Ctrl.ChangeWeight .* (c - prevSpeed).^2;
+[MPC.Cost, Best] = min(J);
+
+%% send only worthwhile changes
+if abs(c(Best) - prevSpeed) >= Ctrl.MinChange
+    newSpeed = c(Best);
+    MPC.TM = TreadmillModel('Command', MPC.TM, newSpeed, ...
+        Ctrl.realtimeAccel, Latency);
+end
+
+end
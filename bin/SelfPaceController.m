@@ -0,0 +1,69 @@
+function [Ctl, newSpeed] = SelfPaceController(Ctl, Meas, prevSpeed, dt)
+% One frame of the self-pace treadmill controller
+% Ctl = SelfPaceController(Ctrl) creates the controller from the
+% constants returned by SelfPaceParams
+% [Ctl, newSpeed] = SelfPaceController(Ctl, Meas, prevSpeed, dt) updates
+% the body position estimate and returns the speed to command
+% Meas holds the frame means CoP1y, CoP2y, F1Z, F2Z and optionally
+% Marker, the marker position from MarkerPosition (NaN when missing);
+% prevSpeed is the last commanded speed
+% Ctl.Pos and Ctl.Vel hold the position estimate used this frame
+
+%% create controller
+if nargin == 1
+    Ctrl = Ctl;
+    Ctl = struct();
+    Ctl.Params = Ctrl;
+    Ctl.KF = [];
+    Ctl.MPC = [];
+    Ctl.Pos = NaN;
+    Ctl.Vel = NaN;
+    newSpeed = [];
+    return
+end
+Ctrl = Ctl.Params;
+
+%% body position estimate
+Ctl.Pos = NaN;
+Ctl.Vel = NaN;
+Continuous = any(strcmp(Ctrl.PositionEstimate, {'Kalman','Markers'}));
+if strcmp(Ctrl.PositionEstimate, 'Kalman')
+    % CoP fused with markers when available
+    Ctl.KF = BodyPositionKF(Ctl.KF, Meas, dt);
+    Ctl.Pos = Ctl.KF.Pos;
+    Ctl.Vel = Ctl.KF.Vel;
+elseif strcmp(Ctrl.PositionEstimate, 'Markers')
+    % markers only, available regardless of foot contact
+    Marker = NaN;
+    if isfield(Meas, 'Marker')
+        Marker = Meas.Marker;
+    end
+    Ctl.KF = BodyPositionKF(Ctl.KF, struct('CoP1y',0, 'CoP2y',0, ...
+        'F1Z',0, 'F2Z',0, 'Marker',Marker), dt);
+    Ctl.Pos = Ctl.KF.Pos;
+    Ctl.Vel = Ctl.KF.Vel;
+elseif Meas.F1Z > Ctrl.Thresh && Meas.F2Z > Ctrl.Thresh
+    % both feet on separate plates, average CoP
+    Ctl.Pos = mean([Meas.CoP1y Meas.CoP2y]);
+end
+
+%% speed law
+if strcmp(Ctrl.Controller, 'Predictive')
+    [Ctl.MPC, newSpeed] = PredictiveSpeed(Ctl.MPC, Ctl.Pos, Ctl.Vel, ...
+        prevSpeed, dt, Ctrl);
+
+elseif Continuous && ~isnan(Ctl.Pos)
+    % runs every frame, so gain is scaled to match double support
+    Position = Ctl.Pos + Ctrl.Lead * Ctl.Vel;
+    newSpeed = SelfPaceLaw(prevSpeed, Position, Ctrl, ...
+        Ctrl.Linear * Ctrl.ContinuousScale);
+
+elseif ~isnan(Ctl.Pos)
+    newSpeed = SelfPaceLaw(prevSpeed, Ctl.Pos, Ctrl);
+
+else
+    % maintain current speed, within belt limits
+    newSpeed = SelfPaceLaw(prevSpeed, Ctrl.TreadmillCenter, Ctrl);
+end
+
+end
@@ -0,0 +1,135 @@
+function [Loop, Row, newSpeed, NewSteps] = SelfPaceFrame(Action, Loop, varargin)
+% The frame path of the self-pace loop, from a new frame's analog samples
+% to the controller's speed, shared by SelfPaceTM and SimulateSelfPace so
+% the simulation runs the code the trials run
+%
+% Loop = SelfPaceFrame('Init', Settings, BodyDefs)
+%   controller constants and state (Ctrl, Ctl; see SelfPaceParams),
+%   plate zero (Zero), contact detection (Contact), gait events (Steps)
+%   and, for the 'Markers' position estimate or Settings.Markers, the
+%   pelvis markers (Mk) found in BodyDefs(), a function returning the
+%   body definitions as mGetBodyDefs does
+% [Loop, Row] = SelfPaceFrame('Convert', Loop, f)
+%   forces (N) less the plates' drifting zero, and CoPs, of new frame f
+% [Loop, Row, newSpeed, NewSteps] = SelfPaceFrame('Frame', Loop, Row, f, prevSpeed, Gap)
+%   contact, gait events (NewSteps, as StepEvents), marker position and
+%   the controller's new speed for Row, from 'Convert' with FrameTime set
+%   (TrialClock); Gap is the frames missing before f
+% Loop = SelfPaceFrame('Sent', Loop, SendTime)
+%   feed a speed command's measured send time (s) to the predictive
+%   controller's latency
+%
+% Row gets Frame, F1Y, F1Z, F2Y, F2Z, CoP1y, CoP2y, CoP1x, CoP2x, then
+% Gap, RightOn, LeftOn, Fp (peak Fp of the stances ending on the frame,
+% [] if none), MeanPeakFp, CoPy (in double support, else []), MarkerPos
+% (with markers), BodyPos and BodyVel: the trial data fields the loop
+% computes; the caller adds Speed, Time, CmdTime and Interp
+
+Row = [];
+newSpeed = [];
+NewSteps = [];
+switch Action
+
+    case 'Init'
+        Settings = Loop;
+        BodyDefs = varargin{1};
+        Loop = struct();
+        Loop.FrameRate = Settings.FrameRate;
+        Loop.Ctrl = SelfPaceParams(Settings);
+        Loop.Ctl = SelfPaceController(Loop.Ctrl);
+        Loop.Contact = ContactDetect('Init', Settings.FrameRate); % 25 N on, 15 N off
+        if isfield(Settings, 'ContactThresh') % [on off] (N)
+            Loop.Contact = ContactDetect('Init', Settings.FrameRate, ...
+                Settings.ContactThresh(1), Settings.ContactThresh(2));
+        end
+        Loop.Zero = PlateZero('Init', Settings.FrameRate, Settings); % follows plate drift
+        Loop.Steps = StepEvents('Init', 3 * Settings.FrameRate); % stances up to 3 s
+
+        % pelvis markers for body position (see MarkerPosition)
+        Loop.UseMarkers = strcmp(Loop.Ctrl.PositionEstimate, 'Markers') ...
+            || isfield(Settings, 'Markers');
+        Loop.Mk = [];
+        if Loop.UseMarkers
+            Loop.Mk = MarkerPosition('Init', BodyDefs(), Settings);
+        end
+
+    case 'Convert'
+        f = varargin{1};
+        CortexTrace('Begin', 'Conversion');
+        [Loop.Zero, F] = PlateZero('Convert', Loop.Zero, f.AnalogData.AnalogSamples);
+        Row.Frame = f.iFrame;
+        Row.F1Y = F(1,:);
+        Row.F1Z = F(2,:);
+        Row.F2Y = F(3,:);
+        Row.F2Z = F(4,:);
+        Row.CoP1y = mean(f.AnalogData.Forces(3,1:2:end));
+        Row.CoP2y = mean(f.AnalogData.Forces(3,2:2:end));
+        Row.CoP1x = mean(f.AnalogData.Forces(4,1:2:end));
+        Row.CoP2x = mean(f.AnalogData.Forces(4,2:2:end));
+        CortexTrace('End', 'Conversion', f.iFrame);
+
+    case 'Frame'
+        Row = varargin{1};
+        f = varargin{2};
+        prevSpeed = varargin{3};
+        Gap = varargin{4};
+        Row.Gap = Gap;
+
+        % stance on every analog sample, with hysteresis (see ContactDetect)
+        CortexTrace('Begin', 'Gait');
+        Loop.Contact = ContactDetect('Frame', Loop.Contact, [Row.F1Z; Row.F2Z], ...
+            Row.FrameTime);
+        Row.RightOn = double(Loop.Contact.On(1));
+        Row.LeftOn = double(Loop.Contact.On(2));
+        Loop.Zero = PlateZero('Swing', Loop.Zero, Loop.Contact); % re-zero unloaded plates
+
+        % heel strikes, toe-offs and completed stances, timed to the
+        % sample crossings
+        [Loop.Steps, NewSteps] = StepEvents('Frame', Loop.Steps, Row, Row.FrameTime, Loop.Contact);
+        Row.Fp = [];
+        Stance = NewSteps(strcmp({NewSteps.Type}, 'Stance'));
+        if ~isempty(Stance)
+            Fp = zeros(1, length(Stance));
+            for i = 1:length(Stance)
+                Fp(i) = Loop.Steps.Latest.(Stance(i).Side).Fp;
+            end
+            Row.Fp = mean(Fp);
+        end
+        Row.MeanPeakFp = Loop.Steps.MeanPeakFp;
+        CortexTrace('End', 'Gait', f.iFrame);
+
+        % both feet on separate plates
+        Row.CoPy = [];
+        if Row.LeftOn && Row.RightOn
+            Row.CoPy = mean([Row.CoP1y Row.CoP2y]);
+        end
+
+        % speed law
+        Meas = struct('CoP1y',Row.CoP1y, 'CoP2y',Row.CoP2y, ...
+            'F1Z',mean(Row.F1Z), 'F2Z',mean(Row.F2Z));
+        if Loop.UseMarkers
+            CortexTrace('Begin', 'Filtering');
+            [Loop.Mk, Meas.Marker] = MarkerPosition('Frame', Loop.Mk, f);
+            if ~isempty(Row.CoPy)
+                Loop.Mk = MarkerPosition('Calibrate', Loop.Mk, Row.CoPy);
+            end
+            Row.MarkerPos = Meas.Marker;
+            CortexTrace('End', 'Filtering', f.iFrame);
+        end
+        CortexTrace('Begin', 'Control');
+        [Loop.Ctl, newSpeed] = SelfPaceController(Loop.Ctl, Meas, prevSpeed, ...
+            (Gap + 1) / Loop.FrameRate);
+        CortexTrace('End', 'Control', f.iFrame);
+        Row.BodyPos = Loop.Ctl.Pos;
+        Row.BodyVel = Loop.Ctl.Vel;
+
+    case 'Sent'
+        SendTime = varargin{1};
+        if isstruct(Loop.Ctl.MPC)
+            Loop.Ctl.MPC.SendDelay = 0.9 * Loop.Ctl.MPC.SendDelay ...
+                + 0.1 * SendTime;
+        end
+
+end
+
+end
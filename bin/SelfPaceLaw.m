@@ -0,0 +1,35 @@
+function [newSpeed] = SelfPaceLaw(prevSpeed, Position, Ctrl, Gain)
+% Dead zone self-pace speed law
+% Speed changes linearly with the distance of Position (m) outside the
+% dead zone about Ctrl.TreadmillCenter and is bounded by the belt limits
+% Gain is the linear factor applied this frame (Ctrl.Linear by default)
+
+if nargin < 4
+    Gain = Ctrl.Linear;
+end
+
+RelCoPy = Position - Ctrl.TreadmillCenter;
+AbsRelCoPy = abs(RelCoPy);
+Outside = AbsRelCoPy - Ctrl.DeadZone;
+Sign = sign(RelCoPy); % direction of change
+
+if Outside > 0 % if outside dead zone, change speed
+    % new speed factor
+    % SpeedChange = Sign .* Outside.^Exp;
+    SpeedChange = Sign .* Outside .* Gain;
+
+    % Calculate new speed, real component only
+    newSpeed = real(prevSpeed + SpeedChange);
+
+else % if within dead zone, maintain current speed
+    newSpeed = prevSpeed;
+end
+
+% bound new speed by set max & min
+if newSpeed > Ctrl.MaxBeltSpeed
+    newSpeed = Ctrl.MaxBeltSpeed;
+elseif newSpeed < Ctrl.MinBeltSpeed
+    newSpeed = Ctrl.MinBeltSpeed;
+end
+
+end
@@ -0,0 +1,54 @@
+function [Ctrl] = SelfPaceParams(Settings)
+% Self-pace controller constants
+% Settings.PositionEstimate and Settings.Controller select the body
+% position estimate and the speed law; fields of Settings.Ctrl override
+% any of the defaults below (used for offline tuning)
+
+%% dead zone speed law
+Ctrl.MinBeltSpeed = 0.4; %m/s
+Ctrl.MaxBeltSpeed = 2;
+Ctrl.realtimeAccel = 0.6; % acceleration limiter
+Ctrl.TreadmillCenter = 0.87; % treadmill center & dead zone center
+% Exp = 2; % exponential factor to change speed outside dead zone
+Ctrl.Linear = 0.10; % linear factor to change increase speed outside dead zone
+Ctrl.DeadZone = 0.10; % set CoP dead zone distance (1 sided)
+
+%% body position estimate driving the speed law
+% 'CoP' = mean CoP, double support only; 'Kalman' = filtered CoP (and
+% markers if given), every frame; 'Markers' = filtered markers, every frame
+Ctrl.PositionEstimate = 'CoP';
+Ctrl.Thresh = 25; % threshold for determining if a true vGRF
+Ctrl.Lead = 0.10; % look-ahead on filtered velocity (s)
+Ctrl.ContinuousScale = 0.25; % per-frame gain scale, ~double support fraction
+
+%% speed law
+% 'Linear' = dead zone law, 'Predictive' = latency compensating horizon
+Ctrl.Controller = 'Linear';
+Ctrl.Latency = 0.15; % network and motor delay before a command acts (s)
+Ctrl.Horizon = 1.5; % prediction horizon (s)
+Ctrl.HorizonSteps = 30; % prediction steps over the horizon
+Ctrl.nCandidates = 41; % speed targets evaluated per frame
+Ctrl.PosWeight = 10; % cost of predicted position outside the dead zone
+Ctrl.SpeedWeight = 1; % cost of belt speed mismatch at end of horizon
+Ctrl.ChangeWeight = 2; % cost of changing the speed target
+Ctrl.MinChange = 0.02; % smallest target change worth sending (m/s)
+Ctrl.PlanInterval = 0.1; % time between speed target updates (s)
+Ctrl.WalkerSmoothing = 1.0; % time constant of walker speed estimate (s)
+
+%% overrides
+if nargin > 0
+    if isfield(Settings, 'PositionEstimate')
+        Ctrl.PositionEstimate = Settings.PositionEstimate;
+    end
+    if isfield(Settings, 'Controller')
+        Ctrl.Controller = Settings.Controller;
+    end
+    if isfield(Settings, 'Ctrl')
+        Fields = fieldnames(Settings.Ctrl);
+        for i = 1:length(Fields)
+            Ctrl.(Fields{i}) = Settings.Ctrl.(Fields{i});
+        end
+    end
+end
+
+end
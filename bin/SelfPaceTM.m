@@ -1,4 +1,4 @@
-function [Data] = SelfPaceTM(Settings)
+function [Data, Summary] = SelfPaceTM(Settings)
 
 
 %% Define IP addresses
@@ -30,6 +30,11 @@ initializeStruct.TalkToClientsNicCardAddress = '0';
 initializeStruct.ClientsMulticastAddress = '225.1.1.2';
 
 % Load the SDK libraries
+UseEngine = libisloaded('CortexEngine');
+if UseEngine
+    CortexSky('Stop'); % engine follows the Cortex connection
+    CortexRelay('Enable'); % SDK2 clients, set before initializing
+end
 r = mCortexExit(); % exit cortex 
 returnValue = mCortexInitialize(initializeStruct); % initialize cortex
 if returnValue ~= 0
@@ -37,21 +42,54 @@ if returnValue ~= 0
 else
     disp('Connected to Cortex'); 
 end
+if UseEngine
+    CortexSky('Start');
+    CortexRelay('Start');
+    CortexRing('Start', 64); % wakes the loop when a frame arrives
+    if isfield(Settings, 'FrameWaitSpin')
+        CortexRing('Spin', Settings.FrameWaitSpin);
+    end
+    if isfield(Settings, 'TraceFile') % stage timings, see CortexTrace
+        CortexTrace('Start');
+    end
+    if isfield(Settings, 'MetricsPort') % live dashboard, see CortexMetrics
+        CortexMetrics('Start', Settings.MetricsPort);
+    end
+    CortexMonitor('Start', Settings); % clipped, stuck or noisy analog channels
+    CortexTreadmill('Open', IP.Treadmill, '4000', Settings); % timed, non-blocking speed commands if Settings.TreadmillLink
+end
 
 %% Initialize data structure and figures
-MinBeltSpeed = 0.4; %m/s
-MaxBeltSpeed = 2;
-fprintf('Max Belt Speed = %.2f m/s \n',MaxBeltSpeed)
-realtimeAccel = 0.6; % acceleration limiter
-TreadmillCenter = 0.87; % treadmill center & dead zone center
-% Exp = 2; % exponential factor to change speed outside dead zone
-Linear = 0.10; % linear factor to change increase speed outside dead zone
-DeadZone = 0.10; % set CoP dead zone distance (1 sided)
+% controller, plate zero, contact and gait events, and pelvis markers:
+% the frame path SimulateSelfPace runs too (see SelfPaceFrame)
+Loop = SelfPaceFrame('Init', Settings, @mGetBodyDefs);
+Ctrl = Loop.Ctrl;
+fprintf('Max Belt Speed = %.2f m/s \n',Ctrl.MaxBeltSpeed)
+
+% frame gap repair
+if ~isfield(Settings, 'FillGaps')
+    Settings.FillGaps = 'No';
+end
+MaxFillGap = 5; % longest gap (frames) to fill by interpolation
 
 Frame = 1;
 k=0; % initialize counter
+Integ = []; % frame integrity record
 
-L = Settings.FrameRate .* Settings.Duration; 
+% the last WindowSeconds of rows stay in memory; every row goes to the
+% trial log as it completes (see TrialLog), so memory use does not grow
+% with the length of the session
+Window = 30;
+if isfield(Settings, 'WindowSeconds')
+    Window = Settings.WindowSeconds;
+end
+Keep = ceil(Window * Settings.FrameRate);
+L = 2 * Keep + MaxFillGap + 1; 
+if ~isfield(Settings, 'LogFile')
+    Settings.LogFile = fullfile(tempdir, ['TrialLog_' datestr(now, 'yyyymmdd_HHMMSS') '.bin']);
+end
+Log = TrialLog('Open', [], Settings.LogFile);
+fprintf('Trial log: %s \n', Settings.LogFile);
 Data = struct([]); 
 % Data(L).AnalogForces = [];
 Data(L).Frame = [];
@@ -69,6 +107,14 @@ Data(L).Time = [];
 Data(L).Speed = [];
 Data(L).Fp = [];
 Data(L).MeanPeakFp = [];
+Data(L).Gap = [];
+Data(L).Interp = [];
+Data(L).FrameTime = [];
+Data(L).CmdTime = [];
+Data(L).BodyPos = [];
+Data(L).BodyVel = [];
+Data(L).MarkerPos = [];
+Data(L).CoPy = [];
 
 StopFig = figure(1); % create stop button
 uicontrol(StopFig, 'Style', 'PushButton', 'String', 'Exit Figure to Stop', ...
@@ -77,31 +123,102 @@ uicontrol(StopFig, 'Style', 'PushButton', 'String', 'Exit Figure to Stop', ...
 FeedbackFig = figure(2);
 set(FeedbackFig, 'Position',[1000 100 800 550]); % create biofeedback figure
 
+% per-step gait events; Fp feedback redraws once per completed stance
+% and the stance force curves are averaged as they complete
+Loop.Steps.MaxLog = 100; % older stances are in the trial log
+Phases = 0;
+if isfield(Settings, 'EnsemblePhases') % phase start times (s)
+    Phases = Settings.EnsemblePhases;
+end
+Ens = StanceEnsemble('Init', [], 101, Phases);
+if strcmp(Settings.Biofeedback, 'Fp')
+    Loop.Steps = StepEvents('Subscribe', Loop.Steps, 'Stance', ...
+        @(Event, Steps) DrawFpFeedback(FeedbackFig, Settings, ...
+        Steps.MeanPeakFp, Event.Time, 'Fp Targeting'));
+end
+
 disp('Starting Trial');
 tic; % create timer
-startTime = datevec(now); % create elapsed timer
+Clock = TrialClock('Init', [], Settings.FrameRate); % trial timeline
+
+% queue Cortex commands (e.g. start recording) without waiting on Cortex
+% and carry the controller state on frames relayed to SDK2 clients
+Sky = struct('Command',{}, 'Ticket',{}, 'Code',{});
+if UseEngine
+    CortexRelay('State', StartSpeed, NaN);
+end
+if UseEngine && isfield(Settings, 'SkyStart')
+    Sky(end+1).Command = Settings.SkyStart;
+    Sky(end).Ticket = CortexSky('Sky', Settings.SkyStart, 1000);
+end
+
+% stop the belt from the engine if this loop or the frames stall
+if UseEngine
+    CortexWatchdog('Start', Settings);
+end
+Seq = 0; % latest frame seen in the engine's ring
 
 %% Self Pace Treadmill Controller Loop
 % stops with button click
 while isempty(StopFig) == 0 %ishandle(StopFig)
     drawnow;
+    if UseEngine
+        CortexTrace('Begin', 'Wait');
+        Seq = CortexRing('Wait', Seq, .02); % sleep until the next frame
+        CortexTrace('End', 'Wait', Frame);
+    end
     f = mGetCurrentFrame();
     timer = toc; 
+    if UseEngine && CortexWatchdog('Beat')
+        close(StopFig);
+        disp('Watchdog stopped the treadmill');
+        break
+    end
+    if UseEngine
+        CortexMonitor('Check', timer); % prints analog alerts once a second
+    end
+    
+    %% check frame sequence
+    if f.iFrame ~= Frame && f.iFrame > 0
+        Frame = f.iFrame;
+        [Integ, FrameStatus] = FrameIntegrity(Integ, f);
+    else
+        FrameStatus = 'Old';
+    end
+    NewStance = 0;
     
     %% if new frame of data
-    if f.iFrame>Frame
+    if strcmp(FrameStatus, 'New')
+        
+        % analog forces, less the plates' drifting zero, and CoPs
+        [Loop, Row] = SelfPaceFrame('Convert', Loop, f);
+        
+        %% roll the window: keep the last Keep rows, the log has the rest
+        if k + MaxFillGap + 1 > L
+            Data(1:Keep) = Data(k-Keep+1:k);
+            k = Keep;
+        end
+        
+        %% repair short gaps in the frame sequence
+        if Integ.Gap > 0 && k > 0 && strcmp(Settings.FillGaps, 'Yes') ...
+                && Integ.Gap <= MaxFillGap
+            Data(k+1:k+Integ.Gap) = FillFrameGap(Data(k), Row, Integ.Gap, ...
+                Settings.FrameRate, Loop.Contact);
+            for i = k+1:k+Integ.Gap
+                Log = TrialLog('Row', Log, Data(i));
+            end
+            k = k + Integ.Gap;
+            Integ.Filled = Integ.Filled + Integ.Gap;
+        end
         k=k+1;
-        Frame = f.iFrame;
         
-        % extract analog forces
-        F1Y = f.AnalogData.AnalogSamples(4,:);
-        F1y = LoadScale('Fy', bits2volts(F1Y));
-        F1Z = f.AnalogData.AnalogSamples(5,:);
-        F1z = LoadScale('Fz', bits2volts(F1Z));
-        F2Y = f.AnalogData.AnalogSamples(11,:);
-        F2y = LoadScale('Fy', bits2volts(F2Y));
-        F2Z = f.AnalogData.AnalogSamples(12,:);
-        F2z = LoadScale('Fz', bits2volts(F2Z));
+        % fields set only on some frames; a row reused after the window
+        % rolls would keep its old values
+        Data(k).CmdTime = [];
+        Data(k).MarkerPos = [];
+        
+        % place frame on the trial timeline
+        [Clock, Row.FrameTime] = TrialClock('Frame', Clock, f);
         
         if k == 1
             prevSpeed = StartSpeed;
@@ -109,81 +226,55 @@ while isempty(StopFig) == 0 %ishandle(StopFig)
             prevSpeed = Data(k-1).Speed;
         end
         
+        %% contact, gait events, body position and the new speed
+        [Loop, Row, newSpeed, NewSteps] = SelfPaceFrame('Frame', Loop, Row, f, ...
+            prevSpeed, Integ.Gap);
+        Row.Interp = 0; % flag frames preceded by missing frames (Gap)
+        
         %% Save Treadmill data in structure
         % save force data in structure
         % Data(k).AnalogForces = frameOfData.AnalogData.Forces;
-        Data(k).Frame = f.iFrame;
         % uncomment to save all cortex frame data
         %             Data(k).FrameData = frameOfData;
-        
-        % save converted forces (in N)
-        Data(k).F1Y = F1y;
-        Data(k).F1Z = F1z;
-        Data(k).F2Y = F2y;
-        Data(k).F2Z = F2z;
-        
-        % save CoPs
-        Data(k).CoP1y = mean(f.AnalogData.Forces(3,1:2:end));
-        Data(k).CoP2y = mean(f.AnalogData.Forces(3,2:2:end));
-        Data(k).CoP1x = mean(f.AnalogData.Forces(4,1:2:end));
-        Data(k).CoP2x = mean(f.AnalogData.Forces(4,2:2:end));
-        
-        % save whether time point is swing or stance for left and right
-        Thresh = 25; % threshold for determining if a true vGRF
-        if mean(Data(k).F1Z) > Thresh
-            Data(k).RightOn = 1;
-        else
-            Data(k).RightOn = 0;
-        end
-        if mean(Data(k).F2Z) > Thresh
-            Data(k).LeftOn = 1;
-        else
-            Data(k).LeftOn = 0;
-        end
-        
-        
-        %% if both feet on separate plates, calculate CoP
-        if Data(k).LeftOn && Data(k).RightOn
-            Data(k).CoPy = mean([Data(k).CoP1y Data(k).CoP2y]);
-            RelCoPy = Data(k).CoPy - TreadmillCenter;
-            AbsRelCoPy = abs(RelCoPy);
-            diff = AbsRelCoPy - DeadZone;
-            Sign = sign(RelCoPy); % direction of change
-            
-            if diff > 0 % if outside dead zone, change speed
-                % new speed factor
-                % SpeedChange = Sign .* diff.^Exp;
-                SpeedChange = Sign .* diff .* Linear;
-                
-                % Calculate new speed, real component only
-                newSpeed = real(prevSpeed + SpeedChange);
-                
-            else % if within dead zone, maintain current speed
-                newSpeed = prevSpeed;
-            end
-            
-        else
-            newSpeed = prevSpeed;
+        for Name = fieldnames(Row)'
+            Data(k).(Name{1}) = Row.(Name{1});
         end
         
-        %% Change speed of treadmill
-        % bound new speed by set max & min
-        if newSpeed > MaxBeltSpeed
-            newSpeed = MaxBeltSpeed;
-        elseif newSpeed < MinBeltSpeed
-            newSpeed = MinBeltSpeed;
+        % stances to the trial log and the stance ensemble
+        Stance = NewSteps(strcmp({NewSteps.Type}, 'Stance'));
+        NewStance = ~isempty(Stance);
+        for Event = Stance
+            Ens = StanceEnsemble('Stance', Ens, Loop.Steps, Event.Side);
+            Log = TrialLog('Stance', Log, Loop.Steps.Latest.(Event.Side));
         end
         
         %set new speed
         if newSpeed ~= prevSpeed
-            calllib('treadmill0x2Dremote','TREADMILL_setSpeed',newSpeed,newSpeed,realtimeAccel);
+            [~, SendStart] = TrialClock('Local', Clock);
+            CortexTrace('Begin', 'Send');
+            SendResult = CortexTreadmill('Speed', newSpeed, newSpeed, Ctrl.realtimeAccel);
+            CortexTrace('End', 'Send', Frame);
+            if SendResult == 30
+                % the watchdog stopped the belt after this iteration's
+                % heartbeat; the next one ends the trial
+                newSpeed = 0;
+            else
+                [Clock, Data(k).CmdTime] = TrialClock('Command', Clock, SendStart, newSpeed);
+                
+                % measured send time feeds the predictive controller's latency
+                Loop = SelfPaceFrame('Sent', Loop, Clock.LastSend);
+            end
         end
         Data(k).Speed = newSpeed; % save speed
+        if UseEngine && (newSpeed ~= prevSpeed || NewStance)
+            CortexRelay('State', newSpeed, Loop.Steps.MeanPeakFp);
+        end
+        CortexMetrics('Loop', Frame, newSpeed ~= prevSpeed);
         
         %% Get current time
-        currTime = datevec(now);
-        ElapsedTime = etime(currTime, startTime);
+        [~, ElapsedTime] = TrialClock('Local', Clock);
         Data(k).Time = ElapsedTime; 
+        Log = TrialLog('Row', Log, Data(k));
         
     end
     
@@ -228,46 +319,8 @@ while isempty(StopFig) == 0 %ishandle(StopFig)
     
     
     %% plot FP biofeedback
-    if strcmp(Settings.Biofeedback, 'Fp') && k > 200
-        
-        % find peak propulsive force from previous step
-        [Fp] = FindPrevFp(Data(k-199:k));
-        MeanPeakFp = nanmean([Fp.LyPeak, Fp.RyPeak]);
-        Data(k).Fp = Fp;
-        Data(k).MeanPeakFp = MeanPeakFp;
-        
-        % plot biofeedback
-        set(0,'CurrentFigure',FeedbackFig);
-        x = [0 1 2];
-        y1 = [Settings.TargetFp Settings.TargetFp  Settings.TargetFp];
-        y2 = [MeanPeakFp MeanPeakFp MeanPeakFp];
-        if abs(1 - MeanPeakFp / Settings.TargetFp) > 0.05
-            Color = '-r';
-        else
-            Color = '-g';
-        end
-        plot(x ,y1,'-k',x,y2,Color,'LineWidth',4);
-        
-        % update title based on minutes completed
-        if ElapsedTime < 60
-            TitleStr = 'Fp Targeting';
-        elseif ElapsedTime >= 60 && ElapsedTime < 120
-            TitleStr = 'Fp Targeting - 1 min elapsed';
-        elseif ElapsedTime >= 120 && ElapsedTime < 180
-            TitleStr = 'Fp Targeting - 2 min elapsed';
-        elseif ElapsedTime >= 180 && ElapsedTime < 240
-            TitleStr = 'Fp Targeting - 3 min elapsed';
-        elseif ElapsedTime >= 240
-            TitleStr = 'Fp Targeting - 4 min elapsed';
-        end
-        title(TitleStr);
-        
-        ax = gca; % edit axes
-        ax.XTick = [];
-        ax.YTick = [];
-        Lo = Settings.NormFp * 0.5;
-        Hi = Settings.NormFp * 1.5;
-        ax.YLim = [Lo Hi];
+    % redrawn by the Stance subscriber; update the elapsed time once per step
+    if strcmp(Settings.Biofeedback, 'Fp') && NewStance
         
         % put elapsed time in contolfig
         if ishandle(StopFig)
@@ -318,22 +371,90 @@ while isempty(StopFig) == 0 %ishandle(StopFig)
 end
 
 %% stop treadmill
+if UseEngine
+    CortexWatchdog('Stop');
+    CortexTrace('Stop');
+    CortexMetrics('Stop');
+end
 disp('Stopping Treadmill');
 speed = 0;
-calllib('treadmill0x2Dremote','TREADMILL_initializeUDP',IP.Treadmill,'4000');
-calllib('treadmill0x2Dremote','TREADMILL_setSpeed',speed, speed,.25);
+[~, SendStart] = TrialClock('Local', Clock);
+StopResult = -1;
+if UseEngine
+    StopResult = CortexTreadmill('Speed', speed, speed, .25); % the link if open, else the library
+    Summary.Treadmill = CortexTreadmill('Close'); % unpins MATLAB's thread
+end
+if StopResult ~= 0 % not sent, or no engine: reopen the library's socket, as the watchdog's stop does
+    calllib('treadmill0x2Dremote','TREADMILL_initializeUDP',IP.Treadmill,'4000');
+    calllib('treadmill0x2Dremote','TREADMILL_setSpeed',speed, speed,.25);
+end
+Clock = TrialClock('Command', Clock, SendStart, speed);
+if UseEngine
+    CortexRelay('State', speed, Loop.Steps.MeanPeakFp);
+end
+if UseEngine && isfield(Settings, 'SkyStop')
+    Sky(end+1).Command = Settings.SkyStop;
+    Sky(end).Ticket = CortexSky('Sky', Settings.SkyStop, 1000);
+end
 close all;
 
-% remove 1st row if empty
-if isempty(Data(1).Frame)
-    Data(1) = []; 
+% the whole trial from the log, or only the rows still in memory
+Log = TrialLog('Close', Log);
+Summary.LogFile = Settings.LogFile;
+if UseEngine && isfield(Settings, 'ExportFile') % .mat, .npz or .npy copy
+    TrialLog('Export', [], Settings.LogFile, Settings.ExportFile);
+end
+if isfield(Settings, 'ReadBack') && strcmp(Settings.ReadBack, 'No')
+    [~, Data] = TrialLog('Columns', [], Data(1:k)); % the same fields as 'Read'
+    Summary.Steps = Loop.Steps.Log; % the last stances
+else
+    [~, Data, Summary.Steps] = TrialLog('Read', [], Settings.LogFile); % every completed stance
 end
 
-% remove empty rows at end
-F = length([Data.Frame]) + 1;
-if length(Data) > F
-    Data(F:end) = []; 
+%% report timeline alignment and frame sequence integrity
+if Loop.UseMarkers
+    Summary.MarkerDropouts = Loop.Mk.Dropouts;
+    Summary.MarkerOffset = Loop.Mk.Offset;
 end
+Summary.Stance = StanceEnsemble('Summary', Ens); % mean stance curves
+Summary.PlateOffset = Loop.Zero.Offset .* Loop.Zero.Scale; % zero drift at the end (N)
+fprintf('Plate zero drift: F1Y %.1f, F1Z %.1f, F2Y %.1f, F2Z %.1f N \n', ...
+    Summary.PlateOffset);
 
+% outcome of queued Cortex commands, off the control path now
+for i = 1:length(Sky)
+    [Done, Sky(i).Code] = CortexSky('Wait', Sky(i).Ticket, 2000);
+    if Done ~= 1 || Sky(i).Code ~= 0
+        fprintf('Cortex command %s did not complete \n', Sky(i).Command);
+    end
+end
+Summary.Sky = Sky;
+if UseEngine
+    Summary.Relay = CortexRelay('Stats');
+    Summary.Watchdog = CortexWatchdog('Status');
+    Summary.Signal = CortexMonitor('Summary');
+    if ~isempty(Summary.Treadmill)
+        fprintf('Treadmill link: %d commands, %d not sent, %d reconnects, send %.0f us mean, %.0f us max \n', ...
+            Summary.Treadmill.Commands, Summary.Treadmill.SendErrors + Summary.Treadmill.NotConnected, ...
+            Summary.Treadmill.Reconnects, Summary.Treadmill.MeanMicros, Summary.Treadmill.MaxMicros);
+    end
+    if isfield(Settings, 'TraceFile')
+        [Summary.TraceSpans, Summary.TraceDropped] = CortexTrace('Write', Settings.TraceFile);
+    end
+    if ~isempty(Summary.Watchdog) && ~isempty(Summary.Watchdog.Reason)
+        fprintf('Watchdog: %s for %.0f ms at %.1f s \n', Summary.Watchdog.Reason, ...
+            1000 * Summary.Watchdog.Gap, Summary.Watchdog.Time);
+    end
+end
+Summary.Clock = TrialClock('Summary', Clock);
+fprintf('Cortex clock drift: %.1f ppm, %d treadmill commands stamped \n', ...
+    Summary.Clock.DriftPPM, Summary.Clock.nCommands);
+Summary.Integrity = FrameIntegrity(Integ);
+fprintf('Frames: %d received, %d dropped (%.2f%%), %d duplicate, %d reordered (%d late), %d filled \n', ...
+    Summary.Integrity.Received, Summary.Integrity.Drops, ...
+    100 * Summary.Integrity.DropRate, Summary.Integrity.Duplicates, ...
+    Summary.Integrity.Reorders, Summary.Integrity.Late, Summary.Integrity.Filled);
+fprintf('Frame delay: mean %.1f ms, max %.1f ms \n', ...
+    1000 * Summary.Integrity.DelayMean, 1000 * Summary.Integrity.DelayMax);
 
 end
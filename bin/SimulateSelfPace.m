@@ -0,0 +1,225 @@
+function [Sim] = SimulateSelfPace(Settings)
+% Offline walker-plus-treadmill simulation of the self-pace controller
+% Runs SelfPaceTM's frame path (FrameIntegrity, TrialClock and
+% SelfPaceFrame: force conversion with PlateZero, ContactDetect,
+% StepEvents, MarkerPosition, SelfPaceController) against WalkerModel,
+% CortexHostModel and TreadmillModel on a virtual clock: no hardware, no
+% waiting, and the same result for the same Settings every time
+%
+% Settings uses the same fields as SelfPaceTM (Duration, FrameRate,
+% StartSpeed, PositionEstimate, Controller, Ctrl) plus optional
+%   Settings.Walker       - WalkerModel parameter overrides
+%   Settings.Host         - CortexHostModel parameter overrides (Delay,
+%                           Jitter, DropRate, BurstLength, Drift,
+%                           MarkerNoise, MarkerDropRate)
+%   Settings.PlantLatency - true command latency of the treadmill (s)
+%   Settings.LoopTime     - control loop time per frame (s, default 2 ms)
+%   Settings.SendTime     - TREADMILL_setSpeed call time (s, default 2 ms)
+%   Settings.SettleBand   - belt speed band around the preferred speed
+%                           counted as settled (m/s, default 0.1)
+%   Settings.Seed         - random seed (default 0); the simulation draws
+%                           from a stream of its own, not the global one
+% Sim holds the frame-by-frame traces and summary metrics
+%
+% Virtual time: frame k is captured at k/FrameRate and reaches the loop
+% after the host's delay; the loop starts on it when it is free, and
+% skips a frame a newer one has replaced by then, as mGetCurrentFrame
+% does. Commands act PlantLatency after they are sent.
+
+%% set up plant, host and controller
+Seed = 0;
+if isfield(Settings, 'Seed')
+    Seed = Settings.Seed;
+end
+Rand = RandStream('mt19937ar', 'Seed', Seed);
+PlantLatency = 0.2;
+if isfield(Settings, 'PlantLatency')
+    PlantLatency = Settings.PlantLatency;
+end
+LoopTime = 0.002;
+if isfield(Settings, 'LoopTime')
+    LoopTime = Settings.LoopTime;
+end
+SendTime = 0.002;
+if isfield(Settings, 'SendTime')
+    SendTime = Settings.SendTime;
+end
+SettleBand = 0.1;
+if isfield(Settings, 'SettleBand')
+    SettleBand = Settings.SettleBand;
+end
+W = struct('Rand', Rand);
+if isfield(Settings, 'Walker')
+    W.Params = Settings.Walker;
+end
+Host = CortexHostModel('Init', [], Settings.FrameRate, Rand);
+if isfield(Settings, 'Host')
+    Fields = fieldnames(Settings.Host);
+    for i = 1:length(Fields)
+        Host.Params.(Fields{i}) = Settings.Host.(Fields{i});
+    end
+end
+
+% everything the loop carries from frame to frame: SelfPaceTM's frame
+% path, with the host's pelvis markers
+[~, BodyDefs] = CortexHostModel('BodyDefs', Host);
+Loop = SelfPaceFrame('Init', Settings, @() BodyDefs);
+Ctrl = Loop.Ctrl;
+Loop.Integ = [];
+Loop.Clock = TrialClock('Init', [], Settings.FrameRate, 'Virtual');
+Loop.Speed = Settings.StartSpeed; % last commanded
+Loop.Free = 0; % virtual time the loop is done with its last frame
+Loop.LoopTime = LoopTime;
+Loop.SendTime = SendTime;
+Loop.nCommands = 0;
+Loop.nSkipped = 0;
+
+TM = TreadmillModel('Init', [], Settings.StartSpeed, PlantLatency);
+dt = 1 / Settings.FrameRate;
+N = round(Settings.Duration * Settings.FrameRate);
+
+Sim.Time = (1:N) .* dt;
+Sim.Pos = NaN(1, N); % true body position on treadmill
+Sim.Estimate = NaN(1, N); % controller position estimate
+Sim.Walker = NaN(1, N); % walker speed over ground
+Sim.Preferred = NaN(1, N); % walker's scheduled speed
+Sim.Belt = NaN(1, N); % actual belt speed
+Sim.Speed = NaN(1, N); % commanded speed
+Sim.TrueFp = NaN(1, N); % walker's noise-free peak propulsive force
+Sim.Latency = NaN(1, N); % capture to end of loop, frames processed
+
+%% run trial
+Held = []; % frame that arrived and waits for the loop
+for k = 1:N
+    % the walker and the belt move over ((k-1)dt, k dt]
+    [W, Meas] = WalkerModel(W, TM.Speed, dt);
+    TM = TreadmillModel('Step', TM, dt);
+    T = k * dt;
+    [Host, f, Arrival] = CortexHostModel('Frame', Host, Meas, T);
+
+    % the loop takes the held frame unless this one replaces it first
+    if ~isempty(Held)
+        Start = max(Loop.Free, Held.Arrival);
+        if isempty(f) || Start <= Arrival
+            [Loop, TM] = LoopFrame(Loop, TM, Held, Start, T);
+            Sim.Latency(Held.k) = Loop.Free - Held.Capture;
+        else
+            Loop.nSkipped = Loop.nSkipped + 1;
+        end
+        Held = [];
+    end
+    if ~isempty(f)
+        Held = struct('f', f, 'Arrival', Arrival, 'Capture', T, 'k', k);
+    end
+
+    Sched = W.Params.Schedule;
+    Sim.Pos(k) = W.Pos;
+    Sim.Estimate(k) = Loop.Ctl.Pos;
+    Sim.Walker(k) = W.Speed;
+    Sim.Preferred(k) = Sched(find(Sched(:,1) <= W.Time, 1, 'last'), 2);
+    Sim.Belt(k) = TM.Speed;
+    Sim.Speed(k) = Loop.Speed;
+    Sim.TrueFp(k) = W.PeakFp;
+end
+
+%% summary metrics
+Outside = max(0, abs(Sim.Pos - Ctrl.TreadmillCenter) - Ctrl.DeadZone);
+Sim.PosRMS = sqrt(mean((Sim.Pos - Ctrl.TreadmillCenter).^2));
+Sim.MaxExcursion = max(abs(Sim.Pos - Ctrl.TreadmillCenter));
+Sim.TimeOutside = mean(Outside > 0);
+Sim.SpeedRMS = sqrt(mean((Sim.Belt - Sim.Walker).^2));
+Sim.MaxAccel = max(abs(diff(Sim.Belt))) / dt;
+% belt speed reversals per minute (overshoot and oscillation)
+dv = diff(Sim.Belt);
+dv = sign(dv(abs(dv) > 1e-6));
+Sim.Reversals = sum(diff(dv) ~= 0) / (Settings.Duration / 60);
+Sim.CommandRate = Loop.nCommands / Settings.Duration;
+Sim.Skipped = Loop.nSkipped;
+Sim.Integrity = FrameIntegrity(Loop.Integ);
+Sim.LatencyMean = mean(Sim.Latency(~isnan(Sim.Latency)));
+
+% settling after the start and after each change of preferred speed:
+% time until the belt stays within SettleBand of the new speed, and how
+% far it overshoots it; SegmentTime is how long each speed was held,
+% the least an unsettled change took
+Changes = [1, find(diff(Sim.Preferred) ~= 0) + 1];
+Sim.Settle = NaN(size(Changes));
+Sim.SegmentTime = NaN(size(Changes));
+Sim.Overshoots = zeros(size(Changes));
+for i = 1:length(Changes)
+    a = Changes(i);
+    b = N;
+    if i < length(Changes)
+        b = Changes(i+1) - 1;
+    end
+    Sim.SegmentTime(i) = (b - a + 1) * dt;
+    Target = Sim.Preferred(a);
+    Before = Settings.StartSpeed;
+    if a > 1
+        Before = Sim.Preferred(a - 1);
+    end
+    Out = find(abs(Sim.Belt(a:b) - Target) > SettleBand, 1, 'last');
+    if isempty(Out)
+        Sim.Settle(i) = 0;
+    elseif Out < b - a + 1
+        Sim.Settle(i) = Out * dt;
+    end
+    Step = sign(Target - Before);
+    if Step ~= 0
+        Sim.Overshoots(i) = max(0, max(Step .* (Sim.Belt(a:b) - Target)));
+    end
+end
+Sim.SettlingTime = mean(Sim.Settle); % NaN if any segment never settled
+Sim.Overshoot = max(Sim.Overshoots);
+
+% Fp the gait events measured against the walker's true Fp
+Log = Loop.Steps.Log;
+Sim.FpError = NaN;
+Sim.FpBias = NaN;
+if ~isempty(Log)
+    Err = [Log.Fp] - Sim.TrueFp([Log.Frame]);
+    Sim.FpError = sqrt(mean(Err.^2));
+    Sim.FpBias = mean(Err);
+end
+Sim.Steps = Log;
+if Loop.UseMarkers
+    Sim.MarkerDropouts = Loop.Mk.Dropouts;
+    Sim.MarkerOffset = Loop.Mk.Offset;
+end
+Sim.Clock = TrialClock('Summary', Loop.Clock);
+Sim.PlateOffset = Loop.Zero.Offset .* Loop.Zero.Scale; % zero drift removed (N)
+
+end
+
+function [Loop, TM] = LoopFrame(Loop, TM, Held, Start, T)
+% one pass of SelfPaceTM's loop over a new frame, starting at virtual
+% time Start; T is the plant's time
+
+f = Held.f;
+Loop.Clock = TrialClock('Advance', Loop.Clock, Start);
+[Loop.Integ, Status] = FrameIntegrity(Loop.Integ, f);
+if ~strcmp(Status, 'New')
+    return
+end
+
+% the frame path of SelfPaceTM
+[Loop, Row] = SelfPaceFrame('Convert', Loop, f);
+[Loop.Clock, Row.FrameTime] = TrialClock('Frame', Loop.Clock, f);
+prevSpeed = Loop.Speed;
+[Loop, ~, newSpeed] = SelfPaceFrame('Frame', Loop, Row, f, prevSpeed, ...
+    Loop.Integ.Gap);
+Loop.Free = Start + Loop.LoopTime;
+if newSpeed ~= prevSpeed
+    SendStart = Loop.Free;
+    Loop.Free = Loop.Free + Loop.SendTime;
+    Loop.Clock = TrialClock('Advance', Loop.Clock, Loop.Free);
+    Loop.Clock = TrialClock('Command', Loop.Clock, SendStart, newSpeed);
+    Loop = SelfPaceFrame('Sent', Loop, Loop.Clock.LastSend);
+    % the plant is at T; the command acts PlantLatency after it was sent
+    TM = TreadmillModel('Command', TM, newSpeed, Loop.Ctrl.realtimeAccel, ...
+        max(0, TM.Latency + Loop.Free - T));
+    Loop.nCommands = Loop.nCommands + 1;
+    Loop.Speed = newSpeed;
+end
+
+end
@@ -0,0 +1,103 @@
+function [Ens, Mean, Std] = StanceEnsemble(Action, Ens, varargin)
+% Running ensemble of time-normalized stance force curves, per side and
+% trial phase, updated at each completed stance in constant memory
+% The stance curves come from StepEvents started with stance samples kept
+%
+% Ens = StanceEnsemble('Init', [], nPoints, PhaseStarts)
+%   nPoints points from 0 to 100% of stance (default 101); PhaseStarts
+%   are the trial times (s) at which phases begin (default 0: one phase)
+% Ens = StanceEnsemble('Stance', Ens, Steps, Side)
+%   add the stance of Side ('R' or 'L') StepEvents just completed; the
+%   phase is that of its StartTime. Truncated stances are left out
+% [~, Mean, Std] = StanceEnsemble('Mean', Ens, Side, Signal, Phase)
+%   current mean and standard deviation curve of Side ('R' or 'L'),
+%   Signal ('Fy' or 'Fz') and Phase (default the latest phase with data)
+% Ens = StanceEnsemble('Summary', Ens)
+%   add the Std arrays for the trial summary
+%
+% Ens.Mean.Fy and Ens.Mean.Fz are nPoints x 2 (R, L) x nPhases and
+% Ens.n(side, phase) counts the stances averaged
+
+Mean = [];
+Std = [];
+switch Action
+
+    case 'Init'
+        nPoints = 101;
+        if ~isempty(varargin) && ~isempty(varargin{1})
+            nPoints = varargin{1};
+        end
+        PhaseStarts = 0;
+        if length(varargin) > 1 && ~isempty(varargin{2})
+            PhaseStarts = varargin{2};
+        end
+        nPhases = length(PhaseStarts);
+        Ens = struct();
+        Ens.Percent = linspace(0, 100, nPoints)';
+        Ens.PhaseStarts = PhaseStarts(:)';
+        Ens.n = zeros(2, nPhases);
+        Ens.Skipped = 0;
+        % Welford running mean and sum of squared deviations
+        Ens.Mean.Fy = zeros(nPoints, 2, nPhases);
+        Ens.Mean.Fz = zeros(nPoints, 2, nPhases);
+        Ens.M2.Fy = zeros(nPoints, 2, nPhases);
+        Ens.M2.Fz = zeros(nPoints, 2, nPhases);
+
+    case 'Stance'
+        Steps = varargin{1};
+        Side = varargin{2};
+        Curve = Steps.Curves.(Side);
+        m = length(Curve.Fy);
+        if Curve.Truncated || m < 3
+            Ens.Skipped = Ens.Skipped + 1;
+            return
+        end
+        j = 1 + strcmp(Side, 'L');
+        p = find(Ens.PhaseStarts <= Steps.Latest.(Side).StartTime, 1, 'last');
+        if isempty(p)
+            p = 1;
+        end
+
+        % samples span the stance evenly, first to last
+        x = linspace(0, 100, m)';
+        n = Ens.n(j,p) + 1;
+        Ens.n(j,p) = n;
+        Signals = {'Fy','Fz'};
+        for i = 1:2
+            Name = Signals{i};
+            y = interp1(x, Curve.(Name)(:), Ens.Percent);
+            d = y - Ens.Mean.(Name)(:,j,p);
+            Ens.Mean.(Name)(:,j,p) = Ens.Mean.(Name)(:,j,p) + d ./ n;
+            Ens.M2.(Name)(:,j,p) = Ens.M2.(Name)(:,j,p) ...
+                + d .* (y - Ens.Mean.(Name)(:,j,p));
+        end
+
+    case 'Mean'
+        j = 1 + strcmp(varargin{1}, 'L');
+        Name = varargin{2};
+        if length(varargin) > 2
+            p = varargin{3};
+        else
+            p = find(Ens.n(j,:) > 0, 1, 'last');
+        end
+        if isempty(p) || Ens.n(j,p) == 0
+            Mean = NaN(size(Ens.Percent));
+            Std = Mean;
+            return
+        end
+        Mean = Ens.Mean.(Name)(:,j,p);
+        Std = sqrt(Ens.M2.(Name)(:,j,p) ./ max(Ens.n(j,p) - 1, 1));
+
+    case 'Summary'
+        Count = reshape(max(Ens.n - 1, 1), 1, 2, []);
+        Ens.Std.Fy = sqrt(Ens.M2.Fy ./ Count);
+        Ens.Std.Fz = sqrt(Ens.M2.Fz ./ Count);
+        Empty = Ens.n(:)' == 0; % columns of the (side, phase) pages
+        Ens.Mean.Fy(:, Empty) = NaN;
+        Ens.Mean.Fz(:, Empty) = NaN;
+        Ens.Std.Fy(:, Empty) = NaN;
+        Ens.Std.Fz(:, Empty) = NaN;
+
+end
+
+end
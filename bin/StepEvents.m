@@ -0,0 +1,200 @@
+function [Ch, Events] = StepEvents(Action, Ch, varargin)
+% Per-step gait event channel with typed subscribers
+% Detects heel strike and toe-off on each plate from the stance flags and
+% publishes them, plus a completed stance summary at each toe-off, to
+% every subscriber of that event type. Work per frame is a running peak;
+% subscribers only run when a step event happens.
+%
+% Ch = StepEvents('Init')
+% Ch = StepEvents('Init', MaxFrames)
+%   also keep the force samples of each stance, up to MaxFrames frames of
+%   them per side in buffers allocated once, for StanceEnsemble
+% Ch = StepEvents('Subscribe', Ch, Type, Handler)
+%   Type is 'HeelStrike', 'ToeOff', 'Stance' or 'All'
+%   Handler is called as Handler(Event, Ch)
+% [Ch, Events] = StepEvents('Frame', Ch, Row, Time)
+%   Row is a row of the trial data (F1Y, F1Z, F2Y, F2Z, RightOn, LeftOn,
+%   Frame) and Time its timeline time; Events holds the events published
+% [Ch, Events] = StepEvents('Frame', Ch, Row, Time, Contact)
+%   stance from ContactDetect run on the frame (plates 1 and 2) instead of
+%   the frame's flags: events at the sub-sample crossing times, peaks and
+%   stance samples from the samples in contact only
+%
+% Event fields: Type, Side ('R' or 'L'), Frame, Time, and for 'Stance'
+% also Fp (peak propulsive force, N), Fz (peak vertical force, N),
+% StanceTime (s), StartFrame and StartTime; with stance samples kept,
+% Ch.Curves.R / Ch.Curves.L hold the Fy and Fz samples of that stance
+% and whether they were Truncated
+% Ch.Latest.R / Ch.Latest.L hold the last stance event of each side and
+% Ch.MeanPeakFp the mean of their Fp; Ch.Log holds every stance event,
+% or the last Ch.MaxLog of them if that is set finite
+
+Events = struct('Type',{}, 'Side',{}, 'Frame',{}, 'Time',{});
+switch Action
+
+    case 'Init'
+        Ch = struct();
+        Ch.nFrames = 0;
+        Ch.Subscribers = struct('Type',{}, 'Handler',{});
+        Ch.Sides = {'R','L'};
+        Ch.Plates = {'1','2'};
+        Ch.On = [0 0];
+        Ch.Start = [NaN NaN; NaN NaN]; % [frame, time] of heel strike
+        Ch.PeakFp = [-Inf -Inf];
+        Ch.PeakFz = [-Inf -Inf];
+        Ch.Latest.R = [];
+        Ch.Latest.L = [];
+        Ch.MeanPeakFp = NaN;
+        Ch.MaxFrames = 0;
+        if ~isempty(varargin)
+            Ch.MaxFrames = varargin{1};
+        end
+        Ch.Curve.Y = []; % [side, sample], sized at the first frame
+        Ch.Curve.Z = [];
+        Ch.Curve.n = [0 0];
+        Ch.Curve.Truncated = [false false];
+        Ch.Curves.R = [];
+        Ch.Curves.L = [];
+        Ch.Log = struct('Type',{}, 'Side',{}, 'Frame',{}, 'Time',{}, ...
+            'Fp',{}, 'Fz',{}, 'StanceTime',{}, 'StartFrame',{}, 'StartTime',{});
+        Ch.MaxLog = Inf;
+
+    case 'Subscribe'
+        Ch.Subscribers(end+1) = struct('Type',varargin{1}, 'Handler',varargin{2});
+
+    case 'Frame'
+        Row = varargin{1};
+        Time = varargin{2};
+        Contact = [];
+        if length(varargin) > 2
+            Contact = varargin{3};
+        end
+        if isempty(Contact)
+            On = [Row.RightOn, Row.LeftOn];
+        else
+            On = Contact.On(1:2)';
+        end
+        if Ch.nFrames == 0
+            Ch.On = On; % no events for feet already down at the start
+        end
+        Ch.nFrames = Ch.nFrames + 1;
+        for j = 1:2
+            Fy = Row.(['F' Ch.Plates{j} 'Y']);
+            Fz = Row.(['F' Ch.Plates{j} 'Z']);
+            nSamples = length(Fz);
+            % samples in stance and the times of this frame's events
+            if isempty(Contact)
+                InStance = On(j);
+                Strike = Time;
+                Off = Time;
+            else
+                InStance = Contact.Mask(j,:);
+                Strike = Contact.Strike(j);
+                Off = Contact.Off(j);
+                if isnan(Strike); Strike = Time; end
+                if isnan(Off); Off = Time; end
+            end
+
+            if On(j) && ~Ch.On(j)
+                % heel strike, start a new stance
+                Ch.Start(j,:) = [Row.Frame, Strike];
+                Ch.PeakFp(j) = -Inf;
+                Ch.PeakFz(j) = -Inf;
+                Ch.Curve.n(j) = 0;
+                Ch.Curve.Truncated(j) = false;
+                Events(end+1) = struct('Type','HeelStrike', ...
+                    'Side',Ch.Sides{j}, 'Frame',Row.Frame, 'Time',Strike); %#ok<AGROW>
+            end
+
+            % running peaks over the stance
+            if any(InStance)
+                if ~isscalar(InStance)
+                    Fy = Fy(InStance);
+                    Fz = Fz(InStance);
+                end
+                Ch.PeakFp(j) = max(Ch.PeakFp(j), max(-Fy));
+                Ch.PeakFz(j) = max(Ch.PeakFz(j), max(Fz));
+                if Ch.MaxFrames > 0
+                    Ch.Curve = AppendSamples(Ch.Curve, j, Fy, Fz, ...
+                        Ch.MaxFrames * nSamples);
+                end
+            end
+
+            if ~On(j) && Ch.On(j)
+                % toe-off, close the stance if its start was seen
+                Events(end+1) = struct('Type','ToeOff', ...
+                    'Side',Ch.Sides{j}, 'Frame',Row.Frame, 'Time',Off); %#ok<AGROW>
+                if ~isnan(Ch.Start(j,1))
+                    Stance = struct('Type','Stance', 'Side',Ch.Sides{j}, ...
+                        'Frame',Row.Frame, 'Time',Off, ...
+                        'Fp',Ch.PeakFp(j), 'Fz',Ch.PeakFz(j), ...
+                        'StanceTime',Off - Ch.Start(j,2), ...
+                        'StartFrame',Ch.Start(j,1), 'StartTime',Ch.Start(j,2));
+                    Ch.Latest.(Ch.Sides{j}) = Stance;
+                    Ch.Log(end+1) = Stance;
+                    if length(Ch.Log) > Ch.MaxLog
+                        Ch.Log(1) = [];
+                    end
+                    if Ch.MaxFrames > 0
+                        n = Ch.Curve.n(j);
+                        Ch.Curves.(Ch.Sides{j}) = struct('Fy',Ch.Curve.Y(j,1:n), ...
+                            'Fz',Ch.Curve.Z(j,1:n), 'Truncated',Ch.Curve.Truncated(j));
+                    end
+                    Events(end+1).Type = 'Stance'; %#ok<AGROW>
+                    Events(end).Side = Ch.Sides{j};
+                    Events(end).Frame = Row.Frame;
+                    Events(end).Time = Off;
+                end
+            end
+        end
+        Ch.On = On;
+
+        if isempty(Events)
+            return
+        end
+
+        % mean of the latest peak propulsive force on each side
+        Fp = NaN(1,2);
+        if ~isempty(Ch.Latest.R); Fp(1) = Ch.Latest.R.Fp; end
+        if ~isempty(Ch.Latest.L); Fp(2) = Ch.Latest.L.Fp; end
+        if any(~isnan(Fp))
+            Ch.MeanPeakFp = mean(Fp(~isnan(Fp)));
+        end
+
+        % publish to subscribers
+        for i = 1:length(Events)
+            Event = Events(i);
+            if strcmp(Event.Type, 'Stance')
+                Event = Ch.Latest.(Event.Side);
+            end
+            for s = 1:length(Ch.Subscribers)
+                Type = Ch.Subscribers(s).Type;
+                if strcmp(Type, 'All') || strcmp(Type, Event.Type)
+                    Handler = Ch.Subscribers(s).Handler;
+                    Handler(Event, Ch);
+                end
+            end
+        end
+
+end
+
+end
+
+function [Curve] = AppendSamples(Curve, j, Fy, Fz, Size)
+% add a frame's samples to side j's stance buffer of Size samples,
+% dropping what does not fit
+n = length(Fy);
+if isempty(Curve.Y)
+    Curve.Y = zeros(2, Size);
+    Curve.Z = zeros(2, Size);
+end
+i = Curve.n(j);
+m = min(n, size(Curve.Y, 2) - i);
+if m < n
+    Curve.Truncated(j) = true;
+end
+Curve.Y(j, i+1:i+m) = Fy(1:m);
+Curve.Z(j, i+1:i+m) = Fz(1:m);
+Curve.n(j) = i + m;
+
+end
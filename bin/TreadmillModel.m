@@ -0,0 +1,49 @@
+function [TM] = TreadmillModel(Action, TM, varargin)
+% Belt dynamics of the treadmill under TREADMILL_setSpeed commands
+% A command takes effect Latency seconds after it is sent, then the belt
+% ramps toward the commanded speed at the commanded acceleration
+%
+% TM = TreadmillModel('Init', [], Speed, Latency)
+% TM = TreadmillModel('Command', TM, Speed, Accel)
+% TM = TreadmillModel('Command', TM, Speed, Accel, Latency)
+% TM = TreadmillModel('Step', TM, dt)
+
+switch Action
+
+    case 'Init'
+        TM.Speed = varargin{1}; % belt speed (m/s)
+        TM.Latency = varargin{2}; % command latency (s)
+        TM.Target = TM.Speed; % speed the belt is ramping toward
+        TM.Accel = 0.25; % ramp acceleration (m/s^2)
+        TM.Queue = zeros(0, 3); % pending [time to effect, speed, accel]
+
+    case 'Command'
+        Latency = TM.Latency;
+        if length(varargin) > 2
+            Latency = varargin{3};
+        end
+        TM.Queue(end+1,:) = [Latency, varargin{1}, varargin{2}];
+
+    case 'Step'
+        dt = varargin{1};
+
+        % apply commands that have landed
+        if ~isempty(TM.Queue)
+            TM.Queue(:,1) = TM.Queue(:,1) - dt;
+            Landed = TM.Queue(:,1) <= 0;
+            if any(Landed)
+                Last = find(Landed, 1, 'last');
+                TM.Target = TM.Queue(Last, 2);
+                TM.Accel = TM.Queue(Last, 3);
+                TM.Queue(Landed,:) = [];
+            end
+        end
+
+        % ramp belt toward target
+        dv = TM.Target - TM.Speed;
+        MaxStep = TM.Accel * dt;
+        TM.Speed = TM.Speed + sign(dv) * min(abs(dv), MaxStep);
+
+end
+
+end
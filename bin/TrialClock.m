@@ -0,0 +1,145 @@
+function [Clock, t] = TrialClock(Action, Clock, varargin)
+% Single monotonic trial timeline for Cortex frames, analog samples and
+% treadmill commands
+%
+% Clock = TrialClock('Init', [], FrameRate)
+%   start the local clock; the timeline is zero at the first Cortex frame
+% Clock = TrialClock('Init', [], FrameRate, 'Virtual')
+%   a local clock that only moves with 'Advance', for simulated trials
+% Clock = TrialClock('Advance', Clock, Local)
+%   set the virtual local time (s since 'Init')
+% [Clock, t] = TrialClock('Frame', Clock, f)
+%   timeline time of frame f from its iFrame, and update the estimate of
+%   local clock offset and drift from its arrival time and fDelay
+% [Clock, t] = TrialClock('Command', Clock, SendStart, Speed)
+%   stamp a treadmill command that left the host between SendStart (from
+%   TrialClock('Local')) and now; Clock.LastSend is its send duration and
+%   the fixed ring Clock.Commands keeps the latest 256 (the trial data
+%   log has every command's time and speed, as CmdTime and Speed)
+% [~, t] = TrialClock('Sample', Clock, iFrame, iSample, nSamples)
+%   timeline time of analog sample iSample of nSamples in frame iFrame
+% [~, t] = TrialClock('Local', Clock)
+%   local monotonic time in seconds since 'Init'
+% [~, t] = TrialClock('Map', Clock, Local)
+%   map a local time onto the timeline
+% Clock = TrialClock('Summary', Clock)
+%   the ring's commands, oldest first, and the fitted offset and drift
+
+Forget = 0.999; % exponential forgetting of the clock fit (~10 s at 100 Hz)
+MinFit = 20; % frames needed before the drift estimate is used
+
+t = [];
+switch Action
+
+    %% start local clock
+    case 'Init'
+        Clock.FrameRate = varargin{1};
+        Clock.Tic = tic;
+        Clock.Virtual = length(varargin) > 1 && strcmp(varargin{2}, 'Virtual');
+        Clock.Now = 0; % virtual local time
+        Clock.FirstFrame = [];
+        Clock.TimeCode = [];
+        % exponentially weighted sums for local = Offset + Rate * timeline
+        Clock.S = zeros(1,5); % [n, sum t, sum t^2, sum y, sum t*y]
+        Clock.nFit = 0;
+        Clock.Offset = NaN;
+        Clock.Rate = 1;
+        Clock.ResidualVar = 0;
+        Clock.Commands = NaN(256, 3); % ring of [timeline, send duration, speed]
+        Clock.nCommands = 0; % stamped in the trial
+        Clock.LastSend = NaN;
+
+    %% move the virtual clock
+    case 'Advance'
+        Clock.Now = varargin{1};
+
+    %% timeline time of a frame
+    case 'Frame'
+        f = varargin{1};
+        Local = LocalTime(Clock);
+        if isempty(Clock.FirstFrame)
+            Clock.FirstFrame = double(f.iFrame);
+            if isfield(f, 'TimeCode')
+                Clock.TimeCode = f.TimeCode; % for system-wide alignment
+            end
+        end
+        t = (double(f.iFrame) - Clock.FirstFrame) / Clock.FrameRate;
+
+        % local time at which the cameras captured this frame
+        y = Local - double(f.fDelay);
+        if isnan(Clock.Offset)
+            Clock.Offset = y;
+        end
+        r = y - (Clock.Offset + Clock.Rate * t);
+        Clock.ResidualVar = Forget * Clock.ResidualVar + (1 - Forget) * r^2;
+
+        % recursive weighted least squares fit of offset and drift
+        Clock.S = Forget .* Clock.S + [1, t, t^2, y, t*y];
+        Clock.nFit = Clock.nFit + 1;
+        n = Clock.S(1); St = Clock.S(2); Stt = Clock.S(3);
+        Sy = Clock.S(4); Sty = Clock.S(5);
+        Den = n * Stt - St^2;
+        if Clock.nFit >= MinFit && Den > eps
+            Clock.Rate = (n * Sty - St * Sy) / Den;
+        end
+        Clock.Offset = (Sy - Clock.Rate * St) / n;
+
+    %% stamp a treadmill command
+    case 'Command'
+        SendStart = varargin{1};
+        Speed = varargin{2};
+        SendEnd = LocalTime(Clock);
+        [~, t] = TrialClock('Map', Clock, SendEnd);
+
+        Clock.LastSend = SendEnd - SendStart;
+        Clock.nCommands = Clock.nCommands + 1;
+        i = mod(Clock.nCommands - 1, size(Clock.Commands, 1)) + 1;
+        Clock.Commands(i,:) = [t, Clock.LastSend, Speed];
+
+    %% timeline time of an analog sample
+    case 'Sample'
+        % samples are taken to span the frame interval ending at the frame
+        iFrame = double(varargin{1});
+        iSample = varargin{2};
+        nSamples = varargin{3};
+        t = (iFrame - Clock.FirstFrame) / Clock.FrameRate ...
+            - (nSamples - iSample) ./ (nSamples * Clock.FrameRate);
+
+    %% local clock
+    case 'Local'
+        t = LocalTime(Clock);
+
+    %% local time onto timeline
+    case 'Map'
+        Local = varargin{1};
+        if isnan(Clock.Offset)
+            t = NaN;
+        else
+            t = (Local - Clock.Offset) ./ Clock.Rate;
+        end
+
+    %% trial summary
+    case 'Summary'
+        nRing = size(Clock.Commands, 1);
+        if Clock.nCommands > nRing
+            i = mod(Clock.nCommands, nRing);
+            Clock.Commands = Clock.Commands([i+1:nRing, 1:i],:);
+        else
+            Clock.Commands = Clock.Commands(1:Clock.nCommands,:);
+        end
+        Clock.DriftPPM = 1e6 * (Clock.Rate - 1);
+        Clock.ResidualStd = sqrt(Clock.ResidualVar);
+
+end
+
+end
+
+function [t] = LocalTime(Clock)
+% seconds since 'Init', of the virtual clock if there is one
+if Clock.Virtual
+    t = Clock.Now;
+else
+    t = toc(Clock.Tic);
+end
+
+end
@@ -0,0 +1,190 @@
+function [Log, Data, Stances] = TrialLog(Action, Log, varargin)
+% On-disk log of a trial's frame rows and completed stances, written as
+% they complete so the trial scripts need keep only a rolling window in
+% memory, however long the session
+%
+% Log = TrialLog('Open', [], File)
+%   frames go to File, stances to [File '.steps']
+% Log = TrialLog('Row', Log, Row)
+%   append a row of the trial data (Frame, Time, forces, CoPs, ...);
+%   the first row fixes the columns and the samples per frame
+% Log = TrialLog('Stance', Log, Stance)
+%   append a 'Stance' event of StepEvents
+% Log = TrialLog('Close', Log)
+% [~, Data, Stances] = TrialLog('Read', [], File)
+%   the log as columns and the stances as StepEvents' Log, e.g. after a
+%   session too long to return in memory: one field per scalar column,
+%   frames down, and F1Y, F1Z, F2Y and F2Z as frames x samples
+% [~, Data, Stances] = TrialLog('Read', [], File, 'Rows')
+%   the rows as the trial data structure, one element per frame
+% [~, Data] = TrialLog('Columns', [], Rows)
+%   the same columns from rows of the trial data structure still in
+%   memory, as they would have been logged
+% n = TrialLog('Export', [], File, OutFile)
+%   convert the log to a .mat, .npz or .npy file (by OutFile's extension)
+%   in the Cortex engine, in large sequential writes; n is the rows written
+%
+% Rows are doubles: the scalar columns named in the header line, then
+% the samples of F1Y, F1Z, F2Y and F2Z. Empty values are logged as NaN,
+% and 'Read' and 'Columns' give every scalar column, NaN where a trial
+% had no such field, so both carry the same fields.
+% Fp is the peak propulsive force of the stances ending on a row's
+% frame (their mean if both feet leave on it); the side, stance time and
+% peak Fz of each stance are in the .steps file
+
+Data = [];
+Stances = [];
+Scalars = {'Frame','Time','FrameTime','CmdTime','Speed','Fp','MeanPeakFp', ...
+    'CoP1y','CoP2y','CoP1x','CoP2x','CoPy','RightOn','LeftOn','Gap','Interp', ...
+    'BodyPos','BodyVel','MarkerPos'};
+Samples = {'F1Y','F1Z','F2Y','F2Z'};
+StanceFields = {'Frame','Time','Fp','Fz','StanceTime','StartFrame','StartTime'};
+
+switch Action
+
+    case 'Open'
+        File = varargin{1};
+        Log.File = File;
+        Log.StepFile = [File '.steps'];
+        % 'W': no flush after every write
+        Log.Fid = fopen(File, 'W');
+        Log.StepFid = fopen(Log.StepFile, 'W');
+        if Log.Fid < 0 || Log.StepFid < 0
+            error('TrialLog: cannot write %s', File);
+        end
+        Log.Columns = {};
+        Log.nSamples = 0;
+        Log.nRows = 0;
+        Log.nStances = 0;
+
+    case 'Row'
+        Row = varargin{1};
+        if isempty(Log.Columns)
+            Log.Columns = Scalars(isfield(Row, Scalars));
+            Log.nSamples = length(Row.F1Z);
+            fprintf(Log.Fid, 'TrialLog 1 %d %s\n', Log.nSamples, ...
+                strjoin(Log.Columns, ','));
+        end
+        fwrite(Log.Fid, RowVector(Row, Log.Columns, Log.nSamples, Samples), 'double');
+        Log.nRows = Log.nRows + 1;
+
+    case 'Stance'
+        S = varargin{1};
+        x = [1 + strcmp(S.Side, 'L'), cellfun(@(f) S.(f), StanceFields)];
+        fwrite(Log.StepFid, x, 'double');
+        Log.nStances = Log.nStances + 1;
+
+    case 'Close'
+        fclose(Log.Fid);
+        fclose(Log.StepFid);
+        Log.Fid = -1;
+        Log.StepFid = -1;
+
+    case 'Export'
+        if ~libisloaded('CortexEngine')
+            error('TrialLog: export needs the Cortex engine loaded');
+        end
+        Log = calllib('CortexEngine', 'CortexEngine_ExportTrialLog', ...
+            varargin{1}, varargin{2});
+        if Log < 0
+            error('TrialLog: cannot export %s to %s', varargin{1}, varargin{2});
+        end
+
+    case 'Read'
+        File = varargin{1};
+        Fid = fopen(File, 'r');
+        if Fid < 0
+            error('TrialLog: cannot read %s', File);
+        end
+        Header = fgetl(Fid);
+        Data = struct([]);
+        if ischar(Header)
+            Parts = strsplit(strtrim(Header), ' ');
+            n = str2double(Parts{3});
+            Columns = strsplit(Parts{4}, ',');
+            nc = length(Columns);
+            X = fread(Fid, [nc + 4 * n, Inf], 'double')';
+            if length(varargin) > 1 && strcmp(varargin{2}, 'Rows')
+                C = cell(size(X, 1), nc + 4);
+                C(:, 1:nc) = num2cell(X(:, 1:nc));
+                for j = 1:4
+                    C(:, nc + j) = num2cell(X(:, nc + (j-1)*n + (1:n)), 2);
+                end
+                Data = cell2struct(C, [Columns, Samples], 2)';
+            else
+                Data = ColumnData(X, Columns, n, Scalars, Samples);
+            end
+        end
+        fclose(Fid);
+
+        Fid = fopen([File '.steps'], 'r');
+        Stances = struct('Type',{}, 'Side',{}, 'Frame',{}, 'Time',{}, ...
+            'Fp',{}, 'Fz',{}, 'StanceTime',{}, 'StartFrame',{}, 'StartTime',{});
+        if Fid >= 0
+            X = fread(Fid, [1 + length(StanceFields), Inf], 'double')';
+            fclose(Fid);
+            Sides = {'R','L'};
+            for i = 1:size(X, 1)
+                Stances(i).Type = 'Stance';
+                Stances(i).Side = Sides{X(i,1)};
+                for j = 1:length(StanceFields)
+                    Stances(i).(StanceFields{j}) = X(i, 1 + j);
+                end
+            end
+        end
+
+    case 'Columns'
+        Rows = varargin{1};
+        Columns = Scalars(isfield(Rows, Scalars));
+        n = 0;
+        if ~isempty(Rows)
+            n = length(Rows(1).F1Z);
+        end
+        X = NaN(length(Rows), length(Columns) + 4 * n);
+        for i = 1:length(Rows)
+            X(i,:) = RowVector(Rows(i), Columns, n, Samples);
+        end
+        Data = ColumnData(X, Columns, n, Scalars, Samples);
+
+end
+
+end
+
+function [x] = RowVector(Row, Columns, n, Samples)
+% a row of the log: the first value of each scalar column, NaN if empty,
+% then n samples of each force
+x = NaN(1, length(Columns) + 4 * n);
+for i = 1:length(Columns)
+    v = Row.(Columns{i});
+    if ~isempty(v)
+        x(i) = v(1);
+    end
+end
+i = length(Columns);
+for j = 1:4
+    v = Row.(Samples{j});
+    m = min(n, length(v));
+    x(i + (1:m)) = v(1:m);
+    i = i + n;
+end
+
+end
+
+function [Data] = ColumnData(X, Columns, n, Scalars, Samples)
+% log rows X as one field per column, every scalar column of the log
+% format whether or not the trial had it
+nRows = size(X, 1);
+for i = 1:length(Scalars)
+    c = find(strcmp(Columns, Scalars{i}), 1);
+    if isempty(c)
+        Data.(Scalars{i}) = NaN(nRows, 1);
+    else
+        Data.(Scalars{i}) = X(:, c);
+    end
+end
+nc = length(Columns);
+for j = 1:4
+    Data.(Samples{j}) = X(:, nc + (j-1)*n + (1:n));
+end
+
+end
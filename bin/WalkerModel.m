@@ -0,0 +1,108 @@
+function [W, Meas] = WalkerModel(W, Belt, dt)
+% Simulated walker on the split-belt treadmill, one frame
+% W is the walker from the previous frame (start with [] or a struct
+% holding only W.Params to override the defaults below, and optionally
+% W.Rand, the RandStream to draw from instead of the global stream)
+% Belt is the current belt speed (m/s) and dt the frame interval (s)
+% Meas holds the plate signals for the frame: per-sample forces F1Y,
+% F1Z, F2Y, F2Z (N, plate 1 = right) and mean CoPs CoP1y, CoP2y (m);
+% W.PeakFp is the noise-free peak propulsive force at the current speed,
+% and Meas.Pos the body's true position on the treadmill (m, as the
+% CoPs), for the host model's pelvis markers
+%
+% The walker's speed over ground follows a preferred speed schedule with
+% slow random variation and a weak pull back toward the treadmill center.
+% Feet land ahead of the body, are carried back by the belt and roll
+% heel to toe; vertical force is double humped and fore/aft force brakes
+% then propels, scaled with speed.
+
+%% default parameters
+if isempty(W) || ~isfield(W, 'Pos')
+    Params.BodyMass = 80; % kg
+    Params.Schedule = [0 1.2]; % preferred speed schedule [time, m/s]
+    Params.SpeedNoise = 0.03; % std of slow speed variation (m/s)
+    Params.NoiseTime = 5; % time constant of speed variation (s)
+    Params.Centering = 0.05; % pull back toward center (1/s)
+    Params.Center = 0.87; % treadmill center (m)
+    Params.StrideTime = 1.1; % s
+    Params.Duty = 0.62; % stance fraction of stride
+    Params.FootLength = 0.22; % heel to toe CoP travel (m)
+    Params.nSamples = 10; % analog samples per frame
+    Params.CoPNoise = 0.005; % CoP measurement noise (m)
+    Params.ForceNoise = 2; % force measurement noise (N)
+    if isstruct(W) && isfield(W, 'Params')
+        Fields = fieldnames(W.Params);
+        for i = 1:length(Fields)
+            Params.(Fields{i}) = W.Params.(Fields{i});
+        end
+    end
+    Rand = RandStream.getGlobalStream;
+    if isstruct(W) && isfield(W, 'Rand')
+        Rand = W.Rand;
+    end
+    W = struct();
+    W.Params = Params;
+    W.Rand = Rand;
+    W.Time = 0;
+    W.Pos = Params.Center;
+    W.Drift = 0;
+    W.Phase = 0;
+    W.Strike = [Params.Center, Params.Center]; % heel strike positions R, L
+    W.Speed = Params.Schedule(1, 2);
+    W.PeakFp = NaN;
+end
+Params = W.Params;
+g = 9.81;
+
+%% walker speed over ground and position on treadmill
+Sched = Params.Schedule;
+Preferred = Sched(find(Sched(:,1) <= W.Time, 1, 'last'), 2);
+a = dt / Params.NoiseTime;
+W.Drift = (1 - a) * W.Drift + Params.SpeedNoise * sqrt(2 * a) * randn(W.Rand);
+W.Speed = Preferred + W.Drift + Params.Centering * (Params.Center - W.Pos);
+W.Pos = W.Pos + (W.Speed - Belt) * dt;
+
+%% gait phase of each foot at every analog sample
+n = Params.nSamples;
+ts = W.Time + (1:n) .* (dt / n);
+Phase = W.Phase + (1:n) .* (dt / Params.StrideTime);
+StepLength = W.Speed * Params.StrideTime / 2;
+PeakFp = 0.2 * Params.BodyMass * g * (W.Speed / 1.2);
+W.PeakFp = PeakFp;
+Foot = {'1','2'};
+Offsets = [0, 0.5]; % right, then left half a stride later
+for j = 1:2
+    s = mod(Phase + Offsets(j), 1) ./ Params.Duty; % stance progress
+    On = s < 1;
+
+    % new heel strike lands half a step ahead of the body
+    sPrev = mod(W.Phase + Offsets(j), 1) / Params.Duty;
+    if sPrev >= 1 && On(end)
+        W.Strike(j) = W.Pos + StepLength / 2;
+    end
+
+    Fz = zeros(1, n);
+    Fy = zeros(1, n);
+    Fz(On) = 1.15 * Params.BodyMass * g .* ...
+        (sin(pi * s(On)) + 0.25 * sin(3 * pi * s(On)));
+    Fy(On) = PeakFp .* sin(2 * pi * s(On));
+    Meas.(['F' Foot{j} 'Z']) = Fz + Params.ForceNoise * randn(W.Rand, 1, n);
+    Meas.(['F' Foot{j} 'Y']) = Fy + Params.ForceNoise * randn(W.Rand, 1, n);
+
+    % CoP carried back by the belt while rolling heel to toe
+    if any(On)
+        sm = mean(s(On));
+        CoP = W.Strike(j) - Belt * sm * Params.Duty * Params.StrideTime ...
+            + Params.FootLength * sm;
+        Meas.(['CoP' Foot{j} 'y']) = CoP + Params.CoPNoise * randn(W.Rand);
+    else
+        Meas.(['CoP' Foot{j} 'y']) = 0;
+    end
+end
+
+Meas.Pos = W.Pos;
+
+W.Time = ts(end);
+W.Phase = mod(Phase(end), 1);
+
+end